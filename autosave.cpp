@@ -0,0 +1,375 @@
+#include "autosave.h"
+#include "vertex.h"
+#include "edge.h"
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QStandardPaths>
+
+// Заголовок журнала: сигнатура 'CTJ1' и метка снимка, к которому относятся записи
+constexpr quint32 JOURNAL_MAGIC = 0x43544A31;
+constexpr int FLUSH_INTERVAL_MS = 1000;
+// После стольких записей журнал сжимается в новый снимок
+constexpr int COMPACT_RECORD_LIMIT = 200000;
+
+static const char *TOKEN_KEY = "autosave_token";
+
+// Реализация AutosaveWriter
+
+AutosaveWriter::AutosaveWriter(QObject *parent)
+    : QObject(parent)
+{
+}
+
+bool AutosaveWriter::openJournal(const QString &journalPath, bool truncate)
+{
+    if (m_journal.isOpen() && m_journal.fileName() == journalPath && !truncate)
+        return true;
+
+    m_journal.close();
+    m_journal.setFileName(journalPath);
+    QIODevice::OpenMode mode = QIODevice::WriteOnly | (truncate ? QIODevice::Truncate : QIODevice::Append);
+    if (!m_journal.open(mode)) {
+        emit writeFailed(tr("Cannot write autosave journal %1:\n%2.")
+                             .arg(journalPath, m_journal.errorString()));
+        return false;
+    }
+    return true;
+}
+
+void AutosaveWriter::appendRecords(const QString &journalPath, const QVector<GraphDelta> &records)
+{
+    // Журнал создаётся только вместе со снимком: без заголовка дописывать некуда
+    if (!QFileInfo::exists(journalPath) || !openJournal(journalPath, false))
+        return;
+
+    QDataStream stream(&m_journal);
+    stream.setVersion(QDataStream::Qt_5_12);
+
+    // Каждая пачка записей предваряется их количеством, поэтому
+    // оборванная при сбое последняя пачка при восстановлении отбрасывается
+    stream << quint32(records.size());
+    for (const GraphDelta &delta : records) {
+        stream << delta;
+    }
+    m_journal.flush();
+}
+
+void AutosaveWriter::writeSnapshot(const QString &snapshotPath, const QString &journalPath,
+                                   const GraphVersion &version)
+{
+    QDir().mkpath(QFileInfo(snapshotPath).absolutePath());
+
+    // Метка связывает журнал со снимком: журнал с чужой меткой при восстановлении игнорируется
+    const qint64 token = QDateTime::currentMSecsSinceEpoch();
+
+    QJsonObject json = version.toSnapshot().toJson();
+    json[TOKEN_KEY] = QString::number(token);
+
+    // Сначала атомарно записываем снимок, затем начинаем новый журнал
+    QSaveFile file(snapshotPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        emit writeFailed(tr("Cannot write autosave snapshot %1:\n%2.")
+                             .arg(snapshotPath, file.errorString()));
+        return;
+    }
+    file.write(QJsonDocument(json).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        emit writeFailed(tr("Cannot write autosave snapshot %1:\n%2.")
+                             .arg(snapshotPath, file.errorString()));
+        return;
+    }
+
+    if (!openJournal(journalPath, true))
+        return;
+
+    QDataStream stream(&m_journal);
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream << JOURNAL_MAGIC << token;
+    m_journal.flush();
+}
+
+void AutosaveWriter::discard(const QString &snapshotPath, const QString &journalPath)
+{
+    if (m_journal.fileName() == journalPath) {
+        m_journal.close();
+    }
+    QFile::remove(journalPath);
+    QFile::remove(snapshotPath);
+}
+
+void AutosaveWriter::closeJournal()
+{
+    m_journal.close();
+}
+
+// Реализация AutosaveJournal
+
+AutosaveJournal::AutosaveJournal(Graph *graph, QObject *parent)
+    : QObject(parent), m_graph(graph), m_recordsSinceSnapshot(0),
+    m_needsSnapshot(true), m_replaying(false), m_documentSet(false)
+{
+    qRegisterMetaType<GraphVersion>("GraphVersion");
+    qRegisterMetaType<QVector<GraphDelta>>("QVector<GraphDelta>");
+
+    // Запись на диск выполняется в отдельном потоке
+    m_writer = new AutosaveWriter();
+    m_writer->moveToThread(&m_thread);
+    connect(this, &AutosaveJournal::recordsReady, m_writer, &AutosaveWriter::appendRecords);
+    connect(this, &AutosaveJournal::snapshotReady, m_writer, &AutosaveWriter::writeSnapshot);
+    connect(this, &AutosaveJournal::discardRequested, m_writer, &AutosaveWriter::discard);
+    connect(m_writer, &AutosaveWriter::writeFailed, this, &AutosaveJournal::writeFailed);
+    m_thread.start(QThread::LowPriority);
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FLUSH_INTERVAL_MS);
+    connect(&m_flushTimer, &QTimer::timeout, this, &AutosaveJournal::flush);
+
+    connect(graph, &Graph::vertexAdded, this, &AutosaveJournal::handleVertexAdded);
+    connect(graph, &Graph::vertexRemoved, this, &AutosaveJournal::handleVertexRemoved);
+    connect(graph, &Graph::edgeAdded, this, &AutosaveJournal::handleEdgeAdded);
+    connect(graph, &Graph::edgeRemoved, this, &AutosaveJournal::handleEdgeRemoved);
+    connect(graph, &Graph::vertexMoved, this, &AutosaveJournal::handleVertexMoved);
+    connect(graph, &Graph::vertexColorIndexChanged,
+            this, &AutosaveJournal::handleVertexColorIndexChanged);
+    connect(graph, &Graph::colorsChanged, this, &AutosaveJournal::handleColorsChanged);
+    connect(graph, &Graph::vertexLockChanged, this, &AutosaveJournal::handleVertexLockChanged);
+}
+
+AutosaveJournal::~AutosaveJournal()
+{
+    flush();
+
+    // Блокирующий вызов выполнится после всех ранее поставленных в очередь записей
+    QMetaObject::invokeMethod(m_writer, &AutosaveWriter::closeJournal, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+    delete m_writer;
+}
+
+QString AutosaveJournal::snapshotPath(const QString &documentPath)
+{
+    QString basePath = documentPath;
+    if (basePath.isEmpty()) {
+        basePath = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)
+                   + "/untitled.json";
+    }
+    return basePath + ".autosave";
+}
+
+QString AutosaveJournal::journalPath(const QString &documentPath)
+{
+    return snapshotPath(documentPath) + ".journal";
+}
+
+bool AutosaveJournal::hasRecoveryData(const QString &documentPath)
+{
+    QFileInfo snapshotInfo(snapshotPath(documentPath));
+    if (!snapshotInfo.exists())
+        return false;
+
+    // Для сохранённого документа данные нужны, только если они новее файла
+    if (!documentPath.isEmpty()) {
+        QFileInfo documentInfo(documentPath);
+        QFileInfo journalInfo(journalPath(documentPath));
+        QDateTime latest = snapshotInfo.lastModified();
+        if (journalInfo.exists() && journalInfo.lastModified() > latest) {
+            latest = journalInfo.lastModified();
+        }
+        return !documentInfo.exists() || latest > documentInfo.lastModified();
+    }
+    return true;
+}
+
+void AutosaveJournal::setDocumentPath(const QString &documentPath)
+{
+    // Данные предыдущего документа больше не нужны: он сохранён или изменения отклонены
+    if (m_documentSet && documentPath != m_documentPath) {
+        emit discardRequested(snapshotPath(m_documentPath), journalPath(m_documentPath));
+    }
+
+    m_documentPath = documentPath;
+    m_documentSet = true;
+
+    // Изменения, сделанные при загрузке документа, в журнал не попадают
+    m_pending.clear();
+    m_pendingMove.clear();
+    m_needsSnapshot = true;
+}
+
+void AutosaveJournal::markClean()
+{
+    m_pending.clear();
+    m_pendingMove.clear();
+    m_needsSnapshot = true;
+    m_flushTimer.stop();
+    emit discardRequested(snapshotPath(m_documentPath), journalPath(m_documentPath));
+}
+
+void AutosaveJournal::flush()
+{
+    m_flushTimer.stop();
+    if (m_pending.isEmpty() || !m_documentSet)
+        return;
+
+    // Первый снимок создаётся лениво при первом изменении документа
+    if (m_needsSnapshot || m_recordsSinceSnapshot + m_pending.size() > COMPACT_RECORD_LIMIT) {
+        compact();
+        return;
+    }
+
+    emit recordsReady(journalPath(m_documentPath), m_pending);
+    m_recordsSinceSnapshot += m_pending.size();
+    m_pending.clear();
+    m_pendingMove.clear();
+}
+
+void AutosaveJournal::compact()
+{
+    if (!m_graph || !m_documentSet)
+        return;
+
+    // В потоке GUI только копируется версия (O(n / 1024)), записи
+    // собираются и сериализуются в фоне
+    emit snapshotReady(snapshotPath(m_documentPath), journalPath(m_documentPath),
+                       m_graph->currentVersion());
+
+    m_pending.clear();
+    m_pendingMove.clear();
+    m_recordsSinceSnapshot = 0;
+    m_needsSnapshot = false;
+}
+
+bool AutosaveJournal::recover(const QString &documentPath, QString *errorMessage)
+{
+    if (!m_graph)
+        return false;
+
+    QFile snapshotFile(snapshotPath(documentPath));
+    if (!snapshotFile.open(QIODevice::ReadOnly)) {
+        if (errorMessage) {
+            *errorMessage = snapshotFile.errorString();
+        }
+        return false;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(snapshotFile.readAll());
+    GraphSnapshot snapshot;
+    if (!doc.isObject() || !GraphSnapshot::fromJson(doc.object(), &snapshot)) {
+        if (errorMessage) {
+            *errorMessage = tr("Invalid autosave snapshot.");
+        }
+        return false;
+    }
+    const qint64 snapshotToken = doc.object()[TOKEN_KEY].toString().toLongLong();
+
+    // Читаем только целые пачки записей журнала, относящегося к этому снимку
+    QVector<GraphDelta> records;
+    QFile journalFile(journalPath(documentPath));
+    if (journalFile.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&journalFile);
+        stream.setVersion(QDataStream::Qt_5_12);
+
+        quint32 magic = 0;
+        qint64 token = 0;
+        stream >> magic >> token;
+        if (stream.status() == QDataStream::Ok && magic == JOURNAL_MAGIC && token == snapshotToken) {
+            while (!stream.atEnd()) {
+                quint32 count = 0;
+                stream >> count;
+                QVector<GraphDelta> block;
+                block.reserve(int(qMin<quint32>(count, 65536)));
+                for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+                    GraphDelta delta;
+                    stream >> delta;
+                    block.append(delta);
+                }
+                if (stream.status() != QDataStream::Ok)
+                    break;
+                records += block;
+            }
+        }
+    }
+
+    m_replaying = true;
+    m_graph->beginBatch(tr("Recover autosave"));
+    m_graph->loadSnapshot(snapshot);
+    applyGraphDeltas(m_graph, records, true);
+    m_graph->endBatch();
+    m_replaying = false;
+
+    // Восстановленное состояние войдёт в следующий снимок
+    m_pending.clear();
+    m_pendingMove.clear();
+    m_needsSnapshot = true;
+    return true;
+}
+
+void AutosaveJournal::handleVertexAdded(Vertex *vertex)
+{
+    record(GraphDelta::vertexAdded(vertex->id(), vertex->position(), vertex->colorIndex()));
+}
+
+void AutosaveJournal::handleVertexRemoved(Vertex *vertex)
+{
+    record(GraphDelta::vertexRemoved(vertex->id(), vertex->position(), vertex->colorIndex(),
+                                    vertex->isLocked()));
+}
+
+void AutosaveJournal::handleEdgeAdded(Edge *edge)
+{
+    record(GraphDelta::edgeAdded(edge->sourceVertex()->id(), edge->destVertex()->id()));
+}
+
+void AutosaveJournal::handleEdgeRemoved(Edge *edge)
+{
+    record(GraphDelta::edgeRemoved(edge->sourceVertex()->id(), edge->destVertex()->id()));
+}
+
+void AutosaveJournal::handleVertexMoved(Vertex *vertex, const QPointF &oldPosition)
+{
+    record(GraphDelta::vertexMoved(vertex->id(), oldPosition, vertex->position()));
+}
+
+void AutosaveJournal::handleVertexColorIndexChanged(Vertex *vertex, int oldIndex)
+{
+    record(GraphDelta::colorChanged(vertex->id(), oldIndex, vertex->colorIndex()));
+}
+
+void AutosaveJournal::handleColorsChanged(const QVector<Vertex*> &vertices, const QVector<int> &oldIndices)
+{
+    for (int i = 0; i < vertices.size(); ++i) {
+        record(GraphDelta::colorChanged(vertices[i]->id(), oldIndices[i], vertices[i]->colorIndex()));
+    }
+}
+
+void AutosaveJournal::handleVertexLockChanged(Vertex *vertex)
+{
+    record(GraphDelta::lockChanged(vertex->id(), !vertex->isLocked(), vertex->isLocked()));
+}
+
+void AutosaveJournal::record(const GraphDelta &delta)
+{
+    if (m_replaying)
+        return;
+
+    // Перетаскивание порождает много перемещений: в журнал идёт только последнее
+    if (delta.type == GraphDelta::MoveVertex) {
+        int index = m_pendingMove.value(delta.a, -1);
+        if (index >= 0) {
+            m_pending[index].to = delta.to;
+            return;
+        }
+        m_pendingMove.insert(delta.a, m_pending.size());
+    } else if (delta.type == GraphDelta::RemoveVertex) {
+        m_pendingMove.remove(delta.a);
+    }
+
+    m_pending.append(delta);
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include <QObject>
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
+#include <QFile>
+#include <QHash>
+#include <QVector>
+#include "graph.h"
+#include "graphdelta.h"
+#include "graphsnapshot.h"
+#include "graphversion.h"
+
+// Класс AutosaveWriter выполняет всю работу с диском в фоновом потоке:
+// дописывает записи в журнал и сжимает журнал в полный снимок
+class AutosaveWriter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AutosaveWriter(QObject *parent = nullptr);
+
+public slots:
+    void appendRecords(const QString &journalPath, const QVector<GraphDelta> &records);
+    void writeSnapshot(const QString &snapshotPath, const QString &journalPath,
+                       const GraphVersion &version);
+    void discard(const QString &snapshotPath, const QString &journalPath);
+    void closeJournal();
+
+signals:
+    void writeFailed(const QString &message);
+
+private:
+    QFile m_journal;
+
+    bool openJournal(const QString &journalPath, bool truncate);
+};
+
+// Класс AutosaveJournal собирает изменения графа в потоке GUI и передаёт их
+// в фоновый поток пачками. Состояние документа восстанавливается как
+// последний снимок плюс записи журнала после него.
+class AutosaveJournal : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AutosaveJournal(Graph *graph, QObject *parent = nullptr);
+    ~AutosaveJournal();
+
+    // Документ, рядом с которым хранятся файлы автосохранения
+    // (пустой путь - безымянный документ в каталоге данных приложения)
+    void setDocumentPath(const QString &documentPath);
+
+    // Документ сохранён явно: данные для восстановления больше не нужны
+    void markClean();
+
+    // Немедленная отправка накопленных записей в фоновый поток
+    void flush();
+
+    // Сжатие журнала в полный снимок
+    void compact();
+
+    // Файлы автосохранения документа
+    static QString snapshotPath(const QString &documentPath);
+    static QString journalPath(const QString &documentPath);
+
+    // Есть ли данные для восстановления документа
+    static bool hasRecoveryData(const QString &documentPath);
+
+    // Восстановление графа из снимка и журнала
+    bool recover(const QString &documentPath, QString *errorMessage = nullptr);
+
+signals:
+    void recordsReady(const QString &journalPath, const QVector<GraphDelta> &records);
+    void snapshotReady(const QString &snapshotPath, const QString &journalPath,
+                       const GraphVersion &version);
+    void discardRequested(const QString &snapshotPath, const QString &journalPath);
+    void writeFailed(const QString &message);
+
+private slots:
+    void handleVertexAdded(Vertex *vertex);
+    void handleVertexRemoved(Vertex *vertex);
+    void handleEdgeAdded(Edge *edge);
+    void handleEdgeRemoved(Edge *edge);
+    void handleVertexMoved(Vertex *vertex, const QPointF &oldPosition);
+    void handleVertexColorIndexChanged(Vertex *vertex, int oldIndex);
+    void handleColorsChanged(const QVector<Vertex*> &vertices, const QVector<int> &oldIndices);
+    void handleVertexLockChanged(Vertex *vertex);
+
+private:
+    QPointer<Graph> m_graph;
+    QThread m_thread;
+    AutosaveWriter *m_writer;
+    QTimer m_flushTimer;
+
+    QString m_documentPath;
+    QVector<GraphDelta> m_pending;
+    QHash<int, int> m_pendingMove;  // Индекс последнего перемещения вершины в m_pending
+    int m_recordsSinceSnapshot;
+    bool m_needsSnapshot;           // Журнал ещё не привязан к снимку
+    bool m_replaying;
+    bool m_documentSet;
+
+    void record(const GraphDelta &delta);
+};
+
+#endif // AUTOSAVE_H
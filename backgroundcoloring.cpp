@@ -0,0 +1,87 @@
+#include "backgroundcoloring.h"
+#include "coloringalgorithm.h"
+#include "profiler.h"
+
+// Реализация ColoringWorker
+
+ColoringWorker::ColoringWorker(QObject *parent)
+    : QObject(parent), m_activeRunId(-1)
+{
+}
+
+void ColoringWorker::run(int runId, const GraphVersion &version, int deadlineMs)
+{
+    if (m_activeRunId.load() != runId)
+        return;
+
+    QVector<int> colors;
+    QString winner;
+    bool optimal = false;
+    ColoringAlgorithm::computePortfolioColoring(Adjacency::fromVersion(version), deadlineMs, &colors,
+                                                &winner, &optimal, [this, runId]() {
+        return m_activeRunId.load() != runId;
+    });
+
+    if (m_activeRunId.load() != runId)
+        return;
+    emit coloringReady(runId, colors, winner, optimal);
+}
+
+// Реализация BackgroundColoring
+
+BackgroundColoring::BackgroundColoring(Graph *graph, QObject *parent)
+    : QObject(parent), m_graph(graph), m_worker(new ColoringWorker), m_running(false), m_runId(0)
+{
+    qRegisterMetaType<GraphVersion>("GraphVersion");
+    qRegisterMetaType<QVector<int>>("QVector<int>");
+
+    m_worker->moveToThread(&m_thread);
+    connect(this, &BackgroundColoring::coloringRequested, m_worker, &ColoringWorker::run);
+    connect(m_worker, &ColoringWorker::coloringReady, this, &BackgroundColoring::applyColoring);
+    m_thread.start();
+}
+
+BackgroundColoring::~BackgroundColoring()
+{
+    // Отмена прерывает гонку, ожидание не дольше шага участников
+    m_worker->setActiveRun(-1);
+    m_thread.quit();
+    m_thread.wait();
+    delete m_worker;
+}
+
+void BackgroundColoring::start(int deadlineMs)
+{
+    if (m_running || m_graph->vertexCount() == 0)
+        return;
+
+    m_version = m_graph->currentVersion();
+
+    m_running = true;
+    m_runId++;
+    m_worker->setActiveRun(m_runId);
+    emit started();
+    emit coloringRequested(m_runId, m_version, deadlineMs);
+}
+
+void BackgroundColoring::cancel()
+{
+    if (!m_running)
+        return;
+
+    m_running = false;
+    m_worker->setActiveRun(-1);
+    m_version = GraphVersion();
+    emit finished(false);
+}
+
+void BackgroundColoring::applyColoring(int runId, const QVector<int> &colors, const QString &winner, bool optimal)
+{
+    if (!m_running || runId != m_runId)
+        return;
+
+    m_running = false;
+    const bool applied = m_graph->applyVersionColoring(m_version, colors, winner, optimal);
+    m_version = GraphVersion();
+    emit finished(applied);
+}
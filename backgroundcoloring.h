@@ -0,0 +1,69 @@
+#ifndef BACKGROUNDCOLORING_H
+#define BACKGROUNDCOLORING_H
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+#include "graph.h"
+#include "graphversion.h"
+
+// Класс ColoringWorker выполняет гонку алгоритмов раскраски
+// (PortfolioColoring) в фоновом потоке
+class ColoringWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ColoringWorker(QObject *parent = nullptr);
+
+    // Запуск, который следует продолжать; остальные прерываются, как по
+    // истечении срока. Вызывается из любого потока.
+    void setActiveRun(int runId) { m_activeRunId.store(runId); }
+
+public slots:
+    void run(int runId, const GraphVersion &version, int deadlineMs);
+
+signals:
+    // Цвета в порядке вершин версии, по которой шёл расчёт
+    void coloringReady(int runId, const QVector<int> &colors, const QString &winner, bool optimal);
+
+private:
+    std::atomic<int> m_activeRunId;
+};
+
+// Класс BackgroundColoring запускает гонку алгоритмов раскраски вне потока
+// GUI: окно остаётся отзывчивым до срока, гонку можно отменить. Результат
+// применяется к графу одной операцией (Graph::applyVersionColoring).
+class BackgroundColoring : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BackgroundColoring(Graph *graph, QObject *parent = nullptr);
+    ~BackgroundColoring();
+
+    void start(int deadlineMs);
+    void cancel();
+    bool isRunning() const { return m_running; }
+
+signals:
+    void started();
+    // applied - раскраска применена; false - гонка отменена или граф за это
+    // время очищен или загружен заново
+    void finished(bool applied);
+
+    void coloringRequested(int runId, const GraphVersion &version, int deadlineMs);
+
+private slots:
+    void applyColoring(int runId, const QVector<int> &colors, const QString &winner, bool optimal);
+
+private:
+    Graph *m_graph;
+    QThread m_thread;
+    ColoringWorker *m_worker;
+    GraphVersion m_version;  // Версия, по которой идёт расчёт
+    bool m_running;
+    int m_runId;
+};
+
+#endif // BACKGROUNDCOLORING_H
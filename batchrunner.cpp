@@ -0,0 +1,424 @@
+#include "batchrunner.h"
+#include "coloringcache.h"
+#include "coloringengine.h"
+#include "graphfile.h"
+#include "graphsnapshot.h"
+#include "kicadboard.h"
+#include "memorystats.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// Оценка памяти на обработку файла в долях его размера: разобранный JSON
+// и снимок занимают в несколько раз больше текста, сжатый файл
+// разворачивается сильнее
+constexpr qint64 TEXT_MEMORY_FACTOR = 8;
+constexpr qint64 COMPRESSED_MEMORY_FACTOR = 24;
+
+const char SUMMARY_FILE_NAME[] = "batch-summary.csv";
+
+// Очереди заданий потоков. Поток берёт задания из начала своей очереди,
+// а опустев - из конца чужих, так что крупные файлы не оставляют
+// остальные потоки без работы.
+class WorkQueues
+{
+public:
+    explicit WorkQueues(int workerCount)
+    {
+        for (int i = 0; i < workerCount; ++i) {
+            m_queues.push_back(std::make_unique<Queue>());
+        }
+    }
+
+    void push(int worker, int task)
+    {
+        Queue &queue = *m_queues[worker];
+        QMutexLocker locker(&queue.mutex);
+        queue.tasks.push_back(task);
+    }
+
+    bool take(int worker, int *task)
+    {
+        const int count = int(m_queues.size());
+        for (int offset = 0; offset < count; ++offset) {
+            Queue &queue = *m_queues[(worker + offset) % count];
+            QMutexLocker locker(&queue.mutex);
+            if (queue.tasks.empty())
+                continue;
+            if (offset == 0) {
+                *task = queue.tasks.front();
+                queue.tasks.pop_front();
+            } else {
+                *task = queue.tasks.back();
+                queue.tasks.pop_back();
+            }
+            return true;
+        }
+        return false;
+    }
+
+private:
+    struct Queue
+    {
+        QMutex mutex;
+        std::deque<int> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+};
+
+// Ограничение суммарной оценки памяти файлов в обработке. Файл больше
+// предела обрабатывается, когда других файлов в работе нет.
+class MemoryGate
+{
+public:
+    explicit MemoryGate(qint64 limit) : m_limit(limit), m_inFlight(0) {}
+
+    qint64 acquire(qint64 bytes)
+    {
+        if (m_limit <= 0)
+            return 0;
+
+        bytes = std::min(bytes, m_limit);
+        QMutexLocker locker(&m_mutex);
+        while (m_inFlight > 0 && m_inFlight + bytes > m_limit) {
+            m_released.wait(&m_mutex);
+        }
+        m_inFlight += bytes;
+        return bytes;
+    }
+
+    void release(qint64 bytes)
+    {
+        if (m_limit <= 0)
+            return;
+
+        QMutexLocker locker(&m_mutex);
+        m_inFlight -= bytes;
+        m_released.wakeAll();
+    }
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_released;
+    qint64 m_limit;
+    qint64 m_inFlight;
+};
+
+qint64 estimateMemory(const QString &filePath, qint64 fileSize)
+{
+    const bool compressed = QFileInfo(filePath).suffix().compare(GraphFile::compressedSuffix(),
+                                                                 Qt::CaseInsensitive) == 0;
+    return fileSize * (compressed ? COMPRESSED_MEMORY_FACTOR : TEXT_MEMORY_FACTOR);
+}
+
+double elapsedMs(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1e6;
+}
+
+QString csvField(const QString &value)
+{
+    if (!value.contains(',') && !value.contains('"') && !value.contains('\n'))
+        return value;
+    QString quoted = value;
+    quoted.replace('"', "\"\"");
+    return '"' + quoted + '"';
+}
+
+} // namespace
+
+BatchRunner::BatchRunner(const Options &options)
+    : m_options(options)
+{
+}
+
+int BatchRunner::run(QTextStream &out)
+{
+    QString errorMessage;
+    if (!collectFiles(&errorMessage)) {
+        out << errorMessage << "\n";
+        return 1;
+    }
+
+    int threadCount = m_options.threadCount > 0 ? m_options.threadCount : QThread::idealThreadCount();
+    threadCount = std::max(1, std::min(threadCount, int(m_files.size())));
+
+    m_results.clear();
+    m_results.resize(m_files.size());
+
+    // Крупные файлы раздаются первыми, по кругу между очередями потоков
+    QVector<qint64> sizes(m_files.size());
+    QVector<int> order(m_files.size());
+    for (int i = 0; i < m_files.size(); ++i) {
+        sizes[i] = QFileInfo(m_files[i]).size();
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sizes](int a, int b) {
+        return sizes[a] > sizes[b];
+    });
+
+    WorkQueues queues(threadCount);
+    for (int i = 0; i < order.size(); ++i) {
+        queues.push(i % threadCount, order[i]);
+    }
+
+    out << QString("Coloring %1 files with %2 threads\n").arg(m_files.size()).arg(threadCount);
+    out.flush();
+
+    MemoryGate gate(m_options.memoryLimit);
+    QMutex outputMutex;
+    std::atomic<int> finished(0);
+    QElapsedTimer wallTimer;
+    wallTimer.start();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+    for (int worker = 0; worker < threadCount; ++worker) {
+        pool.start([&, worker]() {
+            int task;
+            while (queues.take(worker, &task)) {
+                const qint64 estimate = estimateMemory(m_files[task], sizes[task]);
+                const qint64 reserved = gate.acquire(estimate);
+                {
+                    MemoryReservation buffers(MemoryTracker::IoBuffers, estimate);
+                    processFile(task);
+                }
+                gate.release(reserved);
+
+                const Result &result = m_results[task];
+                const int done = ++finished;
+                QMutexLocker locker(&outputMutex);
+                if (result.ok) {
+                    out << QString("[%1/%2] %3: %4 colors, %5 ms\n")
+                               .arg(done).arg(m_files.size()).arg(m_files[task]).arg(result.colorCount)
+                               .arg(result.loadMs + result.colorMs + result.saveMs, 0, 'f', 1);
+                } else {
+                    out << QString("[%1/%2] %3: FAILED: %4\n")
+                               .arg(done).arg(m_files.size()).arg(m_files[task], result.error);
+                }
+                out.flush();
+            }
+        });
+    }
+    pool.waitForDone();
+    const double wallMs = elapsedMs(wallTimer);
+
+    int failed = 0;
+    for (const Result &result : std::as_const(m_results)) {
+        if (!result.ok) {
+            failed++;
+        }
+    }
+
+    QString summaryPath = m_options.summaryPath;
+    if (summaryPath.isEmpty()) {
+        const QString directory = m_options.outputDirectory.isEmpty() ? m_baseDirectory
+                                                                      : m_options.outputDirectory;
+        summaryPath = QDir(directory).filePath(SUMMARY_FILE_NAME);
+    }
+    if (!writeSummary(summaryPath, &errorMessage)) {
+        out << QString("Cannot write summary %1: %2\n").arg(summaryPath, errorMessage);
+        return 1;
+    }
+
+    out << QString("Files: %1, failed: %2, wall time: %3 ms, %4 files/s\n")
+               .arg(m_files.size()).arg(failed).arg(wallMs, 0, 'f', 1)
+               .arg(wallMs > 0 ? m_files.size() / (wallMs / 1000.0) : 0, 0, 'f', 1);
+    out << QString("Summary written to %1\n").arg(summaryPath);
+    return failed > 0 ? 1 : 0;
+}
+
+bool BatchRunner::collectFiles(QString *errorMessage)
+{
+    m_files.clear();
+    const QFileInfo inputInfo(m_options.input);
+
+    if (inputInfo.isDir()) {
+        m_baseDirectory = inputInfo.absoluteFilePath();
+
+        // Результаты прошлого запуска в каталоге результатов не обрабатываются повторно
+        QString skipPrefix;
+        if (!m_options.outputDirectory.isEmpty()) {
+            skipPrefix = QFileInfo(m_options.outputDirectory).absoluteFilePath() + '/';
+        }
+
+        const QStringList filters = {
+            "*.json",
+            QString("*.%1").arg(GraphFile::compressedSuffix()),
+            "*.col",
+            QString("*.%1").arg(KicadBoard::suffix()),
+        };
+        QDirIterator it(m_baseDirectory, filters, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString path = it.next();
+            if (skipPrefix.isEmpty() || !path.startsWith(skipPrefix)) {
+                m_files.append(path);
+            }
+        }
+        m_files.sort();
+    } else if (inputInfo.isFile()) {
+        // Манифест: путь на строке, относительные пути - от каталога манифеста
+        m_baseDirectory = inputInfo.absolutePath();
+        QFile manifest(inputInfo.absoluteFilePath());
+        if (!manifest.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            *errorMessage = QString("Cannot open manifest %1: %2").arg(m_options.input, manifest.errorString());
+            return false;
+        }
+        QTextStream stream(&manifest);
+        const QDir baseDir(m_baseDirectory);
+        while (!stream.atEnd()) {
+            const QString line = stream.readLine().trimmed();
+            if (line.isEmpty() || line.startsWith('#'))
+                continue;
+            m_files.append(QDir::cleanPath(baseDir.absoluteFilePath(line)));
+        }
+    } else {
+        *errorMessage = QString("Batch input not found: %1").arg(m_options.input);
+        return false;
+    }
+
+    if (m_files.isEmpty()) {
+        *errorMessage = QString("No graph files found in %1").arg(m_options.input);
+        return false;
+    }
+    return true;
+}
+
+QString BatchRunner::outputPathFor(const QString &filePath) const
+{
+    QString outputPath = filePath;
+    if (!m_options.outputDirectory.isEmpty()) {
+        // Структура каталогов сохраняется; файлы вне базового каталога
+        // кладутся в корень каталога результатов
+        QString relative = QDir(m_baseDirectory).relativeFilePath(filePath);
+        if (relative.startsWith("..") || QDir::isAbsolutePath(relative)) {
+            relative = QFileInfo(filePath).fileName();
+        }
+        outputPath = QDir(m_options.outputDirectory).filePath(relative);
+    }
+
+    // DIMACS и платы KiCad не хранят цвета: раскраска сохраняется в JSON рядом
+    const QFileInfo info(outputPath);
+    const GraphFile::Format format = GraphFile::formatForPath(outputPath);
+    if (format == GraphFile::Format::Dimacs || format == GraphFile::Format::KiCad) {
+        outputPath = info.dir().filePath(info.completeBaseName() + ".json");
+    }
+    return outputPath;
+}
+
+void BatchRunner::processFile(int index)
+{
+    const QString &filePath = m_files[index];
+    Result &result = m_results[index];
+    QString errorMessage;
+    QElapsedTimer timer;
+
+    timer.start();
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.error = file.errorString();
+        return;
+    }
+    const GraphFile::Format format = GraphFile::detectFormat(&file);
+    GraphSnapshot snapshot;
+    if (!GraphFile::read(&file, &snapshot, &errorMessage)) {
+        result.error = errorMessage;
+        return;
+    }
+    file.close();
+    result.loadMs = elapsedMs(timer);
+    result.vertexCount = snapshot.vertices.size();
+    result.edgeCount = snapshot.edges.size();
+
+    // Та же раскраска, что и в окне программы: жадная с учётом кэша компонент
+    timer.restart();
+    const Adjacency adjacency = Adjacency::fromSnapshot(snapshot);
+    QVector<int> colors;
+    ColoringEngine::color(adjacency, ColoringEngine::Engine::Greedy, &colors);
+    result.colorCount = ColoringCache::instance().improve(adjacency, &colors);
+    for (int i = 0; i < colors.size(); ++i) {
+        snapshot.vertices[i].colorIndex = colors[i];
+    }
+    snapshot.maxColor = result.colorCount;
+    result.colorMs = elapsedMs(timer);
+
+    timer.restart();
+    result.outputPath = outputPathFor(filePath);
+    QDir().mkpath(QFileInfo(result.outputPath).absolutePath());
+    QSaveFile output(result.outputPath);
+    if (!output.open(QIODevice::WriteOnly)) {
+        result.error = output.errorString();
+        return;
+    }
+
+    bool ok;
+    if (format == GraphFile::Format::Compressed) {
+        ok = GraphFile::writeCompressed(snapshot, &output, &errorMessage);
+    } else {
+        const QByteArray data = QJsonDocument(snapshot.toJson()).toJson();
+        ok = output.write(data) == data.size();
+        if (!ok) {
+            errorMessage = output.errorString();
+        }
+    }
+    if (!ok) {
+        result.error = errorMessage;
+        return;
+    }
+    if (!output.commit()) {
+        result.error = output.errorString();
+        return;
+    }
+    result.saveMs = elapsedMs(timer);
+    result.ok = true;
+}
+
+bool BatchRunner::writeSummary(const QString &summaryPath, QString *errorMessage) const
+{
+    QDir().mkpath(QFileInfo(summaryPath).absolutePath());
+    QSaveFile file(summaryPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        *errorMessage = file.errorString();
+        return false;
+    }
+
+    QTextStream stream(&file);
+    stream << "file,status,vertices,edges,colors,load_ms,color_ms,save_ms,output,error\n";
+    for (int i = 0; i < m_files.size(); ++i) {
+        const Result &result = m_results[i];
+        stream << csvField(m_files[i]) << ','
+               << (result.ok ? "ok" : "failed") << ','
+               << result.vertexCount << ','
+               << result.edgeCount << ','
+               << result.colorCount << ','
+               << QString::number(result.loadMs, 'f', 2) << ','
+               << QString::number(result.colorMs, 'f', 2) << ','
+               << QString::number(result.saveMs, 'f', 2) << ','
+               << csvField(result.outputPath) << ','
+               << csvField(result.error) << '\n';
+    }
+    stream.flush();
+
+    if (!file.commit()) {
+        *errorMessage = file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+// Класс BatchRunner раскрашивает набор файлов графов в одном процессе:
+// загрузка, раскраска и сохранение идут параллельно в пуле потоков с
+// перехватом работы (у каждого потока своя очередь, опустевший поток
+// забирает файлы из конца чужих очередей). Объём памяти, одновременно
+// занятой обрабатываемыми файлами, ограничен оценкой по размеру файла.
+class BatchRunner
+{
+public:
+    struct Options
+    {
+        QString input;            // Каталог (обходится рекурсивно) или манифест - список путей по строке
+        QString outputDirectory;  // Пусто - файлы перезаписываются на месте
+        QString summaryPath;      // Пусто - batch-summary.csv в каталоге результатов
+        int threadCount = 0;      // 0 - по числу ядер
+        qint64 memoryLimit = 0;   // Предел памяти файлов в обработке (байты), 0 - без предела
+    };
+
+    // Итог обработки одного файла
+    struct Result
+    {
+        QString outputPath;
+        bool ok = false;
+        QString error;
+        int vertexCount = 0;
+        int edgeCount = 0;
+        int colorCount = 0;
+        double loadMs = 0;
+        double colorMs = 0;
+        double saveMs = 0;
+    };
+
+    explicit BatchRunner(const Options &options);
+
+    // Обработка всех файлов и запись сводки. Возвращает код завершения
+    // процесса (1, если какой-то файл не обработан).
+    int run(QTextStream &out);
+
+private:
+    Options m_options;
+    QString m_baseDirectory;  // Относительно него сохраняется структура каталогов
+    QStringList m_files;
+    QVector<Result> m_results;
+
+    bool collectFiles(QString *errorMessage);
+    QString outputPathFor(const QString &filePath) const;
+    void processFile(int index);
+    bool writeSummary(const QString &summaryPath, QString *errorMessage) const;
+};
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,357 @@
+#include "benchmark.h"
+#include "graphfile.h"
+#include "graphwriter.h"
+#include "dimacs.h"
+#include "coloringengine.h"
+#include "graphsnapshot.h"
+#include "graph.h"
+#include "memorystats.h"
+#include <QBuffer>
+#include <QDir>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QMap>
+#include <algorithm>
+
+namespace {
+
+// Результат замера одного формата
+struct FormatResult
+{
+    QString name;
+    qint64 size = 0;
+    double writeMs = 0;
+    double readMs = 0;
+};
+
+// Пропускная способность в МБ/с относительно объёма JSON,
+// чтобы форматы сравнивались по одному и тому же полезному содержимому
+double throughput(qint64 bytes, double ms)
+{
+    return ms > 0 ? (bytes / (1024.0 * 1024.0)) / (ms / 1000.0) : 0;
+}
+
+void printResult(QTextStream &out, const FormatResult &result, qint64 jsonSize)
+{
+    out << QString("%1 %2 %3 %4 %5 %6 %7\n")
+               .arg(result.name, -12)
+               .arg(result.size, 12)
+               .arg(jsonSize > 0 ? double(result.size) / jsonSize : 0, 7, 'f', 3)
+               .arg(result.writeMs, 10, 'f', 1)
+               .arg(throughput(jsonSize, result.writeMs), 10, 'f', 1)
+               .arg(result.readMs, 10, 'f', 1)
+               .arg(throughput(jsonSize, result.readMs), 10, 'f', 1);
+}
+
+// Хроматические числа (или лучшие известные раскраски) стандартных
+// экземпляров DIMACS
+const QHash<QString, int> &bestKnownColors()
+{
+    static const QHash<QString, int> table = {
+        { "myciel3", 4 }, { "myciel4", 5 }, { "myciel5", 6 }, { "myciel6", 7 }, { "myciel7", 8 },
+        { "queen5_5", 5 }, { "queen6_6", 7 }, { "queen7_7", 7 }, { "queen8_8", 9 },
+        { "queen8_12", 12 }, { "queen9_9", 10 },
+        { "anna", 11 }, { "david", 11 }, { "homer", 13 }, { "huck", 11 }, { "jean", 10 },
+        { "games120", 9 },
+        { "miles250", 8 }, { "miles500", 20 }, { "miles750", 31 }, { "miles1000", 42 },
+        { "miles1500", 73 },
+        { "fpsol2.i.1", 65 }, { "fpsol2.i.2", 30 }, { "fpsol2.i.3", 30 },
+        { "inithx.i.1", 54 }, { "inithx.i.2", 31 }, { "inithx.i.3", 31 },
+        { "mulsol.i.1", 49 }, { "mulsol.i.2", 31 }, { "mulsol.i.3", 31 }, { "mulsol.i.4", 31 },
+        { "mulsol.i.5", 31 },
+        { "zeroin.i.1", 49 }, { "zeroin.i.2", 30 }, { "zeroin.i.3", 30 },
+        { "le450_5a", 5 }, { "le450_5b", 5 }, { "le450_5c", 5 }, { "le450_5d", 5 },
+        { "le450_15a", 15 }, { "le450_15b", 15 }, { "le450_15c", 15 }, { "le450_15d", 15 },
+        { "le450_25a", 25 }, { "le450_25b", 25 }, { "le450_25c", 25 }, { "le450_25d", 25 },
+        { "school1", 14 }, { "school1_nsh", 14 },
+        { "DSJC125.1", 5 }, { "DSJC125.5", 17 }, { "DSJC125.9", 44 },
+        { "DSJC250.5", 28 }, { "DSJC500.1", 12 }, { "DSJC1000.1", 20 },
+        { "DSJR500.1", 12 },
+        { "flat300_20_0", 20 }, { "flat300_26_0", 26 }, { "flat300_28_0", 28 },
+    };
+    return table;
+}
+
+} // namespace
+
+int Benchmark::runDimacsBenchmark(const QString &directory, QTextStream &out, qint64 memoryBudget)
+{
+    QDir dir(directory);
+    const QStringList files = dir.entryList({ QString("*.") + DimacsFile::suffix() },
+                                            QDir::Files, QDir::Name);
+    if (!dir.exists() || files.isEmpty()) {
+        out << QString("No DIMACS instances (*.col) in %1\n").arg(directory);
+        return 1;
+    }
+
+    out << QString("%1 %2 %3 %4 %5 %6 %7 %8\n")
+               .arg("instance", -16).arg("vertices", 9).arg("edges", 9).arg("engine", -14)
+               .arg("layers", 7).arg("best", 5).arg("gap", 5).arg("ms", 10);
+
+    // Итоги по алгоритмам: суммарное время и число достигнутых оптимумов
+    QMap<ColoringEngine::Engine, double> totalMs;
+    QMap<ColoringEngine::Engine, int> optimal;
+    int instancesWithBest = 0;
+    bool allValid = true;
+    QElapsedTimer timer;
+
+    for (const QString &fileName : files) {
+        QFile file(dir.filePath(fileName));
+        if (!file.open(QIODevice::ReadOnly)) {
+            out << QString("Cannot open file %1: %2\n").arg(fileName, file.errorString());
+            allValid = false;
+            continue;
+        }
+
+        GraphSnapshot snapshot;
+        QString errorMessage;
+        {
+            MEMORY_OPERATION("dimacs.read");
+            if (!DimacsFile::read(&file, &snapshot, &errorMessage)) {
+                out << QString("Cannot read %1: %2\n").arg(fileName, errorMessage);
+                allValid = false;
+                continue;
+            }
+        }
+
+        const Adjacency adjacency = Adjacency::fromSnapshot(snapshot);
+        const QString instance = QFileInfo(fileName).completeBaseName();
+        const int best = bestKnownColors().value(instance, 0);
+        if (best > 0) {
+            instancesWithBest++;
+        }
+
+        for (ColoringEngine::Engine engine : ColoringEngine::engines()) {
+            QVector<int> colors;
+            int layers;
+            {
+                MEMORY_OPERATION("dimacs.color");
+                timer.start();
+                layers = ColoringEngine::color(adjacency, engine, &colors);
+            }
+            const double ms = timer.nsecsElapsed() / 1e6;
+
+            const bool valid = ColoringEngine::isProperColoring(adjacency, colors);
+            allValid = allValid && valid;
+            totalMs[engine] += ms;
+            if (best > 0 && layers <= best) {
+                optimal[engine]++;
+            }
+
+            out << QString("%1 %2 %3 %4 %5 %6 %7 %8%9\n")
+                       .arg(instance, -16)
+                       .arg(adjacency.vertexCount(), 9)
+                       .arg(adjacency.edgeCount(), 9)
+                       .arg(ColoringEngine::engineName(engine), -14)
+                       .arg(layers, 7)
+                       .arg(best > 0 ? QString::number(best) : QString("?"), 5)
+                       .arg(best > 0 ? QString::number(layers - best) : QString("-"), 5)
+                       .arg(ms, 10, 'f', 2)
+                       .arg(valid ? "" : "  INVALID");
+        }
+    }
+
+    out << QString("\n%1 %2 %3\n").arg("engine", -14).arg("total ms", 12).arg("optimal", 10);
+    for (ColoringEngine::Engine engine : ColoringEngine::engines()) {
+        out << QString("%1 %2 %3\n")
+                   .arg(ColoringEngine::engineName(engine), -14)
+                   .arg(totalMs.value(engine), 12, 'f', 2)
+                   .arg(QString("%1/%2").arg(optimal.value(engine)).arg(instancesWithBest), 10);
+    }
+
+    printMemoryReport(out, nullptr);
+    if (!checkMemoryBudget(out, nullptr, memoryBudget)) {
+        return MEMORY_BUDGET_EXCEEDED;
+    }
+    return allValid ? 0 : 1;
+}
+
+void Benchmark::printMemoryReport(QTextStream &out, const Graph *graph)
+{
+    using MemoryStats::formatBytes;
+    MemoryTracker &tracker = MemoryTracker::instance();
+
+    out << QString("\n%1 %2 %3\n").arg("memory", -24).arg("current", 12).arg("peak", 12);
+    out << QString("%1 %2 %3\n").arg("graph model", -24)
+               .arg(formatBytes(MemoryStats::estimateGraphBytes(graph)), 12).arg("", 12);
+    for (int i = 0; i < MemoryTracker::CategoryCount; ++i) {
+        const MemoryTracker::Category category = MemoryTracker::Category(i);
+        out << QString("%1 %2 %3\n").arg(MemoryTracker::categoryName(category).toLower(), -24)
+                   .arg(formatBytes(tracker.current(category)), 12)
+                   .arg(formatBytes(tracker.peak(category)), 12);
+    }
+    out << QString("%1 %2 %3\n").arg("process rss", -24)
+               .arg(formatBytes(MemoryStats::residentBytes()), 12)
+               .arg(formatBytes(MemoryStats::peakResidentBytes()), 12);
+
+    const QVector<MemoryTracker::OperationStats> operations = tracker.operationStats();
+    if (!operations.isEmpty()) {
+        out << QString("\n%1 %2 %3 %4\n").arg("operation", -24).arg("runs", 6)
+                   .arg("max peak", 12).arg("rss delta", 12);
+        for (const MemoryTracker::OperationStats &operation : operations) {
+            out << QString("%1 %2 %3 %4\n").arg(operation.name, -24).arg(operation.runs, 6)
+                       .arg(formatBytes(operation.maxPeakBytes), 12)
+                       .arg(formatBytes(operation.lastResidentDelta), 12);
+        }
+    }
+}
+
+bool Benchmark::checkMemoryBudget(QTextStream &out, const Graph *graph, qint64 memoryBudget)
+{
+    if (memoryBudget <= 0)
+        return true;
+
+    qint64 used = MemoryStats::peakResidentBytes();
+    QString source = "peak rss";
+    if (used == 0) {
+        // Пик процесса недоступен: модель графа плюс наибольший пик операции
+        qint64 operationPeak = 0;
+        for (const MemoryTracker::OperationStats &operation : MemoryTracker::instance().operationStats()) {
+            operationPeak = std::max(operationPeak, operation.maxPeakBytes);
+        }
+        used = MemoryStats::estimateGraphBytes(graph) + operationPeak;
+        source = "tracked peak";
+    }
+
+    const bool ok = used <= memoryBudget;
+    out << QString("\nmemory budget %1: %2 %3 (%4)\n")
+               .arg(MemoryStats::formatBytes(memoryBudget),
+                    ok ? "ok," : "EXCEEDED,",
+                    MemoryStats::formatBytes(used), source);
+    return ok;
+}
+
+int Benchmark::runFormatBenchmark(const QString &filePath, QTextStream &out, qint64 memoryBudget)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        out << QString("Cannot open file %1: %2\n").arg(filePath, file.errorString());
+        return 1;
+    }
+
+    GraphSnapshot snapshot;
+    QString errorMessage;
+    bool loaded;
+    {
+        MEMORY_OPERATION("read");
+        loaded = GraphFile::read(&file, &snapshot, &errorMessage);
+    }
+    if (!loaded) {
+        out << QString("Cannot read graph %1: %2\n").arg(filePath, errorMessage);
+        return 1;
+    }
+    MemoryReservation snapshotBuffer(MemoryTracker::IoBuffers, MemoryStats::estimateSnapshotBytes(snapshot));
+
+    out << QString("Graph: %1 vertices, %2 edges\n")
+               .arg(snapshot.vertices.size()).arg(snapshot.edges.size());
+
+    QElapsedTimer timer;
+
+    // JSON в том виде, в каком его пишет MainWindow::saveGraph
+    FormatResult json;
+    json.name = "json";
+    QByteArray jsonData;
+    {
+        MEMORY_OPERATION("json.write");
+        timer.start();
+        jsonData = QJsonDocument(snapshot.toJson()).toJson();
+        json.writeMs = timer.nsecsElapsed() / 1e6;
+    }
+    json.size = jsonData.size();
+    MemoryReservation jsonBuffer(MemoryTracker::IoBuffers, jsonData.size());
+
+    {
+        MEMORY_OPERATION("json.read");
+        timer.restart();
+        GraphSnapshot jsonCopy;
+        GraphSnapshot::fromJson(QJsonDocument::fromJson(jsonData).object(), &jsonCopy);
+        MemoryReservation copyBuffer(MemoryTracker::IoBuffers, MemoryStats::estimateSnapshotBytes(jsonCopy));
+        json.readMs = timer.nsecsElapsed() / 1e6;
+    }
+
+    // Сжатый контейнер
+    FormatResult compressed;
+    compressed.name = "compressed";
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    {
+        MEMORY_OPERATION("compressed.write");
+        timer.restart();
+        GraphFile::writeCompressed(snapshot, &buffer);
+        compressed.writeMs = timer.nsecsElapsed() / 1e6;
+    }
+    compressed.size = buffer.size();
+    buffer.close();
+    MemoryReservation compressedBuffer(MemoryTracker::IoBuffers, compressed.size);
+
+    buffer.open(QIODevice::ReadOnly);
+    GraphSnapshot compressedCopy;
+    bool ok;
+    {
+        MEMORY_OPERATION("compressed.read");
+        timer.restart();
+        ok = GraphFile::readCompressed(&buffer, &compressedCopy, &errorMessage);
+        compressed.readMs = timer.nsecsElapsed() / 1e6;
+    }
+
+    if (!ok || compressedCopy.vertices.size() != snapshot.vertices.size()) {
+        out << QString("Compressed round trip failed: %1\n").arg(errorMessage);
+        return 1;
+    }
+
+    out << QString("%1 %2 %3 %4 %5 %6 %7\n")
+               .arg("format", -12).arg("bytes", 12).arg("ratio", 7)
+               .arg("write ms", 10).arg("write MB/s", 10)
+               .arg("read ms", 10).arg("read MB/s", 10);
+    printResult(out, json, json.size);
+    printResult(out, compressed, json.size);
+
+    // Модель графа строится, чтобы её объём вошёл в отчёт и бюджет
+    Graph graph;
+    {
+        MEMORY_OPERATION("build");
+        graph.loadSnapshot(snapshot);
+    }
+
+    // Запись модели графа: документ QJsonDocument против потоковой записи.
+    // Потоковый вывод обязан совпадать с документом побайтно.
+    QByteArray domData;
+    double domMs;
+    {
+        MEMORY_OPERATION("json.dom");
+        timer.restart();
+        domData = QJsonDocument(graph.toJson()).toJson();
+        domMs = timer.nsecsElapsed() / 1e6;
+    }
+
+    QBuffer streamBuffer;
+    streamBuffer.open(QIODevice::WriteOnly);
+    double streamMs;
+    {
+        MEMORY_OPERATION("json.stream");
+        timer.restart();
+        GraphWriter::writeJson(&graph, &streamBuffer);
+        streamMs = timer.nsecsElapsed() / 1e6;
+    }
+
+    out << QString("\n%1 %2 %3 %4\n").arg("graph writer", -12).arg("bytes", 12)
+               .arg("write ms", 10).arg("write MB/s", 10);
+    out << QString("%1 %2 %3 %4\n").arg("dom", -12).arg(domData.size(), 12)
+               .arg(domMs, 10, 'f', 1).arg(throughput(domData.size(), domMs), 10, 'f', 1);
+    out << QString("%1 %2 %3 %4\n").arg("stream", -12).arg(streamBuffer.size(), 12)
+               .arg(streamMs, 10, 'f', 1).arg(throughput(streamBuffer.size(), streamMs), 10, 'f', 1);
+
+    if (streamBuffer.data() != domData) {
+        out << "Streaming writer output differs from QJsonDocument\n";
+        return 1;
+    }
+
+    printMemoryReport(out, &graph);
+    if (!checkMemoryBudget(out, &graph, memoryBudget)) {
+        return MEMORY_BUDGET_EXCEEDED;
+    }
+    return 0;
+}
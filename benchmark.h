@@ -0,0 +1,34 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QString>
+#include <QTextStream>
+
+class Graph;
+
+// Замеры производительности, запускаемые из командной строки
+namespace Benchmark {
+
+// Сравнение размера и скорости записи/чтения JSON и сжатого формата для файла графа.
+// Возвращает код завершения процесса.
+// При ненулевом memoryBudget (в байтах) проверяется и бюджет памяти.
+int runFormatBenchmark(const QString &filePath, QTextStream &out, qint64 memoryBudget = 0);
+
+// Прогон всех алгоритмов раскраски по экземплярам DIMACS (*.col) из каталога:
+// число цветов, лучшее известное значение, время. Возвращает код завершения
+// процесса (1, если какая-то раскраска некорректна).
+int runDimacsBenchmark(const QString &directory, QTextStream &out, qint64 memoryBudget = 0);
+
+// Таблица памяти: модель графа, учтённые буферы, пики операций и процесс
+void printMemoryReport(QTextStream &out, const Graph *graph);
+
+// Проверка пика памяти процесса (или учтённой памяти, если пик процесса
+// недоступен) против бюджета. Возвращает false и печатает причину при превышении.
+bool checkMemoryBudget(QTextStream &out, const Graph *graph, qint64 memoryBudget);
+
+// Код завершения при превышении бюджета памяти
+constexpr int MEMORY_BUDGET_EXCEEDED = 2;
+
+} // namespace Benchmark
+
+#endif // BENCHMARK_H
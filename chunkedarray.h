@@ -0,0 +1,88 @@
+#ifndef CHUNKEDARRAY_H
+#define CHUNKEDARRAY_H
+
+#include <QtGlobal>
+#include <QSharedData>
+#include <QSharedDataPointer>
+#include <QVector>
+
+// Класс ChunkedArray - массив с копированием при записи по частям.
+// Элементы лежат в частях по ChunkSize штук, части разделяются между
+// копиями массива через счётчик ссылок. Копия массива стоит O(n / ChunkSize),
+// запись в элемент копирует только его часть, и только если она общая.
+// Копию можно читать в другом потоке, пока владелец пишет в свою:
+// счётчики ссылок атомарны, а общие части не изменяются.
+template <typename T>
+class ChunkedArray
+{
+public:
+    static constexpr int ChunkBits = 10;
+    static constexpr int ChunkSize = 1 << ChunkBits;
+
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+    int chunkCount() const { return m_chunks.size(); }
+
+    const T &at(int index) const
+    {
+        return m_chunks.at(index >> ChunkBits)->values.at(index & (ChunkSize - 1));
+    }
+    const T &operator[](int index) const { return at(index); }
+
+    void set(int index, const T &value)
+    {
+        // Неконстантный operator-> отделяет общую часть
+        m_chunks[index >> ChunkBits]->values[index & (ChunkSize - 1)] = value;
+    }
+
+    void append(const T &value)
+    {
+        if ((m_size & (ChunkSize - 1)) == 0) {
+            Chunk *chunk = new Chunk;
+            chunk->values.reserve(ChunkSize);
+            m_chunks.append(QSharedDataPointer<Chunk>(chunk));
+        }
+        m_chunks.last()->values.append(value);
+        m_size++;
+    }
+
+    void removeLast()
+    {
+        if (m_size == 0)
+            return;
+        m_size--;
+        if ((m_size & (ChunkSize - 1)) == 0) {
+            m_chunks.removeLast();
+        } else {
+            m_chunks.last()->values.removeLast();
+        }
+    }
+
+    // Удаление переносом последнего элемента на место удаляемого,
+    // так же как в SlotMap::remove
+    void swapRemove(int index)
+    {
+        const int lastIndex = m_size - 1;
+        if (index != lastIndex) {
+            set(index, at(lastIndex));
+        }
+        removeLast();
+    }
+
+    void clear()
+    {
+        m_chunks.clear();
+        m_size = 0;
+    }
+
+private:
+    struct Chunk : public QSharedData
+    {
+        QVector<T> values;
+    };
+
+    QVector<QSharedDataPointer<Chunk>> m_chunks;
+    int m_size = 0;
+};
+
+#endif // CHUNKEDARRAY_H
@@ -1,5 +1,10 @@
 #include "coloringalgorithm.h"
-#include <QSet>
+#include "coloringengine.h"
+#include "layerbudget.h"
+#include "coloringcache.h"
+#include "graph.h"
+#include "portfolio.h"
+#include "profiler.h"
 #include <algorithm>
 
 ColoringAlgorithm::ColoringAlgorithm(QObject *parent)
@@ -30,40 +35,153 @@ void ColoringAlgorithm::initColorPalette()
     };
 }
 
-int ColoringAlgorithm::applyGreedyColoring(QList<Vertex*> vertices)
+int ColoringAlgorithm::computeGreedyColoring(const Graph *graph, QVector<int> *colorIndices,
+                                             ColoringEngine::Structure *structure) const
 {
-    // Жадный алгоритм раскраски графа
+    // Распознанные компоненты получают оптимальную раскраску, остальные -
+    // жадную: первый свободный цвет в порядке вершин
+    PROFILE_SCOPE("color.compute");
+    const Adjacency adjacency = Adjacency::fromGraph(graph);
+    const ColoringEngine::Structure recognized =
+        ColoringEngine::colorByStructure(adjacency, ColoringEngine::Engine::Greedy, colorIndices);
+    if (structure) {
+        *structure = recognized;
+    }
+
+    // Компоненты, уже встречавшиеся с лучшей раскраской, берутся из кэша
+    return ColoringCache::instance().improve(adjacency, colorIndices);
+}
 
-    // Сбрасываем цвета вершин
-    for (Vertex *vertex : vertices) {
-        vertex->setColorIndex(-1);
+int ColoringAlgorithm::computePortfolioColoring(const Graph *graph, int deadlineMs, QVector<int> *colorIndices,
+                                                QString *winner, bool *optimal) const
+{
+    return computePortfolioColoring(Adjacency::fromGraph(graph), deadlineMs, colorIndices, winner, optimal);
+}
+
+int ColoringAlgorithm::computePortfolioColoring(const Adjacency &adjacency, int deadlineMs,
+                                                QVector<int> *colorIndices, QString *winner, bool *optimal,
+                                                const std::function<bool()> &cancelled)
+{
+    PROFILE_SCOPE("color.compute");
+    PortfolioColoring portfolio(adjacency);
+    portfolio.setDeadline(deadlineMs);
+    if (cancelled) {
+        portfolio.setCancelCheck(cancelled);
     }
+    const PortfolioColoring::Result result = portfolio.run();
 
-    int maxColor = 0;
+    *colorIndices = result.colors;
+    if (winner) {
+        *winner = PortfolioColoring::memberName(result.winner);
+    }
+    if (optimal) {
+        *optimal = result.optimal;
+    }
+    if (result.optimal)
+        return result.colorCount;
+    return ColoringCache::instance().improve(adjacency, colorIndices);
+}
 
-    // Перебираем все вершины
-    for (Vertex *vertex : vertices) {
-        // Получаем множество использованных цветов у соседей
-        QSet<int> usedColors;
-        for (Vertex *neighbor : vertex->neighbors()) {
-            if (neighbor->colorIndex() != -1) {
-                usedColors.insert(neighbor->colorIndex());
-            }
+bool ColoringAlgorithm::computeBudgetColoring(const Graph *graph, int layerCount, QVector<int> *colorIndices,
+                                              QVector<QPair<int, int>> *conflicts, QString *errorMessage) const
+{
+    PROFILE_SCOPE("color.compute");
+
+    const QList<Vertex*> &vertices = graph->vertices();
+    QVector<int> lockedColors(vertices.size(), -1);
+    bool hasLocked = false;
+    for (int i = 0; i < vertices.size(); ++i) {
+        if (vertices[i]->isLocked()) {
+            lockedColors[i] = vertices[i]->colorIndex();
+            hasLocked = true;
         }
+    }
+
+    const Adjacency adjacency = Adjacency::fromGraph(graph);
+    LayerBudgetSolver solver(adjacency, layerCount);
+    solver.setLockedColors(lockedColors);
+    if (!solver.solve(errorMessage))
+        return false;
+
+    *colorIndices = solver.colors();
+    if (conflicts) {
+        *conflicts = solver.conflictEdges();
+    }
 
-        // Находим минимальный доступный цвет
-        int colorIndex = 0;
-        while (usedColors.contains(colorIndex)) {
-            colorIndex++;
+    // Правильная раскраска без закреплений не хуже любой из кэша в пределах
+    // бюджета и сама может оказаться лучше сохранённой
+    if (!hasLocked && solver.conflictCount() == 0) {
+        ColoringCache::instance().improve(adjacency, colorIndices);
+    }
+    return true;
+}
+
+int ColoringAlgorithm::computeRepairColoring(const Graph *graph, QVector<int> *colorIndices) const
+{
+    PROFILE_SCOPE("color.repair");
+
+    const QList<Vertex*> &vertices = graph->vertices();
+    const Adjacency adjacency = Adjacency::fromGraph(graph);
+    const int vertexCount = vertices.size();
+    QVector<int> &colors = *colorIndices;
+    colors.resize(vertexCount);
+    QVector<char> dirty(vertexCount, 0);
+    for (int v = 0; v < vertexCount; ++v) {
+        colors[v] = vertices[v]->colorIndex();
+        dirty[v] = colors[v] < 0;
+    }
+
+    // Из двух концов конфликтного ребра перекрашивается незакреплённый
+    for (int v = 0; v < vertexCount; ++v) {
+        for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+            const int u = *n;
+            if (u <= v || colors[u] != colors[v] || colors[v] < 0 || dirty[u] || dirty[v])
+                continue;
+            if (!vertices[u]->isLocked()) {
+                dirty[u] = 1;
+            } else if (!vertices[v]->isLocked()) {
+                dirty[v] = 1;
+            }
         }
+    }
 
-        // Присваиваем цвет вершине
-        vertex->setColorIndex(colorIndex);
-        vertex->setColor(m_colorPalette[colorIndex % m_colorPalette.size()]);
+    QVector<int> order;
+    for (int v = 0; v < vertexCount; ++v) {
+        if (dirty[v]) {
+            order.append(v);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&adjacency](int a, int b) {
+        return adjacency.degree(a) > adjacency.degree(b);
+    });
 
-        // Обновляем максимальный использованный цвет
-        maxColor = std::max(maxColor, colorIndex);
+    // Соседи, ещё ждущие перекраски, учитываются со своим прежним цветом:
+    // они сами потом выберут цвет, отличный от уже выбранных
+    QVector<int> used;
+    int stamp = 0;
+    for (int v : std::as_const(order)) {
+        stamp++;
+        for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+            const int color = colors[*n];
+            if (color < 0)
+                continue;
+            if (color >= used.size()) {
+                used.resize(color + 1);
+            }
+            used[color] = stamp;
+        }
+        int color = 0;
+        while (color < used.size() && used[color] == stamp) {
+            color++;
+        }
+        colors[v] = color;
     }
+    return order.size();
+}
 
-    return maxColor + 1; // Возвращаем количество использованных цветов
+QColor ColoringAlgorithm::colorForIndex(int colorIndex) const
+{
+    if (colorIndex < 0 || m_colorPalette.isEmpty())
+        return Qt::white;
+    return m_colorPalette[colorIndex % m_colorPalette.size()];
 }
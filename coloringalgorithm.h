@@ -5,7 +5,13 @@
 #include <QList>
 #include <QVector>
 #include <QColor>
+#include <QPair>
+#include <QString>
+#include <functional>
 #include "vertex.h"
+#include "coloringengine.h"
+
+class Graph;
 
 // Класс ColoringAlgorithm реализует алгоритм раскраски графа
 class ColoringAlgorithm : public QObject
@@ -14,11 +20,45 @@ class ColoringAlgorithm : public QObject
 public:
     explicit ColoringAlgorithm(QObject *parent = nullptr);
 
-    // Применить жадный алгоритм раскраски к списку вершин
-    int applyGreedyColoring(QList<Vertex*> vertices);
+    // Раскраска графа без изменения вершин: colorIndices[i] - номер
+    // цвета i-й вершины из graph->vertices(). Двудольные и хордальные
+    // компоненты раскрашиваются оптимально, остальные - жадно; в structure -
+    // класс графа (см. ColoringEngine::colorByStructure). Связные компоненты,
+    // для которых в ColoringCache есть раскраска с меньшим числом цветов,
+    // получают её. Возвращает число цветов.
+    // Результат применяется одним проходом через Graph::setVertexColorIndices.
+    int computeGreedyColoring(const Graph *graph, QVector<int> *colorIndices,
+                              ColoringEngine::Structure *structure = nullptr) const;
+
+    // Гонка нескольких алгоритмов (PortfolioColoring) со сроком deadlineMs.
+    // В winner - имя алгоритма, давшего лучшую раскраску, в optimal - признак
+    // того, что число цветов доказуемо минимально. Возвращает число цветов.
+    int computePortfolioColoring(const Graph *graph, int deadlineMs, QVector<int> *colorIndices,
+                                 QString *winner = nullptr, bool *optimal = nullptr) const;
+    // То же по готовым спискам смежности, для фоновых потоков; cancelled -
+    // внешняя отмена гонки (см. PortfolioColoring::setCancelCheck)
+    static int computePortfolioColoring(const Adjacency &adjacency, int deadlineMs, QVector<int> *colorIndices,
+                                        QString *winner = nullptr, bool *optimal = nullptr,
+                                        const std::function<bool()> &cancelled = nullptr);
+
+    // Раскраска не более чем в layerCount цветов, закреплённые вершины
+    // сохраняют текущий номер цвета (см. LayerBudgetSolver). В conflicts -
+    // пары номеров вершин, соединённых ребром и оставшихся одного цвета.
+    bool computeBudgetColoring(const Graph *graph, int layerCount, QVector<int> *colorIndices,
+                               QVector<QPair<int, int>> *conflicts, QString *errorMessage) const;
+
+    // Починка текущей раскраски: перекрашиваются только вершины без цвета
+    // и по одному незакреплённому концу каждого ребра с одинаково
+    // раскрашенными концами (первый свободный цвет, от больших степеней к
+    // меньшим). Остальные вершины сохраняют цвет. Возвращает число
+    // перекрашенных вершин.
+    int computeRepairColoring(const Graph *graph, QVector<int> *colorIndices) const;
 
     // Получить палитру цветов
-    QVector<QColor> colorPalette() const { return m_colorPalette; }
+    const QVector<QColor> &colorPalette() const { return m_colorPalette; }
+
+    // Цвет для номера (белый для вершины без цвета)
+    QColor colorForIndex(int colorIndex) const;
 
 private:
     // Палитра доступных цветов для раскраски
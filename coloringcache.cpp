@@ -0,0 +1,431 @@
+#include "coloringcache.h"
+#include "memorystats.h"
+#include "profiler.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+
+namespace {
+
+constexpr quint32 CACHE_MAGIC = 0x43544343;
+constexpr quint32 CACHE_VERSION = 1;
+
+// Маленькие компоненты жадный алгоритм и так раскрашивает хорошо
+constexpr int MIN_COMPONENT_SIZE = 16;
+// Очень большие компоненты не кэшируются, чтобы файл не разрастался
+constexpr int MAX_COMPONENT_EDGES = 1 << 21;
+// Наибольшее число раундов уточнения меток
+constexpr int MAX_REFINE_ROUNDS = 16;
+
+// Перемешивание битов (splitmix64)
+quint64 mix(quint64 x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+int distinctCount(const QVector<quint64> &labels)
+{
+    QVector<quint64> sorted = labels;
+    std::sort(sorted.begin(), sorted.end());
+    return int(std::unique(sorted.begin(), sorted.end()) - sorted.begin());
+}
+
+// Компонента в каноническом порядке вершин
+struct CanonicalForm
+{
+    QVector<int> order;         // order[i] - вершина графа на i-м месте
+    QVector<quint64> edgeKeys;  // (i << 32) | j, i < j, по возрастанию
+    quint64 hash = 0;
+};
+
+// Метки вершин уточняются по меткам соседей, пока число классов растёт.
+// Хеш - от отсортированного набора меток, поэтому не зависит от нумерации.
+// Канонический порядок - по меткам, равные метки упорядочиваются обходом
+// в ширину; при симметриях порядок может зависеть от нумерации, такие
+// случаи отсекает точная проверка рёбер.
+CanonicalForm canonicalForm(const Adjacency &adjacency, const QVector<int> &vertices,
+                            QVector<int> &local)
+{
+    const int count = vertices.size();
+    for (int i = 0; i < count; ++i) {
+        local[vertices[i]] = i;
+    }
+
+    QVector<quint64> labels(count);
+    for (int i = 0; i < count; ++i) {
+        labels[i] = mix(quint64(adjacency.degree(vertices[i])));
+    }
+
+    int classes = distinctCount(labels);
+    QVector<quint64> next(count);
+    for (int round = 0; round < MAX_REFINE_ROUNDS && classes < count; ++round) {
+        for (int i = 0; i < count; ++i) {
+            // Сумма по соседям не зависит от их порядка
+            quint64 sum = 0;
+            const int v = vertices[i];
+            for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+                sum += mix(labels[local[*n]] ^ 0x5851F42D4C957F2Dull);
+            }
+            next[i] = mix(labels[i] + sum);
+        }
+
+        const int refined = distinctCount(next);
+        if (refined <= classes)
+            break;
+        labels.swap(next);
+        classes = refined;
+    }
+
+    CanonicalForm form;
+    QVector<quint64> sortedLabels = labels;
+    std::sort(sortedLabels.begin(), sortedLabels.end());
+    quint64 edgeCount = 0;
+    for (int v : vertices) {
+        edgeCount += quint64(adjacency.degree(v));
+    }
+    form.hash = mix(quint64(count) ^ (edgeCount << 32));
+    for (quint64 label : sortedLabels) {
+        form.hash = mix(form.hash ^ label);
+    }
+
+    // Обход в ширину от вершины с наименьшей меткой, соседи - по возрастанию меток
+    const int start = int(std::min_element(labels.constBegin(), labels.constEnd()) - labels.constBegin());
+    QVector<int> bfsOrder;
+    bfsOrder.reserve(count);
+    QVector<bool> visited(count, false);
+    visited[start] = true;
+    bfsOrder.append(start);
+    QVector<int> pending;
+    for (int head = 0; head < bfsOrder.size(); ++head) {
+        const int v = vertices[bfsOrder[head]];
+        pending.clear();
+        for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+            const int i = local[*n];
+            if (!visited[i]) {
+                visited[i] = true;
+                pending.append(i);
+            }
+        }
+        std::stable_sort(pending.begin(), pending.end(), [&labels](int a, int b) {
+            return labels[a] < labels[b];
+        });
+        bfsOrder += pending;
+    }
+    std::stable_sort(bfsOrder.begin(), bfsOrder.end(), [&labels](int a, int b) {
+        return labels[a] < labels[b];
+    });
+
+    // local переводится из позиции в компоненте в канонический номер
+    form.order.resize(count);
+    for (int i = 0; i < count; ++i) {
+        form.order[i] = vertices[bfsOrder[i]];
+        local[form.order[i]] = i;
+    }
+
+    form.edgeKeys.reserve(int(edgeCount / 2));
+    for (int i = 0; i < count; ++i) {
+        const int v = form.order[i];
+        for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+            const int j = local[*n];
+            if (j > i) {
+                form.edgeKeys.append((quint64(i) << 32) | quint64(j));
+            }
+        }
+    }
+    std::sort(form.edgeKeys.begin(), form.edgeKeys.end());
+    return form;
+}
+
+} // namespace
+
+bool ColoringCache::isValidEntry(const Entry &entry)
+{
+    if (entry.vertexCount < 1 || entry.colors.size() != entry.vertexCount)
+        return false;
+    for (int color : entry.colors) {
+        if (color < 0 || color >= entry.colorCount)
+            return false;
+    }
+    // Раскраска из файла должна быть правильной для сохранённых рёбер
+    for (quint64 key : entry.edgeKeys) {
+        const quint64 i = key >> 32;
+        const quint64 j = key & 0xFFFFFFFFu;
+        if (i >= j || j >= quint64(entry.vertexCount) || entry.colors[int(i)] == entry.colors[int(j)])
+            return false;
+    }
+    return true;
+}
+
+ColoringCache::ColoringCache()
+    : m_loaded(false), m_lastHits(0), m_lastStores(0)
+{
+    m_filePath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+                 + "/colorings.cache";
+}
+
+ColoringCache &ColoringCache::instance()
+{
+    static ColoringCache cache;
+    return cache;
+}
+
+int ColoringCache::improve(const Adjacency &adjacency, QVector<int> *colors)
+{
+    PROFILE_SCOPE("color.cache");
+    {
+        QMutexLocker locker(&m_mutex);
+        ensureLoaded();
+    }
+
+    // Канонические формы считаются без блокировки, под ней - только поиск
+    // и запись, поэтому кэшем могут одновременно пользоваться несколько потоков
+    int hits = 0;
+    int stores = 0;
+
+    const int vertexCount = adjacency.vertexCount();
+    QVector<int> component(vertexCount, -1);
+    QVector<int> local(vertexCount, -1);
+    MemoryReservation buffers(MemoryTracker::Algorithm, qint64(vertexCount) * 4 * qint64(sizeof(int)));
+
+    // Кэшируются только полные раскраски
+    int maxColor = -1;
+    bool complete = true;
+    for (int color : *colors) {
+        complete = complete && color >= 0;
+        maxColor = std::max(maxColor, color);
+    }
+    if (!complete)
+        return maxColor + 1;
+    QVector<int> renumber(maxColor + 1, -1);
+
+    QVector<int> vertices;
+    for (int root = 0; root < vertexCount; ++root) {
+        if (component[root] >= 0)
+            continue;
+
+        // Вершины компоненты обходом в ширину
+        vertices.clear();
+        vertices.append(root);
+        component[root] = root;
+        int edgeEnds = 0;
+        for (int head = 0; head < vertices.size(); ++head) {
+            const int v = vertices[head];
+            edgeEnds += adjacency.degree(v);
+            for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+                if (component[*n] < 0) {
+                    component[*n] = root;
+                    vertices.append(*n);
+                }
+            }
+        }
+        if (vertices.size() < MIN_COMPONENT_SIZE || edgeEnds / 2 > MAX_COMPONENT_EDGES)
+            continue;
+
+        Entry key;
+        CanonicalForm form = canonicalForm(adjacency, vertices, local);
+        key.hash = form.hash;
+        key.vertexCount = vertices.size();
+        key.edgeKeys = std::move(form.edgeKeys);
+
+        // Текущие цвета компоненты, перенумерованные по первому появлению
+        key.colors.resize(key.vertexCount);
+        key.colorCount = 0;
+        for (int i = 0; i < key.vertexCount; ++i) {
+            int &color = renumber[(*colors)[form.order[i]]];
+            if (color < 0) {
+                color = key.colorCount++;
+            }
+            key.colors[i] = color;
+        }
+        for (int v : vertices) {
+            renumber[(*colors)[v]] = -1;
+        }
+
+        QMutexLocker locker(&m_mutex);
+        Entry *entry = find(key);
+        if (entry && entry->colorCount < key.colorCount) {
+            for (int i = 0; i < key.vertexCount; ++i) {
+                (*colors)[form.order[i]] = entry->colors[i];
+            }
+            hits++;
+        } else if (!entry || key.colorCount < entry->colorCount) {
+            if (entry) {
+                entry->colors = key.colors;
+                entry->colorCount = key.colorCount;
+            } else {
+                m_entries.insert(key.hash, key);
+            }
+            append(key);
+            stores++;
+        }
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_lastHits = hits;
+        m_lastStores = stores;
+    }
+
+    int colorCount = 0;
+    for (int color : *colors) {
+        colorCount = std::max(colorCount, color + 1);
+    }
+    return colorCount;
+}
+
+int ColoringCache::lastHitCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_lastHits;
+}
+
+int ColoringCache::lastStoreCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_lastStores;
+}
+
+int ColoringCache::entryCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.size();
+}
+
+void ColoringCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_loaded = true;
+    QFile::remove(m_filePath);
+}
+
+QString ColoringCache::filePath() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_filePath;
+}
+
+void ColoringCache::setFilePath(const QString &filePath)
+{
+    QMutexLocker locker(&m_mutex);
+    m_filePath = filePath;
+    m_entries.clear();
+    m_loaded = false;
+}
+
+void ColoringCache::ensureLoaded()
+{
+    if (m_loaded)
+        return;
+    m_loaded = true;
+
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_12);
+    quint32 magic = 0, version = 0;
+    stream >> magic >> version;
+    if (stream.status() != QDataStream::Ok || magic != CACHE_MAGIC || version != CACHE_VERSION) {
+        // Чужой или старый формат: иначе append дописывал бы записи,
+        // которые уже никогда не прочитаются
+        file.close();
+        writeCompacted();
+        return;
+    }
+
+    // Записи только дописываются: более поздняя запись той же компоненты лучше.
+    // Оборванная или испорченная запись (сбой при дописывании) отрезается
+    // вместе со всем, что за ней, чтобы новые записи шли сразу после последней
+    // целой.
+    qint64 lastGood = file.pos();
+    bool damaged = false;
+    int superseded = 0;
+    while (!stream.atEnd()) {
+        Entry entry;
+        qint32 vertexCount, colorCount;
+        stream >> entry.hash >> vertexCount >> colorCount >> entry.edgeKeys >> entry.colors;
+        if (stream.status() != QDataStream::Ok) {
+            damaged = true;
+            break;
+        }
+        entry.vertexCount = vertexCount;
+        entry.colorCount = colorCount;
+        if (!isValidEntry(entry)) {
+            damaged = true;
+            break;
+        }
+        lastGood = file.pos();
+
+        if (Entry *existing = find(entry)) {
+            superseded++;
+            if (entry.colorCount < existing->colorCount) {
+                existing->colors = entry.colors;
+                existing->colorCount = entry.colorCount;
+            }
+        } else {
+            m_entries.insert(entry.hash, entry);
+        }
+    }
+    file.close();
+
+    // Вытесненных записей больше, чем живых - файл переписывается только
+    // с лучшими раскрасками, иначе он растёт без предела
+    if (superseded > m_entries.size()) {
+        writeCompacted();
+    } else if (damaged) {
+        QFile::resize(m_filePath, lastGood);
+    }
+}
+
+void ColoringCache::writeCompacted()
+{
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream << CACHE_MAGIC << CACHE_VERSION;
+    for (const Entry &entry : std::as_const(m_entries)) {
+        stream << entry.hash << qint32(entry.vertexCount) << qint32(entry.colorCount)
+               << entry.edgeKeys << entry.colors;
+    }
+    file.commit();
+}
+
+void ColoringCache::append(const Entry &entry)
+{
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_12);
+    if (file.size() == 0) {
+        stream << CACHE_MAGIC << CACHE_VERSION;
+    }
+    stream << entry.hash << qint32(entry.vertexCount) << qint32(entry.colorCount)
+           << entry.edgeKeys << entry.colors;
+}
+
+ColoringCache::Entry *ColoringCache::find(const Entry &key)
+{
+    // Совпадение хеша проверяется сравнением рёбер в каноническом порядке
+    for (auto it = m_entries.find(key.hash); it != m_entries.end() && it.key() == key.hash; ++it) {
+        if (it->vertexCount == key.vertexCount && it->edgeKeys == key.edgeKeys)
+            return &it.value();
+    }
+    return nullptr;
+}
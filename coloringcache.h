@@ -0,0 +1,66 @@
+#ifndef COLORINGCACHE_H
+#define COLORINGCACHE_H
+
+#include <QtGlobal>
+#include <QMultiHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include "coloringengine.h"
+
+// Класс ColoringCache хранит лучшие найденные раскраски связных компонент.
+// Ключ - структурный хеш компоненты (уточнение меток в духе
+// Вейсфейлера-Лемана), совпадение проверяется точно: рёбра компоненты
+// в каноническом порядке вершин должны совпасть с сохранёнными. Кэш общий
+// для всех графов и дописывается в файл в QStandardPaths::CacheLocation.
+class ColoringCache
+{
+public:
+    static ColoringCache &instance();
+
+    // Улучшение раскраски colors[v] раскрасками из кэша: компонента получает
+    // сохранённую раскраску, если в ней меньше цветов. Компоненты, для которых
+    // colors лучше сохранённого, записываются в кэш. Возвращает число цветов.
+    int improve(const Adjacency &adjacency, QVector<int> *colors);
+
+    // Итоги последнего завершившегося вызова improve
+    int lastHitCount() const;
+    int lastStoreCount() const;
+
+    int entryCount() const;
+
+    // Очистка кэша вместе с файлом
+    void clear();
+
+    // Файл кэша (по умолчанию - в каталоге кэша приложения)
+    QString filePath() const;
+    void setFilePath(const QString &filePath);
+
+private:
+    struct Entry
+    {
+        quint64 hash;
+        int vertexCount;
+        QVector<quint64> edgeKeys;  // Рёбра в каноническом порядке вершин
+        QVector<int> colors;        // Цвета в каноническом порядке вершин
+        int colorCount;
+    };
+
+    ColoringCache();
+
+    mutable QMutex m_mutex;
+    QMultiHash<quint64, Entry> m_entries;
+    QString m_filePath;
+    bool m_loaded;
+    int m_lastHits;
+    int m_lastStores;
+
+    static bool isValidEntry(const Entry &entry);
+    void ensureLoaded();
+    void append(const Entry &entry);
+    // Файл заново: заголовок и по одной записи на компоненту
+    void writeCompacted();
+    Entry *find(const Entry &key);
+};
+
+#endif // COLORINGCACHE_H
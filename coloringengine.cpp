@@ -0,0 +1,402 @@
+#include "coloringengine.h"
+#include "graphsnapshot.h"
+#include "graphversion.h"
+#include "graph.h"
+#include "memorystats.h"
+#include "profiler.h"
+#include <QHash>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// Сборка CSR по записям снимка или версии: оба контейнера дают size() и operator[]
+template <typename VertexRecords, typename EdgeRecords>
+Adjacency adjacencyFromRecords(const VertexRecords &vertices, const EdgeRecords &edges)
+{
+    const int vertexCount = vertices.size();
+
+    QHash<int, int> idToIndex;
+    idToIndex.reserve(vertexCount);
+    for (int i = 0; i < vertexCount; ++i) {
+        idToIndex.insert(vertices[i].id, i);
+    }
+
+    // Концы рёбер в виде позиций, подсчёт степеней
+    QVector<int> endpoints;
+    endpoints.reserve(edges.size() * 2);
+    QVector<int> degrees(vertexCount, 0);
+    for (int i = 0; i < edges.size(); ++i) {
+        const int source = idToIndex.value(edges[i].sourceId, -1);
+        const int dest = idToIndex.value(edges[i].destId, -1);
+        if (source < 0 || dest < 0 || source == dest)
+            continue;
+        endpoints.append(source);
+        endpoints.append(dest);
+        degrees[source]++;
+        degrees[dest]++;
+    }
+
+    Adjacency adjacency;
+    adjacency.offsets.resize(vertexCount + 1);
+    adjacency.offsets[0] = 0;
+    for (int v = 0; v < vertexCount; ++v) {
+        adjacency.offsets[v + 1] = adjacency.offsets[v] + degrees[v];
+    }
+
+    // Раскладка соседей по местам, degrees используется как курсор
+    adjacency.neighbors.resize(endpoints.size());
+    std::copy(adjacency.offsets.constBegin(), adjacency.offsets.constEnd() - 1, degrees.begin());
+    for (int i = 0; i < endpoints.size(); i += 2) {
+        const int source = endpoints[i];
+        const int dest = endpoints[i + 1];
+        adjacency.neighbors[degrees[source]++] = dest;
+        adjacency.neighbors[degrees[dest]++] = source;
+    }
+    return adjacency;
+}
+
+} // namespace
+
+Adjacency Adjacency::fromSnapshot(const GraphSnapshot &snapshot)
+{
+    return adjacencyFromRecords(snapshot.vertices, snapshot.edges);
+}
+
+Adjacency Adjacency::fromVersion(const GraphVersion &version)
+{
+    return adjacencyFromRecords(version.vertices(), version.edges());
+}
+
+Adjacency Adjacency::fromGraph(const Graph *graph)
+{
+    const QList<Vertex*> &vertices = graph->vertices();
+    const QList<Edge*> &edges = graph->edges();
+
+    Adjacency adjacency;
+    adjacency.offsets.resize(vertices.size() + 1);
+    adjacency.offsets[0] = 0;
+    for (int v = 0; v < vertices.size(); ++v) {
+        adjacency.offsets[v + 1] = adjacency.offsets[v] + vertices[v]->degree();
+    }
+
+    // Курсоры заполнения для каждой вершины
+    QVector<int> cursor(adjacency.offsets.constBegin(), adjacency.offsets.constEnd() - 1);
+    adjacency.neighbors.resize(adjacency.offsets.last());
+    for (Edge *edge : edges) {
+        const int source = graph->vertexIndex(edge->sourceVertex());
+        const int dest = graph->vertexIndex(edge->destVertex());
+        adjacency.neighbors[cursor[source]++] = dest;
+        adjacency.neighbors[cursor[dest]++] = source;
+    }
+    return adjacency;
+}
+
+namespace {
+
+// Жадная раскраска в заданном порядке. Занятые цвета отмечаются номером
+// текущей вершины, поэтому массив отметок не нужно очищать между вершинами.
+int colorInOrder(const Adjacency &adjacency, const QVector<int> &order, QVector<int> *colors)
+{
+    const int vertexCount = adjacency.vertexCount();
+    colors->fill(-1, vertexCount);
+
+    QVector<int> usedBy(vertexCount + 1, -1);
+    MemoryReservation buffers(MemoryTracker::Algorithm,
+                              qint64(usedBy.size() + order.size()) * qint64(sizeof(int)));
+
+    int colorCount = 0;
+    for (int vertex : order) {
+        for (const int *n = adjacency.neighborsBegin(vertex); n != adjacency.neighborsEnd(vertex); ++n) {
+            const int neighborColor = (*colors)[*n];
+            if (neighborColor >= 0) {
+                usedBy[neighborColor] = vertex;
+            }
+        }
+
+        int color = 0;
+        while (usedBy[color] == vertex) {
+            color++;
+        }
+        (*colors)[vertex] = color;
+        colorCount = std::max(colorCount, color + 1);
+    }
+    return colorCount;
+}
+
+// Лексикографический поиск в ширину уточнением разбиения. Непройденные
+// вершины лежат в seq группами с одинаковой меткой, группы с большей меткой
+// левее. Соседи очередной вершины переносятся в новую группу прямо перед
+// своей, поэтому первая вершина seq[head] всегда имеет наибольшую метку.
+// По окончании seq - порядок обхода. Время O(n + m).
+QVector<int> lexBfsOrder(const Adjacency &adjacency)
+{
+    const int vertexCount = adjacency.vertexCount();
+    QVector<int> seq(vertexCount);
+    QVector<int> position(vertexCount);
+    std::iota(seq.begin(), seq.end(), 0);
+    std::iota(position.begin(), position.end(), 0);
+    QVector<int> group(vertexCount, 0);
+    QVector<char> visited(vertexCount, 0);
+
+    // Группа занимает seq[groupStart[g] .. начало следующей группы)
+    QVector<int> groupStart{ 0 };
+    QVector<int> groupSplit{ -1 };  // Новая группа, отделённая от g на текущем шаге
+    QVector<int> touched;
+    MemoryReservation buffers(MemoryTracker::Algorithm,
+                              qint64(vertexCount) * 4 * qint64(sizeof(int))
+                                  + qint64(adjacency.neighbors.size()) * 2 * qint64(sizeof(int)));
+
+    for (int head = 0; head < vertexCount; ++head) {
+        const int v = seq[head];
+        visited[v] = 1;
+        groupStart[group[v]]++;
+
+        for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+            const int w = *n;
+            if (visited[w])
+                continue;
+
+            const int g = group[w];
+            int split = groupSplit[g];
+            if (split < 0) {
+                split = groupStart.size();
+                groupStart.append(groupStart[g]);
+                groupSplit.append(-1);
+                groupSplit[g] = split;
+                touched.append(g);
+            }
+
+            // w меняется местами с первой вершиной своей группы, граница
+            // группы сдвигается на одну позицию вправо
+            const int first = groupStart[g];
+            const int u = seq[first];
+            seq[first] = w;
+            seq[position[w]] = u;
+            position[u] = position[w];
+            position[w] = first;
+            groupStart[g]++;
+            group[w] = split;
+        }
+
+        for (int g : std::as_const(touched)) {
+            groupSplit[g] = -1;
+        }
+        touched.clear();
+    }
+    return seq;
+}
+
+} // namespace
+
+QList<ColoringEngine::Engine> ColoringEngine::engines()
+{
+    return { Engine::Greedy, Engine::LargestFirst, Engine::Structured };
+}
+
+QString ColoringEngine::engineName(Engine engine)
+{
+    switch (engine) {
+    case Engine::Greedy:
+        return QStringLiteral("greedy");
+    case Engine::LargestFirst:
+        return QStringLiteral("largest-first");
+    case Engine::Structured:
+        return QStringLiteral("structured");
+    }
+    return QString();
+}
+
+QString ColoringEngine::structureName(Structure structure)
+{
+    switch (structure) {
+    case Structure::Edgeless:
+        return QStringLiteral("edgeless");
+    case Structure::Bipartite:
+        return QStringLiteral("bipartite");
+    case Structure::Chordal:
+        return QStringLiteral("chordal");
+    case Structure::General:
+        return QStringLiteral("general");
+    }
+    return QString();
+}
+
+int ColoringEngine::color(const Adjacency &adjacency, Engine engine, QVector<int> *colors)
+{
+    PROFILE_SCOPE("engine.color");
+
+    if (engine == Engine::Structured) {
+        colorByStructure(adjacency, Engine::LargestFirst, colors);
+        return colors->isEmpty() ? 0 : *std::max_element(colors->constBegin(), colors->constEnd()) + 1;
+    }
+
+    QVector<int> order(adjacency.vertexCount());
+    std::iota(order.begin(), order.end(), 0);
+
+    if (engine == Engine::LargestFirst) {
+        std::stable_sort(order.begin(), order.end(), [&adjacency](int a, int b) {
+            return adjacency.degree(a) > adjacency.degree(b);
+        });
+    }
+
+    return colorInOrder(adjacency, order, colors);
+}
+
+ColoringEngine::Structure ColoringEngine::colorByStructure(const Adjacency &adjacency, Engine fallback,
+                                                           QVector<int> *colors)
+{
+    PROFILE_SCOPE("engine.structure");
+
+    const int vertexCount = adjacency.vertexCount();
+    QVector<int> component(vertexCount, -1);
+    QVector<int> side(vertexCount, -1);
+    QVector<Structure> componentStructure;
+    QVector<int> queue;
+    queue.reserve(vertexCount);
+    MemoryReservation buffers(MemoryTracker::Algorithm, qint64(vertexCount) * 3 * qint64(sizeof(int)));
+
+    // Компоненты связности и попытка 2-раскраски обходом в ширину.
+    // Недвудольная компонента пока считается хордальной и проверяется ниже.
+    bool hasChordal = false;
+    for (int root = 0; root < vertexCount; ++root) {
+        if (component[root] >= 0)
+            continue;
+
+        const int c = componentStructure.size();
+        Structure structure = adjacency.degree(root) == 0 ? Structure::Edgeless : Structure::Bipartite;
+        queue.clear();
+        queue.append(root);
+        component[root] = c;
+        side[root] = 0;
+        for (int head = 0; head < queue.size(); ++head) {
+            const int v = queue[head];
+            for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+                const int w = *n;
+                if (component[w] < 0) {
+                    component[w] = c;
+                    side[w] = 1 - side[v];
+                    queue.append(w);
+                } else if (side[w] == side[v]) {
+                    structure = Structure::Chordal;
+                }
+            }
+        }
+        hasChordal = hasChordal || structure == Structure::Chordal;
+        componentStructure.append(structure);
+    }
+
+    // Граф хордален, если обратный к LexBFS порядок - совершенный порядок
+    // исключения: пройденные раньше v соседи образуют клику. Проверка по
+    // Тарьяну-Яннакакису: каждый из них, кроме пройденного последним
+    // родителя p, должен быть соседом p. Требования группируются по p.
+    QVector<int> order;
+    if (hasChordal) {
+        order = lexBfsOrder(adjacency);
+        QVector<int> rank(vertexCount);
+        for (int i = 0; i < vertexCount; ++i) {
+            rank[order[i]] = i;
+        }
+
+        QVector<int> parent(vertexCount, -1);
+        QVector<int> requiredOffsets(vertexCount + 1, 0);
+        for (int v = 0; v < vertexCount; ++v) {
+            if (componentStructure[component[v]] != Structure::Chordal)
+                continue;
+            int earlier = 0;
+            for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+                if (rank[*n] < rank[v]) {
+                    earlier++;
+                    if (parent[v] < 0 || rank[*n] > rank[parent[v]]) {
+                        parent[v] = *n;
+                    }
+                }
+            }
+            if (earlier > 1) {
+                requiredOffsets[parent[v] + 1] += earlier - 1;
+            }
+        }
+        for (int v = 0; v < vertexCount; ++v) {
+            requiredOffsets[v + 1] += requiredOffsets[v];
+        }
+
+        QVector<int> required(requiredOffsets.last());
+        QVector<int> cursor(requiredOffsets.constBegin(), requiredOffsets.constEnd() - 1);
+        for (int v = 0; v < vertexCount; ++v) {
+            if (parent[v] < 0)
+                continue;
+            for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+                if (rank[*n] < rank[v] && *n != parent[v]) {
+                    required[cursor[parent[v]]++] = *n;
+                }
+            }
+        }
+
+        QVector<int> mark(vertexCount, -1);
+        for (int p = 0; p < vertexCount; ++p) {
+            if (requiredOffsets[p] == requiredOffsets[p + 1])
+                continue;
+            for (const int *n = adjacency.neighborsBegin(p); n != adjacency.neighborsEnd(p); ++n) {
+                mark[*n] = p;
+            }
+            for (int i = requiredOffsets[p]; i < requiredOffsets[p + 1]; ++i) {
+                if (mark[required[i]] != p) {
+                    componentStructure[component[p]] = Structure::General;
+                    break;
+                }
+            }
+        }
+    }
+
+    Structure result = Structure::Edgeless;
+    for (Structure structure : std::as_const(componentStructure)) {
+        result = std::max(result, structure);
+    }
+
+    // Хордальная компонента жадно в порядке LexBFS получает ω цветов: уже
+    // раскрашенные соседи вершины образуют клику. Компоненты независимы,
+    // поэтому раскраски всего графа можно брать покомпонентно.
+    QVector<int> chordalColors;
+    if (hasChordal) {
+        colorInOrder(adjacency, order, &chordalColors);
+    }
+    QVector<int> fallbackColors;
+    if (result == Structure::General) {
+        color(adjacency, fallback == Engine::Structured ? Engine::LargestFirst : fallback, &fallbackColors);
+    }
+
+    colors->resize(vertexCount);
+    for (int v = 0; v < vertexCount; ++v) {
+        switch (componentStructure[component[v]]) {
+        case Structure::Edgeless:
+            (*colors)[v] = 0;
+            break;
+        case Structure::Bipartite:
+            (*colors)[v] = side[v];
+            break;
+        case Structure::Chordal:
+            (*colors)[v] = chordalColors[v];
+            break;
+        case Structure::General:
+            (*colors)[v] = fallbackColors[v];
+            break;
+        }
+    }
+    return result;
+}
+
+bool ColoringEngine::isProperColoring(const Adjacency &adjacency, const QVector<int> &colors)
+{
+    if (colors.size() != adjacency.vertexCount())
+        return false;
+
+    for (int v = 0; v < adjacency.vertexCount(); ++v) {
+        if (colors[v] < 0)
+            return false;
+        for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+            if (colors[*n] == colors[v])
+                return false;
+        }
+    }
+    return true;
+}
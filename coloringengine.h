@@ -0,0 +1,72 @@
+#ifndef COLORINGENGINE_H
+#define COLORINGENGINE_H
+
+#include <QList>
+#include <QString>
+#include <QVector>
+
+struct GraphSnapshot;
+class GraphVersion;
+class Graph;
+
+// Списки смежности в сжатом виде (CSR): соседи вершины v занимают
+// neighbors[offsets[v] .. offsets[v + 1]). Вершины нумеруются позицией
+// в снимке. Структура не содержит QObject и подходит для фоновых потоков
+// и больших экземпляров, которые незачем загружать в Graph.
+struct Adjacency
+{
+    QVector<int> offsets;
+    QVector<int> neighbors;
+
+    int vertexCount() const { return offsets.isEmpty() ? 0 : offsets.size() - 1; }
+    int edgeCount() const { return neighbors.size() / 2; }
+    int degree(int vertex) const { return offsets[vertex + 1] - offsets[vertex]; }
+
+    const int *neighborsBegin(int vertex) const { return neighbors.constData() + offsets[vertex]; }
+    const int *neighborsEnd(int vertex) const { return neighbors.constData() + offsets[vertex + 1]; }
+
+    static Adjacency fromSnapshot(const GraphSnapshot &snapshot);
+    static Adjacency fromVersion(const GraphVersion &version);
+    // Вершины нумеруются позицией в graph->vertices()
+    static Adjacency fromGraph(const Graph *graph);
+};
+
+// Алгоритмы раскраски над Adjacency
+namespace ColoringEngine {
+
+enum class Engine {
+    Greedy,        // Первый свободный цвет в порядке вершин (как в ColoringAlgorithm)
+    LargestFirst,  // То же в порядке убывания степени (Welsh-Powell)
+    Structured     // Оптимально для распознанных компонент (см. colorByStructure),
+                   // остальные - как LargestFirst
+};
+
+// Классы графов, раскрашиваемых оптимально за линейное время. Интервальные
+// графы (конфликты трассировки в канале) - частный случай хордальных.
+// Классы упорядочены от частного к общему.
+enum class Structure {
+    Edgeless,   // Нет рёбер: один цвет
+    Bipartite,  // Двудольный (2-раскраска обходом в ширину): два цвета
+    Chordal,    // Хордальный (LexBFS даёт совершенный порядок исключения): ω цветов
+    General     // Класс не распознан, оптимальность не гарантируется
+};
+
+QList<Engine> engines();
+QString engineName(Engine engine);
+QString structureName(Structure structure);
+
+// Раскраска: colors[v] - номер цвета вершины v. Возвращает число цветов.
+int color(const Adjacency &adjacency, Engine engine, QVector<int> *colors);
+
+// Распознавание класса каждой компоненты связности. Распознанные компоненты
+// раскрашиваются оптимально, остальные - движком fallback (Structured
+// трактуется как LargestFirst). Возвращает самый общий класс среди
+// компонент: если это не General, раскраска заведомо оптимальна.
+Structure colorByStructure(const Adjacency &adjacency, Engine fallback, QVector<int> *colors);
+
+// Проверка, что концы каждого ребра раскрашены в разные цвета
+bool isProperColoring(const Adjacency &adjacency, const QVector<int> &colors);
+
+} // namespace ColoringEngine
+
+#endif // COLORINGENGINE_H
@@ -0,0 +1,583 @@
+#include "coloringservice.h"
+#include "coloringcache.h"
+#include "coloringengine.h"
+#include "graphfile.h"
+#include "graphsnapshot.h"
+#include "localmessage.h"
+#include "profiler.h"
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+enum RequestType : qint32 {
+    ColorRequest = 1,
+    StatsRequest = 2,  // Ответ - сводка задержек сервера
+    StopRequest = 3    // Ответ - сводка, затем сервер завершается
+};
+
+const int CONNECT_TIMEOUT_MS = 5000;
+// Проверка, не занято ли имя работающим сервером
+const int PROBE_TIMEOUT_MS = 500;
+const int REPLY_TIMEOUT_MS = 600000;
+// Кадр длиннее считается испорченным, соединение закрывается
+const qint64 MAX_FRAME_SIZE = qint64(1) << 30;
+// Сводка в журнал сервера через каждые столько запросов
+const int LOG_INTERVAL = 1000;
+// Последние задержки, по которым считаются перцентили
+const int LATENCY_WINDOW = 4096;
+
+double elapsedMs(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1e6;
+}
+
+// Перцентиль по ближайшему рангу, samples отсортированы
+double percentile(const QVector<double> &samples, double p)
+{
+    if (samples.isEmpty())
+        return 0;
+    const int rank = int(std::ceil(p * samples.size())) - 1;
+    return samples[std::clamp(rank, 0, int(samples.size()) - 1)];
+}
+
+struct Timings
+{
+    double parseMs = 0;
+    double queueMs = 0;  // От приёма запроса до начала работы в пуле
+    double colorMs = 0;
+    double totalMs = 0;  // От приёма запроса до отправки ответа
+};
+
+// Задержки запросов: перцентили полной задержки по последним запросам
+// и средние по этапам за всё время
+class LatencyStats
+{
+public:
+    LatencyStats() : m_next(0), m_count(0), m_failures(0) {}
+
+    void add(const Timings &timings, bool ok)
+    {
+        if (m_totals.size() < LATENCY_WINDOW) {
+            m_totals.append(timings.totalMs);
+        } else {
+            m_totals[m_next] = timings.totalMs;
+        }
+        m_next = (m_next + 1) % LATENCY_WINDOW;
+
+        m_count++;
+        if (!ok) {
+            m_failures++;
+        }
+        m_sum.parseMs += timings.parseMs;
+        m_sum.queueMs += timings.queueMs;
+        m_sum.colorMs += timings.colorMs;
+        m_sum.totalMs += timings.totalMs;
+    }
+
+    qint64 count() const { return m_count; }
+
+    QString report() const
+    {
+        QVector<double> sorted = m_totals;
+        std::sort(sorted.begin(), sorted.end());
+        const double count = std::max<qint64>(m_count, 1);
+        return QString("%1 requests, %2 failed; latency ms p50 %3, p95 %4, p99 %5, max %6; "
+                       "mean ms parse %7, queue %8, color %9")
+            .arg(m_count).arg(m_failures)
+            .arg(percentile(sorted, 0.50), 0, 'f', 2)
+            .arg(percentile(sorted, 0.95), 0, 'f', 2)
+            .arg(percentile(sorted, 0.99), 0, 'f', 2)
+            .arg(sorted.isEmpty() ? 0.0 : sorted.last(), 0, 'f', 2)
+            .arg(m_sum.parseMs / count, 0, 'f', 2)
+            .arg(m_sum.queueMs / count, 0, 'f', 2)
+            .arg(m_sum.colorMs / count, 0, 'f', 2);
+    }
+
+private:
+    QVector<double> m_totals;
+    int m_next;
+    qint64 m_count;
+    qint64 m_failures;
+    Timings m_sum;
+};
+
+struct ColorResult
+{
+    bool ok = false;
+    QString error;
+    QVector<qint32> vertexIds;
+    QVector<qint32> colors;
+    qint32 colorCount = 0;
+    Timings timings;
+};
+
+// Разбор графа и раскраска, выполняется в потоке пула
+ColorResult colorGraph(const QString &engineName, const QByteArray &data, const QElapsedTimer &received)
+{
+    PROFILE_SCOPE("service.request");
+    ColorResult result;
+    result.timings.queueMs = elapsedMs(received);
+
+    ColoringEngine::Engine engine = ColoringEngine::Engine::Greedy;
+    if (!engineName.isEmpty()) {
+        const QList<ColoringEngine::Engine> engines = ColoringEngine::engines();
+        auto it = std::find_if(engines.cbegin(), engines.cend(), [&engineName](ColoringEngine::Engine e) {
+            return ColoringEngine::engineName(e).compare(engineName, Qt::CaseInsensitive) == 0;
+        });
+        if (it == engines.cend()) {
+            result.error = QString("Unknown engine '%1'").arg(engineName);
+            return result;
+        }
+        engine = *it;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    GraphSnapshot snapshot;
+    if (!GraphFile::read(&buffer, &snapshot, &result.error))
+        return result;
+    result.timings.parseMs = elapsedMs(timer);
+
+    // Та же раскраска, что и в пакетном режиме: движок и кэш компонент
+    timer.restart();
+    const Adjacency adjacency = Adjacency::fromSnapshot(snapshot);
+    QVector<int> colors;
+    ColoringEngine::color(adjacency, engine, &colors);
+    result.colorCount = ColoringCache::instance().improve(adjacency, &colors);
+    result.timings.colorMs = elapsedMs(timer);
+
+    result.vertexIds.reserve(snapshot.vertices.size());
+    for (const GraphSnapshot::VertexRecord &record : std::as_const(snapshot.vertices)) {
+        result.vertexIds.append(record.id);
+    }
+    result.colors = colors;
+    result.ok = true;
+    return result;
+}
+
+// Сервер работает в цикле событий главного потока: читает кадры из всех
+// соединений, раздаёт раскраску в глобальный пул потоков и отправляет
+// ответы по мере готовности
+class Server
+{
+public:
+    explicit Server(QTextStream &out)
+        : m_out(out), m_nextConnection(0), m_inFlight(0), m_stopping(false)
+    {
+    }
+
+    bool listen(const QString &serverName, QString *errorMessage)
+    {
+        // Сокет, оставшийся от упавшего сервера, мешает listen. Удаляется
+        // он только если на нём никто не отвечает: иначе работающий сервер
+        // остался бы без сокета и стал недоступен
+        QLocalSocket probe;
+        probe.connectToServer(serverName);
+        if (probe.waitForConnected(PROBE_TIMEOUT_MS)) {
+            probe.disconnectFromServer();
+            *errorMessage = QString("a coloring service is already running");
+            return false;
+        }
+        QLocalServer::removeServer(serverName);
+        m_server.setSocketOptions(QLocalServer::UserAccessOption);
+        if (!m_server.listen(serverName)) {
+            *errorMessage = m_server.errorString();
+            return false;
+        }
+        QObject::connect(&m_server, &QLocalServer::newConnection, &m_server, [this]() {
+            acceptConnections();
+        });
+        return true;
+    }
+
+    QString fullServerName() const { return m_server.fullServerName(); }
+    QString report() const { return m_stats.report(); }
+
+private:
+    struct Connection
+    {
+        QLocalSocket *socket = nullptr;
+        QByteArray buffer;  // Принятые байты незавершённого кадра
+        bool reading = false;
+    };
+
+    QTextStream &m_out;
+    QLocalServer m_server;
+    QHash<quint64, Connection> m_connections;
+    quint64 m_nextConnection;
+    int m_inFlight;
+    bool m_stopping;
+    LatencyStats m_stats;
+
+    void acceptConnections()
+    {
+        while (QLocalSocket *socket = m_server.nextPendingConnection()) {
+            const quint64 connectionId = ++m_nextConnection;
+            Connection connection;
+            connection.socket = socket;
+            m_connections.insert(connectionId, connection);
+
+            QObject::connect(socket, &QLocalSocket::readyRead, &m_server, [this, connectionId]() {
+                readRequests(connectionId);
+            });
+            // Ответы на запросы закрытого соединения отбрасываются в sendReply
+            QObject::connect(socket, &QLocalSocket::disconnected, &m_server, [this, connectionId, socket]() {
+                m_connections.remove(connectionId);
+                socket->deleteLater();
+            });
+        }
+    }
+
+    void readRequests(quint64 connectionId)
+    {
+        auto it = m_connections.find(connectionId);
+        // Повторный вход (readyRead из ожидания в flushReplies): данные
+        // дочитает внешний вызов
+        if (it == m_connections.end() || it->reading)
+            return;
+
+        it->reading = true;
+        QLocalSocket *socket = it->socket;
+        QByteArray buffer = it->buffer;
+        it->buffer.clear();
+
+        // Обработка запроса может отправлять ответы синхронно и закрыть
+        // соединение, поэтому после каждого запроса оно ищется заново
+        int offset = 0;
+        while (socket->bytesAvailable() > 0) {
+            buffer += socket->readAll();
+            while (true) {
+                const qint64 length = LocalMessage::peekLength(buffer, offset);
+                if (length < 0)
+                    break;
+                if (length > MAX_FRAME_SIZE) {
+                    log(QString("Dropping connection %1: frame of %2 bytes").arg(connectionId).arg(length));
+                    // abort посылает disconnected, соединение удаляется
+                    socket->abort();
+                    return;
+                }
+                if (buffer.size() - offset - LocalMessage::HEADER_SIZE < length)
+                    break;
+
+                QElapsedTimer received;
+                received.start();
+                handleRequest(connectionId, buffer.mid(offset + LocalMessage::HEADER_SIZE, int(length)), received);
+                offset += LocalMessage::HEADER_SIZE + int(length);
+                if (!m_connections.contains(connectionId))
+                    return;
+            }
+        }
+
+        it = m_connections.find(connectionId);
+        if (it == m_connections.end())
+            return;
+        it->buffer = buffer.mid(offset);
+        it->reading = false;
+    }
+
+    void handleRequest(quint64 connectionId, const QByteArray &payload, const QElapsedTimer &received)
+    {
+        QDataStream stream(payload);
+        stream.setVersion(QDataStream::Qt_5_12);
+        qint32 type;
+        quint32 requestId;
+        stream >> type >> requestId;
+        if (stream.status() != QDataStream::Ok) {
+            log(QString("Malformed request on connection %1").arg(connectionId));
+            return;
+        }
+
+        if (type == ColorRequest) {
+            QString engineName;
+            QByteArray data;
+            stream >> engineName >> data;
+            if (stream.status() != QDataStream::Ok) {
+                ColorResult result;
+                result.error = QString("Malformed color request");
+                finishColor(connectionId, requestId, result, received);
+                return;
+            }
+
+            // После StopRequest новые раскраски не начинаются: ответ на них
+            // мог бы не успеть уйти до выхода из цикла событий
+            if (m_stopping) {
+                ColorResult result;
+                result.error = QString("Coloring service is stopping");
+                finishColor(connectionId, requestId, result, received);
+                return;
+            }
+
+            m_inFlight++;
+            QThreadPool::globalInstance()->start([this, connectionId, requestId, engineName, data, received]() {
+                const ColorResult result = colorGraph(engineName, data, received);
+                QMetaObject::invokeMethod(&m_server, [this, connectionId, requestId, result, received]() {
+                    m_inFlight--;
+                    finishColor(connectionId, requestId, result, received);
+                    if (m_stopping && m_inFlight == 0) {
+                        QCoreApplication::quit();
+                    }
+                }, Qt::QueuedConnection);
+            });
+            return;
+        }
+
+        if (type == StatsRequest || type == StopRequest) {
+            const QString text = m_stats.report();
+            sendReply(connectionId, LocalMessage::encode([requestId, &text](QDataStream &out) {
+                out << requestId << true << text;
+            }));
+            if (type == StopRequest) {
+                log(QString("Stopping: %1").arg(text));
+                flushReplies();
+                // Начатые раскраски досчитываются, их ответы отправляются
+                m_stopping = true;
+                m_server.close();
+                if (m_inFlight == 0) {
+                    QCoreApplication::quit();
+                }
+            }
+            return;
+        }
+
+        log(QString("Unknown request type %1 on connection %2").arg(type).arg(connectionId));
+    }
+
+    void finishColor(quint64 connectionId, quint32 requestId, ColorResult result, const QElapsedTimer &received)
+    {
+        result.timings.totalMs = elapsedMs(received);
+        m_stats.add(result.timings, result.ok);
+
+        const QByteArray payload = LocalMessage::encode([requestId, &result](QDataStream &out) {
+            out << requestId << result.ok << result.error << result.vertexIds << result.colors
+                << result.colorCount << result.timings.parseMs << result.timings.queueMs
+                << result.timings.colorMs << result.timings.totalMs;
+        });
+        sendReply(connectionId, payload);
+
+        if (m_stats.count() % LOG_INTERVAL == 0) {
+            log(m_stats.report());
+        }
+        if (m_stopping) {
+            flushReplies();
+        }
+    }
+
+    void sendReply(quint64 connectionId, const QByteArray &payload)
+    {
+        auto it = m_connections.constFind(connectionId);
+        if (it == m_connections.constEnd())
+            return;
+        it.value().socket->write(LocalMessage::frame(payload));
+    }
+
+    // Перед выходом из цикла событий ответы отправляются синхронно
+    void flushReplies()
+    {
+        // Ожидание может послать disconnected, и обработчик удалит
+        // соединение из m_connections: обход идёт по копии
+        QVector<QPointer<QLocalSocket>> sockets;
+        for (const Connection &connection : std::as_const(m_connections)) {
+            sockets.append(connection.socket);
+        }
+        for (const QPointer<QLocalSocket> &socket : std::as_const(sockets)) {
+            while (socket && socket->state() == QLocalSocket::ConnectedState && socket->bytesToWrite() > 0) {
+                if (!socket->waitForBytesWritten(CONNECT_TIMEOUT_MS))
+                    break;
+            }
+        }
+    }
+
+    void log(const QString &message)
+    {
+        m_out << message << '\n';
+        m_out.flush();
+    }
+};
+
+struct ClientReply
+{
+    quint32 requestId = 0;
+    bool ok = false;
+    QString error;
+    QVector<qint32> vertexIds;
+    QVector<qint32> colors;
+    qint32 colorCount = 0;
+    Timings timings;
+};
+
+bool readReply(QLocalSocket *socket, bool colorReply, ClientReply *reply, QString *errorMessage)
+{
+    QByteArray payload;
+    if (!LocalMessage::read(socket, &payload, REPLY_TIMEOUT_MS)) {
+        *errorMessage = QString("No reply from server: %1").arg(socket->errorString());
+        return false;
+    }
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream >> reply->requestId >> reply->ok >> reply->error;
+    if (colorReply) {
+        stream >> reply->vertexIds >> reply->colors >> reply->colorCount >> reply->timings.parseMs
+            >> reply->timings.queueMs >> reply->timings.colorMs >> reply->timings.totalMs;
+    }
+    if (stream.status() != QDataStream::Ok) {
+        *errorMessage = QString("Malformed reply from server");
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int ColoringService::runServer(const QString &serverName, QTextStream &out)
+{
+    // Потоки пула не завершаются между запросами
+    QThreadPool::globalInstance()->setExpiryTimeout(-1);
+
+    Server server(out);
+    QString errorMessage;
+    if (!server.listen(serverName, &errorMessage)) {
+        out << QString("Cannot listen on %1: %2\n").arg(serverName, errorMessage);
+        return 1;
+    }
+    out << QString("Coloring service listening on %1 (%2 threads)\n")
+               .arg(server.fullServerName())
+               .arg(QThreadPool::globalInstance()->maxThreadCount());
+    out.flush();
+
+    const int exitCode = QCoreApplication::exec();
+    QThreadPool::globalInstance()->waitForDone();
+    out << server.report() << '\n';
+    return exitCode;
+}
+
+int ColoringService::runClient(const QString &serverName, const QStringList &files, int repeat, int pipeline,
+                               bool stopServer, QTextStream &out)
+{
+    QVector<QByteArray> graphs;
+    for (const QString &filePath : files) {
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            out << QString("Cannot open %1: %2\n").arg(filePath, file.errorString());
+            return 1;
+        }
+        graphs.append(file.readAll());
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+    if (!socket.waitForConnected(CONNECT_TIMEOUT_MS)) {
+        out << QString("Cannot connect to %1: %2\n").arg(serverName, socket.errorString());
+        return 1;
+    }
+
+    const int total = graphs.size() * std::max(1, repeat);
+    pipeline = std::max(1, pipeline);
+    QHash<quint32, QElapsedTimer> sent;
+    QVector<double> roundTrips;
+    roundTrips.reserve(total);
+    QVector<int> colorCounts(graphs.size(), -1);
+    QVector<int> vertexCounts(graphs.size(), 0);
+    Timings serverSum;
+    int failures = 0;
+    QString errorMessage;
+
+    QElapsedTimer wallTimer;
+    wallTimer.start();
+    int next = 0;
+    int received = 0;
+    while (received < total) {
+        // Конвейер: до pipeline запросов без ожидания ответов
+        while (next < total && sent.size() < pipeline) {
+            const QByteArray payload = LocalMessage::encode([next, &graphs](QDataStream &stream) {
+                stream << qint32(ColorRequest) << quint32(next) << QString() << graphs[next % graphs.size()];
+            });
+            QElapsedTimer timer;
+            timer.start();
+            sent.insert(quint32(next), timer);
+            socket.write(LocalMessage::frame(payload));
+            next++;
+        }
+        socket.flush();
+
+        ClientReply reply;
+        if (!readReply(&socket, true, &reply, &errorMessage)) {
+            out << errorMessage << '\n';
+            return 1;
+        }
+        if (!sent.contains(reply.requestId)) {
+            out << QString("Unexpected reply %1\n").arg(reply.requestId);
+            return 1;
+        }
+        roundTrips.append(elapsedMs(sent.take(reply.requestId)));
+        received++;
+
+        const int graphIndex = int(reply.requestId) % graphs.size();
+        if (!reply.ok) {
+            failures++;
+            out << QString("%1: %2\n").arg(files[graphIndex], reply.error);
+            continue;
+        }
+        colorCounts[graphIndex] = reply.colorCount;
+        vertexCounts[graphIndex] = reply.vertexIds.size();
+        serverSum.parseMs += reply.timings.parseMs;
+        serverSum.queueMs += reply.timings.queueMs;
+        serverSum.colorMs += reply.timings.colorMs;
+        serverSum.totalMs += reply.timings.totalMs;
+    }
+    const double wallMs = elapsedMs(wallTimer);
+
+    for (int i = 0; i < graphs.size(); ++i) {
+        if (colorCounts[i] >= 0) {
+            out << QString("%1: %2 vertices, %3 colors\n").arg(files[i]).arg(vertexCounts[i]).arg(colorCounts[i]);
+        }
+    }
+
+    std::sort(roundTrips.begin(), roundTrips.end());
+    const double succeeded = std::max(1, total - failures);
+    out << QString("%1 requests (%2 failed), pipeline %3: %4 ms, %5 requests/s\n")
+               .arg(total).arg(failures).arg(pipeline)
+               .arg(wallMs, 0, 'f', 1)
+               .arg(wallMs > 0 ? total * 1000.0 / wallMs : 0.0, 0, 'f', 1);
+    out << QString("Round trip ms: p50 %1, p95 %2, p99 %3, max %4\n")
+               .arg(percentile(roundTrips, 0.50), 0, 'f', 2)
+               .arg(percentile(roundTrips, 0.95), 0, 'f', 2)
+               .arg(percentile(roundTrips, 0.99), 0, 'f', 2)
+               .arg(roundTrips.isEmpty() ? 0.0 : roundTrips.last(), 0, 'f', 2);
+    out << QString("Server mean ms: parse %1, queue %2, color %3, total %4\n")
+               .arg(serverSum.parseMs / succeeded, 0, 'f', 2)
+               .arg(serverSum.queueMs / succeeded, 0, 'f', 2)
+               .arg(serverSum.colorMs / succeeded, 0, 'f', 2)
+               .arg(serverSum.totalMs / succeeded, 0, 'f', 2);
+
+    // Сводка сервера за всё время его работы
+    const qint32 type = stopServer ? StopRequest : StatsRequest;
+    if (!LocalMessage::write(&socket, LocalMessage::encode([type, total](QDataStream &stream) {
+            stream << type << quint32(total);
+        }), REPLY_TIMEOUT_MS)) {
+        out << QString("Cannot send request: %1\n").arg(socket.errorString());
+        return 1;
+    }
+    ClientReply reply;
+    if (!readReply(&socket, false, &reply, &errorMessage)) {
+        out << errorMessage << '\n';
+        return 1;
+    }
+    out << QString("Server: %1\n").arg(reply.error);
+
+    socket.disconnectFromServer();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+#ifndef COLORINGSERVICE_H
+#define COLORINGSERVICE_H
+
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+// Служба раскраски: долгоживущий процесс без интерфейса принимает графы
+// через локальный сокет (QLocalServer: сокет Unix в Linux и macOS,
+// именованный канал в Windows) и возвращает раскраски. Пул потоков и кэш
+// компонент (ColoringCache) остаются прогретыми между запросами.
+//
+// Сообщения - кадры LocalMessage. Запрос раскраски: qint32 ColorRequest,
+// quint32 номер запроса, QString движок (пусто - жадная раскраска, как
+// в окне программы), QByteArray с содержимым файла графа любого
+// поддерживаемого формата (JSON, сжатый контейнер, DIMACS, KiCad). Ответ: quint32
+// номер запроса, bool успех, QString ошибка, QVector<qint32> идентификаторы
+// вершин, QVector<qint32> цвета, qint32 число цветов и задержки этапов
+// в миллисекундах (double): разбор, ожидание в пуле, раскраска, всего
+// от приёма запроса до отправки ответа.
+// Запросы одного соединения можно слать, не дожидаясь ответов: они
+// обрабатываются параллельно, ответы приходят по мере готовности и
+// сопоставляются по номеру.
+// StatsRequest и StopRequest (qint32 тип, quint32 номер) возвращают номер,
+// true и текстовую сводку задержек сервера; после StopRequest сервер
+// досчитывает начатые запросы и завершается.
+namespace ColoringService {
+
+// Сервер: обработка запросов до StopRequest. Возвращает код завершения процесса.
+int runServer(const QString &serverName, QTextStream &out);
+
+// Клиент для проверки: каждый файл отправляется repeat раз, в полёте
+// держится до pipeline запросов. Печатает задержки и пропускную способность.
+// stopServer - после запросов остановить сервер.
+int runClient(const QString &serverName, const QStringList &files, int repeat, int pipeline,
+              bool stopServer, QTextStream &out);
+
+} // namespace ColoringService
+
+#endif // COLORINGSERVICE_H
@@ -0,0 +1,299 @@
+#include "console.h"
+#include "benchmark.h"
+#include "batchrunner.h"
+#include "coloringservice.h"
+#include "distributedcoloring.h"
+#include "externalcoloring.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+#include <cstring>
+
+namespace {
+
+// Опции, включающие консольный режим
+const char *const CONSOLE_OPTIONS[] = {
+    "--benchmark-format",
+    "--bench-dimacs",
+    "--batch",
+    "--distributed",
+    "--worker",
+    "--external-color",
+    "--serve",
+    "--client",
+};
+
+} // namespace
+
+bool Console::isConsoleCommand(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        for (const char *option : CONSOLE_OPTIONS) {
+            if (std::strcmp(argv[i], option) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int Console::run(const QStringList &arguments)
+{
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QCoreApplication::translate("Console",
+                                                                 "Graph Coloring for PCB Routing"));
+    parser.addHelpOption();
+
+    QCommandLineOption benchmarkFormatOption("benchmark-format",
+                                             QCoreApplication::translate("Console",
+                                                                         "Compare JSON and compressed storage for <file>."),
+                                             "file");
+    parser.addOption(benchmarkFormatOption);
+
+    QCommandLineOption benchDimacsOption("bench-dimacs",
+                                         QCoreApplication::translate("Console",
+                                                                     "Run every coloring engine over the DIMACS instances (*.col) in <dir>."),
+                                         "dir");
+    parser.addOption(benchDimacsOption);
+
+    QCommandLineOption memoryBudgetOption("memory-budget",
+                                          QCoreApplication::translate("Console",
+                                                                      "Fail with exit code 2 if peak memory exceeds <MiB>."),
+                                          "MiB");
+    parser.addOption(memoryBudgetOption);
+
+    QCommandLineOption batchOption("batch",
+                                   QCoreApplication::translate("Console",
+                                                               "Color every graph file in <dir> (recursively) or listed in the manifest <file>."),
+                                   "dir|file");
+    parser.addOption(batchOption);
+
+    QCommandLineOption batchOutputOption("batch-output",
+                                         QCoreApplication::translate("Console",
+                                                                     "Save colored graphs under <dir> instead of in place."),
+                                         "dir");
+    parser.addOption(batchOutputOption);
+
+    QCommandLineOption batchSummaryOption("batch-summary",
+                                          QCoreApplication::translate("Console",
+                                                                      "Write the per-file CSV summary to <file>."),
+                                          "file");
+    parser.addOption(batchSummaryOption);
+
+    QCommandLineOption jobsOption("jobs",
+                                  QCoreApplication::translate("Console",
+                                                              "Number of batch worker threads (default: number of cores)."),
+                                  "n");
+    parser.addOption(jobsOption);
+
+    QCommandLineOption batchMemoryOption("batch-memory",
+                                         QCoreApplication::translate("Console",
+                                                                     "Limit the estimated memory of files in flight to <MiB>."),
+                                         "MiB");
+    parser.addOption(batchMemoryOption);
+
+    QCommandLineOption distributedOption("distributed",
+                                         QCoreApplication::translate("Console",
+                                                                     "Color <file> in separate worker processes and report scaling per worker count."),
+                                         "file");
+    parser.addOption(distributedOption);
+
+    QCommandLineOption workersOption("workers",
+                                     QCoreApplication::translate("Console",
+                                                                 "Comma-separated worker process counts for --distributed (default: 1,2,4)."),
+                                     "list");
+    parser.addOption(workersOption);
+
+    QCommandLineOption distributedOutputOption("distributed-output",
+                                               QCoreApplication::translate("Console",
+                                                                           "Save the coloring of the last --distributed run to <file>."),
+                                               "file");
+    parser.addOption(distributedOutputOption);
+
+    QCommandLineOption externalOption("external-color",
+                                      QCoreApplication::translate("Console",
+                                                                  "Color the DIMACS graph <file> out of core, keeping only per-vertex state in memory."),
+                                      "file");
+    parser.addOption(externalOption);
+
+    QCommandLineOption externalMemoryOption("external-memory",
+                                            QCoreApplication::translate("Console",
+                                                                        "Sort buffer for --external-color in <MiB> (default: 64)."),
+                                            "MiB");
+    parser.addOption(externalMemoryOption);
+
+    QCommandLineOption externalOutputOption("external-output",
+                                            QCoreApplication::translate("Console",
+                                                                        "Save the --external-color coloring to <file> as '<vertex> <color>' lines."),
+                                            "file");
+    parser.addOption(externalOutputOption);
+
+    QCommandLineOption serveOption("serve",
+                                   QCoreApplication::translate("Console",
+                                                               "Run the coloring service on the local socket <name> until stopped."),
+                                   "name");
+    parser.addOption(serveOption);
+
+    QCommandLineOption clientOption("client",
+                                    QCoreApplication::translate("Console",
+                                                                "Send the graph files given as arguments to the coloring service <name>."),
+                                    "name");
+    parser.addOption(clientOption);
+
+    QCommandLineOption repeatOption("repeat",
+                                    QCoreApplication::translate("Console",
+                                                                "Send every --client file <n> times (default: 1)."),
+                                    "n");
+    parser.addOption(repeatOption);
+
+    QCommandLineOption pipelineOption("pipeline",
+                                      QCoreApplication::translate("Console",
+                                                                  "Keep up to <n> --client requests in flight (default: 8)."),
+                                      "n");
+    parser.addOption(pipelineOption);
+
+    QCommandLineOption stopServerOption("stop-server",
+                                        QCoreApplication::translate("Console",
+                                                                    "Stop the coloring service after the --client requests."));
+    parser.addOption(stopServerOption);
+
+    parser.addPositionalArgument("files",
+                                 QCoreApplication::translate("Console", "Graph files for --client."),
+                                 "[files...]");
+
+    // Рабочий процесс распределённой раскраски, запускается координатором
+    QCommandLineOption workerOption("worker", QString(), "server");
+    workerOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    parser.addOption(workerOption);
+
+    parser.process(arguments);
+
+    if (parser.isSet(workerOption)) {
+        return DistributedColoring::runWorker(parser.value(workerOption));
+    }
+
+    qint64 memoryBudget = 0;
+    if (parser.isSet(memoryBudgetOption)) {
+        bool ok = false;
+        const double megabytes = parser.value(memoryBudgetOption).toDouble(&ok);
+        if (!ok || megabytes <= 0) {
+            out << QString("Invalid memory budget: %1\n").arg(parser.value(memoryBudgetOption));
+            return 1;
+        }
+        memoryBudget = qint64(megabytes * 1024 * 1024);
+    }
+
+    if (parser.isSet(batchOption)) {
+        BatchRunner::Options options;
+        options.input = parser.value(batchOption);
+        options.outputDirectory = parser.value(batchOutputOption);
+        options.summaryPath = parser.value(batchSummaryOption);
+
+        if (parser.isSet(jobsOption)) {
+            bool ok = false;
+            options.threadCount = parser.value(jobsOption).toInt(&ok);
+            if (!ok || options.threadCount <= 0) {
+                out << QString("Invalid number of jobs: %1\n").arg(parser.value(jobsOption));
+                return 1;
+            }
+        }
+        if (parser.isSet(batchMemoryOption)) {
+            bool ok = false;
+            const double megabytes = parser.value(batchMemoryOption).toDouble(&ok);
+            if (!ok || megabytes <= 0) {
+                out << QString("Invalid batch memory limit: %1\n").arg(parser.value(batchMemoryOption));
+                return 1;
+            }
+            options.memoryLimit = qint64(megabytes * 1024 * 1024);
+        }
+
+        BatchRunner runner(options);
+        const int exitCode = runner.run(out);
+        if (memoryBudget > 0 && !Benchmark::checkMemoryBudget(out, nullptr, memoryBudget))
+            return Benchmark::MEMORY_BUDGET_EXCEEDED;
+        return exitCode;
+    }
+    if (parser.isSet(distributedOption)) {
+        QList<int> workerCounts = { 1, 2, 4 };
+        if (parser.isSet(workersOption)) {
+            workerCounts.clear();
+            const QStringList values = parser.value(workersOption).split(',', Qt::SkipEmptyParts);
+            for (const QString &value : values) {
+                bool ok = false;
+                const int count = value.trimmed().toInt(&ok);
+                if (!ok || count <= 0) {
+                    out << QString("Invalid worker count: %1\n").arg(value);
+                    return 1;
+                }
+                workerCounts.append(count);
+            }
+        }
+
+        const int exitCode = DistributedColoring::runScaling(parser.value(distributedOption), workerCounts,
+                                                             parser.value(distributedOutputOption), out);
+        if (memoryBudget > 0 && !Benchmark::checkMemoryBudget(out, nullptr, memoryBudget))
+            return Benchmark::MEMORY_BUDGET_EXCEEDED;
+        return exitCode;
+    }
+    if (parser.isSet(externalOption)) {
+        ExternalColoring::Options options;
+        options.inputPath = parser.value(externalOption);
+        options.outputPath = parser.value(externalOutputOption);
+        if (parser.isSet(externalMemoryOption)) {
+            bool ok = false;
+            const double megabytes = parser.value(externalMemoryOption).toDouble(&ok);
+            if (!ok || megabytes <= 0) {
+                out << QString("Invalid sort buffer size: %1\n").arg(parser.value(externalMemoryOption));
+                return 1;
+            }
+            options.memoryLimit = qint64(megabytes * 1024 * 1024);
+        }
+
+        const int exitCode = ExternalColoring::run(options, out);
+        if (memoryBudget > 0 && !Benchmark::checkMemoryBudget(out, nullptr, memoryBudget))
+            return Benchmark::MEMORY_BUDGET_EXCEEDED;
+        return exitCode;
+    }
+    if (parser.isSet(serveOption)) {
+        return ColoringService::runServer(parser.value(serveOption), out);
+    }
+    if (parser.isSet(clientOption)) {
+        const QStringList files = parser.positionalArguments();
+        if (files.isEmpty()) {
+            out << QString("No graph files for --client\n");
+            return 1;
+        }
+        int repeat = 1;
+        if (parser.isSet(repeatOption)) {
+            bool ok = false;
+            repeat = parser.value(repeatOption).toInt(&ok);
+            if (!ok || repeat <= 0) {
+                out << QString("Invalid repeat count: %1\n").arg(parser.value(repeatOption));
+                return 1;
+            }
+        }
+        int pipeline = 8;
+        if (parser.isSet(pipelineOption)) {
+            bool ok = false;
+            pipeline = parser.value(pipelineOption).toInt(&ok);
+            if (!ok || pipeline <= 0) {
+                out << QString("Invalid pipeline depth: %1\n").arg(parser.value(pipelineOption));
+                return 1;
+            }
+        }
+
+        return ColoringService::runClient(parser.value(clientOption), files, repeat, pipeline,
+                                          parser.isSet(stopServerOption), out);
+    }
+    if (parser.isSet(benchmarkFormatOption)) {
+        return Benchmark::runFormatBenchmark(parser.value(benchmarkFormatOption), out, memoryBudget);
+    }
+    if (parser.isSet(benchDimacsOption)) {
+        return Benchmark::runDimacsBenchmark(parser.value(benchDimacsOption), out, memoryBudget);
+    }
+
+    parser.showHelp(1);
+    return 1;
+}
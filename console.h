@@ -0,0 +1,18 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <QStringList>
+
+// Консольные режимы приложения (замеры, пакетная обработка),
+// работающие без графического интерфейса
+namespace Console {
+
+// Есть ли среди аргументов команда консольного режима
+bool isConsoleCommand(int argc, char *argv[]);
+
+// Выполнение консольной команды, возвращает код завершения процесса
+int run(const QStringList &arguments);
+
+} // namespace Console
+
+#endif // CONSOLE_H
@@ -0,0 +1,284 @@
+#include "dimacs.h"
+#include <QHash>
+#include <QObject>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace {
+
+// Размер блока чтения и буфера записи
+constexpr int CHUNK_SIZE = 1 << 16;
+// Шаг сетки, по которой раскладываются вершины
+constexpr double GRID_SPACING = 60.0;
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Разбор неотрицательного целого с позиции *pos, пропуская пробелы
+bool parseNumber(const char *line, int length, int *pos, qint64 *value)
+{
+    int i = *pos;
+    while (i < length && isSpace(line[i])) {
+        i++;
+    }
+    if (i >= length || line[i] < '0' || line[i] > '9')
+        return false;
+
+    qint64 result = 0;
+    while (i < length && line[i] >= '0' && line[i] <= '9') {
+        result = result * 10 + (line[i] - '0');
+        if (result > INT_MAX)
+            return false;
+        i++;
+    }
+    *pos = i;
+    *value = result;
+    return true;
+}
+
+// Разбор файла по строкам
+class LineParser
+{
+public:
+    LineParser(GraphSnapshot *snapshot)
+        : m_snapshot(snapshot), m_vertexCount(-1), m_lineNumber(0)
+    {
+    }
+
+    bool parseLine(const char *line, int length)
+    {
+        m_lineNumber++;
+
+        int pos = 0;
+        while (pos < length && isSpace(line[pos])) {
+            pos++;
+        }
+        if (pos >= length)
+            return true;
+
+        switch (line[pos]) {
+        case 'c':
+            return true;
+        case 'p':
+            return parseProblem(line, length, pos + 1);
+        case 'e':
+            return parseEdge(line, length, pos + 1);
+        default:
+            // Прочие строки (n, x и т.п.) в раскраске не используются
+            return true;
+        }
+    }
+
+    bool finish()
+    {
+        if (m_vertexCount < 0)
+            return fail(QObject::tr("Missing 'p edge' line."));
+
+        // Рёбра без повторов в порядке возрастания концов
+        std::sort(m_edgeKeys.begin(), m_edgeKeys.end());
+        m_edgeKeys.erase(std::unique(m_edgeKeys.begin(), m_edgeKeys.end()), m_edgeKeys.end());
+
+        m_snapshot->edges.clear();
+        m_snapshot->edges.reserve(m_edgeKeys.size());
+        for (quint64 key : m_edgeKeys) {
+            GraphSnapshot::EdgeRecord record;
+            record.sourceId = int(key >> 32);
+            record.destId = int(key & 0xFFFFFFFFu);
+            m_snapshot->edges.append(record);
+        }
+        return true;
+    }
+
+    QString errorMessage() const { return m_errorMessage; }
+
+private:
+    GraphSnapshot *m_snapshot;
+    int m_vertexCount;
+    int m_lineNumber;
+    QVector<quint64> m_edgeKeys;
+    QString m_errorMessage;
+
+    bool fail(const QString &message)
+    {
+        m_errorMessage = message;
+        return false;
+    }
+
+    bool parseProblem(const char *line, int length, int pos)
+    {
+        if (m_vertexCount >= 0)
+            return fail(QObject::tr("Duplicate 'p' line at line %1.").arg(m_lineNumber));
+
+        // Формат задачи: "edge" или устаревший "col"
+        while (pos < length && isSpace(line[pos])) {
+            pos++;
+        }
+        const int formatStart = pos;
+        while (pos < length && !isSpace(line[pos])) {
+            pos++;
+        }
+        const QByteArray format(line + formatStart, pos - formatStart);
+        if (format != "edge" && format != "col")
+            return fail(QObject::tr("Unsupported problem format '%1' at line %2.")
+                            .arg(QString::fromLatin1(format)).arg(m_lineNumber));
+
+        qint64 vertices, edges;
+        if (!parseNumber(line, length, &pos, &vertices) || !parseNumber(line, length, &pos, &edges))
+            return fail(QObject::tr("Malformed 'p' line at line %1.").arg(m_lineNumber));
+
+        m_vertexCount = int(vertices);
+        const int columns = std::max(1, int(std::ceil(std::sqrt(double(m_vertexCount)))));
+
+        m_snapshot->vertices.clear();
+        m_snapshot->vertices.reserve(m_vertexCount);
+        for (int i = 0; i < m_vertexCount; ++i) {
+            GraphSnapshot::VertexRecord record;
+            record.id = i;
+            record.x = (i % columns) * GRID_SPACING;
+            record.y = (i / columns) * GRID_SPACING;
+            record.colorIndex = -1;
+            record.locked = false;
+            m_snapshot->vertices.append(record);
+        }
+        m_snapshot->maxColor = 0;
+
+        // Число рёбер в заголовке часто учитывает оба направления
+        m_edgeKeys.reserve(int(std::min<qint64>(edges, 1 << 24)));
+        return true;
+    }
+
+    bool parseEdge(const char *line, int length, int pos)
+    {
+        if (m_vertexCount < 0)
+            return fail(QObject::tr("Edge before 'p' line at line %1.").arg(m_lineNumber));
+
+        qint64 u, v;
+        if (!parseNumber(line, length, &pos, &u) || !parseNumber(line, length, &pos, &v))
+            return fail(QObject::tr("Malformed edge at line %1.").arg(m_lineNumber));
+        if (u < 1 || v < 1 || u > m_vertexCount || v > m_vertexCount)
+            return fail(QObject::tr("Edge endpoint out of range at line %1.").arg(m_lineNumber));
+
+        if (u == v)
+            return true;
+
+        const quint64 a = quint64(std::min(u, v) - 1);
+        const quint64 b = quint64(std::max(u, v) - 1);
+        m_edgeKeys.append((a << 32) | b);
+        return true;
+    }
+};
+
+} // namespace
+
+bool DimacsFile::read(QIODevice *device, GraphSnapshot *snapshot, QString *errorMessage)
+{
+    LineParser parser(snapshot);
+    auto fail = [&]() {
+        if (errorMessage) {
+            *errorMessage = parser.errorMessage();
+        }
+        return false;
+    };
+
+    // Блоки читаются целиком, незавершённая строка переносится в следующий блок
+    QByteArray buffer;
+    buffer.reserve(CHUNK_SIZE * 2);
+    while (true) {
+        const int carried = buffer.size();
+        buffer.resize(carried + CHUNK_SIZE);
+        const qint64 bytesRead = device->read(buffer.data() + carried, CHUNK_SIZE);
+        if (bytesRead < 0) {
+            if (errorMessage) {
+                *errorMessage = device->errorString();
+            }
+            return false;
+        }
+        buffer.resize(carried + int(bytesRead));
+
+        const bool atEnd = bytesRead == 0;
+        const char *data = buffer.constData();
+        int lineStart = 0;
+        for (int i = 0; i < buffer.size(); ++i) {
+            if (data[i] == '\n') {
+                if (!parser.parseLine(data + lineStart, i - lineStart))
+                    return fail();
+                lineStart = i + 1;
+            }
+        }
+
+        if (atEnd) {
+            if (lineStart < buffer.size() && !parser.parseLine(data + lineStart, buffer.size() - lineStart))
+                return fail();
+            break;
+        }
+        buffer.remove(0, lineStart);
+    }
+
+    if (!parser.finish())
+        return fail();
+    return true;
+}
+
+bool DimacsFile::write(const GraphSnapshot &snapshot, QIODevice *device, QString *errorMessage)
+{
+    // Вершины нумеруются с 1 в порядке снимка
+    QHash<int, int> idToNumber;
+    idToNumber.reserve(snapshot.vertices.size());
+    for (int i = 0; i < snapshot.vertices.size(); ++i) {
+        idToNumber.insert(snapshot.vertices[i].id, i + 1);
+    }
+
+    QByteArray buffer;
+    buffer.reserve(CHUNK_SIZE + 64);
+    auto flush = [&]() {
+        if (device->write(buffer) != buffer.size()) {
+            if (errorMessage) {
+                *errorMessage = device->errorString();
+            }
+            return false;
+        }
+        buffer.resize(0);
+        return true;
+    };
+
+    buffer += "c Graph Coloring for PCB Routing\n";
+    buffer += "p edge ";
+    buffer += QByteArray::number(snapshot.vertices.size());
+    buffer += ' ';
+    buffer += QByteArray::number(snapshot.edges.size());
+    buffer += '\n';
+
+    for (const GraphSnapshot::EdgeRecord &record : snapshot.edges) {
+        const int source = idToNumber.value(record.sourceId);
+        const int dest = idToNumber.value(record.destId);
+        if (source == 0 || dest == 0)
+            continue;
+
+        buffer += "e ";
+        buffer += QByteArray::number(source);
+        buffer += ' ';
+        buffer += QByteArray::number(dest);
+        buffer += '\n';
+
+        if (buffer.size() >= CHUNK_SIZE && !flush())
+            return false;
+    }
+    return flush();
+}
+
+bool DimacsFile::probe(QIODevice *device)
+{
+    const QByteArray head = device->peek(CHUNK_SIZE);
+    for (int i = 0; i < head.size(); ++i) {
+        const char c = head[i];
+        if (isSpace(c) || c == '\n')
+            continue;
+        if (c != 'c' && c != 'p')
+            return false;
+        return i + 1 >= head.size() || isSpace(head[i + 1]) || head[i + 1] == '\n';
+    }
+    return false;
+}
@@ -0,0 +1,28 @@
+#ifndef DIMACS_H
+#define DIMACS_H
+
+#include <QIODevice>
+#include <QString>
+#include "graphsnapshot.h"
+
+// Класс DimacsFile читает и пишет графы в формате DIMACS (.col):
+//   c <комментарий>
+//   p edge <вершин> <рёбер>
+//   e <u> <v>           (вершины нумеруются с 1)
+// Чтение потоковое, по строкам, без промежуточных копий файла.
+// Повторные рёбра (во многих экземплярах ребро записано в обе стороны)
+// и петли отбрасываются. Координат в формате нет, поэтому вершины
+// раскладываются по сетке.
+class DimacsFile
+{
+public:
+    static bool read(QIODevice *device, GraphSnapshot *snapshot, QString *errorMessage = nullptr);
+    static bool write(const GraphSnapshot &snapshot, QIODevice *device, QString *errorMessage = nullptr);
+
+    // Похоже ли содержимое на DIMACS (первая значащая строка 'c' или 'p')
+    static bool probe(QIODevice *device);
+
+    static const char *suffix() { return "col"; }
+};
+
+#endif // DIMACS_H
@@ -0,0 +1,550 @@
+#include "distributedcoloring.h"
+#include "graphfile.h"
+#include "graphsnapshot.h"
+#include "localmessage.h"
+#include "memorystats.h"
+#include "partition.h"
+#include "profiler.h"
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QSaveFile>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// Сообщения координатора рабочему процессу
+enum MessageType : qint32 {
+    SetupMessage = 1,    // Часть графа; ответ - раскраска всех её вершин
+    RecolorMessage = 2,  // Цвета соседей из других частей и вершины на перекраску
+    FinishMessage = 3
+};
+
+const int CONNECT_TIMEOUT_MS = 30000;
+const int REPLY_TIMEOUT_MS = 600000;
+const int FINISH_TIMEOUT_MS = 5000;
+// После стольких раундов оставшиеся конфликты разрешает координатор
+const int MAX_RESOLVE_ROUNDS = 64;
+
+std::atomic<int> serverCounter(0);
+
+double elapsedMs(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1e6;
+}
+
+// Первый цвет, не занятый соседями. used - рабочий массив отметок.
+int firstFreeColor(const int *begin, const int *end, const QVector<int> &colors,
+                   QVector<int> &used, int stamp)
+{
+    for (const int *n = begin; n != end; ++n) {
+        const int color = colors[*n];
+        if (color >= 0) {
+            if (color >= used.size()) {
+                used.resize(color + 1);
+            }
+            used[color] = stamp;
+        }
+    }
+    int color = 0;
+    while (color < used.size() && used[color] == stamp) {
+        color++;
+    }
+    return color;
+}
+
+// Приоритет вершины в конфликте: перекрашивается конец с меньшим значением
+quint64 priority(int vertex)
+{
+    quint64 x = quint64(vertex) + 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+bool losesTo(int vertex, int other)
+{
+    const quint64 a = priority(vertex);
+    const quint64 b = priority(other);
+    return a < b || (a == b && vertex < other);
+}
+
+// Рабочий процесс и его часть графа. Вершины части нумеруются локально
+// с нуля, соседи из других частей ("призраки") - номерами от localCount.
+struct Worker
+{
+    QProcess process;
+    QLocalSocket *socket = nullptr;
+    QVector<int> globalIds;   // Локальный номер -> номер в графе
+    QVector<int> ghostIds;    // Номер призрака - localCount -> номер в графе
+    QVector<int> offsets;
+    QVector<int> neighbors;
+    QVector<int> pending;     // Вершины (глобальные номера) текущего раунда перекраски
+};
+
+class Coordinator
+{
+public:
+    ~Coordinator() { shutdown(); }
+
+    bool start(int workerCount, QString *errorMessage);
+    bool colorParts(const Adjacency &adjacency, const QVector<int> &parts, QVector<int> *colors,
+                    QString *errorMessage);
+    bool resolve(const Adjacency &adjacency, const QVector<int> &parts, QVector<int> *colors,
+                 int *rounds, qint64 *recolored, QString *errorMessage);
+    void shutdown();
+
+private:
+    QLocalServer m_server;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+};
+
+bool Coordinator::start(int workerCount, QString *errorMessage)
+{
+    const QString serverName = QString("circuit-tracing-%1-%2")
+                                   .arg(QCoreApplication::applicationPid())
+                                   .arg(serverCounter++);
+    QLocalServer::removeServer(serverName);
+    if (!m_server.listen(serverName)) {
+        *errorMessage = QString("Cannot listen on %1: %2").arg(serverName, m_server.errorString());
+        return false;
+    }
+
+    for (int i = 0; i < workerCount; ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->process.setProcessChannelMode(QProcess::ForwardedChannels);
+        worker->process.start(QCoreApplication::applicationFilePath(),
+                              { "--worker", m_server.fullServerName() });
+        if (!worker->process.waitForStarted(CONNECT_TIMEOUT_MS)) {
+            *errorMessage = QString("Cannot start worker process: %1").arg(worker->process.errorString());
+            return false;
+        }
+        m_workers.push_back(std::move(worker));
+    }
+
+    // Части раздаются в порядке подключения
+    for (const auto &worker : m_workers) {
+        if (!m_server.hasPendingConnections() && !m_server.waitForNewConnection(CONNECT_TIMEOUT_MS)) {
+            *errorMessage = QString("Worker processes did not connect to %1").arg(m_server.fullServerName());
+            return false;
+        }
+        worker->socket = m_server.nextPendingConnection();
+    }
+    return true;
+}
+
+bool Coordinator::colorParts(const Adjacency &adjacency, const QVector<int> &parts,
+                             QVector<int> *colors, QString *errorMessage)
+{
+    const int vertexCount = adjacency.vertexCount();
+    QVector<int> localIds(vertexCount);
+    for (int v = 0; v < vertexCount; ++v) {
+        Worker &worker = *m_workers[parts[v]];
+        localIds[v] = worker.globalIds.size();
+        worker.globalIds.append(v);
+    }
+
+    // Локальные списки смежности; призрак заводится при первой встрече
+    // в каждой части, ghostSlot[v] отмечается номером части
+    QVector<int> ghostSlot(vertexCount, -1);
+    QVector<int> ghostOwner(vertexCount, -1);
+    for (int part = 0; part < int(m_workers.size()); ++part) {
+        Worker &worker = *m_workers[part];
+        const int localCount = worker.globalIds.size();
+        worker.offsets.reserve(localCount + 1);
+        worker.offsets.append(0);
+        for (int v : std::as_const(worker.globalIds)) {
+            for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+                if (parts[*n] == part) {
+                    worker.neighbors.append(localIds[*n]);
+                    continue;
+                }
+                if (ghostOwner[*n] != part) {
+                    ghostOwner[*n] = part;
+                    ghostSlot[*n] = localCount + worker.ghostIds.size();
+                    worker.ghostIds.append(*n);
+                }
+                worker.neighbors.append(ghostSlot[*n]);
+            }
+            worker.offsets.append(worker.neighbors.size());
+        }
+
+        const QByteArray payload = LocalMessage::encode([&worker, localCount](QDataStream &stream) {
+            stream << qint32(SetupMessage) << qint32(localCount) << qint32(worker.ghostIds.size())
+                   << worker.offsets << worker.neighbors;
+        });
+        if (!LocalMessage::write(worker.socket, payload, REPLY_TIMEOUT_MS)) {
+            *errorMessage = QString("Cannot send part %1 to its worker: %2").arg(part).arg(worker.socket->errorString());
+            return false;
+        }
+    }
+
+    colors->fill(-1, vertexCount);
+    for (int part = 0; part < int(m_workers.size()); ++part) {
+        Worker &worker = *m_workers[part];
+        QByteArray payload;
+        QVector<int> partColors;
+        if (LocalMessage::read(worker.socket, &payload, REPLY_TIMEOUT_MS)) {
+            QDataStream stream(payload);
+            stream.setVersion(QDataStream::Qt_5_12);
+            stream >> partColors;
+        }
+        if (partColors.size() != worker.globalIds.size()) {
+            *errorMessage = QString("Worker for part %1 did not return its coloring").arg(part);
+            return false;
+        }
+        for (int i = 0; i < partColors.size(); ++i) {
+            (*colors)[worker.globalIds[i]] = partColors[i];
+        }
+    }
+    return true;
+}
+
+bool Coordinator::resolve(const Adjacency &adjacency, const QVector<int> &parts, QVector<int> *colors,
+                          int *rounds, qint64 *recolored, QString *errorMessage)
+{
+    const int vertexCount = adjacency.vertexCount();
+    QVector<int> pendingRound(vertexCount, -1);
+    QVector<int> localIds(vertexCount);
+    for (const auto &worker : m_workers) {
+        for (int i = 0; i < worker->globalIds.size(); ++i) {
+            localIds[worker->globalIds[i]] = i;
+        }
+    }
+
+    *rounds = 0;
+    *recolored = 0;
+    while (*rounds < MAX_RESOLVE_ROUNDS) {
+        // Конфликты возможны только на разрезанных рёбрах: внутри части
+        // рабочий процесс красит правильно
+        bool conflicts = false;
+        for (int v = 0; v < vertexCount; ++v) {
+            for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+                if (parts[*n] != parts[v] && (*colors)[*n] == (*colors)[v] && losesTo(v, *n)) {
+                    if (pendingRound[v] != *rounds) {
+                        pendingRound[v] = *rounds;
+                        m_workers[parts[v]]->pending.append(v);
+                    }
+                    conflicts = true;
+                    break;
+                }
+            }
+        }
+        if (!conflicts)
+            return true;
+        (*rounds)++;
+
+        for (int part = 0; part < int(m_workers.size()); ++part) {
+            Worker &worker = *m_workers[part];
+            if (worker.pending.isEmpty())
+                continue;
+            QVector<int> ghostColors(worker.ghostIds.size());
+            for (int i = 0; i < worker.ghostIds.size(); ++i) {
+                ghostColors[i] = (*colors)[worker.ghostIds[i]];
+            }
+            QVector<int> vertices(worker.pending.size());
+            for (int i = 0; i < worker.pending.size(); ++i) {
+                vertices[i] = localIds[worker.pending[i]];
+            }
+            const QByteArray payload = LocalMessage::encode([&ghostColors, &vertices](QDataStream &stream) {
+                stream << qint32(RecolorMessage) << ghostColors << vertices;
+            });
+            if (!LocalMessage::write(worker.socket, payload, REPLY_TIMEOUT_MS)) {
+                *errorMessage = QString("Cannot send conflicts to worker %1: %2").arg(part).arg(worker.socket->errorString());
+                return false;
+            }
+        }
+
+        for (int part = 0; part < int(m_workers.size()); ++part) {
+            Worker &worker = *m_workers[part];
+            if (worker.pending.isEmpty())
+                continue;
+            QByteArray payload;
+            QVector<int> newColors;
+            if (LocalMessage::read(worker.socket, &payload, REPLY_TIMEOUT_MS)) {
+                QDataStream stream(payload);
+                stream.setVersion(QDataStream::Qt_5_12);
+                stream >> newColors;
+            }
+            if (newColors.size() != worker.pending.size()) {
+                *errorMessage = QString("Worker for part %1 did not return recolored vertices").arg(part);
+                return false;
+            }
+            for (int i = 0; i < newColors.size(); ++i) {
+                (*colors)[worker.pending[i]] = newColors[i];
+            }
+            *recolored += newColors.size();
+            worker.pending.clear();
+        }
+    }
+
+    // Раунды не сошлись: оставшиеся конфликты перекрашиваются последовательно.
+    // Каждая перекрашенная вершина отличается от всех текущих соседей, так
+    // что одного прохода достаточно.
+    QVector<int> used;
+    int stamp = 0;
+    for (int v = 0; v < vertexCount; ++v) {
+        for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+            if ((*colors)[*n] == (*colors)[v]) {
+                (*colors)[v] = firstFreeColor(adjacency.neighborsBegin(v), adjacency.neighborsEnd(v),
+                                              *colors, used, ++stamp);
+                (*recolored)++;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+void Coordinator::shutdown()
+{
+    const QByteArray finish = LocalMessage::encode([](QDataStream &stream) {
+        stream << qint32(FinishMessage);
+    });
+    for (const auto &worker : m_workers) {
+        if (worker->socket && worker->socket->state() == QLocalSocket::ConnectedState) {
+            LocalMessage::write(worker->socket, finish, REPLY_TIMEOUT_MS);
+        }
+    }
+    for (const auto &worker : m_workers) {
+        if (worker->process.state() != QProcess::NotRunning
+            && !worker->process.waitForFinished(FINISH_TIMEOUT_MS)) {
+            worker->process.kill();
+            worker->process.waitForFinished(FINISH_TIMEOUT_MS);
+        }
+    }
+    m_workers.clear();
+    m_server.close();
+}
+
+bool saveColoring(const QString &filePath, GraphSnapshot snapshot, const QVector<int> &colors,
+                  QString *errorMessage)
+{
+    int maxColor = 0;
+    for (int i = 0; i < colors.size(); ++i) {
+        snapshot.vertices[i].colorIndex = colors[i];
+        maxColor = std::max(maxColor, colors[i] + 1);
+    }
+    snapshot.maxColor = maxColor;
+
+    QSaveFile output(filePath);
+    if (!output.open(QIODevice::WriteOnly)) {
+        *errorMessage = output.errorString();
+        return false;
+    }
+    if (GraphFile::formatForPath(filePath) == GraphFile::Format::Compressed) {
+        if (!GraphFile::writeCompressed(snapshot, &output, errorMessage))
+            return false;
+    } else {
+        const QByteArray data = QJsonDocument(snapshot.toJson()).toJson();
+        if (output.write(data) != data.size()) {
+            *errorMessage = output.errorString();
+            return false;
+        }
+    }
+    if (!output.commit()) {
+        *errorMessage = output.errorString();
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool DistributedColoring::color(const Adjacency &adjacency, int workerCount, QVector<int> *colors,
+                                RunStats *stats, QString *errorMessage)
+{
+    PROFILE_SCOPE("distributed.color");
+
+    QString error;
+    if (!errorMessage) {
+        errorMessage = &error;
+    }
+    workerCount = std::max(1, std::min(workerCount, std::max(1, adjacency.vertexCount())));
+    *stats = RunStats();
+    stats->workerCount = workerCount;
+
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+    QElapsedTimer timer;
+
+    timer.start();
+    const QVector<int> parts = GraphPartition::partition(adjacency, workerCount);
+    stats->cutEdges = GraphPartition::edgeCut(adjacency, parts);
+    stats->partitionMs = elapsedMs(timer);
+
+    Coordinator coordinator;
+    timer.restart();
+    if (!coordinator.start(workerCount, errorMessage))
+        return false;
+    stats->setupMs = elapsedMs(timer);
+
+    timer.restart();
+    if (!coordinator.colorParts(adjacency, parts, colors, errorMessage))
+        return false;
+    stats->colorMs = elapsedMs(timer);
+
+    timer.restart();
+    if (!coordinator.resolve(adjacency, parts, colors, &stats->rounds, &stats->recolored, errorMessage))
+        return false;
+    stats->resolveMs = elapsedMs(timer);
+
+    coordinator.shutdown();
+    stats->totalMs = elapsedMs(totalTimer);
+
+    stats->colorCount = 0;
+    for (int color : std::as_const(*colors)) {
+        stats->colorCount = std::max(stats->colorCount, color + 1);
+    }
+    return true;
+}
+
+int DistributedColoring::runScaling(const QString &filePath, const QList<int> &workerCounts,
+                                    const QString &outputPath, QTextStream &out)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        out << QString("Cannot open file %1: %2\n").arg(filePath, file.errorString());
+        return 1;
+    }
+    GraphSnapshot snapshot;
+    QString errorMessage;
+    if (!GraphFile::read(&file, &snapshot, &errorMessage)) {
+        out << QString("Cannot read graph %1: %2\n").arg(filePath, errorMessage);
+        return 1;
+    }
+    file.close();
+
+    const Adjacency adjacency = Adjacency::fromSnapshot(snapshot);
+    MemoryReservation adjacencyBuffer(MemoryTracker::Algorithm,
+                                      qint64(adjacency.offsets.size() + adjacency.neighbors.size()) * qint64(sizeof(int)));
+    out << QString("Graph: %1 vertices, %2 edges\n").arg(adjacency.vertexCount()).arg(adjacency.edgeCount());
+
+    // Опорное время - та же раскраска в одном процессе без разбиения
+    QElapsedTimer timer;
+    timer.start();
+    QVector<int> colors;
+    const int sequentialColors = ColoringEngine::color(adjacency, ColoringEngine::Engine::LargestFirst, &colors);
+    const double sequentialMs = elapsedMs(timer);
+    out << QString("Sequential: %1 colors, %2 ms\n\n").arg(sequentialColors).arg(sequentialMs, 0, 'f', 2);
+
+    out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10 %11\n")
+               .arg("workers", 7).arg("cut %", 7).arg("part ms", 9).arg("spawn ms", 9)
+               .arg("color ms", 9).arg("resolve ms", 10).arg("rounds", 6).arg("recolored", 9)
+               .arg("colors", 6).arg("total ms", 10).arg("speedup", 7);
+
+    bool allValid = true;
+    for (int workerCount : workerCounts) {
+        RunStats stats;
+        if (!color(adjacency, workerCount, &colors, &stats, &errorMessage)) {
+            out << QString("%1 workers: FAILED: %2\n").arg(workerCount).arg(errorMessage);
+            return 1;
+        }
+        const bool valid = ColoringEngine::isProperColoring(adjacency, colors);
+        allValid = allValid && valid;
+
+        const double cutPercent = adjacency.edgeCount() > 0 ? 100.0 * stats.cutEdges / adjacency.edgeCount() : 0;
+        out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10 %11%12\n")
+                   .arg(stats.workerCount, 7)
+                   .arg(cutPercent, 7, 'f', 2)
+                   .arg(stats.partitionMs, 9, 'f', 1)
+                   .arg(stats.setupMs, 9, 'f', 1)
+                   .arg(stats.colorMs, 9, 'f', 1)
+                   .arg(stats.resolveMs, 10, 'f', 1)
+                   .arg(stats.rounds, 6)
+                   .arg(stats.recolored, 9)
+                   .arg(stats.colorCount, 6)
+                   .arg(stats.totalMs, 10, 'f', 1)
+                   .arg(stats.totalMs > 0 ? sequentialMs / stats.totalMs : 0, 7, 'f', 2)
+                   .arg(valid ? "" : "  INVALID");
+        out.flush();
+    }
+
+    if (!outputPath.isEmpty() && !workerCounts.isEmpty()) {
+        if (!saveColoring(outputPath, snapshot, colors, &errorMessage)) {
+            out << QString("Cannot save %1: %2\n").arg(outputPath, errorMessage);
+            return 1;
+        }
+        out << QString("Coloring written to %1\n").arg(outputPath);
+    }
+    return allValid ? 0 : 1;
+}
+
+int DistributedColoring::runWorker(const QString &serverName)
+{
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+    if (!socket.waitForConnected(CONNECT_TIMEOUT_MS))
+        return 1;
+
+    Adjacency local;
+    int localCount = 0;
+    QVector<int> colors;  // Цвета своих вершин и затем призраков
+    QVector<int> used;
+    int stamp = 0;
+
+    QByteArray payload;
+    while (LocalMessage::read(&socket, &payload, REPLY_TIMEOUT_MS)) {
+        QDataStream stream(payload);
+        stream.setVersion(QDataStream::Qt_5_12);
+        qint32 type;
+        stream >> type;
+
+        QVector<int> reply;
+        if (type == SetupMessage) {
+            qint32 count, ghostCount;
+            stream >> count >> ghostCount >> local.offsets >> local.neighbors;
+            localCount = count;
+
+            // Призраки при первой раскраске не учитываются: части красятся
+            // независимо, а конфликты на границах разрешает координатор
+            Adjacency inner;
+            inner.offsets.reserve(localCount + 1);
+            inner.offsets.append(0);
+            for (int v = 0; v < localCount; ++v) {
+                for (const int *n = local.neighborsBegin(v); n != local.neighborsEnd(v); ++n) {
+                    if (*n < localCount) {
+                        inner.neighbors.append(*n);
+                    }
+                }
+                inner.offsets.append(inner.neighbors.size());
+            }
+            ColoringEngine::color(inner, ColoringEngine::Engine::LargestFirst, &reply);
+            colors = reply;
+            colors.resize(localCount + ghostCount);
+        } else if (type == RecolorMessage) {
+            QVector<int> ghostColors, vertices;
+            stream >> ghostColors >> vertices;
+            std::copy(ghostColors.cbegin(), ghostColors.cend(), colors.begin() + localCount);
+
+            // Последовательная перекраска не создаёт конфликтов внутри части
+            reply.reserve(vertices.size());
+            for (int v : std::as_const(vertices)) {
+                colors[v] = firstFreeColor(local.neighborsBegin(v), local.neighborsEnd(v),
+                                           colors, used, ++stamp);
+                reply.append(colors[v]);
+            }
+        } else {
+            break;
+        }
+
+        if (stream.status() != QDataStream::Ok)
+            return 1;
+        const QByteArray replyPayload = LocalMessage::encode([&reply](QDataStream &out) {
+            out << reply;
+        });
+        if (!LocalMessage::write(&socket, replyPayload, REPLY_TIMEOUT_MS))
+            return 1;
+    }
+
+    socket.disconnectFromServer();
+    return 0;
+}
@@ -0,0 +1,49 @@
+#ifndef DISTRIBUTEDCOLORING_H
+#define DISTRIBUTEDCOLORING_H
+
+#include <QList>
+#include <QString>
+#include <QTextStream>
+#include <QVector>
+#include "coloringengine.h"
+
+// Раскраска в нескольких процессах. Координатор делит граф на части
+// (GraphPartition), запускает по рабочему процессу на часть и обменивается
+// с ними сообщениями через QLocalSocket. Рабочие раскрашивают свои части
+// независимо, затем координатор по раундам находит конфликты на
+// разрезанных рёбрах и отправляет вершины с меньшим приоритетом на
+// перекраску с учётом цветов соседей из других частей.
+namespace DistributedColoring {
+
+// Показатели одного запуска
+struct RunStats
+{
+    int workerCount = 0;
+    qint64 cutEdges = 0;
+    double partitionMs = 0;
+    double setupMs = 0;     // Запуск рабочих процессов и подключение
+    double colorMs = 0;     // Передача частей и их независимая раскраска
+    double resolveMs = 0;   // Раунды разрешения конфликтов на границах
+    int rounds = 0;
+    qint64 recolored = 0;
+    int colorCount = 0;
+    double totalMs = 0;
+};
+
+// Раскраска adjacency в workerCount рабочих процессах
+bool color(const Adjacency &adjacency, int workerCount, QVector<int> *colors,
+           RunStats *stats, QString *errorMessage = nullptr);
+
+// Таблица масштабирования: файл графа раскрашивается при каждом числе
+// рабочих процессов из списка. Если задан outputPath, туда сохраняется
+// раскраска последнего запуска. Возвращает код завершения процесса.
+int runScaling(const QString &filePath, const QList<int> &workerCounts,
+               const QString &outputPath, QTextStream &out);
+
+// Рабочий процесс: подключение к координатору и обработка запросов
+// до команды завершения. Возвращает код завершения процесса.
+int runWorker(const QString &serverName);
+
+} // namespace DistributedColoring
+
+#endif // DISTRIBUTEDCOLORING_H
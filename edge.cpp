@@ -2,6 +2,7 @@
 #include "vertex.h"
 
 Edge::Edge(Vertex *sourceVertex, Vertex *destVertex, QObject *parent)
-    : QObject(parent), m_sourceVertex(sourceVertex), m_destVertex(destVertex)
+    : QObject(parent), m_sourceVertex(sourceVertex), m_destVertex(destVertex),
+    m_sourceSlot(-1), m_destSlot(-1)
 {
 }
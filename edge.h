@@ -2,6 +2,7 @@
 #define EDGE_H
 
 #include <QObject>
+#include "slotmap.h"
 
 class Vertex;
 
@@ -14,10 +15,32 @@ public:
 
     Vertex* sourceVertex() const { return m_sourceVertex; }
     Vertex* destVertex() const { return m_destVertex; }
+    // Второй конец ребра относительно vertex
+    Vertex* otherVertex(const Vertex *vertex) const
+    {
+        return vertex == m_sourceVertex ? m_destVertex : m_sourceVertex;
+    }
+
+    // Дескриптор ребра в хранилище графа
+    SlotHandle handle() const { return m_handle; }
 
 private:
+    friend class Graph;
+    friend class Vertex;
+
     Vertex *m_sourceVertex;
     Vertex *m_destVertex;
+    SlotHandle m_handle;
+
+    // Позиции ребра в списках инцидентности концевых вершин,
+    // нужны для удаления ребра из вершины за O(1)
+    int m_sourceSlot;
+    int m_destSlot;
+
+    int &incidenceSlot(const Vertex *vertex)
+    {
+        return vertex == m_sourceVertex ? m_sourceSlot : m_destSlot;
+    }
 };
 
 #endif // EDGE_H
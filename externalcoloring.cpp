@@ -0,0 +1,594 @@
+#include "externalcoloring.h"
+#include "memorystats.h"
+#include "profiler.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// Наименьший буфер сортировки и блок чтения прогона при слиянии
+constexpr qint64 MIN_MEMORY_LIMIT = 1024 * 1024;
+constexpr qint64 MIN_MERGE_BLOCK = 64 * 1024;
+// Буфер строки DIMACS; более длинные строки - комментарии, их хвост пропускается
+constexpr int LINE_BUFFER_SIZE = 4096;
+constexpr int WRITE_BLOCK = 1 << 16;
+
+double elapsedMs(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1e6;
+}
+
+double mebibytes(qint64 bytes)
+{
+    return bytes / (1024.0 * 1024.0);
+}
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool parseNumber(const char *line, int length, int *pos, qint64 *value)
+{
+    int i = *pos;
+    while (i < length && isSpace(line[i])) {
+        i++;
+    }
+    if (i >= length || line[i] < '0' || line[i] > '9')
+        return false;
+
+    qint64 result = 0;
+    while (i < length && line[i] >= '0' && line[i] <= '9') {
+        result = result * 10 + (line[i] - '0');
+        if (result > INT_MAX)
+            return false;
+        i++;
+    }
+    *pos = i;
+    *value = result;
+    return true;
+}
+
+// Ориентированное ребро; каждое ребро графа записывается в обе стороны
+struct EdgePair
+{
+    quint32 source;
+    quint32 dest;
+
+    bool operator<(const EdgePair &other) const
+    {
+        return source != other.source ? source < other.source : dest < other.dest;
+    }
+    bool operator>(const EdgePair &other) const { return other < *this; }
+    bool operator==(const EdgePair &other) const { return source == other.source && dest == other.dest; }
+    bool operator!=(const EdgePair &other) const { return !(*this == other); }
+};
+
+// Последовательное чтение прогона блоками
+class RunReader
+{
+public:
+    RunReader(const QString &filePath, qint64 blockBytes)
+        : m_file(filePath), m_blockSize(int(std::max<qint64>(1, blockBytes / qint64(sizeof(EdgePair))))),
+        m_position(0), m_bytesRead(0)
+    {
+    }
+
+    bool open() { return m_file.open(QIODevice::ReadOnly); }
+    QString errorString() const { return m_file.errorString(); }
+    qint64 bytesRead() const { return m_bytesRead; }
+
+    // false - прогон закончился
+    bool next(EdgePair *pair)
+    {
+        if (m_position == m_buffer.size()) {
+            m_buffer.resize(m_blockSize);
+            const qint64 bytes = m_file.read(reinterpret_cast<char *>(m_buffer.data()),
+                                             qint64(m_blockSize) * qint64(sizeof(EdgePair)));
+            if (bytes <= 0) {
+                m_buffer.clear();
+                m_position = 0;
+                return false;
+            }
+            m_bytesRead += bytes;
+            m_buffer.resize(int(bytes / qint64(sizeof(EdgePair))));
+            m_position = 0;
+        }
+        *pair = m_buffer[m_position++];
+        return true;
+    }
+
+private:
+    QFile m_file;
+    int m_blockSize;
+    QVector<EdgePair> m_buffer;
+    int m_position;
+    qint64 m_bytesRead;
+};
+
+class ExternalColorer
+{
+public:
+    ExternalColorer(const ExternalColoring::Options &options, ExternalColoring::Stats *stats)
+        : m_options(options), m_stats(stats), m_nextRun(0), m_vertexCount(-1)
+    {
+        m_options.memoryLimit = std::max(m_options.memoryLimit, MIN_MEMORY_LIMIT);
+        m_options.maxPasses = std::max(m_options.maxPasses, 1);
+    }
+
+    bool run(QVector<int> *colors, QString *errorMessage)
+    {
+        const QString directory = m_options.workDirectory.isEmpty()
+                                      ? QFileInfo(m_options.inputPath).absolutePath()
+                                      : m_options.workDirectory;
+        // Временные файлы рядом с данными, а не в /tmp, который бывает в памяти
+        m_workDir.reset(new QTemporaryDir(directory + "/.external-coloring-XXXXXX"));
+        if (!m_workDir->isValid())
+            return fail(errorMessage, QString("Cannot create a temporary directory in %1: %2")
+                                          .arg(directory, m_workDir->errorString()));
+
+        QElapsedTimer timer;
+        timer.start();
+        if (!writeRuns(errorMessage) || !mergeRuns(errorMessage))
+            return false;
+        m_stats->sortMs = elapsedMs(timer);
+
+        timer.restart();
+        if (!colorPasses(colors, errorMessage))
+            return false;
+        m_stats->colorMs = elapsedMs(timer);
+        return true;
+    }
+
+private:
+    ExternalColoring::Options m_options;
+    ExternalColoring::Stats *m_stats;
+    std::unique_ptr<QTemporaryDir> m_workDir;
+    QStringList m_runPaths;
+    int m_nextRun;
+    QString m_neighborsPath;
+    int m_vertexCount;
+    QVector<qint64> m_offsets;  // Смещения списков соседей в файле, в элементах
+
+    QString nextRunPath()
+    {
+        return m_workDir->filePath(QString("run%1.bin").arg(m_nextRun++));
+    }
+
+    static bool fail(QString *errorMessage, const QString &message)
+    {
+        if (errorMessage) {
+            *errorMessage = message;
+        }
+        return false;
+    }
+
+    // Разбор DIMACS в отсортированные прогоны размером не больше буфера
+    bool writeRuns(QString *errorMessage)
+    {
+        PROFILE_SCOPE("external.runs");
+        QFile input(m_options.inputPath);
+        if (!input.open(QIODevice::ReadOnly))
+            return fail(errorMessage, QString("Cannot open file %1: %2").arg(m_options.inputPath, input.errorString()));
+
+        const int capacity = int(std::min<qint64>(INT_MAX / 2, m_options.memoryLimit / qint64(sizeof(EdgePair))));
+        QVector<EdgePair> buffer;
+        buffer.reserve(capacity);
+        MemoryReservation sortBuffer(MemoryTracker::IoBuffers, qint64(capacity) * qint64(sizeof(EdgePair)));
+
+        QByteArray line(LINE_BUFFER_SIZE, '\0');
+        int lineNumber = 0;
+        bool continuation = false;
+        while (!input.atEnd()) {
+            const qint64 length = input.readLine(line.data(), line.size());
+            if (length < 0)
+                return fail(errorMessage, QString("Cannot read %1: %2").arg(m_options.inputPath, input.errorString()));
+
+            // Хвост слишком длинной строки
+            const bool skip = continuation;
+            continuation = length > 0 && line[int(length) - 1] != '\n';
+            if (skip)
+                continue;
+            lineNumber++;
+
+            const char *text = line.constData();
+            int pos = 0;
+            while (pos < length && isSpace(text[pos])) {
+                pos++;
+            }
+            if (pos >= length)
+                continue;
+
+            if (text[pos] == 'p') {
+                if (m_vertexCount >= 0)
+                    return fail(errorMessage, QString("Duplicate 'p' line at line %1.").arg(lineNumber));
+                pos++;
+                while (pos < length && isSpace(text[pos])) {
+                    pos++;
+                }
+                while (pos < length && !isSpace(text[pos])) {
+                    pos++;
+                }
+                qint64 vertices, edges;
+                if (!parseNumber(text, int(length), &pos, &vertices) || !parseNumber(text, int(length), &pos, &edges))
+                    return fail(errorMessage, QString("Malformed 'p' line at line %1.").arg(lineNumber));
+                m_vertexCount = int(vertices);
+            } else if (text[pos] == 'e') {
+                if (m_vertexCount < 0)
+                    return fail(errorMessage, QString("Edge before the 'p' line at line %1.").arg(lineNumber));
+                pos++;
+                qint64 u, v;
+                if (!parseNumber(text, int(length), &pos, &u) || !parseNumber(text, int(length), &pos, &v))
+                    return fail(errorMessage, QString("Malformed edge at line %1.").arg(lineNumber));
+                if (u < 1 || v < 1 || u > m_vertexCount || v > m_vertexCount)
+                    return fail(errorMessage, QString("Edge at line %1 refers to a vertex outside 1..%2.")
+                                                  .arg(lineNumber).arg(m_vertexCount));
+                if (u == v)
+                    continue;
+
+                if (buffer.size() + 2 > capacity && !flushRun(&buffer, errorMessage))
+                    return false;
+                buffer.append({ quint32(u - 1), quint32(v - 1) });
+                buffer.append({ quint32(v - 1), quint32(u - 1) });
+            }
+        }
+        m_stats->bytesRead += input.size();
+
+        if (m_vertexCount < 0)
+            return fail(errorMessage, QString("Missing 'p edge' line."));
+        return buffer.isEmpty() || flushRun(&buffer, errorMessage);
+    }
+
+    bool flushRun(QVector<EdgePair> *buffer, QString *errorMessage)
+    {
+        std::sort(buffer->begin(), buffer->end());
+        buffer->erase(std::unique(buffer->begin(), buffer->end()), buffer->end());
+
+        const QString path = nextRunPath();
+        QFile file(path);
+        const qint64 bytes = qint64(buffer->size()) * qint64(sizeof(EdgePair));
+        if (!file.open(QIODevice::WriteOnly)
+            || file.write(reinterpret_cast<const char *>(buffer->constData()), bytes) != bytes) {
+            return fail(errorMessage, QString("Cannot write %1: %2").arg(path, file.errorString()));
+        }
+        m_runPaths.append(path);
+        m_stats->bytesWritten += bytes;
+        m_stats->runs++;
+        buffer->clear();
+        return true;
+    }
+
+    // Наибольшее число прогонов в одном слиянии: блок чтения на каждый
+    // прогон и блок на выход помещаются в memoryLimit
+    int mergeFanIn() const
+    {
+        return int(std::clamp<qint64>(m_options.memoryLimit / MIN_MERGE_BLOCK - 1, 2, INT_MAX));
+    }
+
+    // Слияние группы прогонов в порядке возрастания без повторов. consume
+    // получает каждое ребро и возвращает false при ошибке (сообщение
+    // записывает сам). Прочитанные прогоны удаляются.
+    bool mergeGroup(const QStringList &paths, QString *errorMessage,
+                    const std::function<bool(const EdgePair &)> &consume)
+    {
+        const qint64 blockBytes = std::max(MIN_MERGE_BLOCK, m_options.memoryLimit / (paths.size() + 1));
+        MemoryReservation blocks(MemoryTracker::IoBuffers, blockBytes * (paths.size() + 1));
+
+        std::vector<std::unique_ptr<RunReader>> readers;
+        using Entry = std::pair<EdgePair, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+        for (const QString &path : paths) {
+            readers.emplace_back(new RunReader(path, blockBytes));
+            if (!readers.back()->open())
+                return fail(errorMessage, QString("Cannot open %1: %2").arg(path, readers.back()->errorString()));
+            EdgePair pair;
+            if (readers.back()->next(&pair)) {
+                heap.push(Entry(pair, int(readers.size()) - 1));
+            }
+        }
+
+        EdgePair last = { UINT_MAX, UINT_MAX };
+        while (!heap.empty()) {
+            const Entry entry = heap.top();
+            heap.pop();
+            EdgePair pair;
+            if (readers[entry.second]->next(&pair)) {
+                heap.push(Entry(pair, entry.second));
+            }
+
+            // Одно ребро может встретиться в нескольких прогонах
+            if (entry.first == last)
+                continue;
+            last = entry.first;
+            if (!consume(last))
+                return false;
+        }
+
+        for (const std::unique_ptr<RunReader> &reader : readers) {
+            m_stats->bytesRead += reader->bytesRead();
+        }
+        readers.clear();
+        for (const QString &path : paths) {
+            QFile::remove(path);
+        }
+        m_stats->mergePasses++;
+        return true;
+    }
+
+    // Промежуточные слияния, пока прогонов больше, чем сливается за раз
+    bool reduceRuns(QString *errorMessage)
+    {
+        const int fanIn = mergeFanIn();
+        while (m_runPaths.size() > fanIn) {
+            QStringList merged;
+            for (int first = 0; first < m_runPaths.size(); first += fanIn) {
+                const QStringList group = m_runPaths.mid(first, fanIn);
+                if (group.size() == 1) {
+                    merged.append(group.first());
+                    continue;
+                }
+
+                const QString path = nextRunPath();
+                QFile output(path);
+                if (!output.open(QIODevice::WriteOnly))
+                    return fail(errorMessage, QString("Cannot write %1: %2").arg(path, output.errorString()));
+
+                QVector<EdgePair> block;
+                block.reserve(WRITE_BLOCK);
+                auto flush = [&]() {
+                    const qint64 bytes = qint64(block.size()) * qint64(sizeof(EdgePair));
+                    if (output.write(reinterpret_cast<const char *>(block.constData()), bytes) != bytes)
+                        return fail(errorMessage, QString("Cannot write %1: %2").arg(path, output.errorString()));
+                    m_stats->bytesWritten += bytes;
+                    block.clear();
+                    return true;
+                };
+                const bool ok = mergeGroup(group, errorMessage, [&](const EdgePair &pair) {
+                    block.append(pair);
+                    return block.size() < WRITE_BLOCK || flush();
+                });
+                if (!ok || !flush())
+                    return false;
+                merged.append(path);
+            }
+            m_runPaths = merged;
+        }
+        return true;
+    }
+
+    // Слияние прогонов: в файл пишутся только концы рёбер, упорядоченные
+    // по началу, начала превращаются в смещения списков соседей. Прогонов
+    // больше, чем позволяет память, - сначала промежуточные слияния
+    bool mergeRuns(QString *errorMessage)
+    {
+        PROFILE_SCOPE("external.merge");
+        if (!reduceRuns(errorMessage))
+            return false;
+
+        m_offsets.fill(0, m_vertexCount + 1);
+        MemoryReservation offsets(MemoryTracker::Algorithm, qint64(m_offsets.size()) * qint64(sizeof(qint64)));
+
+        m_neighborsPath = m_workDir->filePath("neighbors.bin");
+        QFile output(m_neighborsPath);
+        if (!output.open(QIODevice::WriteOnly))
+            return fail(errorMessage, QString("Cannot write %1: %2").arg(m_neighborsPath, output.errorString()));
+
+        QVector<quint32> block;
+        block.reserve(WRITE_BLOCK);
+        auto flush = [&]() {
+            const qint64 bytes = qint64(block.size()) * qint64(sizeof(quint32));
+            if (output.write(reinterpret_cast<const char *>(block.constData()), bytes) != bytes)
+                return fail(errorMessage, QString("Cannot write %1: %2").arg(m_neighborsPath, output.errorString()));
+            m_stats->bytesWritten += bytes;
+            block.clear();
+            return true;
+        };
+
+        qint64 entries = 0;
+        const bool ok = mergeGroup(m_runPaths, errorMessage, [&](const EdgePair &pair) {
+            m_offsets[int(pair.source) + 1]++;
+            entries++;
+            block.append(pair.dest);
+            return block.size() < WRITE_BLOCK || flush();
+        });
+        if (!ok || !flush())
+            return false;
+        output.close();
+        m_runPaths.clear();
+
+        for (int v = 0; v < m_vertexCount; ++v) {
+            m_offsets[v + 1] += m_offsets[v];
+        }
+        m_stats->vertexCount = m_vertexCount;
+        m_stats->edgeCount = entries / 2;
+        return true;
+    }
+
+    bool colorPasses(QVector<int> *colors, QString *errorMessage)
+    {
+        PROFILE_SCOPE("external.color");
+        QFile file(m_neighborsPath);
+        if (!file.open(QIODevice::ReadOnly))
+            return fail(errorMessage, QString("Cannot open %1: %2").arg(m_neighborsPath, file.errorString()));
+
+        const qint64 entries = m_offsets[m_vertexCount];
+        const qint64 bytes = entries * qint64(sizeof(quint32));
+        const quint32 *neighbors = nullptr;
+        uchar *mapped = nullptr;
+        if (bytes > 0) {
+            mapped = file.map(0, bytes);
+            if (!mapped)
+                return fail(errorMessage, QString("Cannot map %1: %2").arg(m_neighborsPath, file.errorString()));
+#ifdef Q_OS_UNIX
+            // Проходы последовательные: ядро читает с опережением и
+            // освобождает уже пройденные страницы
+            posix_madvise(mapped, size_t(bytes), POSIX_MADV_SEQUENTIAL);
+#endif
+            neighbors = reinterpret_cast<const quint32 *>(mapped);
+        }
+
+        colors->fill(-1, m_vertexCount);
+        QVector<int> usedBy;
+        MemoryReservation state(MemoryTracker::Algorithm, qint64(m_vertexCount) * qint64(sizeof(int)));
+
+        // Наименьший цвет, не занятый соседями с известным цветом
+        auto firstFree = [&](int v) {
+            for (qint64 i = m_offsets[v]; i < m_offsets[v + 1]; ++i) {
+                const int color = (*colors)[int(neighbors[i])];
+                if (color < 0)
+                    continue;
+                if (color >= usedBy.size()) {
+                    usedBy.resize(color + 1, -1);
+                }
+                usedBy[color] = v;
+            }
+            int color = 0;
+            while (color < usedBy.size() && usedBy[color] == v) {
+                color++;
+            }
+            return color;
+        };
+
+        // Первый проход: у вершины раскрашены только соседи с меньшими номерами
+        usedBy.fill(-1, 1);
+        for (int v = 0; v < m_vertexCount; ++v) {
+            (*colors)[v] = firstFree(v);
+        }
+        m_stats->passes++;
+        m_stats->bytesRead += bytes;
+
+        // Вершины спускаются в наименьший свободный цвет среди всех соседей;
+        // опустевшие старшие цвета исчезают
+        for (int pass = 1; pass < m_options.maxPasses; ++pass) {
+            usedBy.fill(-1);
+            qint64 changed = 0;
+            for (int v = 0; v < m_vertexCount; ++v) {
+                const int color = firstFree(v);
+                if (color < (*colors)[v]) {
+                    (*colors)[v] = color;
+                    changed++;
+                }
+            }
+            m_stats->passes++;
+            m_stats->bytesRead += bytes;
+            m_stats->recolored += changed;
+            if (changed == 0)
+                break;
+        }
+
+        // Проверочный проход
+        bool valid = true;
+        for (int v = 0; v < m_vertexCount && valid; ++v) {
+            for (qint64 i = m_offsets[v]; i < m_offsets[v + 1]; ++i) {
+                if ((*colors)[int(neighbors[i])] == (*colors)[v]) {
+                    valid = false;
+                    break;
+                }
+            }
+        }
+        m_stats->passes++;
+        m_stats->bytesRead += bytes;
+
+        if (mapped) {
+            file.unmap(mapped);
+        }
+        if (!valid)
+            return fail(errorMessage, QString("The coloring failed verification."));
+
+        m_stats->colorCount = 0;
+        for (int color : std::as_const(*colors)) {
+            m_stats->colorCount = std::max(m_stats->colorCount, color + 1);
+        }
+        return true;
+    }
+};
+
+bool saveColoring(const QString &filePath, const QVector<int> &colors, qint64 *bytesWritten, QString *errorMessage)
+{
+    QSaveFile output(filePath);
+    if (!output.open(QIODevice::WriteOnly)) {
+        *errorMessage = output.errorString();
+        return false;
+    }
+
+    QByteArray block;
+    block.reserve(WRITE_BLOCK + 32);
+    for (int v = 0; v < colors.size(); ++v) {
+        block += QByteArray::number(v + 1);
+        block += ' ';
+        block += QByteArray::number(colors[v]);
+        block += '\n';
+        if (block.size() >= WRITE_BLOCK || v + 1 == colors.size()) {
+            if (output.write(block) != block.size()) {
+                *errorMessage = output.errorString();
+                return false;
+            }
+            *bytesWritten += block.size();
+            block.clear();
+        }
+    }
+    if (!output.commit()) {
+        *errorMessage = output.errorString();
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool ExternalColoring::color(const Options &options, QVector<int> *colors, Stats *stats, QString *errorMessage)
+{
+    PROFILE_SCOPE("external");
+    *stats = Stats();
+    QElapsedTimer timer;
+    timer.start();
+
+    ExternalColorer colorer(options, stats);
+    if (!colorer.run(colors, errorMessage))
+        return false;
+    stats->totalMs = elapsedMs(timer);
+    return true;
+}
+
+int ExternalColoring::run(const Options &options, QTextStream &out)
+{
+    QVector<int> colors;
+    Stats stats;
+    QString errorMessage;
+    if (!color(options, &colors, &stats, &errorMessage)) {
+        out << QString("External coloring of %1 failed: %2\n").arg(options.inputPath, errorMessage);
+        return 1;
+    }
+
+    if (!options.outputPath.isEmpty()) {
+        if (!saveColoring(options.outputPath, colors, &stats.bytesWritten, &errorMessage)) {
+            out << QString("Cannot save %1: %2\n").arg(options.outputPath, errorMessage);
+            return 1;
+        }
+    }
+
+    out << QString("Graph: %1 vertices, %2 edges\n").arg(stats.vertexCount).arg(stats.edgeCount);
+    out << QString("Sort: %1 runs, %2 merges, %3 ms\n")
+               .arg(stats.runs).arg(stats.mergePasses).arg(stats.sortMs, 0, 'f', 1);
+    out << QString("Color: %1 passes (including verification), %2 vertices recolored after the first pass, %3 ms\n")
+               .arg(stats.passes).arg(stats.recolored).arg(stats.colorMs, 0, 'f', 1);
+    out << QString("I/O: %1 MiB read, %2 MiB written\n")
+               .arg(mebibytes(stats.bytesRead), 0, 'f', 1).arg(mebibytes(stats.bytesWritten), 0, 'f', 1);
+    out << QString("Colors: %1, total %2 ms\n").arg(stats.colorCount).arg(stats.totalMs, 0, 'f', 1);
+    if (!options.outputPath.isEmpty()) {
+        out << QString("Coloring written to %1\n").arg(options.outputPath);
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef EXTERNALCOLORING_H
+#define EXTERNALCOLORING_H
+
+#include <QString>
+#include <QTextStream>
+#include <QVector>
+
+// Раскраска графов, рёбра которых не помещаются в память. В памяти только
+// состояние вершин (цвет и смещение списка соседей), рёбра лежат на диске:
+// файл DIMACS разбирается потоком в отсортированные прогоны ограниченного
+// размера, прогоны сливаются (при нехватке памяти на все сразу - в
+// несколько проходов) в файл списков соседей, упорядоченный по вершинам. Этот файл отображается в память (QFile::map) и читается
+// последовательными проходами: первый - жадная раскраска в порядке вершин,
+// следующие - перенос вершин в наименьший свободный цвет, пока проход
+// что-то меняет. Последний проход проверяет правильность раскраски.
+namespace ExternalColoring {
+
+struct Options
+{
+    QString inputPath;      // Граф в формате DIMACS
+    QString outputPath;     // Раскраска "<вершина> <цвет>" по строкам; пусто - не сохранять
+    QString workDirectory;  // Временные файлы; пусто - каталог входного файла
+    qint64 memoryLimit = 64 * 1024 * 1024;  // Буфер сортировки прогонов
+    int maxPasses = 16;     // Проходы раскраски, не считая проверки
+};
+
+struct Stats
+{
+    int vertexCount = 0;
+    qint64 edgeCount = 0;
+    int runs = 0;           // Отсортированные прогоны на диске
+    int mergePasses = 0;    // Слияния групп прогонов, включая последнее
+    int passes = 0;         // Проходы по файлу соседей, включая проверку
+    qint64 recolored = 0;   // Перекрашено проходами после первого
+    qint64 bytesRead = 0;
+    qint64 bytesWritten = 0;
+    int colorCount = 0;
+    double sortMs = 0;      // Разбор, сортировка и слияние
+    double colorMs = 0;
+    double totalMs = 0;
+};
+
+bool color(const Options &options, QVector<int> *colors, Stats *stats, QString *errorMessage = nullptr);
+
+// Консольный режим: раскраска, отчёт о проходах и объёме ввода-вывода.
+// Возвращает код завершения процесса.
+int run(const Options &options, QTextStream &out);
+
+} // namespace ExternalColoring
+
+#endif // EXTERNALCOLORING_H
@@ -0,0 +1,362 @@
+#include "forcelayout.h"
+#include "parallel.h"
+#include "profiler.h"
+#include "memorystats.h"
+#include <QElapsedTimer>
+#include <QVarLengthArray>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+// Желаемое расстояние между соседними вершинами (диаметр вершины - 30)
+constexpr double SPACING = 60.0;
+// Число шагов раскладки
+constexpr int ITERATIONS = 300;
+// Точность приближения Barnes-Hut: узел заменяется центром масс,
+// если его размер меньше THETA расстояний до него
+constexpr double THETA = 0.9;
+// Притяжение к центру, удерживающее несвязные компоненты рядом
+constexpr double GRAVITY = 0.5;
+// Число вершин в листе дерева и предельная глубина дерева
+constexpr int LEAF_SIZE = 8;
+constexpr int MAX_DEPTH = 24;
+// Число вершин, обрабатываемых одной задачей пула
+constexpr int CHUNK_SIZE = 2048;
+// Период публикации промежуточных позиций
+constexpr int PUBLISH_INTERVAL_MS = 250;
+
+} // namespace
+
+ForceLayout::ForceLayout(const QVector<QPointF> &positions, const Adjacency &adjacency)
+    : m_adjacency(adjacency), m_positions(positions), m_k(SPACING),
+      m_iteration(0), m_iterationCount(ITERATIONS)
+{
+    const int vertexCount = m_positions.size();
+    m_displacements.resize(vertexCount);
+
+    // Если вершины свалены в кучу меньше одной ячейки на вершину,
+    // начинаем со спирали: совпадающие точки не дают направления силы
+    double minX = 0, minY = 0, maxX = 0, maxY = 0;
+    if (vertexCount > 0) {
+        minX = maxX = m_positions[0].x();
+        minY = maxY = m_positions[0].y();
+        for (const QPointF &position : m_positions) {
+            minX = std::min(minX, position.x());
+            maxX = std::max(maxX, position.x());
+            minY = std::min(minY, position.y());
+            maxY = std::max(maxY, position.y());
+        }
+    }
+    if ((maxX - minX) * (maxY - minY) < double(vertexCount) * m_k * m_k * 0.25) {
+        const double centerX = (minX + maxX) / 2;
+        const double centerY = (minY + maxY) / 2;
+        for (int i = 0; i < vertexCount; ++i) {
+            const double radius = m_k * std::sqrt(double(i));
+            const double angle = i * 2.399963229728653;  // Золотой угол
+            m_positions[i] = QPointF(centerX + radius * std::cos(angle), centerY + radius * std::sin(angle));
+        }
+    }
+
+    // Температура остывает геометрически от размера графа до доли оптимального расстояния
+    m_temperature = std::max(m_k, m_k * std::sqrt(double(vertexCount)) * 0.5);
+    const double finalTemperature = m_k * 0.05;
+    m_cooling = std::pow(finalTemperature / m_temperature, 1.0 / m_iterationCount);
+}
+
+int ForceLayout::buildNode(int first, int count, double x, double y, double size, int depth)
+{
+    const int index = m_nodes.size();
+    Node node;
+    node.x = x;
+    node.y = y;
+    node.size = size;
+    node.mass = count;
+    node.first = first;
+    node.count = count;
+    std::fill(node.children, node.children + 4, -1);
+
+    double sumX = 0, sumY = 0;
+    for (int i = first; i < first + count; ++i) {
+        sumX += m_positions[m_order[i]].x();
+        sumY += m_positions[m_order[i]].y();
+    }
+    node.massX = sumX / count;
+    node.massY = sumY / count;
+    m_nodes.append(node);
+
+    if (count <= LEAF_SIZE || depth >= MAX_DEPTH)
+        return index;
+
+    // Разбиение на квадранты: сначала по y, затем каждую половину по x
+    const double half = size / 2;
+    const double midX = x + half;
+    const double midY = y + half;
+    int *begin = m_order.data() + first;
+    int *end = begin + count;
+    const QVector<QPointF> &positions = m_positions;
+
+    int *middle = std::partition(begin, end, [&](int v) { return positions[v].y() < midY; });
+    int *topSplit = std::partition(begin, middle, [&](int v) { return positions[v].x() < midX; });
+    int *bottomSplit = std::partition(middle, end, [&](int v) { return positions[v].x() < midX; });
+
+    int *bounds[5] = { begin, topSplit, middle, bottomSplit, end };
+    const double originX[4] = { x, midX, x, midX };
+    const double originY[4] = { y, y, midY, midY };
+    for (int quadrant = 0; quadrant < 4; ++quadrant) {
+        const int childCount = int(bounds[quadrant + 1] - bounds[quadrant]);
+        if (childCount == 0)
+            continue;
+        const int childFirst = int(bounds[quadrant] - m_order.data());
+        const int child = buildNode(childFirst, childCount, originX[quadrant], originY[quadrant],
+                                    half, depth + 1);
+        m_nodes[index].children[quadrant] = child;
+    }
+    return index;
+}
+
+void ForceLayout::buildTree()
+{
+    const int vertexCount = m_positions.size();
+    m_nodes.resize(0);
+    m_order.resize(vertexCount);
+    std::iota(m_order.begin(), m_order.end(), 0);
+
+    double minX = m_positions[0].x(), maxX = minX;
+    double minY = m_positions[0].y(), maxY = minY;
+    for (const QPointF &position : m_positions) {
+        minX = std::min(minX, position.x());
+        maxX = std::max(maxX, position.x());
+        minY = std::min(minY, position.y());
+        maxY = std::max(maxY, position.y());
+    }
+    const double size = std::max(maxX - minX, maxY - minY) + 1.0;
+    buildNode(0, vertexCount, minX, minY, size, 0);
+}
+
+QPointF ForceLayout::repulsion(int vertex) const
+{
+    const double px = m_positions[vertex].x();
+    const double py = m_positions[vertex].y();
+    const double k2 = m_k * m_k;
+    double fx = 0, fy = 0;
+
+    QVarLengthArray<int, 128> stack;
+    stack.append(0);
+    while (!stack.isEmpty()) {
+        const Node &node = m_nodes[stack.last()];
+        stack.removeLast();
+
+        const double dx = px - node.massX;
+        const double dy = py - node.massY;
+        const double distance2 = dx * dx + dy * dy;
+
+        const bool leaf = node.children[0] < 0 && node.children[1] < 0
+                          && node.children[2] < 0 && node.children[3] < 0;
+        if (leaf) {
+            // В листе силы считаются точно
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                const int other = m_order[i];
+                if (other == vertex)
+                    continue;
+                double ox = px - m_positions[other].x();
+                double oy = py - m_positions[other].y();
+                double d2 = ox * ox + oy * oy;
+                if (d2 < 1e-6) {
+                    // Совпадающие вершины расталкиваются в детерминированном направлении
+                    ox = (vertex < other ? 1.0 : -1.0) * 0.1;
+                    oy = ((qint64(vertex) * 7919 + other) % 13 - 6) * 0.01;
+                    d2 = ox * ox + oy * oy;
+                }
+                fx += ox * k2 / d2;
+                fy += oy * k2 / d2;
+            }
+        } else if (node.size * node.size < THETA * THETA * distance2) {
+            fx += dx * k2 * node.mass / distance2;
+            fy += dy * k2 * node.mass / distance2;
+        } else {
+            for (int child : node.children) {
+                if (child >= 0) {
+                    stack.append(child);
+                }
+            }
+        }
+    }
+    return QPointF(fx, fy);
+}
+
+void ForceLayout::step()
+{
+    PROFILE_SCOPE("layout.step");
+    const int vertexCount = m_positions.size();
+    if (vertexCount == 0 || isFinished()) {
+        m_iteration = m_iterationCount;
+        return;
+    }
+
+    buildTree();
+    const double centerX = m_nodes[0].massX;
+    const double centerY = m_nodes[0].massY;
+
+    const int chunkCount = (vertexCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+    // Массивы отделяются от копий, отправленных в поток GUI, до параллельной
+    // части: неконстантный доступ из нескольких потоков к общему QVector небезопасен
+    QPointF *positions = m_positions.data();
+    QPointF *displacements = m_displacements.data();
+
+    // Силы: отталкивание через дерево, притяжение вдоль рёбер, притяжение к центру
+    parallelFor(chunkCount, [&](int chunk) {
+        const int begin = chunk * CHUNK_SIZE;
+        const int end = std::min(vertexCount, begin + CHUNK_SIZE);
+        for (int v = begin; v < end; ++v) {
+            QPointF force = repulsion(v);
+            const QPointF position = positions[v];
+
+            for (const int *n = m_adjacency.neighborsBegin(v); n != m_adjacency.neighborsEnd(v); ++n) {
+                const QPointF delta = position - positions[*n];
+                const double distance = std::sqrt(delta.x() * delta.x() + delta.y() * delta.y());
+                force -= delta * (distance / m_k);
+            }
+
+            force -= QPointF(position.x() - centerX, position.y() - centerY) * GRAVITY;
+            displacements[v] = force;
+        }
+    });
+
+    // Смещение ограничено температурой
+    const double temperature = m_temperature;
+    parallelFor(chunkCount, [&](int chunk) {
+        const int begin = chunk * CHUNK_SIZE;
+        const int end = std::min(vertexCount, begin + CHUNK_SIZE);
+        for (int v = begin; v < end; ++v) {
+            const QPointF &force = displacements[v];
+            const double length = std::sqrt(force.x() * force.x() + force.y() * force.y());
+            if (length > 0) {
+                positions[v] += force * (std::min(length, temperature) / length);
+            }
+        }
+    });
+
+    m_temperature *= m_cooling;
+    m_iteration++;
+}
+
+// Реализация LayoutWorker
+
+LayoutWorker::LayoutWorker(QObject *parent)
+    : QObject(parent), m_activeRunId(-1)
+{
+}
+
+void LayoutWorker::run(int runId, const GraphVersion &version)
+{
+    if (m_activeRunId.load() != runId)
+        return;
+
+    PROFILE_SCOPE("layout");
+    QVector<QPointF> positions;
+    positions.reserve(version.vertexCount());
+    for (int i = 0; i < version.vertexCount(); ++i) {
+        const GraphVersion::VertexRecord &record = version.vertexAt(i);
+        positions.append(QPointF(record.x, record.y));
+    }
+
+    ForceLayout layout(positions, Adjacency::fromVersion(version));
+    MemoryReservation buffers(MemoryTracker::Algorithm,
+                              qint64(positions.size()) * qint64(2 * sizeof(QPointF) + sizeof(int) + 80));
+
+    QElapsedTimer publishTimer;
+    publishTimer.start();
+    while (!layout.isFinished()) {
+        if (m_activeRunId.load() != runId)
+            return;
+
+        layout.step();
+
+        if (publishTimer.elapsed() >= PUBLISH_INTERVAL_MS && !layout.isFinished()) {
+            publishTimer.restart();
+            emit positionsReady(runId, version.number(), layout.positions(),
+                                100 * layout.iteration() / layout.iterationCount(), false);
+        }
+    }
+
+    emit positionsReady(runId, version.number(), layout.positions(), 100, true);
+}
+
+// Реализация AutoLayout
+
+AutoLayout::AutoLayout(Graph *graph, QObject *parent)
+    : QObject(parent), m_graph(graph), m_worker(new LayoutWorker), m_running(false), m_runId(0)
+{
+    qRegisterMetaType<GraphVersion>("GraphVersion");
+    qRegisterMetaType<QVector<QPointF>>("QVector<QPointF>");
+
+    m_worker->moveToThread(&m_thread);
+    connect(this, &AutoLayout::layoutRequested, m_worker, &LayoutWorker::run);
+    connect(m_worker, &LayoutWorker::positionsReady, this, &AutoLayout::applyPositions);
+    m_thread.start(QThread::LowPriority);
+}
+
+AutoLayout::~AutoLayout()
+{
+    m_worker->setActiveRun(-1);
+    m_thread.quit();
+    m_thread.wait();
+    delete m_worker;
+}
+
+void AutoLayout::start()
+{
+    if (m_running || m_graph->vertexCount() == 0)
+        return;
+
+    // Граф можно править во время раскладки: поток раскладки читает
+    // свою версию, а позиции применяются по идентификаторам её вершин
+    m_version = m_graph->currentVersion();
+
+    m_running = true;
+    m_runId++;
+    m_worker->setActiveRun(m_runId);
+    emit started();
+    emit layoutRequested(m_runId, m_version);
+}
+
+void AutoLayout::cancel()
+{
+    if (!m_running)
+        return;
+
+    m_running = false;
+    m_worker->setActiveRun(-1);
+    // Старая версия удерживает общие с графом части, отпускаем её
+    m_version = GraphVersion();
+    emit finished();
+}
+
+void AutoLayout::applyPositions(int runId, quint64 version, const QVector<QPointF> &positions,
+                                int percent, bool finished)
+{
+    if (!m_running || runId != m_runId || version != m_version.number())
+        return;
+
+    PROFILE_SCOPE("layout.apply");
+    // Вершины, удалённые за время раскладки, пропускаются
+    // Публикации одной раскладки сливаются в один шаг отмены
+    m_graph->beginBatch(tr("Auto layout"), m_runId);
+    for (int i = 0; i < positions.size() && i < m_version.vertexCount(); ++i) {
+        Vertex *vertex = m_graph->vertexById(m_version.vertexAt(i).id);
+        if (vertex) {
+            vertex->setPosition(positions[i]);
+        }
+    }
+    m_graph->endBatch();
+
+    emit progress(percent);
+    if (finished) {
+        m_running = false;
+        m_version = GraphVersion();
+        emit this->finished();
+    }
+}
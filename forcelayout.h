@@ -0,0 +1,121 @@
+#ifndef FORCELAYOUT_H
+#define FORCELAYOUT_H
+
+#include <QObject>
+#include <QPointF>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+#include "coloringengine.h"
+#include "graph.h"
+#include "graphversion.h"
+
+// Класс ForceLayout - силовая раскладка Фрухтермана-Рейнгольда.
+// Отталкивание всех пар вершин приближается деревом квадрантов
+// (Barnes-Hut), поэтому шаг стоит O(n log n + m). Силы для вершин
+// считаются параллельно. Класс не зависит от Graph и работает над
+// массивом позиций и списками смежности.
+class ForceLayout
+{
+public:
+    ForceLayout(const QVector<QPointF> &positions, const Adjacency &adjacency);
+
+    // Один шаг: расчёт сил и смещение вершин не дальше текущей температуры
+    void step();
+
+    int iteration() const { return m_iteration; }
+    int iterationCount() const { return m_iterationCount; }
+    bool isFinished() const { return m_iteration >= m_iterationCount; }
+
+    const QVector<QPointF> &positions() const { return m_positions; }
+
+private:
+    // Узел дерева квадрантов: квадрат, суммарная масса и центр масс.
+    // У листа first/count задают вершины в m_order.
+    struct Node
+    {
+        double x, y, size;
+        double massX, massY;
+        int mass;
+        int children[4];
+        int first;
+        int count;
+    };
+
+    Adjacency m_adjacency;
+    QVector<QPointF> m_positions;
+    QVector<QPointF> m_displacements;
+    QVector<Node> m_nodes;
+    QVector<int> m_order;
+
+    double m_k;            // Оптимальное расстояние между вершинами
+    double m_temperature;  // Наибольшее смещение за шаг
+    double m_cooling;
+    int m_iteration;
+    int m_iterationCount;
+
+    void buildTree();
+    int buildNode(int first, int count, double x, double y, double size, int depth);
+    QPointF repulsion(int vertex) const;
+};
+
+// Класс LayoutWorker выполняет раскладку в фоновом потоке и периодически
+// публикует промежуточные позиции
+class LayoutWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LayoutWorker(QObject *parent = nullptr);
+
+    // Запуск, который следует продолжать; остальные прерываются на ближайшем шаге.
+    // Вызывается из любого потока.
+    void setActiveRun(int runId) { m_activeRunId.store(runId); }
+
+public slots:
+    void run(int runId, const GraphVersion &version);
+
+signals:
+    // Позиции в порядке вершин версии с номером version; runId отличает
+    // результаты отменённого запуска от результатов следующего
+    void positionsReady(int runId, quint64 version, const QVector<QPointF> &positions,
+                        int percent, bool finished);
+
+private:
+    std::atomic<int> m_activeRunId;
+};
+
+// Класс AutoLayout запускает раскладку графа и применяет её результаты
+// в потоке GUI пачками. Все пачки одной раскладки сливаются в стеке
+// отмены в одну операцию.
+class AutoLayout : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AutoLayout(Graph *graph, QObject *parent = nullptr);
+    ~AutoLayout();
+
+    void start();
+    void cancel();
+    bool isRunning() const { return m_running; }
+
+signals:
+    void started();
+    void progress(int percent);
+    void finished();
+
+    void layoutRequested(int runId, const GraphVersion &version);
+
+private slots:
+    void applyPositions(int runId, quint64 version, const QVector<QPointF> &positions,
+                        int percent, bool finished);
+
+private:
+    Graph *m_graph;
+    QThread m_thread;
+    LayoutWorker *m_worker;
+    GraphVersion m_version;  // Версия, по которой идёт раскладка
+    bool m_running;
+    int m_runId;
+};
+
+#endif // FORCELAYOUT_H
@@ -0,0 +1,86 @@
+#include "framestats.h"
+#include <QObject>
+#include <algorithm>
+#include <cmath>
+
+FrameStats::FrameStats(int window)
+    : m_window(std::max(1, window)), m_frameCount(0)
+{
+    clear();
+}
+
+void FrameStats::addSample(Metric metric, double value)
+{
+    QVector<double> &samples = m_samples[metric];
+    if (samples.size() < m_window) {
+        samples.append(value);
+    } else {
+        samples[m_next[metric]] = value;
+    }
+    m_next[metric] = (m_next[metric] + 1) % m_window;
+}
+
+FrameStats::Summary FrameStats::summary(Metric metric) const
+{
+    Summary summary;
+    QVector<double> sorted = m_samples[metric];
+    summary.count = sorted.size();
+    if (sorted.isEmpty())
+        return summary;
+
+    // Перцентиль по ближайшему рангу
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) {
+        const int rank = int(std::ceil(p * sorted.size())) - 1;
+        return sorted[std::clamp(rank, 0, int(sorted.size()) - 1)];
+    };
+    summary.p50 = percentile(0.50);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    summary.max = sorted.last();
+    return summary;
+}
+
+void FrameStats::clear()
+{
+    for (int metric = 0; metric < MetricCount; ++metric) {
+        m_samples[metric].clear();
+        m_samples[metric].reserve(m_window);
+        m_next[metric] = 0;
+    }
+    m_frameCount = 0;
+}
+
+QString FrameStats::metricName(Metric metric)
+{
+    switch (metric) {
+    case PaintTime:
+        return QObject::tr("paint ms");
+    case PaintedItems:
+        return QObject::tr("items");
+    case IndexQueryTime:
+        return QObject::tr("index ms");
+    case InputLatency:
+        return QObject::tr("input ms");
+    case MetricCount:
+        break;
+    }
+    return QString();
+}
+
+QString FrameStats::report() const
+{
+    QString text = QString("%1 %2 %3 %4 %5\n")
+                       .arg("", -9).arg("p50", 7).arg("p95", 7).arg("p99", 7).arg("max", 7);
+    for (int metric = 0; metric < MetricCount; ++metric) {
+        const Summary stats = summary(Metric(metric));
+        text += QString("%1 %2 %3 %4 %5\n")
+                    .arg(metricName(Metric(metric)), -9)
+                    .arg(stats.p50, 7, 'f', 2)
+                    .arg(stats.p95, 7, 'f', 2)
+                    .arg(stats.p99, 7, 'f', 2)
+                    .arg(stats.max, 7, 'f', 2);
+    }
+    text += QObject::tr("%1 frames").arg(m_frameCount);
+    return text;
+}
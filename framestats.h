@@ -0,0 +1,52 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <QString>
+#include <QVector>
+
+// Класс FrameStats хранит показатели последних кадров отрисовки в
+// кольцевых буферах и считает по ним перцентили. Задержка ввода
+// приходит не с каждым кадром, поэтому у каждого показателя свой буфер.
+class FrameStats
+{
+public:
+    enum Metric {
+        PaintTime,       // Время paintEvent, мс
+        PaintedItems,    // Элементов сцены, отрисованных за кадр
+        IndexQueryTime,  // Запросы к индексам сцены между кадрами, мс
+        InputLatency,    // От события мыши или клавиатуры до конца отрисовки, мс
+        MetricCount
+    };
+
+    struct Summary
+    {
+        int count = 0;
+        double p50 = 0;
+        double p95 = 0;
+        double p99 = 0;
+        double max = 0;
+    };
+
+    explicit FrameStats(int window = 240);
+
+    void addSample(Metric metric, double value);
+    Summary summary(Metric metric) const;
+    void clear();
+
+    // Кадров с последней очистки
+    qint64 frameCount() const { return m_frameCount; }
+    void countFrame() { m_frameCount++; }
+
+    static QString metricName(Metric metric);
+
+    // Таблица перцентилей по всем показателям (для оверлея и журнала)
+    QString report() const;
+
+private:
+    int m_window;
+    QVector<double> m_samples[MetricCount];
+    int m_next[MetricCount];
+    qint64 m_frameCount;
+};
+
+#endif // FRAMESTATS_H
@@ -2,13 +2,19 @@
 #include "vertex.h"
 #include "edge.h"
 #include "coloringalgorithm.h"
+#include "graphsnapshot.h"
+#include "profiler.h"
+#include "memorystats.h"
 #include <QRandomGenerator>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QMap>
+#include <QSet>
+#include <algorithm>
 
 Graph::Graph(QObject *parent)
-    : QObject(parent), m_maxColor(0)
+    : QObject(parent), m_maxColor(0), m_coloringStructure(ColoringEngine::Structure::General),
+      m_coloringOptimal(false), m_portfolioDeadline(0), m_nextVertexId(0), m_batchDepth(0)
 {
     // Создаем алгоритм раскраски
     m_coloringAlgorithm = new ColoringAlgorithm(this);
@@ -21,8 +27,33 @@ Graph::~Graph()
 
 Vertex* Graph::addVertex(const QPointF &position)
 {
-    Vertex *vertex = new Vertex(position, this);
-    m_vertices.append(vertex);
+    return addVertex(position, m_nextVertexId);
+}
+
+Vertex* Graph::addVertex(const QPointF &position, int id)
+{
+    if (id < 0 || m_vertexIds.contains(id)) {
+        id = m_nextVertexId;
+    }
+    m_nextVertexId = std::max(m_nextVertexId, id + 1);
+
+    // Вершины и рёбра создаются без QObject-родителя: граф владеет ими сам,
+    // а удаление из списка детей QObject выполняется за линейное время
+    Vertex *vertex = new Vertex(position);
+    vertex->m_handle = m_vertices.insert(vertex);
+    vertex->m_id = id;
+    vertex->m_graph = this;
+    m_vertexIds.insert(id, vertex);
+
+    GraphVersion::VertexRecord record;
+    record.id = id;
+    record.x = position.x();
+    record.y = position.y();
+    record.colorIndex = vertex->m_colorIndex;
+    record.locked = vertex->m_locked;
+    m_version.m_vertices.append(record);
+    m_version.m_number++;
+
     emit vertexAdded(vertex);
     emit graphChanged();
     return vertex;
@@ -34,37 +65,57 @@ Edge* Graph::addEdge(Vertex *source, Vertex *dest)
         return nullptr;
 
     // Проверим, есть ли уже такое ребро
-    for (Edge *edge : m_edges) {
-        if ((edge->sourceVertex() == source && edge->destVertex() == dest) ||
-            (edge->sourceVertex() == dest && edge->destVertex() == source)) {
-            return nullptr;
-        }
-    }
+    if (findEdge(source, dest))
+        return nullptr;
 
-    Edge *edge = new Edge(source, dest, this);
-    m_edges.append(edge);
+    Edge *edge = new Edge(source, dest);
+    edge->m_handle = m_edges.insert(edge);
     source->addEdge(edge);
     dest->addEdge(edge);
+
+    GraphVersion::EdgeRecord record;
+    record.sourceId = source->m_id;
+    record.destId = dest->m_id;
+    m_version.m_edges.append(record);
+    m_version.m_number++;
+
     emit edgeAdded(edge);
     emit graphChanged();
     return edge;
 }
 
+Edge* Graph::findEdge(Vertex *source, Vertex *dest) const
+{
+    if (!source || !dest)
+        return nullptr;
+
+    // Достаточно просмотреть рёбра вершины с меньшей степенью
+    Vertex *from = source->degree() <= dest->degree() ? source : dest;
+    Vertex *to = from == source ? dest : source;
+    for (Edge *edge : from->m_edges) {
+        if (edge->sourceVertex() == to || edge->destVertex() == to) {
+            return edge;
+        }
+    }
+    return nullptr;
+}
+
 void Graph::removeVertex(Vertex *vertex)
 {
     if (!vertex)
         return;
 
+    beginBatch(tr("Remove vertex"));
+
     // Удаляем связанные ребра
-    QList<Edge*> edgesToRemove = vertex->edges();
-    for (Edge *edge : edgesToRemove) {
-        removeEdge(edge);
+    while (!vertex->m_edges.isEmpty()) {
+        detachEdge(vertex->m_edges.last());
     }
 
-    m_vertices.removeOne(vertex);
-    emit vertexRemoved(vertex);
+    destroyVertex(vertex);
     emit graphChanged();
-    delete vertex;
+
+    endBatch();
 }
 
 void Graph::removeEdge(Edge *edge)
@@ -72,62 +123,338 @@ void Graph::removeEdge(Edge *edge)
     if (!edge)
         return;
 
+    detachEdge(edge);
+    emit graphChanged();
+}
+
+int Graph::removeItems(const QVector<SlotHandle> &vertexHandles,
+                       const QVector<SlotHandle> &edgeHandles)
+{
+    int removedCount = 0;
+    beginBatch(tr("Delete selection"));
+
+    // Сначала удаляем явно выбранные рёбра
+    for (const SlotHandle &handle : edgeHandles) {
+        Edge *edge = m_edges.value(handle, nullptr);
+        if (edge) {
+            detachEdge(edge);
+            removedCount++;
+        }
+    }
+
+    // Затем вершины вместе с оставшимися инцидентными рёбрами.
+    // После удаления поколение слота меняется, поэтому повторный
+    // дескриптор той же вершины здесь уже не найдётся
+    for (const SlotHandle &handle : vertexHandles) {
+        Vertex *vertex = m_vertices.value(handle, nullptr);
+        if (!vertex)
+            continue;
+
+        while (!vertex->m_edges.isEmpty()) {
+            detachEdge(vertex->m_edges.last());
+            removedCount++;
+        }
+
+        destroyVertex(vertex);
+        removedCount++;
+    }
+
+    if (removedCount > 0) {
+        emit graphChanged();
+    }
+
+    endBatch();
+    return removedCount;
+}
+
+void Graph::detachEdge(Edge *edge)
+{
     edge->sourceVertex()->removeEdge(edge);
     edge->destVertex()->removeEdge(edge);
-    m_edges.removeOne(edge);
+    // Записи версии удаляются так же, как элементы SlotMap, и порядок совпадает
+    m_version.m_edges.swapRemove(m_edges.indexOf(edge->m_handle));
+    m_version.m_number++;
+    m_edges.remove(edge->m_handle);
     emit edgeRemoved(edge);
-    emit graphChanged();
     delete edge;
 }
 
+void Graph::destroyVertex(Vertex *vertex)
+{
+    m_version.m_vertices.swapRemove(m_vertices.indexOf(vertex->m_handle));
+    m_version.m_number++;
+    m_vertices.remove(vertex->m_handle);
+    m_vertexIds.remove(vertex->m_id);
+    emit vertexRemoved(vertex);
+    delete vertex;
+}
+
 void Graph::clear()
 {
+    beginBatch(tr("Clear graph"));
+
     while (!m_edges.isEmpty()) {
-        removeEdge(m_edges.first());
+        detachEdge(m_edges.at(m_edges.size() - 1));
     }
 
     while (!m_vertices.isEmpty()) {
-        removeVertex(m_vertices.first());
+        destroyVertex(m_vertices.at(m_vertices.size() - 1));
     }
 
     m_maxColor = 0;
+    m_coloringStructure = ColoringEngine::Structure::General;
+    m_coloringOptimal = false;
+    m_version.m_generation++;
     emit graphChanged();
+
+    endBatch();
 }
 
 void Graph::colorVertices()
 {
-    // Применяем жадный алгоритм раскраски
-    m_maxColor = m_coloringAlgorithm->applyGreedyColoring(m_vertices);
+    PROFILE_SCOPE("color");
+    MEMORY_OPERATION("color");
+    beginBatch(tr("Color graph"));
+
+    // Номера цветов считаются заранее, применяются они одним проходом
+    QVector<int> colorIndices;
+    if (m_portfolioDeadline > 0) {
+        m_maxColor = m_coloringAlgorithm->computePortfolioColoring(this, m_portfolioDeadline, &colorIndices,
+                                                                   &m_coloringEngine, &m_coloringOptimal);
+        m_coloringStructure = ColoringEngine::Structure::General;
+    } else {
+        m_maxColor = m_coloringAlgorithm->computeGreedyColoring(this, &colorIndices, &m_coloringStructure);
+        m_coloringOptimal = m_coloringStructure != ColoringEngine::Structure::General;
+        m_coloringEngine = ColoringEngine::engineName(ColoringEngine::Engine::Greedy);
+    }
+
+    const QList<Vertex*> &vertices = m_vertices.values();
+    setVertexColorIndices(QVector<Vertex*>(vertices.begin(), vertices.end()), colorIndices);
+
+    endBatch();
     emit graphColored();
 }
 
+bool Graph::colorVerticesWithBudget(int layerCount, QVector<Edge*> *conflicts, QString *errorMessage)
+{
+    PROFILE_SCOPE("color");
+    MEMORY_OPERATION("color");
+
+    QVector<int> colorIndices;
+    QVector<QPair<int, int>> conflictPairs;
+    if (!m_coloringAlgorithm->computeBudgetColoring(this, layerCount, &colorIndices,
+                                                    &conflictPairs, errorMessage)) {
+        return false;
+    }
+
+    beginBatch(tr("Color graph"));
+
+    const QList<Vertex*> &vertices = m_vertices.values();
+    setVertexColorIndices(QVector<Vertex*>(vertices.begin(), vertices.end()), colorIndices);
+    m_maxColor = colorIndices.isEmpty()
+                     ? 0 : *std::max_element(colorIndices.constBegin(), colorIndices.constEnd()) + 1;
+    m_coloringStructure = ColoringEngine::Structure::General;
+    m_coloringOptimal = false;
+
+    endBatch();
+
+    if (conflicts) {
+        conflicts->clear();
+        conflicts->reserve(conflictPairs.size());
+        for (const QPair<int, int> &pair : conflictPairs) {
+            conflicts->append(findEdge(vertices[pair.first], vertices[pair.second]));
+        }
+    }
+
+    emit graphColored();
+    return true;
+}
+
+bool Graph::applyVersionColoring(const GraphVersion &version, const QVector<int> &colorIndices,
+                                 const QString &engine, bool optimal)
+{
+    if (version.generation() != m_version.m_generation)
+        return false;
+
+    PROFILE_SCOPE("color");
+    // Добавленные за время расчёта вершины и рёбра могли оставить вершины
+    // без цвета или одноцветные концы ребра
+    const bool modified = version.number() != m_version.m_number;
+    beginBatch(tr("Color graph"));
+
+    // Вершины, удалённые за время расчёта, пропускаются
+    QVector<Vertex*> vertices;
+    QVector<int> colors;
+    vertices.reserve(version.vertexCount());
+    colors.reserve(version.vertexCount());
+    for (int i = 0; i < version.vertexCount() && i < colorIndices.size(); ++i) {
+        if (Vertex *vertex = vertexById(version.vertexAt(i).id)) {
+            vertices.append(vertex);
+            colors.append(colorIndices[i]);
+        }
+    }
+    setVertexColorIndices(vertices, colors);
+    m_maxColor = colorIndices.isEmpty()
+                     ? 0 : *std::max_element(colorIndices.constBegin(), colorIndices.constEnd()) + 1;
+    m_coloringStructure = ColoringEngine::Structure::General;
+    m_coloringOptimal = optimal;
+    m_coloringEngine = engine;
+
+    if (modified) {
+        repairColoring();
+    }
+
+    endBatch();
+    emit graphColored();
+    return true;
+}
+
+int Graph::repairColoring()
+{
+    PROFILE_SCOPE("color");
+    QVector<int> colorIndices;
+    const int recolored = m_coloringAlgorithm->computeRepairColoring(this, &colorIndices);
+    if (recolored == 0)
+        return 0;
+
+    beginBatch(tr("Repair coloring"));
+
+    const QList<Vertex*> &vertices = m_vertices.values();
+    setVertexColorIndices(QVector<Vertex*>(vertices.begin(), vertices.end()), colorIndices);
+    m_maxColor = *std::max_element(colorIndices.constBegin(), colorIndices.constEnd()) + 1;
+    m_coloringStructure = ColoringEngine::Structure::General;
+    m_coloringOptimal = false;
+
+    endBatch();
+
+    emit graphColored();
+    return recolored;
+}
+
+void Graph::setVertexColorIndex(Vertex *vertex, int colorIndex)
+{
+    if (!vertex)
+        return;
+
+    vertex->setColorIndex(colorIndex);
+    vertex->setColor(m_coloringAlgorithm->colorForIndex(colorIndex));
+}
+
+void Graph::setVertexColorIndices(const QVector<Vertex*> &vertices, const QVector<int> &colorIndices)
+{
+    PROFILE_SCOPE("color.apply");
+
+    QVector<Vertex*> changed;
+    QVector<int> oldIndices;
+    const int count = std::min(vertices.size(), colorIndices.size());
+    for (int i = 0; i < count; ++i) {
+        Vertex *vertex = vertices[i];
+        if (!vertex || vertex->m_colorIndex == colorIndices[i])
+            continue;
+
+        // Поля меняются напрямую, без сигналов отдельных вершин
+        changed.append(vertex);
+        oldIndices.append(vertex->m_colorIndex);
+        vertex->m_colorIndex = colorIndices[i];
+        vertex->m_color = m_coloringAlgorithm->colorForIndex(colorIndices[i]);
+        updateVersionRecord(vertex);
+        // Слой, назначенный вручную (закрепление), тоже учитывается в числе цветов
+        m_maxColor = std::max(m_maxColor, colorIndices[i] + 1);
+    }
+
+    if (!changed.isEmpty()) {
+        // Все изменения - одна операция для отмены и журнала
+        beginBatch(tr("Change colors"));
+        emit colorsChanged(changed, oldIndices);
+        endBatch();
+    }
+}
+
+void Graph::setVertexLocked(Vertex *vertex, bool locked)
+{
+    if (!vertex || vertex->m_locked == locked)
+        return;
+
+    vertex->m_locked = locked;
+    updateVersionRecord(vertex);
+    emit vertexLockChanged(vertex);
+}
+
+void Graph::beginBatch(const QString &text, int mergeKey)
+{
+    if (m_batchDepth++ == 0) {
+        emit batchStarted(text, mergeKey);
+    }
+}
+
+void Graph::endBatch()
+{
+    if (m_batchDepth > 0 && --m_batchDepth == 0) {
+        emit batchFinished();
+    }
+}
+
+GraphVersion Graph::currentVersion() const
+{
+    GraphVersion version = m_version;
+    version.m_maxColor = m_maxColor;
+    return version;
+}
+
+void Graph::updateVersionRecord(Vertex *vertex)
+{
+    const int index = m_vertices.indexOf(vertex->m_handle);
+    if (index < 0)
+        return;
+
+    GraphVersion::VertexRecord record = m_version.m_vertices.at(index);
+    record.x = vertex->m_position.x();
+    record.y = vertex->m_position.y();
+    record.colorIndex = vertex->m_colorIndex;
+    record.locked = vertex->m_locked;
+    m_version.m_vertices.set(index, record);
+    m_version.m_number++;
+}
+
+void Graph::notifyVertexMoved(Vertex *vertex, const QPointF &oldPosition)
+{
+    updateVersionRecord(vertex);
+    emit vertexMoved(vertex, oldPosition);
+}
+
+void Graph::notifyVertexColorIndexChanged(Vertex *vertex, int oldIndex)
+{
+    updateVersionRecord(vertex);
+    emit vertexColorIndexChanged(vertex, oldIndex);
+}
+
 QJsonObject Graph::toJson() const
 {
     QJsonObject graphJson;
     QJsonArray verticesJson;
     QJsonArray edgesJson;
 
-    // Сохраняем вершины с уникальными ID
-    QMap<Vertex*, int> vertexToId;
-    int nextId = 0;
-
-    for (Vertex *vertex : m_vertices) {
+    // Сохраняем вершины с постоянными идентификаторами: по ним файл
+    // сопоставляется с графом при перечитывании (applySnapshotDiff)
+    for (Vertex *vertex : m_vertices.values()) {
         QJsonObject vertexJson;
-        vertexJson["id"] = nextId;
+        vertexJson["id"] = vertex->id();
         vertexJson["x"] = vertex->position().x();
         vertexJson["y"] = vertex->position().y();
         vertexJson["color_index"] = vertex->colorIndex();
+        // Ключ пишется только для закреплённых вершин, прежние файлы не меняются
+        if (vertex->isLocked()) {
+            vertexJson["locked"] = true;
+        }
 
         verticesJson.append(vertexJson);
-        vertexToId[vertex] = nextId;
-        nextId++;
     }
 
     // Сохраняем ребра, ссылаясь на ID вершин
-    for (Edge *edge : m_edges) {
+    for (Edge *edge : m_edges.values()) {
         QJsonObject edgeJson;
-        edgeJson["source_id"] = vertexToId[edge->sourceVertex()];
-        edgeJson["dest_id"] = vertexToId[edge->destVertex()];
+        edgeJson["source_id"] = edge->sourceVertex()->id();
+        edgeJson["dest_id"] = edge->destVertex()->id();
 
         edgesJson.append(edgeJson);
     }
@@ -141,14 +468,18 @@ QJsonObject Graph::toJson() const
 
 bool Graph::fromJson(const QJsonObject &json)
 {
-    // Очищаем текущий граф
-    clear();
-
     // Проверяем наличие необходимых ключей
     if (!json.contains("vertices") || !json.contains("edges")) {
+        clear();
         return false;
     }
 
+    // Загрузка целиком - одна операция для отмены
+    beginBatch(tr("Load graph"));
+
+    // Очищаем текущий граф
+    clear();
+
     QJsonArray verticesJson = json["vertices"].toArray();
     QJsonArray edgesJson = json["edges"].toArray();
 
@@ -162,16 +493,10 @@ bool Graph::fromJson(const QJsonObject &json)
         double y = vertexJson["y"].toDouble();
         int colorIndex = vertexJson["color_index"].toInt(-1);
 
-        Vertex *vertex = addVertex(QPointF(x, y));
-        vertex->setColorIndex(colorIndex);
-
-        // Если у вершины указан цвет, устанавливаем его
-        if (colorIndex >= 0 && m_coloringAlgorithm) {
-            QVector<QColor> palette = m_coloringAlgorithm->colorPalette();
-            if (colorIndex < palette.size()) {
-                vertex->setColor(palette[colorIndex]);
-            }
-        }
+        // Идентификаторы из файла становятся постоянными идентификаторами вершин
+        Vertex *vertex = addVertex(QPointF(x, y), id);
+        setVertexColorIndex(vertex, colorIndex);
+        setVertexLocked(vertex, vertexJson["locked"].toBool(false));
 
         idToVertex[id] = vertex;
     }
@@ -193,13 +518,133 @@ bool Graph::fromJson(const QJsonObject &json)
     }
 
     emit graphChanged();
+    endBatch();
     return true;
 }
 
+void Graph::loadSnapshot(const GraphSnapshot &snapshot)
+{
+    beginLoad();
+
+    m_vertices.reserve(snapshot.vertices.size());
+    m_edges.reserve(snapshot.edges.size());
+
+    appendVertices(snapshot.vertices);
+    appendEdges(snapshot.edges);
+    endLoad(snapshot.maxColor);
+}
+
+void Graph::beginLoad()
+{
+    beginBatch(tr("Load graph"));
+    clear();
+}
+
+void Graph::appendVertices(const QVector<GraphSnapshot::VertexRecord> &records)
+{
+    for (const GraphSnapshot::VertexRecord &record : records) {
+        Vertex *vertex = addVertex(QPointF(record.x, record.y), record.id);
+        setVertexColorIndex(vertex, record.colorIndex);
+        setVertexLocked(vertex, record.locked);
+    }
+}
+
+void Graph::appendEdges(const QVector<GraphSnapshot::EdgeRecord> &records)
+{
+    for (const GraphSnapshot::EdgeRecord &record : records) {
+        addEdge(vertexById(record.sourceId), vertexById(record.destId));
+    }
+}
+
+void Graph::endLoad(int maxColor)
+{
+    m_maxColor = maxColor;
+    emit graphChanged();
+    endBatch();
+}
+
+GraphDiffStats Graph::applySnapshotDiff(const GraphSnapshot &snapshot)
+{
+    PROFILE_SCOPE("reload.diff");
+    GraphDiffStats stats;
+
+    auto edgeKey = [](int a, int b) {
+        return (quint64(quint32(std::min(a, b))) << 32) | quint32(std::max(a, b));
+    };
+
+    QSet<int> snapshotIds;
+    snapshotIds.reserve(snapshot.vertices.size());
+    for (const GraphSnapshot::VertexRecord &record : snapshot.vertices) {
+        snapshotIds.insert(record.id);
+    }
+    QSet<quint64> snapshotEdges;
+    snapshotEdges.reserve(snapshot.edges.size());
+    for (const GraphSnapshot::EdgeRecord &record : snapshot.edges) {
+        snapshotEdges.insert(edgeKey(record.sourceId, record.destId));
+    }
+
+    // Исчезнувшие элементы собираются до изменений и удаляются пакетом
+    QVector<SlotHandle> removedVertices;
+    for (Vertex *vertex : m_vertices.values()) {
+        if (!snapshotIds.contains(vertex->id())) {
+            removedVertices.append(vertex->handle());
+        }
+    }
+    QVector<SlotHandle> removedEdges;
+    for (Edge *edge : m_edges.values()) {
+        if (!snapshotEdges.contains(edgeKey(edge->sourceVertex()->id(), edge->destVertex()->id()))) {
+            removedEdges.append(edge->handle());
+        }
+    }
+
+    beginBatch(tr("Reload graph"));
+
+    if (!removedVertices.isEmpty() || !removedEdges.isEmpty()) {
+        removeItems(removedVertices, removedEdges);
+        stats.removedVertices = removedVertices.size();
+        stats.removedEdges = removedEdges.size();
+    }
+
+    for (const GraphSnapshot::VertexRecord &record : snapshot.vertices) {
+        const QPointF position(record.x, record.y);
+        Vertex *vertex = vertexById(record.id);
+        if (vertex) {
+            if (vertex->position() != position) {
+                vertex->setPosition(position);
+                stats.movedVertices++;
+            }
+            // Цвет и закрепление тоже берутся из файла: иначе вершина,
+            // сопоставленная не с той записью, сохранила бы чужой слой
+            if (vertex->colorIndex() != record.colorIndex || vertex->isLocked() != record.locked) {
+                setVertexColorIndex(vertex, record.colorIndex);
+                setVertexLocked(vertex, record.locked);
+                m_maxColor = std::max(m_maxColor, record.colorIndex + 1);
+                stats.changedVertices++;
+            }
+            continue;
+        }
+        vertex = addVertex(position, record.id);
+        setVertexColorIndex(vertex, record.colorIndex);
+        setVertexLocked(vertex, record.locked);
+        m_maxColor = std::max(m_maxColor, record.colorIndex + 1);
+        stats.addedVertices++;
+    }
+
+    for (const GraphSnapshot::EdgeRecord &record : snapshot.edges) {
+        // Существующие рёбра и рёбра с неизвестными концами addEdge пропускает
+        if (addEdge(vertexById(record.sourceId), vertexById(record.destId))) {
+            stats.addedEdges++;
+        }
+    }
+
+    endBatch();
+    return stats;
+}
+
 Vertex* Graph::findVertexById(int id) const
 {
     if (id >= 0 && id < m_vertices.size()) {
-        return m_vertices[id];
+        return m_vertices.at(id);
     }
     return nullptr;
 }
@@ -6,11 +6,34 @@
 #include <QPointF>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QHash>
+#include <QString>
 #include "vertex.h"
 #include "edge.h"
+#include "slotmap.h"
+#include "graphsnapshot.h"
+#include "graphversion.h"
+#include "coloringengine.h"
 
 class ColoringAlgorithm;
 
+// Итог применения нового содержимого файла к графу (Graph::applySnapshotDiff)
+struct GraphDiffStats
+{
+    int addedVertices = 0;
+    int removedVertices = 0;
+    int movedVertices = 0;
+    int changedVertices = 0;  // Изменились цвет или закрепление
+    int addedEdges = 0;
+    int removedEdges = 0;
+
+    bool isEmpty() const
+    {
+        return addedVertices == 0 && removedVertices == 0 && movedVertices == 0
+               && changedVertices == 0 && addedEdges == 0 && removedEdges == 0;
+    }
+};
+
 // Класс Graph представляет граф с вершинами и рёбрами
 class Graph : public QObject
 {
@@ -21,27 +44,123 @@ public:
 
     // Управление вершинами и рёбрами
     Vertex* addVertex(const QPointF &position);
+    // Добавление вершины с заданным идентификатором (при загрузке и отмене
+    // удаления); если идентификатор занят, назначается новый
+    Vertex* addVertex(const QPointF &position, int id);
     Edge* addEdge(Vertex *source, Vertex *dest);
     void removeVertex(Vertex *vertex);
     void removeEdge(Edge *edge);
 
+    // Пакетное удаление выделенных элементов. Рёбра, инцидентные удаляемым
+    // вершинам, удаляются вместе с ними; устаревшие и повторяющиеся дескрипторы
+    // пропускаются. Возвращает количество удалённых элементов.
+    int removeItems(const QVector<SlotHandle> &vertexHandles,
+                    const QVector<SlotHandle> &edgeHandles);
+
     // Доступ к данным
-    QList<Vertex*> vertices() const { return m_vertices; }
-    QList<Edge*> edges() const { return m_edges; }
+    // Списки без копирования; при удалении элементов порядок меняется,
+    // поэтому удалять во время обхода нельзя (см. removeItems)
+    const QList<Vertex*> &vertices() const { return m_vertices.values(); }
+    const QList<Edge*> &edges() const { return m_edges.values(); }
+    int vertexCount() const { return m_vertices.size(); }
+    int edgeCount() const { return m_edges.size(); }
+
+    // Поиск по дескриптору, nullptr для устаревшего дескриптора
+    Vertex* vertexAt(const SlotHandle &handle) const { return m_vertices.value(handle, nullptr); }
+    Edge* edgeAt(const SlotHandle &handle) const { return m_edges.value(handle, nullptr); }
+
+    // Поиск вершины по постоянному идентификатору и ребра по концам
+    Vertex* vertexById(int id) const { return m_vertexIds.value(id, nullptr); }
+    Edge* findEdge(Vertex *source, Vertex *dest) const;
+
+    // Текущая версия структуры для фоновых потоков. Копия дешёвая и не
+    // меняется при дальнейших правках графа (см. GraphVersion).
+    GraphVersion currentVersion() const;
+
+    // Позиция вершины в списке vertices() (номер вершины в файле), -1 для чужой вершины
+    int vertexIndex(const Vertex *vertex) const { return m_vertices.indexOf(vertex->handle()); }
+
+    // Установка номера цвета вместе с цветом из палитры (-1 - без цвета)
+    void setVertexColorIndex(Vertex *vertex, int colorIndex);
+
+    // Массовая установка номеров цветов одним проходом: вершины не посылают
+    // сигналов по отдельности, вместо этого один раз посылается colorsChanged
+    // со списком действительно изменившихся вершин
+    void setVertexColorIndices(const QVector<Vertex*> &vertices, const QVector<int> &colorIndices);
+
+    // Закрепление вершины за её текущим слоем (номером цвета)
+    void setVertexLocked(Vertex *vertex, bool locked);
+
+    // Группировка изменений в одну логическую операцию (для отмены и журнала).
+    // Вызовы могут быть вложенными, сигналы посылает только внешняя пара.
+    // mergeKey > 0 - перемещения подряд идущих пакетов с тем же ключом
+    // сливаются в один шаг отмены (публикации одной раскладки)
+    void beginBatch(const QString &text, int mergeKey = 0);
+    void endBatch();
+    bool inBatch() const { return m_batchDepth > 0; }
 
     // Очистка графа
     void clear();
 
-    // Раскраска графа жадным алгоритмом
+    // Раскраска графа жадным алгоритмом или, если задан срок, гонкой
+    // нескольких алгоритмов (см. ColoringAlgorithm::computePortfolioColoring)
     void colorVertices();
+    // 0 - жадная раскраска
+    void setPortfolioDeadline(int milliseconds) { m_portfolioDeadline = milliseconds; }
+    int portfolioDeadline() const { return m_portfolioDeadline; }
+
+    // Раскраска не более чем в layerCount цветов, закреплённые вершины
+    // сохраняют свой цвет. Если слоёв не хватает, в conflicts возвращаются
+    // рёбра с одинаково раскрашенными концами. false - недопустимый бюджет
+    // или вершина закреплена за слоем вне бюджета.
+    bool colorVerticesWithBudget(int layerCount, QVector<Edge*> *conflicts = nullptr,
+                                 QString *errorMessage = nullptr);
+
+    // Применение раскраски, посчитанной в фоне по версии version:
+    // colorIndices[i] - цвет i-й вершины версии, вершины сопоставляются по
+    // идентификатору, изменения графа за время расчёта чинит repairColoring.
+    // false - граф с тех пор очищался или загружался, раскраска не применена.
+    bool applyVersionColoring(const GraphVersion &version, const QVector<int> &colorIndices,
+                              const QString &engine, bool optimal);
+
+    // Починка раскраски после изменения графа: перекрашиваются только вершины
+    // без цвета и концы конфликтных рёбер (см. ColoringAlgorithm::computeRepairColoring).
+    // Возвращает число перекрашенных вершин.
+    int repairColoring();
 
     // Получить максимальное количество цветов
     int maxColorCount() const { return m_maxColor; }
 
+    // Класс графа при последней раскраске colorVertices; не General -
+    // число цветов заведомо минимально. Другие раскраски сбрасывают в General.
+    ColoringEngine::Structure coloringStructure() const { return m_coloringStructure; }
+    // Минимальность числа цветов доказана (по классу графа или по клике)
+    bool isColoringOptimal() const { return m_coloringOptimal; }
+    // Алгоритм, давший последнюю раскраску colorVertices
+    QString coloringEngine() const { return m_coloringEngine; }
+
     // Поддержка JSON для сохранения/загрузки
     QJsonObject toJson() const;
     bool fromJson(const QJsonObject &json);
 
+    // Замена содержимого графа снимком с сохранением идентификаторов вершин
+    void loadSnapshot(const GraphSnapshot &snapshot);
+
+    // Загрузка по частям: beginLoad очищает граф и открывает операцию
+    // "Load graph", записи добавляются порциями (рёбра - после своих
+    // вершин), endLoad закрывает операцию. Между вызовами может
+    // обрабатываться цикл событий.
+    void beginLoad();
+    void appendVertices(const QVector<GraphSnapshot::VertexRecord> &records);
+    void appendEdges(const QVector<GraphSnapshot::EdgeRecord> &records);
+    void endLoad(int maxColor);
+
+    // Приведение графа к снимку одной операцией "Reload graph": вершины
+    // сопоставляются по идентификатору, рёбра - по паре идентификаторов
+    // концов. Добавляются и удаляются только отличающиеся элементы,
+    // сохранившимся вершинам переносятся позиция, цвет и закрепление из файла.
+    GraphDiffStats applySnapshotDiff(const GraphSnapshot &snapshot);
+
 signals:
     void graphChanged();
     void vertexAdded(Vertex *vertex);
@@ -50,16 +169,53 @@ signals:
     void edgeRemoved(Edge *edge);
     void graphColored();
 
+    // Изменения атрибутов вершин с прежними значениями
+    void vertexMoved(Vertex *vertex, const QPointF &oldPosition);
+    void vertexColorIndexChanged(Vertex *vertex, int oldIndex);
+    // Массовое изменение цветов: oldIndices[i] - прежний номер vertices[i]
+    void colorsChanged(const QVector<Vertex*> &vertices, const QVector<int> &oldIndices);
+    // Закрепление вершины изменилось (прежнее значение - !vertex->isLocked())
+    void vertexLockChanged(Vertex *vertex);
+
+    // Границы пакетной операции
+    void batchStarted(const QString &text, int mergeKey);
+    void batchFinished();
+
 private:
-    QList<Vertex*> m_vertices;
-    QList<Edge*> m_edges;
+    SlotMap<Vertex*> m_vertices;
+    SlotMap<Edge*> m_edges;
     int m_maxColor;  // Максимальный используемый цвет
+    ColoringEngine::Structure m_coloringStructure;
+    bool m_coloringOptimal;
+    QString m_coloringEngine;
+    int m_portfolioDeadline;
+
+    // Постоянные идентификаторы вершин
+    QHash<int, Vertex*> m_vertexIds;
+    int m_nextVertexId;
+
+    int m_batchDepth;
+
+    // Версия, которую граф обновляет при каждом изменении
+    GraphVersion m_version;
 
     // Алгоритм раскраски
     ColoringAlgorithm *m_coloringAlgorithm;
 
     // Вспомогательный метод для поиска вершины по ID
     Vertex* findVertexById(int id) const;
+
+    // Отсоединяет ребро от вершин и удаляет его без сигнала graphChanged
+    void detachEdge(Edge *edge);
+    // Удаляет вершину, не трогая рёбра и не посылая graphChanged
+    void destroyVertex(Vertex *vertex);
+    // Перенос атрибутов вершины в её запись текущей версии
+    void updateVersionRecord(Vertex *vertex);
+
+    // Уведомления от вершин
+    friend class Vertex;
+    void notifyVertexMoved(Vertex *vertex, const QPointF &oldPosition);
+    void notifyVertexColorIndexChanged(Vertex *vertex, int oldIndex);
 };
 
 #endif // GRAPH_H
@@ -0,0 +1,250 @@
+#include "graphdelta.h"
+#include "graph.h"
+
+GraphDelta GraphDelta::vertexAdded(int id, const QPointF &position, int colorIndex)
+{
+    GraphDelta delta;
+    delta.type = AddVertex;
+    delta.a = id;
+    delta.b = colorIndex;
+    delta.to = position;
+    return delta;
+}
+
+GraphDelta GraphDelta::vertexRemoved(int id, const QPointF &position, int colorIndex, bool locked)
+{
+    GraphDelta delta;
+    delta.type = RemoveVertex;
+    delta.a = id;
+    delta.b = colorIndex;
+    delta.c = locked ? 1 : 0;
+    delta.from = position;
+    return delta;
+}
+
+GraphDelta GraphDelta::edgeAdded(int sourceId, int destId)
+{
+    GraphDelta delta;
+    delta.type = AddEdge;
+    delta.a = sourceId;
+    delta.b = destId;
+    return delta;
+}
+
+GraphDelta GraphDelta::edgeRemoved(int sourceId, int destId)
+{
+    GraphDelta delta;
+    delta.type = RemoveEdge;
+    delta.a = sourceId;
+    delta.b = destId;
+    return delta;
+}
+
+GraphDelta GraphDelta::vertexMoved(int id, const QPointF &from, const QPointF &to)
+{
+    GraphDelta delta;
+    delta.type = MoveVertex;
+    delta.a = id;
+    delta.from = from;
+    delta.to = to;
+    return delta;
+}
+
+GraphDelta GraphDelta::colorChanged(int id, int oldIndex, int newIndex)
+{
+    GraphDelta delta;
+    delta.type = SetColor;
+    delta.a = id;
+    delta.b = oldIndex;
+    delta.c = newIndex;
+    return delta;
+}
+
+GraphDelta GraphDelta::lockChanged(int id, bool oldLocked, bool newLocked)
+{
+    GraphDelta delta;
+    delta.type = SetLocked;
+    delta.a = id;
+    delta.b = oldLocked ? 1 : 0;
+    delta.c = newLocked ? 1 : 0;
+    return delta;
+}
+
+bool GraphDelta::isNoop() const
+{
+    switch (type) {
+    case MoveVertex:
+        return from == to;
+    case SetColor:
+    case SetLocked:
+        return b == c;
+    default:
+        return false;
+    }
+}
+
+QDataStream &operator<<(QDataStream &stream, const GraphDelta &delta)
+{
+    stream << quint8(delta.type) << qint32(delta.a) << qint32(delta.b) << qint32(delta.c);
+
+    // Координаты пишем только для записей, где они используются
+    switch (delta.type) {
+    case GraphDelta::AddVertex:
+        stream << delta.to.x() << delta.to.y();
+        break;
+    case GraphDelta::RemoveVertex:
+        stream << delta.from.x() << delta.from.y();
+        break;
+    case GraphDelta::MoveVertex:
+        stream << delta.from.x() << delta.from.y() << delta.to.x() << delta.to.y();
+        break;
+    default:
+        break;
+    }
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, GraphDelta &delta)
+{
+    quint8 type;
+    qint32 a, b, c;
+    stream >> type >> a >> b >> c;
+
+    delta = GraphDelta();
+    delta.type = GraphDelta::Type(type);
+    delta.a = a;
+    delta.b = b;
+    delta.c = c;
+
+    double x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+    switch (delta.type) {
+    case GraphDelta::AddVertex:
+        stream >> x1 >> y1;
+        delta.to = QPointF(x1, y1);
+        break;
+    case GraphDelta::RemoveVertex:
+        stream >> x1 >> y1;
+        delta.from = QPointF(x1, y1);
+        break;
+    case GraphDelta::MoveVertex:
+        stream >> x1 >> y1 >> x2 >> y2;
+        delta.from = QPointF(x1, y1);
+        delta.to = QPointF(x2, y2);
+        break;
+    case GraphDelta::AddEdge:
+    case GraphDelta::RemoveEdge:
+    case GraphDelta::SetColor:
+    case GraphDelta::SetLocked:
+        break;
+    default:
+        stream.setStatus(QDataStream::ReadCorruptData);
+        break;
+    }
+    return stream;
+}
+
+// Добавление и удаление симметричны: обратное к добавлению - удаление
+static void insertVertex(Graph *graph, const GraphDelta &delta, const QPointF &position)
+{
+    Vertex *vertex = graph->addVertex(position, delta.a);
+    graph->setVertexColorIndex(vertex, delta.b);
+    // У записи добавления c не задано, закрепление восстанавливается при отмене удаления
+    graph->setVertexLocked(vertex, delta.type == GraphDelta::RemoveVertex && delta.c > 0);
+}
+
+static void eraseVertex(Graph *graph, const GraphDelta &delta)
+{
+    graph->removeVertex(graph->vertexById(delta.a));
+}
+
+static void insertEdge(Graph *graph, const GraphDelta &delta)
+{
+    graph->addEdge(graph->vertexById(delta.a), graph->vertexById(delta.b));
+}
+
+static void eraseEdge(Graph *graph, const GraphDelta &delta)
+{
+    graph->removeEdge(graph->findEdge(graph->vertexById(delta.a), graph->vertexById(delta.b)));
+}
+
+void applyGraphDelta(Graph *graph, const GraphDelta &delta, bool forward)
+{
+    switch (delta.type) {
+    case GraphDelta::AddVertex:
+        if (forward) {
+            insertVertex(graph, delta, delta.to);
+        } else {
+            eraseVertex(graph, delta);
+        }
+        break;
+
+    case GraphDelta::RemoveVertex:
+        if (forward) {
+            eraseVertex(graph, delta);
+        } else {
+            insertVertex(graph, delta, delta.from);
+        }
+        break;
+
+    case GraphDelta::AddEdge:
+        if (forward) {
+            insertEdge(graph, delta);
+        } else {
+            eraseEdge(graph, delta);
+        }
+        break;
+
+    case GraphDelta::RemoveEdge:
+        if (forward) {
+            eraseEdge(graph, delta);
+        } else {
+            insertEdge(graph, delta);
+        }
+        break;
+
+    case GraphDelta::MoveVertex:
+        if (Vertex *vertex = graph->vertexById(delta.a)) {
+            vertex->setPosition(forward ? delta.to : delta.from);
+        }
+        break;
+
+    case GraphDelta::SetColor:
+        graph->setVertexColorIndex(graph->vertexById(delta.a), forward ? delta.c : delta.b);
+        break;
+
+    case GraphDelta::SetLocked:
+        graph->setVertexLocked(graph->vertexById(delta.a), (forward ? delta.c : delta.b) > 0);
+        break;
+    }
+}
+
+void applyGraphDeltas(Graph *graph, const QVector<GraphDelta> &deltas, bool forward)
+{
+    // Подряд идущие смены цвета (раскраска графа) применяются одним
+    // массовым вызовом, чтобы не рассылать уведомление на каждую вершину
+    QVector<Vertex*> colorVertices;
+    QVector<int> colorIndices;
+    auto flushColors = [&]() {
+        if (!colorVertices.isEmpty()) {
+            graph->setVertexColorIndices(colorVertices, colorIndices);
+            colorVertices.clear();
+            colorIndices.clear();
+        }
+    };
+
+    const int count = deltas.size();
+    for (int step = 0; step < count; ++step) {
+        const GraphDelta &delta = deltas[forward ? step : count - 1 - step];
+        if (delta.type == GraphDelta::SetColor) {
+            if (Vertex *vertex = graph->vertexById(delta.a)) {
+                colorVertices.append(vertex);
+                colorIndices.append(forward ? delta.c : delta.b);
+            }
+            continue;
+        }
+
+        flushColors();
+        applyGraphDelta(graph, delta, forward);
+    }
+    flushColors();
+}
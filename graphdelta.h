@@ -0,0 +1,59 @@
+#ifndef GRAPHDELTA_H
+#define GRAPHDELTA_H
+
+#include <QtGlobal>
+#include <QPointF>
+#include <QVector>
+#include <QDataStream>
+#include <QMetaType>
+
+class Graph;
+
+// Элементарное структурное изменение графа. Вершины задаются постоянными
+// идентификаторами, поэтому запись остаётся применимой после удаления и
+// повторного создания объектов.
+struct GraphDelta
+{
+    enum Type : quint8 {
+        AddVertex,    // a - id, b - номер цвета, to - позиция
+        RemoveVertex, // a - id, b - номер цвета, c - закрепление (1/0), from - позиция
+        AddEdge,      // a - id начала, b - id конца
+        RemoveEdge,   // a - id начала, b - id конца
+        MoveVertex,   // a - id, from -> to
+        SetColor,     // a - id, b -> c
+        SetLocked     // a - id, b -> c (1 - закреплена, 0 - нет)
+    };
+
+    Type type = AddVertex;
+    int a = -1;
+    int b = -1;
+    int c = -1;
+    QPointF from;
+    QPointF to;
+
+    static GraphDelta vertexAdded(int id, const QPointF &position, int colorIndex);
+    static GraphDelta vertexRemoved(int id, const QPointF &position, int colorIndex, bool locked);
+    static GraphDelta edgeAdded(int sourceId, int destId);
+    static GraphDelta edgeRemoved(int sourceId, int destId);
+    static GraphDelta vertexMoved(int id, const QPointF &from, const QPointF &to);
+    static GraphDelta colorChanged(int id, int oldIndex, int newIndex);
+    static GraphDelta lockChanged(int id, bool oldLocked, bool newLocked);
+
+    // Изменение не имеет эффекта (например, вершину вернули на место)
+    bool isNoop() const;
+};
+
+Q_DECLARE_METATYPE(GraphDelta)
+
+// Двоичная запись изменений (журнал автосохранения)
+QDataStream &operator<<(QDataStream &stream, const GraphDelta &delta);
+QDataStream &operator>>(QDataStream &stream, GraphDelta &delta);
+
+// Применение изменения к графу: forward = true повторяет изменение,
+// forward = false выполняет обратное
+void applyGraphDelta(Graph *graph, const GraphDelta &delta, bool forward);
+
+// Применение последовательности изменений (обратные - в обратном порядке)
+void applyGraphDeltas(Graph *graph, const QVector<GraphDelta> &deltas, bool forward);
+
+#endif // GRAPHDELTA_H
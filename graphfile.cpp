@@ -0,0 +1,388 @@
+#include "graphfile.h"
+#include "dimacs.h"
+#include "kicadboard.h"
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QtEndian>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+const char COMPRESSED_MAGIC[4] = { 'C', 'T', 'Z', '1' };
+// Версия 2 добавляет флаги вершин (закрепление за слоем), версия 1 читается
+constexpr quint64 COMPRESSED_VERSION = 2;
+constexpr quint64 VERTEX_LOCKED = 1;
+
+// Размер распакованного блока и уровень сжатия zlib
+constexpr int BLOCK_SIZE = 1 << 20;
+constexpr int COMPRESSION_LEVEL = 6;
+// Ограничение на размер сжатого блока при чтении повреждённого файла
+constexpr quint32 MAX_FRAME_SIZE = 64u << 20;
+
+// Запись потока данных блоками, каждый блок сжимается отдельно.
+// Блок предваряется размером (4 байта), пустой блок завершает поток.
+class BlockWriter
+{
+public:
+    explicit BlockWriter(QIODevice *device)
+        : m_device(device), m_ok(true)
+    {
+        m_buffer.reserve(BLOCK_SIZE + 16);
+    }
+
+    void writeVarint(quint64 value)
+    {
+        while (value >= 0x80) {
+            m_buffer.append(char(value | 0x80));
+            value >>= 7;
+        }
+        m_buffer.append(char(value));
+        maybeFlush();
+    }
+
+    // Знаковые числа кодируются зигзагом, чтобы малые по модулю были короткими
+    void writeSigned(qint64 value)
+    {
+        writeVarint((quint64(value) << 1) ^ quint64(value >> 63));
+    }
+
+    void writeDouble(double value)
+    {
+        quint64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uchar bytes[8];
+        qToLittleEndian(bits, bytes);
+        m_buffer.append(reinterpret_cast<const char*>(bytes), 8);
+        maybeFlush();
+    }
+
+    bool finish()
+    {
+        flushBlock();
+        writeFrame(QByteArray());
+        return m_ok;
+    }
+
+private:
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    bool m_ok;
+
+    void maybeFlush()
+    {
+        if (m_buffer.size() >= BLOCK_SIZE) {
+            flushBlock();
+        }
+    }
+
+    void flushBlock()
+    {
+        if (m_buffer.isEmpty())
+            return;
+        writeFrame(qCompress(m_buffer, COMPRESSION_LEVEL));
+        m_buffer.resize(0);
+    }
+
+    void writeFrame(const QByteArray &frame)
+    {
+        uchar header[4];
+        qToLittleEndian(quint32(frame.size()), header);
+        if (m_device->write(reinterpret_cast<const char*>(header), 4) != 4
+            || m_device->write(frame) != frame.size()) {
+            m_ok = false;
+        }
+    }
+};
+
+// Чтение потока, записанного BlockWriter: в памяти держится один блок
+class BlockReader
+{
+public:
+    explicit BlockReader(QIODevice *device)
+        : m_device(device), m_position(0), m_finished(false)
+    {
+    }
+
+    bool readVarint(quint64 *value)
+    {
+        quint64 result = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uchar byte;
+            if (!readByte(&byte))
+                return false;
+            result |= quint64(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                *value = result;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool readSigned(qint64 *value)
+    {
+        quint64 encoded;
+        if (!readVarint(&encoded))
+            return false;
+        *value = qint64(encoded >> 1) ^ -qint64(encoded & 1);
+        return true;
+    }
+
+    bool readDouble(double *value)
+    {
+        uchar bytes[8];
+        for (uchar &byte : bytes) {
+            if (!readByte(&byte))
+                return false;
+        }
+        quint64 bits = qFromLittleEndian<quint64>(bytes);
+        std::memcpy(value, &bits, sizeof(bits));
+        return true;
+    }
+
+private:
+    QIODevice *m_device;
+    QByteArray m_block;
+    int m_position;
+    bool m_finished;
+
+    bool readByte(uchar *byte)
+    {
+        if (m_position >= m_block.size() && !nextBlock())
+            return false;
+        *byte = uchar(m_block.constData()[m_position++]);
+        return true;
+    }
+
+    bool nextBlock()
+    {
+        if (m_finished)
+            return false;
+
+        uchar header[4];
+        if (m_device->read(reinterpret_cast<char*>(header), 4) != 4)
+            return false;
+
+        quint32 frameSize = qFromLittleEndian<quint32>(header);
+        if (frameSize == 0) {
+            m_finished = true;
+            return false;
+        }
+        if (frameSize > MAX_FRAME_SIZE)
+            return false;
+
+        QByteArray frame = m_device->read(frameSize);
+        if (frame.size() != int(frameSize))
+            return false;
+
+        m_block = qUncompress(frame);
+        m_position = 0;
+        return !m_block.isEmpty();
+    }
+};
+
+} // namespace
+
+GraphFile::Format GraphFile::detectFormat(QIODevice *device)
+{
+    QByteArray head = device->peek(sizeof(COMPRESSED_MAGIC));
+    if (head.size() == int(sizeof(COMPRESSED_MAGIC))
+        && std::memcmp(head.constData(), COMPRESSED_MAGIC, sizeof(COMPRESSED_MAGIC)) == 0) {
+        return Format::Compressed;
+    }
+    if (KicadBoard::probe(device)) {
+        return Format::KiCad;
+    }
+    if (DimacsFile::probe(device)) {
+        return Format::Dimacs;
+    }
+    return Format::Json;
+}
+
+GraphFile::Format GraphFile::formatForPath(const QString &filePath)
+{
+    const QString suffix = QFileInfo(filePath).suffix();
+    if (suffix.compare(compressedSuffix(), Qt::CaseInsensitive) == 0) {
+        return Format::Compressed;
+    }
+    if (suffix.compare(DimacsFile::suffix(), Qt::CaseInsensitive) == 0) {
+        return Format::Dimacs;
+    }
+    if (suffix.compare(KicadBoard::suffix(), Qt::CaseInsensitive) == 0) {
+        return Format::KiCad;
+    }
+    return Format::Json;
+}
+
+bool GraphFile::writeCompressed(const GraphSnapshot &snapshot, QIODevice *device,
+                                QString *errorMessage)
+{
+    // Номера вершин в файле - их позиции в списке, рёбра ссылаются на позиции
+    QHash<int, int> idToIndex;
+    idToIndex.reserve(snapshot.vertices.size());
+    for (int i = 0; i < snapshot.vertices.size(); ++i) {
+        idToIndex.insert(snapshot.vertices[i].id, i);
+    }
+
+    QVector<QPair<int, int>> edges;
+    edges.reserve(snapshot.edges.size());
+    for (const GraphSnapshot::EdgeRecord &record : snapshot.edges) {
+        int source = idToIndex.value(record.sourceId, -1);
+        int dest = idToIndex.value(record.destId, -1);
+        if (source < 0 || dest < 0)
+            continue;
+        edges.append(qMakePair(std::min(source, dest), std::max(source, dest)));
+    }
+
+    // После сортировки разности соседних индексов малы и хорошо сжимаются
+    std::sort(edges.begin(), edges.end());
+
+    if (device->write(COMPRESSED_MAGIC, sizeof(COMPRESSED_MAGIC)) != qint64(sizeof(COMPRESSED_MAGIC))) {
+        if (errorMessage) {
+            *errorMessage = device->errorString();
+        }
+        return false;
+    }
+
+    BlockWriter writer(device);
+    writer.writeVarint(COMPRESSED_VERSION);
+    writer.writeVarint(quint64(snapshot.vertices.size()));
+    writer.writeVarint(quint64(edges.size()));
+    writer.writeSigned(snapshot.maxColor);
+
+    qint64 previousId = -1;
+    for (const GraphSnapshot::VertexRecord &record : snapshot.vertices) {
+        writer.writeSigned(record.id - previousId);
+        writer.writeDouble(record.x);
+        writer.writeDouble(record.y);
+        writer.writeSigned(record.colorIndex);
+        writer.writeVarint(record.locked ? VERTEX_LOCKED : 0);
+        previousId = record.id;
+    }
+
+    int previousSource = 0;
+    int previousDest = 0;
+    for (const QPair<int, int> &edge : edges) {
+        writer.writeVarint(quint64(edge.first - previousSource));
+        if (edge.first == previousSource) {
+            writer.writeVarint(quint64(edge.second - previousDest));
+        } else {
+            writer.writeVarint(quint64(edge.second - edge.first));
+        }
+        previousSource = edge.first;
+        previousDest = edge.second;
+    }
+
+    if (!writer.finish()) {
+        if (errorMessage) {
+            *errorMessage = device->errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+bool GraphFile::readCompressed(QIODevice *device, GraphSnapshot *snapshot, QString *errorMessage)
+{
+    auto fail = [errorMessage](const QString &message) {
+        if (errorMessage) {
+            *errorMessage = message;
+        }
+        return false;
+    };
+
+    char magic[sizeof(COMPRESSED_MAGIC)];
+    if (device->read(magic, sizeof(magic)) != qint64(sizeof(magic))
+        || std::memcmp(magic, COMPRESSED_MAGIC, sizeof(magic)) != 0) {
+        return fail(QObject::tr("Not a compressed graph file."));
+    }
+
+    BlockReader reader(device);
+    quint64 version, vertexCount, edgeCount;
+    qint64 maxColor;
+    if (!reader.readVarint(&version) || version < 1 || version > COMPRESSED_VERSION) {
+        return fail(QObject::tr("Unsupported compressed graph version."));
+    }
+    if (!reader.readVarint(&vertexCount) || !reader.readVarint(&edgeCount)
+        || !reader.readSigned(&maxColor) || vertexCount > quint64(INT_MAX)
+        || edgeCount > quint64(INT_MAX)) {
+        return fail(QObject::tr("Corrupted compressed graph header."));
+    }
+
+    snapshot->vertices.clear();
+    snapshot->edges.clear();
+    snapshot->maxColor = int(maxColor);
+
+    // Резервируем память осторожно: счётчики в повреждённом файле могут быть любыми
+    snapshot->vertices.reserve(int(std::min<quint64>(vertexCount, 1 << 22)));
+    qint64 previousId = -1;
+    for (quint64 i = 0; i < vertexCount; ++i) {
+        qint64 idDelta, colorIndex;
+        quint64 flags = 0;
+        GraphSnapshot::VertexRecord record;
+        if (!reader.readSigned(&idDelta) || !reader.readDouble(&record.x)
+            || !reader.readDouble(&record.y) || !reader.readSigned(&colorIndex)
+            || (version >= 2 && !reader.readVarint(&flags))) {
+            return fail(QObject::tr("Corrupted compressed graph vertices."));
+        }
+        previousId += idDelta;
+        record.id = int(previousId);
+        record.colorIndex = int(colorIndex);
+        record.locked = (flags & VERTEX_LOCKED) != 0;
+        snapshot->vertices.append(record);
+    }
+
+    snapshot->edges.reserve(int(std::min<quint64>(edgeCount, 1 << 22)));
+    quint64 source = 0;
+    quint64 dest = 0;
+    for (quint64 i = 0; i < edgeCount; ++i) {
+        quint64 sourceDelta, destDelta;
+        if (!reader.readVarint(&sourceDelta) || !reader.readVarint(&destDelta)) {
+            return fail(QObject::tr("Corrupted compressed graph edges."));
+        }
+        dest = sourceDelta == 0 ? dest + destDelta : source + sourceDelta + destDelta;
+        source += sourceDelta;
+        if (source >= vertexCount || dest >= vertexCount) {
+            return fail(QObject::tr("Corrupted compressed graph edges."));
+        }
+
+        GraphSnapshot::EdgeRecord record;
+        record.sourceId = snapshot->vertices[int(source)].id;
+        record.destId = snapshot->vertices[int(dest)].id;
+        snapshot->edges.append(record);
+    }
+
+    return true;
+}
+
+bool GraphFile::read(QIODevice *device, GraphSnapshot *snapshot, QString *errorMessage)
+{
+    switch (detectFormat(device)) {
+    case Format::Compressed:
+        return readCompressed(device, snapshot, errorMessage);
+    case Format::Dimacs:
+        return DimacsFile::read(device, snapshot, errorMessage);
+    case Format::KiCad:
+        return KicadBoard::read(device, snapshot, errorMessage);
+    case Format::Json:
+        break;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(device->readAll());
+    if (doc.isNull() || !doc.isObject()) {
+        if (errorMessage) {
+            *errorMessage = QObject::tr("Invalid JSON format.");
+        }
+        return false;
+    }
+    if (!GraphSnapshot::fromJson(doc.object(), snapshot)) {
+        if (errorMessage) {
+            *errorMessage = QObject::tr("Missing vertices or edges.");
+        }
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef GRAPHFILE_H
+#define GRAPHFILE_H
+
+#include <QIODevice>
+#include <QString>
+#include "graphsnapshot.h"
+
+// Класс GraphFile отвечает за форматы файлов графа: JSON, сжатый контейнер,
+// DIMACS (см. DimacsFile) и импорт плат KiCad (см. KicadBoard).
+// Сжатый контейнер: сигнатура 'CTZ1', затем поток блоков, каждый из которых
+// сжимается zlib из Qt (qCompress) отдельно, поэтому ни запись, ни чтение
+// не держат в памяти весь распакованный файл. Рёбра перед сжатием
+// сортируются и кодируются разностями индексов вершин.
+class GraphFile
+{
+public:
+    enum class Format {
+        Json,
+        Compressed,
+        Dimacs,
+        KiCad
+    };
+
+    // Формат по содержимому (сигнатуре) файла
+    static Format detectFormat(QIODevice *device);
+
+    // Формат для сохранения по расширению имени файла
+    static Format formatForPath(const QString &filePath);
+
+    // Платы KiCad только импортируются
+    static bool canWrite(Format format) { return format != Format::KiCad; }
+
+    static bool writeCompressed(const GraphSnapshot &snapshot, QIODevice *device,
+                                QString *errorMessage = nullptr);
+    static bool readCompressed(QIODevice *device, GraphSnapshot *snapshot,
+                               QString *errorMessage = nullptr);
+
+    // Чтение файла любого поддерживаемого формата
+    static bool read(QIODevice *device, GraphSnapshot *snapshot, QString *errorMessage = nullptr);
+
+    static const char *compressedSuffix() { return "ctz"; }
+};
+
+#endif // GRAPHFILE_H
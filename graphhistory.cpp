@@ -0,0 +1,246 @@
+#include "graphhistory.h"
+#include "vertex.h"
+#include "edge.h"
+
+// Идентификатор команд, состоящих только из перемещений
+constexpr int MOVE_COMMAND_ID = 1;
+// Ключ объединения одиночных перемещений вне пакетных операций
+constexpr int SINGLE_MOVE_KEY = -1;
+
+// Реализация GraphDeltaCommand
+
+GraphDeltaCommand::GraphDeltaCommand(GraphHistory *history, Graph *graph, const QString &text,
+                                     const QVector<GraphDelta> &deltas, int mergeKey)
+    : QUndoCommand(text), m_history(history), m_graph(graph), m_deltas(deltas), m_mergeKey(mergeKey),
+      m_firstRedo(true)
+{
+}
+
+void GraphDeltaCommand::undo()
+{
+    apply(false);
+}
+
+void GraphDeltaCommand::redo()
+{
+    // Изменения уже применены к графу в момент записи
+    if (m_firstRedo) {
+        m_firstRedo = false;
+        return;
+    }
+    apply(true);
+}
+
+void GraphDeltaCommand::apply(bool forward)
+{
+    m_history->setApplying(true);
+    m_graph->beginBatch(text());
+    applyGraphDeltas(m_graph, m_deltas, forward);
+    m_graph->endBatch();
+    m_history->setApplying(false);
+}
+
+int GraphDeltaCommand::id() const
+{
+    return m_mergeKey != 0 && isMoveOnly() ? MOVE_COMMAND_ID : -1;
+}
+
+bool GraphDeltaCommand::mergeWith(const QUndoCommand *other)
+{
+    const GraphDeltaCommand *command = static_cast<const GraphDeltaCommand*>(other);
+    const QVector<GraphDelta> &otherDeltas = command->deltas();
+
+    // Объединяем только перемещения того же набора вершин с тем же ключом
+    if (command->m_mergeKey != m_mergeKey || otherDeltas.size() != m_deltas.size())
+        return false;
+    for (int i = 0; i < m_deltas.size(); ++i) {
+        if (otherDeltas[i].a != m_deltas[i].a)
+            return false;
+    }
+
+    for (int i = 0; i < m_deltas.size(); ++i) {
+        m_deltas[i].to = otherDeltas[i].to;
+    }
+    return true;
+}
+
+bool GraphDeltaCommand::isMoveOnly() const
+{
+    for (const GraphDelta &delta : m_deltas) {
+        if (delta.type != GraphDelta::MoveVertex)
+            return false;
+    }
+    return !m_deltas.isEmpty();
+}
+
+// Реализация GraphHistory
+
+GraphHistory::GraphHistory(Graph *graph, QObject *parent)
+    : QObject(parent), m_graph(graph), m_applying(false), m_pendingMergeKey(0), m_batchOpen(false)
+{
+    m_undoStack = new QUndoStack(this);
+
+    connect(graph, &Graph::batchStarted, this, &GraphHistory::handleBatchStarted);
+    connect(graph, &Graph::batchFinished, this, &GraphHistory::handleBatchFinished);
+    connect(graph, &Graph::vertexAdded, this, &GraphHistory::handleVertexAdded);
+    connect(graph, &Graph::vertexRemoved, this, &GraphHistory::handleVertexRemoved);
+    connect(graph, &Graph::edgeAdded, this, &GraphHistory::handleEdgeAdded);
+    connect(graph, &Graph::edgeRemoved, this, &GraphHistory::handleEdgeRemoved);
+    connect(graph, &Graph::vertexMoved, this, &GraphHistory::handleVertexMoved);
+    connect(graph, &Graph::vertexColorIndexChanged,
+            this, &GraphHistory::handleVertexColorIndexChanged);
+    connect(graph, &Graph::colorsChanged, this, &GraphHistory::handleColorsChanged);
+    connect(graph, &Graph::vertexLockChanged, this, &GraphHistory::handleVertexLockChanged);
+}
+
+void GraphHistory::clear()
+{
+    m_pending.clear();
+    m_positionDelta.clear();
+    m_colorDelta.clear();
+    m_undoStack->clear();
+}
+
+void GraphHistory::handleBatchStarted(const QString &text, int mergeKey)
+{
+    if (m_applying)
+        return;
+
+    m_pendingText = text;
+    m_pendingMergeKey = mergeKey;
+    m_batchOpen = true;
+}
+
+void GraphHistory::handleBatchFinished()
+{
+    if (m_applying)
+        return;
+
+    m_batchOpen = false;
+    commit(m_pendingMergeKey);
+}
+
+void GraphHistory::handleVertexAdded(Vertex *vertex)
+{
+    record(GraphDelta::vertexAdded(vertex->id(), vertex->position(), vertex->colorIndex()));
+}
+
+void GraphHistory::handleVertexRemoved(Vertex *vertex)
+{
+    record(GraphDelta::vertexRemoved(vertex->id(), vertex->position(), vertex->colorIndex(),
+                                    vertex->isLocked()));
+}
+
+void GraphHistory::handleEdgeAdded(Edge *edge)
+{
+    record(GraphDelta::edgeAdded(edge->sourceVertex()->id(), edge->destVertex()->id()));
+}
+
+void GraphHistory::handleEdgeRemoved(Edge *edge)
+{
+    record(GraphDelta::edgeRemoved(edge->sourceVertex()->id(), edge->destVertex()->id()));
+}
+
+void GraphHistory::handleVertexMoved(Vertex *vertex, const QPointF &oldPosition)
+{
+    record(GraphDelta::vertexMoved(vertex->id(), oldPosition, vertex->position()));
+}
+
+void GraphHistory::handleVertexColorIndexChanged(Vertex *vertex, int oldIndex)
+{
+    record(GraphDelta::colorChanged(vertex->id(), oldIndex, vertex->colorIndex()));
+}
+
+void GraphHistory::handleColorsChanged(const QVector<Vertex*> &vertices, const QVector<int> &oldIndices)
+{
+    for (int i = 0; i < vertices.size(); ++i) {
+        record(GraphDelta::colorChanged(vertices[i]->id(), oldIndices[i], vertices[i]->colorIndex()));
+    }
+}
+
+void GraphHistory::handleVertexLockChanged(Vertex *vertex)
+{
+    record(GraphDelta::lockChanged(vertex->id(), !vertex->isLocked(), vertex->isLocked()));
+}
+
+void GraphHistory::record(const GraphDelta &delta)
+{
+    if (m_applying)
+        return;
+
+    switch (delta.type) {
+    case GraphDelta::AddVertex:
+        m_positionDelta.insert(delta.a, m_pending.size());
+        m_colorDelta.insert(delta.a, m_pending.size());
+        break;
+
+    case GraphDelta::RemoveVertex:
+        m_positionDelta.remove(delta.a);
+        m_colorDelta.remove(delta.a);
+        break;
+
+    case GraphDelta::MoveVertex: {
+        // Повторное перемещение вершины обновляет уже записанное
+        int index = m_positionDelta.value(delta.a, -1);
+        if (index >= 0) {
+            m_pending[index].to = delta.to;
+            return;
+        }
+        m_positionDelta.insert(delta.a, m_pending.size());
+        break;
+    }
+
+    case GraphDelta::SetColor: {
+        int index = m_colorDelta.value(delta.a, -1);
+        if (index >= 0) {
+            GraphDelta &previous = m_pending[index];
+            if (previous.type == GraphDelta::AddVertex) {
+                previous.b = delta.c;
+            } else {
+                previous.c = delta.c;
+            }
+            return;
+        }
+        m_colorDelta.insert(delta.a, m_pending.size());
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    m_pending.append(delta);
+
+    // Вне пакетной операции каждое изменение - отдельный шаг отмены
+    if (!m_batchOpen) {
+        switch (delta.type) {
+        case GraphDelta::AddVertex: m_pendingText = tr("Add vertex"); break;
+        case GraphDelta::RemoveVertex: m_pendingText = tr("Remove vertex"); break;
+        case GraphDelta::AddEdge: m_pendingText = tr("Add edge"); break;
+        case GraphDelta::RemoveEdge: m_pendingText = tr("Remove edge"); break;
+        case GraphDelta::MoveVertex: m_pendingText = tr("Move vertex"); break;
+        case GraphDelta::SetColor: m_pendingText = tr("Change color"); break;
+        case GraphDelta::SetLocked: m_pendingText = tr("Lock vertex"); break;
+        }
+        commit(SINGLE_MOVE_KEY);
+    }
+}
+
+void GraphHistory::commit(int mergeKey)
+{
+    QVector<GraphDelta> deltas;
+    deltas.reserve(m_pending.size());
+    for (const GraphDelta &delta : m_pending) {
+        if (!delta.isNoop()) {
+            deltas.append(delta);
+        }
+    }
+
+    m_pending.clear();
+    m_positionDelta.clear();
+    m_colorDelta.clear();
+
+    if (!deltas.isEmpty() && m_graph) {
+        m_undoStack->push(new GraphDeltaCommand(this, m_graph, m_pendingText, deltas, mergeKey));
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef GRAPHHISTORY_H
+#define GRAPHHISTORY_H
+
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QUndoStack>
+#include <QUndoCommand>
+#include "graph.h"
+#include "graphdelta.h"
+
+class GraphHistory;
+
+// Команда отмены, хранящая только журнал изменений одной операции.
+// Размер команды пропорционален объёму изменения, а не размеру графа.
+class GraphDeltaCommand : public QUndoCommand
+{
+public:
+    // mergeKey - команда может поглотить следующее перемещение тех же вершин
+    // с тем же ключом; 0 - не объединяется. Пакетные операции (одно
+    // перетаскивание - один пакет) по умолчанию не объединяются, иначе два
+    // перетаскивания отменялись бы одним шагом
+    GraphDeltaCommand(GraphHistory *history, Graph *graph, const QString &text,
+                      const QVector<GraphDelta> &deltas, int mergeKey);
+
+    void undo() override;
+    void redo() override;
+
+    // Подряд идущие одиночные перемещения одних и тех же вершин объединяются
+    int id() const override;
+    bool mergeWith(const QUndoCommand *other) override;
+
+    const QVector<GraphDelta> &deltas() const { return m_deltas; }
+
+private:
+    GraphHistory *m_history;
+    Graph *m_graph;
+    QVector<GraphDelta> m_deltas;
+    int m_mergeKey;
+    bool m_firstRedo;
+
+    bool isMoveOnly() const;
+    void apply(bool forward);
+};
+
+// Класс GraphHistory записывает изменения графа и предоставляет отмену/повтор
+class GraphHistory : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GraphHistory(Graph *graph, QObject *parent = nullptr);
+
+    QUndoStack* undoStack() const { return m_undoStack; }
+
+    void undo() { m_undoStack->undo(); }
+    void redo() { m_undoStack->redo(); }
+    void clear();
+
+    // Флаг применения журнала: изменения, сделанные самой историей, не записываются
+    bool isApplying() const { return m_applying; }
+    void setApplying(bool applying) { m_applying = applying; }
+
+private slots:
+    void handleBatchStarted(const QString &text, int mergeKey);
+    void handleBatchFinished();
+    void handleVertexAdded(Vertex *vertex);
+    void handleVertexRemoved(Vertex *vertex);
+    void handleEdgeAdded(Edge *edge);
+    void handleEdgeRemoved(Edge *edge);
+    void handleVertexMoved(Vertex *vertex, const QPointF &oldPosition);
+    void handleVertexColorIndexChanged(Vertex *vertex, int oldIndex);
+    void handleColorsChanged(const QVector<Vertex*> &vertices, const QVector<int> &oldIndices);
+    void handleVertexLockChanged(Vertex *vertex);
+
+private:
+    QPointer<Graph> m_graph;
+    QUndoStack *m_undoStack;
+    bool m_applying;
+
+    // Текущая незавершённая операция
+    QString m_pendingText;
+    int m_pendingMergeKey;
+    QVector<GraphDelta> m_pending;
+    bool m_batchOpen;
+
+    // Индексы последних записей о позиции и цвете вершин в текущей операции,
+    // чтобы повторные изменения одной вершины обновляли запись, а не добавляли новую
+    QHash<int, int> m_positionDelta;
+    QHash<int, int> m_colorDelta;
+
+    void record(const GraphDelta &delta);
+    void commit(int mergeKey);
+};
+
+#endif // GRAPHHISTORY_H
@@ -0,0 +1,417 @@
+#include "graphloader.h"
+#include "graphfile.h"
+#include "memorystats.h"
+#include "profiler.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPair>
+#include <algorithm>
+
+namespace {
+
+// Порции публикуются с частотой кадров
+constexpr int PUBLISH_INTERVAL_MS = 16;
+// Наибольшая порция: её добавление в граф не должно заметно задерживать окно
+constexpr int MAX_CHUNK_RECORDS = 16384;
+// Столько элементов массива JSON разбирается за один вызов QJsonDocument
+constexpr int PARSE_BATCH = 1024;
+
+// Разметка JSON без построения документа: нужна, чтобы разбирать
+// массивы вершин и рёбер по частям
+
+int skipSpace(const QByteArray &data, int pos)
+{
+    while (pos < data.size()
+           && (data[pos] == ' ' || data[pos] == '\n' || data[pos] == '\r' || data[pos] == '\t')) {
+        pos++;
+    }
+    return pos;
+}
+
+// pos указывает на открывающую кавычку; возвращает позицию за закрывающей, -1 при ошибке
+int skipString(const QByteArray &data, int pos)
+{
+    for (++pos; pos < data.size(); ++pos) {
+        if (data[pos] == '\\') {
+            pos++;
+        } else if (data[pos] == '"') {
+            return pos + 1;
+        }
+    }
+    return -1;
+}
+
+// Возвращает позицию за значением, начинающимся в pos, -1 при ошибке
+int skipValue(const QByteArray &data, int pos)
+{
+    if (pos >= data.size())
+        return -1;
+    if (data[pos] == '"')
+        return skipString(data, pos);
+
+    if (data[pos] == '{' || data[pos] == '[') {
+        int depth = 0;
+        while (pos < data.size()) {
+            const char c = data[pos];
+            if (c == '"') {
+                pos = skipString(data, pos);
+                if (pos < 0)
+                    return -1;
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0)
+                    return pos + 1;
+            }
+            pos++;
+        }
+        return -1;
+    }
+
+    // Число, true, false, null
+    const int start = pos;
+    while (pos < data.size() && data[pos] != ',' && data[pos] != '}' && data[pos] != ']'
+           && data[pos] != ' ' && data[pos] != '\n' && data[pos] != '\r' && data[pos] != '\t') {
+        pos++;
+    }
+    return pos > start ? pos : -1;
+}
+
+// Границы значений ключей объекта верхнего уровня
+bool scanTopLevel(const QByteArray &data, QHash<QByteArray, QPair<int, int>> *values)
+{
+    int pos = skipSpace(data, 0);
+    if (pos >= data.size() || data[pos] != '{')
+        return false;
+    pos = skipSpace(data, pos + 1);
+    if (pos < data.size() && data[pos] == '}')
+        return true;
+
+    while (pos < data.size()) {
+        if (data[pos] != '"')
+            return false;
+        const int keyEnd = skipString(data, pos);
+        if (keyEnd < 0)
+            return false;
+        const QByteArray key = data.mid(pos + 1, keyEnd - pos - 2);
+
+        pos = skipSpace(data, keyEnd);
+        if (pos >= data.size() || data[pos] != ':')
+            return false;
+        pos = skipSpace(data, pos + 1);
+        const int valueEnd = skipValue(data, pos);
+        if (valueEnd < 0)
+            return false;
+        values->insert(key, qMakePair(pos, valueEnd));
+
+        pos = skipSpace(data, valueEnd);
+        if (pos < data.size() && data[pos] == '}')
+            return true;
+        if (pos >= data.size() || data[pos] != ',')
+            return false;
+        pos = skipSpace(data, pos + 1);
+    }
+    return false;
+}
+
+GraphSnapshot::VertexRecord vertexRecord(const QJsonObject &json)
+{
+    GraphSnapshot::VertexRecord record;
+    record.id = json["id"].toInt();
+    record.x = json["x"].toDouble();
+    record.y = json["y"].toDouble();
+    record.colorIndex = json["color_index"].toInt(-1);
+    record.locked = json["locked"].toBool(false);
+    return record;
+}
+
+GraphSnapshot::EdgeRecord edgeRecord(const QJsonObject &json)
+{
+    GraphSnapshot::EdgeRecord record;
+    record.sourceId = json["source_id"].toInt();
+    record.destId = json["dest_id"].toInt();
+    return record;
+}
+
+int percentOf(qint64 done, qint64 total)
+{
+    return total > 0 ? int(100 * done / total) : 100;
+}
+
+} // namespace
+
+// Реализация LoadWorker
+
+LoadWorker::LoadWorker(QObject *parent)
+    : QObject(parent), m_activeRunId(-1)
+{
+}
+
+void LoadWorker::run(int runId, const QString &filePath)
+{
+    if (m_activeRunId.load() != runId)
+        return;
+
+    PROFILE_SCOPE("load.parse");
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit loadFailed(runId, tr("Cannot open file %1:\n%2.").arg(filePath).arg(file.errorString()));
+        return;
+    }
+
+    // Сжатый контейнер, DIMACS и платы KiCad определяются по содержимому независимо от расширения
+    const GraphFile::Format format = GraphFile::detectFormat(&file);
+    if (format != GraphFile::Format::Json) {
+        GraphSnapshot snapshot;
+        QString errorMessage;
+        if (!GraphFile::read(&file, &snapshot, &errorMessage)) {
+            emit loadFailed(runId, tr("Error loading graph from file %1:\n%2").arg(filePath).arg(errorMessage));
+            return;
+        }
+        MemoryReservation snapshotBuffer(MemoryTracker::IoBuffers, MemoryStats::estimateSnapshotBytes(snapshot));
+        publishSnapshot(runId, snapshot);
+        return;
+    }
+
+    const QByteArray data = file.readAll();
+    file.close();
+    MemoryReservation dataBuffer(MemoryTracker::IoBuffers, data.size());
+    if (!readJson(runId, data, filePath) && m_activeRunId.load() == runId) {
+        emit loadFailed(runId, tr("Invalid JSON format in file %1.").arg(filePath));
+    }
+}
+
+bool LoadWorker::readJson(int runId, const QByteArray &data, const QString &filePath)
+{
+    QHash<QByteArray, QPair<int, int>> values;
+    if (!scanTopLevel(data, &values))
+        return false;
+    if (!values.contains("vertices") || !values.contains("edges")) {
+        emit loadFailed(runId, tr("Error loading graph from file %1.").arg(filePath));
+        return true;
+    }
+
+    QElapsedTimer publishTimer;
+    publishTimer.start();
+    bool published = false;
+
+    // Вершины публикуются раньше рёбер независимо от порядка ключей в файле
+    // (QJsonDocument пишет ключи по алфавиту, "edges" - первым)
+    QVector<GraphSnapshot::VertexRecord> vertices;
+    QVector<GraphSnapshot::EdgeRecord> edges;
+    const qint64 totalBytes = (values["vertices"].second - values["vertices"].first)
+                              + (values["edges"].second - values["edges"].first);
+    qint64 doneBytes = 0;
+
+    for (const char *key : { "vertices", "edges" }) {
+        const bool vertexArray = qstrcmp(key, "vertices") == 0;
+        const QPair<int, int> range = values[key];
+        if (data[range.first] != '[')
+            return false;
+
+        int pos = skipSpace(data, range.first + 1);
+        while (pos < range.second && data[pos] != ']') {
+            if (m_activeRunId.load() != runId)
+                return true;
+
+            // Несколько элементов подряд разбираются как один массив
+            const int batchStart = pos;
+            int batchEnd = pos;
+            for (int count = 0; count < PARSE_BATCH && pos < range.second && data[pos] != ']'; ++count) {
+                batchEnd = skipValue(data, pos);
+                if (batchEnd < 0 || batchEnd > range.second)
+                    return false;
+                pos = skipSpace(data, batchEnd);
+                if (pos < range.second && data[pos] == ',') {
+                    pos = skipSpace(data, pos + 1);
+                }
+            }
+
+            QJsonParseError error;
+            const QJsonDocument batch = QJsonDocument::fromJson(
+                '[' + QByteArray::fromRawData(data.constData() + batchStart, batchEnd - batchStart) + ']',
+                &error);
+            if (error.error != QJsonParseError::NoError || !batch.isArray())
+                return false;
+            const QJsonArray elements = batch.array();
+            for (const QJsonValue &element : elements) {
+                if (vertexArray) {
+                    vertices.append(vertexRecord(element.toObject()));
+                } else {
+                    edges.append(edgeRecord(element.toObject()));
+                }
+            }
+            doneBytes += pos - batchStart;
+
+            // Первая порция уходит сразу, чтобы граф начал появляться на экране
+            const int pending = vertexArray ? vertices.size() : edges.size();
+            if (!published || pending >= MAX_CHUNK_RECORDS || publishTimer.elapsed() >= PUBLISH_INTERVAL_MS) {
+                published = true;
+                publishTimer.restart();
+                if (vertexArray) {
+                    emit verticesReady(runId, vertices, percentOf(doneBytes, totalBytes));
+                    vertices.clear();
+                } else {
+                    emit edgesReady(runId, edges, percentOf(doneBytes, totalBytes));
+                    edges.clear();
+                }
+            }
+        }
+
+        if (vertexArray && !vertices.isEmpty()) {
+            emit verticesReady(runId, vertices, percentOf(doneBytes, totalBytes));
+            vertices.clear();
+        }
+    }
+    if (!edges.isEmpty()) {
+        emit edgesReady(runId, edges, 100);
+    }
+
+    int maxColor = 0;
+    if (values.contains("max_color")) {
+        const QPair<int, int> range = values["max_color"];
+        maxColor = data.mid(range.first, range.second - range.first).toInt();
+    }
+    emit loadFinished(runId, maxColor);
+    return true;
+}
+
+void LoadWorker::publishSnapshot(int runId, const GraphSnapshot &snapshot)
+{
+    // Снимок уже разобран целиком: в граф он передаётся порциями
+    const qint64 total = qint64(snapshot.vertices.size()) + snapshot.edges.size();
+    for (int i = 0; i < snapshot.vertices.size(); i += MAX_CHUNK_RECORDS) {
+        if (m_activeRunId.load() != runId)
+            return;
+        emit verticesReady(runId, snapshot.vertices.mid(i, MAX_CHUNK_RECORDS),
+                           percentOf(std::min<qint64>(i + MAX_CHUNK_RECORDS, snapshot.vertices.size()), total));
+    }
+    for (int i = 0; i < snapshot.edges.size(); i += MAX_CHUNK_RECORDS) {
+        if (m_activeRunId.load() != runId)
+            return;
+        emit edgesReady(runId, snapshot.edges.mid(i, MAX_CHUNK_RECORDS),
+                        percentOf(snapshot.vertices.size() + std::min<qint64>(i + MAX_CHUNK_RECORDS, snapshot.edges.size()),
+                                  total));
+    }
+    emit loadFinished(runId, snapshot.maxColor);
+}
+
+// Реализация GraphLoader
+
+GraphLoader::GraphLoader(Graph *graph, QObject *parent)
+    : QObject(parent), m_graph(graph), m_worker(new LoadWorker), m_running(false), m_loadOpen(false),
+    m_runId(0)
+{
+    qRegisterMetaType<QVector<GraphSnapshot::VertexRecord>>("QVector<GraphSnapshot::VertexRecord>");
+    qRegisterMetaType<QVector<GraphSnapshot::EdgeRecord>>("QVector<GraphSnapshot::EdgeRecord>");
+
+    m_worker->moveToThread(&m_thread);
+    connect(this, &GraphLoader::loadRequested, m_worker, &LoadWorker::run);
+    connect(m_worker, &LoadWorker::verticesReady, this, &GraphLoader::applyVertices);
+    connect(m_worker, &LoadWorker::edgesReady, this, &GraphLoader::applyEdges);
+    connect(m_worker, &LoadWorker::loadFinished, this, &GraphLoader::handleFinished);
+    connect(m_worker, &LoadWorker::loadFailed, this, &GraphLoader::handleFailed);
+    m_thread.start();
+}
+
+GraphLoader::~GraphLoader()
+{
+    m_worker->setActiveRun(-1);
+    m_thread.quit();
+    m_thread.wait();
+    delete m_worker;
+}
+
+void GraphLoader::start(const QString &filePath)
+{
+    cancel();
+
+    m_filePath = filePath;
+    m_running = true;
+    m_loadOpen = false;
+    m_runId++;
+    m_worker->setActiveRun(m_runId);
+    emit started();
+    emit loadRequested(m_runId, filePath);
+}
+
+void GraphLoader::cancel()
+{
+    if (!m_running)
+        return;
+
+    m_running = false;
+    m_worker->setActiveRun(-1);
+    const bool graphCleared = m_loadOpen;
+    if (m_loadOpen) {
+        m_loadOpen = false;
+        m_graph->clear();
+        m_graph->endLoad(0);
+    }
+    emit cancelled(graphCleared);
+}
+
+void GraphLoader::openLoad()
+{
+    // Граф очищается с приходом первой порции: если файл не разобрался,
+    // прежнее содержимое остаётся
+    if (!m_loadOpen) {
+        m_loadOpen = true;
+        m_graph->beginLoad();
+    }
+}
+
+void GraphLoader::applyVertices(int runId, const QVector<GraphSnapshot::VertexRecord> &records, int percent)
+{
+    if (!m_running || runId != m_runId)
+        return;
+
+    PROFILE_SCOPE_AGGREGATE("load.build");
+    openLoad();
+    m_graph->appendVertices(records);
+    emit progress(percent);
+}
+
+void GraphLoader::applyEdges(int runId, const QVector<GraphSnapshot::EdgeRecord> &records, int percent)
+{
+    if (!m_running || runId != m_runId)
+        return;
+
+    PROFILE_SCOPE_AGGREGATE("load.build");
+    openLoad();
+    m_graph->appendEdges(records);
+    emit progress(percent);
+}
+
+void GraphLoader::handleFinished(int runId, int maxColor)
+{
+    if (!m_running || runId != m_runId)
+        return;
+
+    openLoad();
+    m_graph->endLoad(maxColor);
+    m_loadOpen = false;
+    m_running = false;
+    emit finished();
+}
+
+void GraphLoader::handleFailed(int runId, const QString &errorMessage)
+{
+    if (!m_running || runId != m_runId)
+        return;
+
+    // Частично загруженный граф не оставляется
+    if (m_loadOpen) {
+        m_graph->clear();
+        m_graph->endLoad(0);
+        m_loadOpen = false;
+    }
+    m_running = false;
+    emit failed(errorMessage);
+}
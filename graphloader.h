@@ -0,0 +1,88 @@
+#ifndef GRAPHLOADER_H
+#define GRAPHLOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+#include "graph.h"
+#include "graphsnapshot.h"
+
+// Класс LoadWorker читает и разбирает файл графа в фоновом потоке и
+// публикует записи порциями. Массивы JSON разбираются по частям, поэтому
+// первые вершины появляются, не дожидаясь разбора всего файла.
+class LoadWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LoadWorker(QObject *parent = nullptr);
+
+    // Загрузка, которую следует продолжать; остальные прерываются на ближайшей порции.
+    // Вызывается из любого потока.
+    void setActiveRun(int runId) { m_activeRunId.store(runId); }
+
+public slots:
+    void run(int runId, const QString &filePath);
+
+signals:
+    // percent - доля разобранного файла
+    void verticesReady(int runId, const QVector<GraphSnapshot::VertexRecord> &records, int percent);
+    void edgesReady(int runId, const QVector<GraphSnapshot::EdgeRecord> &records, int percent);
+    void loadFinished(int runId, int maxColor);
+    void loadFailed(int runId, const QString &errorMessage);
+
+private:
+    std::atomic<int> m_activeRunId;
+
+    bool readJson(int runId, const QByteArray &data, const QString &filePath);
+    void publishSnapshot(int runId, const GraphSnapshot &snapshot);
+};
+
+// Класс GraphLoader загружает граф по частям: разбор идёт в фоновом
+// потоке, порции добавляются в граф в потоке GUI по мере поступления,
+// так что граф заполняется на экране постепенно, а окно не зависает.
+// Вся загрузка - одна операция в стеке отмены.
+class GraphLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GraphLoader(Graph *graph, QObject *parent = nullptr);
+    ~GraphLoader();
+
+    void start(const QString &filePath);
+    // Отмена: уже загруженная часть удаляется из графа
+    void cancel();
+    bool isRunning() const { return m_running; }
+    QString filePath() const { return m_filePath; }
+
+signals:
+    void started();
+    void progress(int percent);
+    void finished();
+    void failed(const QString &errorMessage);
+    // graphCleared - частично загруженный граф удалён; false, если отмена
+    // пришла до первой порции и на экране остался прежний граф
+    void cancelled(bool graphCleared);
+
+    void loadRequested(int runId, const QString &filePath);
+
+private slots:
+    void applyVertices(int runId, const QVector<GraphSnapshot::VertexRecord> &records, int percent);
+    void applyEdges(int runId, const QVector<GraphSnapshot::EdgeRecord> &records, int percent);
+    void handleFinished(int runId, int maxColor);
+    void handleFailed(int runId, const QString &errorMessage);
+
+private:
+    Graph *m_graph;
+    QThread m_thread;
+    LoadWorker *m_worker;
+    QString m_filePath;
+    bool m_running;
+    bool m_loadOpen;  // Граф очищен и операция загрузки открыта
+    int m_runId;
+
+    void openLoad();
+};
+
+#endif // GRAPHLOADER_H
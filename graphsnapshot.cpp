@@ -0,0 +1,74 @@
+#include "graphsnapshot.h"
+#include "graph.h"
+#include <QJsonArray>
+
+GraphSnapshot GraphSnapshot::capture(const Graph *graph)
+{
+    return graph->currentVersion().toSnapshot();
+}
+
+QJsonObject GraphSnapshot::toJson() const
+{
+    QJsonArray verticesJson;
+    for (const VertexRecord &record : vertices) {
+        QJsonObject vertexJson;
+        vertexJson["id"] = record.id;
+        vertexJson["x"] = record.x;
+        vertexJson["y"] = record.y;
+        vertexJson["color_index"] = record.colorIndex;
+        if (record.locked) {
+            vertexJson["locked"] = true;
+        }
+        verticesJson.append(vertexJson);
+    }
+
+    QJsonArray edgesJson;
+    for (const EdgeRecord &record : edges) {
+        QJsonObject edgeJson;
+        edgeJson["source_id"] = record.sourceId;
+        edgeJson["dest_id"] = record.destId;
+        edgesJson.append(edgeJson);
+    }
+
+    QJsonObject graphJson;
+    graphJson["vertices"] = verticesJson;
+    graphJson["edges"] = edgesJson;
+    graphJson["max_color"] = maxColor;
+    return graphJson;
+}
+
+bool GraphSnapshot::fromJson(const QJsonObject &json, GraphSnapshot *snapshot)
+{
+    if (!json.contains("vertices") || !json.contains("edges")) {
+        return false;
+    }
+
+    const QJsonArray verticesJson = json["vertices"].toArray();
+    const QJsonArray edgesJson = json["edges"].toArray();
+
+    snapshot->vertices.clear();
+    snapshot->vertices.reserve(verticesJson.size());
+    for (const QJsonValue &vertexValue : verticesJson) {
+        QJsonObject vertexJson = vertexValue.toObject();
+        VertexRecord record;
+        record.id = vertexJson["id"].toInt();
+        record.x = vertexJson["x"].toDouble();
+        record.y = vertexJson["y"].toDouble();
+        record.colorIndex = vertexJson["color_index"].toInt(-1);
+        record.locked = vertexJson["locked"].toBool(false);
+        snapshot->vertices.append(record);
+    }
+
+    snapshot->edges.clear();
+    snapshot->edges.reserve(edgesJson.size());
+    for (const QJsonValue &edgeValue : edgesJson) {
+        QJsonObject edgeJson = edgeValue.toObject();
+        EdgeRecord record;
+        record.sourceId = edgeJson["source_id"].toInt();
+        record.destId = edgeJson["dest_id"].toInt();
+        snapshot->edges.append(record);
+    }
+
+    snapshot->maxColor = json["max_color"].toInt();
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef GRAPHSNAPSHOT_H
+#define GRAPHSNAPSHOT_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QJsonObject>
+#include <QMetaType>
+
+class Graph;
+
+// Класс GraphSnapshot - копия структуры графа из простых записей без QObject.
+// Снимок дёшево создаётся в потоке GUI и затем обрабатывается в фоновом потоке.
+struct GraphSnapshot
+{
+    struct VertexRecord
+    {
+        int id;
+        double x;
+        double y;
+        int colorIndex;
+        bool locked;
+    };
+
+    struct EdgeRecord
+    {
+        int sourceId;
+        int destId;
+    };
+
+    QVector<VertexRecord> vertices;
+    QVector<EdgeRecord> edges;
+    int maxColor = 0;
+
+    // Снимок текущего состояния графа
+    static GraphSnapshot capture(const Graph *graph);
+
+    // Схема JSON совпадает с Graph::toJson, но идентификаторы вершин - постоянные
+    QJsonObject toJson() const;
+    static bool fromJson(const QJsonObject &json, GraphSnapshot *snapshot);
+};
+
+Q_DECLARE_METATYPE(GraphSnapshot)
+Q_DECLARE_METATYPE(GraphSnapshot::VertexRecord)
+Q_DECLARE_METATYPE(GraphSnapshot::EdgeRecord)
+
+#endif // GRAPHSNAPSHOT_H
@@ -0,0 +1,19 @@
+#include "graphversion.h"
+
+GraphSnapshot GraphVersion::toSnapshot() const
+{
+    GraphSnapshot snapshot;
+
+    snapshot.vertices.reserve(m_vertices.size());
+    for (int i = 0; i < m_vertices.size(); ++i) {
+        snapshot.vertices.append(m_vertices.at(i));
+    }
+
+    snapshot.edges.reserve(m_edges.size());
+    for (int i = 0; i < m_edges.size(); ++i) {
+        snapshot.edges.append(m_edges.at(i));
+    }
+
+    snapshot.maxColor = m_maxColor;
+    return snapshot;
+}
@@ -0,0 +1,51 @@
+#ifndef GRAPHVERSION_H
+#define GRAPHVERSION_H
+
+#include <QtGlobal>
+#include <QMetaType>
+#include "chunkedarray.h"
+#include "graphsnapshot.h"
+
+// Класс GraphVersion - неизменяемая версия структуры графа для фоновых
+// потоков. Граф ведёт свою текущую версию при каждом изменении и выдаёт
+// копии (Graph::currentVersion). Записи хранятся в ChunkedArray, поэтому
+// копия дешёвая, а неизменённые части разделяются между версиями.
+// Порядок записей совпадает с Graph::vertices() и Graph::edges() в момент
+// создания версии.
+class GraphVersion
+{
+public:
+    typedef GraphSnapshot::VertexRecord VertexRecord;
+    typedef GraphSnapshot::EdgeRecord EdgeRecord;
+
+    // Номер растёт с каждым изменением графа; результаты фоновых
+    // вычислений несут номер версии, по которой они получены
+    quint64 number() const { return m_number; }
+
+    int vertexCount() const { return m_vertices.size(); }
+    int edgeCount() const { return m_edges.size(); }
+    const VertexRecord &vertexAt(int index) const { return m_vertices.at(index); }
+    const EdgeRecord &edgeAt(int index) const { return m_edges.at(index); }
+    const ChunkedArray<VertexRecord> &vertices() const { return m_vertices; }
+    const ChunkedArray<EdgeRecord> &edges() const { return m_edges; }
+    int maxColor() const { return m_maxColor; }
+    // Растёт при каждой очистке графа (в том числе перед загрузкой): вершины
+    // версий разных поколений нельзя сопоставлять по идентификатору
+    quint64 generation() const { return m_generation; }
+
+    // Полная копия в плоском виде
+    GraphSnapshot toSnapshot() const;
+
+private:
+    friend class Graph;
+
+    quint64 m_number = 0;
+    quint64 m_generation = 0;
+    int m_maxColor = 0;
+    ChunkedArray<VertexRecord> m_vertices;
+    ChunkedArray<EdgeRecord> m_edges;
+};
+
+Q_DECLARE_METATYPE(GraphVersion)
+
+#endif // GRAPHVERSION_H
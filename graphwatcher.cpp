@@ -0,0 +1,166 @@
+#include "graphwatcher.h"
+#include "graphfile.h"
+#include "profiler.h"
+#include <QFile>
+#include <QFileInfo>
+
+// Пауза после последнего уведомления перед чтением файла
+constexpr int RELOAD_DELAY_MS = 300;
+
+// Реализация SnapshotReader
+
+void SnapshotReader::read(int requestId, const QString &filePath)
+{
+    PROFILE_SCOPE("reload.read");
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit readFailed(requestId, tr("Cannot open file %1:\n%2.").arg(filePath).arg(file.errorString()));
+        return;
+    }
+
+    GraphSnapshot snapshot;
+    QString errorMessage;
+    if (!GraphFile::read(&file, &snapshot, &errorMessage)) {
+        emit readFailed(requestId, tr("Error loading graph from file %1:\n%2").arg(filePath).arg(errorMessage));
+        return;
+    }
+    emit snapshotRead(requestId, snapshot);
+}
+
+// Реализация GraphWatcher
+
+GraphWatcher::GraphWatcher(Graph *graph, QObject *parent)
+    : QObject(parent), m_graph(graph), m_reader(new SnapshotReader), m_enabled(false), m_requestId(0),
+      m_ownWriteSize(-1)
+{
+    qRegisterMetaType<GraphSnapshot>("GraphSnapshot");
+
+    m_debounceTimer.setSingleShot(true);
+    m_debounceTimer.setInterval(RELOAD_DELAY_MS);
+    connect(&m_debounceTimer, &QTimer::timeout, this, &GraphWatcher::startReload);
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &GraphWatcher::handleFileChanged);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &GraphWatcher::handleDirectoryChanged);
+
+    m_reader->moveToThread(&m_thread);
+    connect(this, &GraphWatcher::readRequested, m_reader, &SnapshotReader::read);
+    connect(m_reader, &SnapshotReader::snapshotRead, this, &GraphWatcher::applySnapshot);
+    connect(m_reader, &SnapshotReader::readFailed, this, &GraphWatcher::handleReadFailed);
+    m_thread.start(QThread::LowPriority);
+}
+
+GraphWatcher::~GraphWatcher()
+{
+    m_thread.quit();
+    m_thread.wait();
+    delete m_reader;
+}
+
+void GraphWatcher::setFilePath(const QString &filePath)
+{
+    if (m_filePath == filePath)
+        return;
+
+    m_filePath = filePath;
+    m_requestId++;  // Результаты чтения прежнего файла отбрасываются
+    m_debounceTimer.stop();
+    updateWatchedPaths();
+}
+
+void GraphWatcher::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled)
+        return;
+
+    m_enabled = enabled;
+    m_requestId++;
+    m_debounceTimer.stop();
+    updateWatchedPaths();
+}
+
+void GraphWatcher::markOwnWrite(const QString &filePath)
+{
+    const QFileInfo info(filePath);
+    m_ownWritePath = info.absoluteFilePath();
+    m_ownWriteSize = info.size();
+    m_ownWriteModified = info.lastModified();
+}
+
+void GraphWatcher::updateWatchedPaths()
+{
+    const QStringList watched = m_watcher.files() + m_watcher.directories();
+    if (!watched.isEmpty()) {
+        m_watcher.removePaths(watched);
+    }
+    if (!m_enabled || m_filePath.isEmpty())
+        return;
+
+    // Каталог наблюдается на случай, если генератор заменяет файл
+    // переименованием: заменённый файл выпадает из наблюдения
+    const QFileInfo info(m_filePath);
+    m_watcher.addPath(info.absolutePath());
+    if (info.exists()) {
+        m_watcher.addPath(info.absoluteFilePath());
+    }
+}
+
+void GraphWatcher::handleFileChanged(const QString &path)
+{
+    Q_UNUSED(path);
+    m_debounceTimer.start();
+}
+
+void GraphWatcher::handleDirectoryChanged(const QString &path)
+{
+    Q_UNUSED(path);
+    const QFileInfo info(m_filePath);
+    if (info.exists() && !m_watcher.files().contains(info.absoluteFilePath())) {
+        m_watcher.addPath(info.absoluteFilePath());
+        m_debounceTimer.start();
+    }
+}
+
+void GraphWatcher::startReload()
+{
+    if (!m_enabled || m_filePath.isEmpty())
+        return;
+
+    // Пустой (только что созданный) файл дописывается: ждём следующего уведомления
+    const QFileInfo info(m_filePath);
+    if (!info.exists() || info.size() == 0)
+        return;
+
+    // Файл не менялся после собственного сохранения: граф уже совпадает с ним
+    if (info.absoluteFilePath() == m_ownWritePath && info.size() == m_ownWriteSize
+        && info.lastModified() == m_ownWriteModified)
+        return;
+
+    emit readRequested(++m_requestId, m_filePath);
+}
+
+void GraphWatcher::applySnapshot(int requestId, const GraphSnapshot &snapshot)
+{
+    if (requestId != m_requestId)
+        return;
+
+    // Во время перетаскивания или загрузки открыта другая операция:
+    // изменения применяются позже
+    if (m_graph->inBatch()) {
+        m_debounceTimer.start();
+        return;
+    }
+
+    const bool colored = m_graph->maxColorCount() > 0;
+    const GraphDiffStats stats = m_graph->applySnapshotDiff(snapshot);
+    const int recolored = colored && !stats.isEmpty() ? m_graph->repairColoring() : 0;
+    emit reloaded(stats, recolored);
+}
+
+void GraphWatcher::handleReadFailed(int requestId, const QString &errorMessage)
+{
+    if (requestId != m_requestId)
+        return;
+
+    // Файл мог быть прочитан на середине записи; следующее уведомление
+    // о его изменении повторит попытку
+    emit reloadFailed(errorMessage);
+}
@@ -0,0 +1,82 @@
+#ifndef GRAPHWATCHER_H
+#define GRAPHWATCHER_H
+
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include "graph.h"
+#include "graphsnapshot.h"
+
+// Класс SnapshotReader читает файл графа в снимок в фоновом потоке
+class SnapshotReader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SnapshotReader(QObject *parent = nullptr) : QObject(parent) {}
+
+public slots:
+    void read(int requestId, const QString &filePath);
+
+signals:
+    void snapshotRead(int requestId, const GraphSnapshot &snapshot);
+    void readFailed(int requestId, const QString &errorMessage);
+};
+
+// Класс GraphWatcher следит за файлом документа и при его изменении
+// приводит граф к новому содержимому через Graph::applySnapshotDiff:
+// добавляются и удаляются только отличающиеся элементы, сохранившимся
+// вершинам переносятся позиция, цвет и закрепление. Если граф был
+// раскрашен, затем чинится раскраска (Graph::repairColoring).
+class GraphWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GraphWatcher(Graph *graph, QObject *parent = nullptr);
+    ~GraphWatcher();
+
+    // Наблюдаемый файл; пустой путь - наблюдать нечего
+    void setFilePath(const QString &filePath);
+    QString filePath() const { return m_filePath; }
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+
+    // Файл только что записан самим приложением: уведомление об этой записи
+    // не вызывает перечитывания. Вызывается после закрытия файла.
+    void markOwnWrite(const QString &filePath);
+
+signals:
+    void reloaded(const GraphDiffStats &stats, int recolored);
+    void reloadFailed(const QString &errorMessage);
+
+    void readRequested(int requestId, const QString &filePath);
+
+private slots:
+    void handleFileChanged(const QString &path);
+    void handleDirectoryChanged(const QString &path);
+    void startReload();
+    void applySnapshot(int requestId, const GraphSnapshot &snapshot);
+    void handleReadFailed(int requestId, const QString &errorMessage);
+
+private:
+    Graph *m_graph;
+    QFileSystemWatcher m_watcher;
+    QTimer m_debounceTimer;  // Запись файла генератором приходит несколькими уведомлениями
+    QThread m_thread;
+    SnapshotReader *m_reader;
+    QString m_filePath;
+    bool m_enabled;
+    int m_requestId;
+
+    // Размер и время изменения файла после собственной записи
+    QString m_ownWritePath;
+    qint64 m_ownWriteSize;
+    QDateTime m_ownWriteModified;
+
+    void updateWatchedPaths();
+};
+
+#endif // GRAPHWATCHER_H
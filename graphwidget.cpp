@@ -3,13 +3,93 @@
 #include <QGraphicsSceneMouseEvent>
 #include <QPainter>
 #include <QKeyEvent>
+#include <QResizeEvent>
+#include <QTimer>
 #include <QDebug>
+#include <QLabel>
+#include <QFontDatabase>
+#include <QTextStream>
+#include <algorithm>
+#include "profiler.h"
 
 // Константы для визуализации
 constexpr int VERTEX_RADIUS = 15;
 constexpr int EDGE_WIDTH = 2;
+constexpr int CONFLICT_EDGE_WIDTH = 4;
+constexpr int LOCKED_BORDER_WIDTH = 3;
 constexpr int SCENE_WIDTH = 800;
 constexpr int SCENE_HEIGHT = 600;
+// Запас вокруг видимой области в долях её размера (виртуализированный режим)
+constexpr qreal VIEWPORT_MARGIN = 0.5;
+// Область пересчитывается, если она шире видимой больше чем во столько раз
+constexpr qreal MAX_REALIZED_FACTOR = 4.0;
+// Сколько освободившихся элементов каждого типа хранится для повторного использования
+constexpr int ITEM_POOL_LIMIT = 4096;
+// Период обновления оверлея со статистикой кадров
+constexpr int FRAME_OVERLAY_INTERVAL_MS = 250;
+// Событие ввода, за которым так долго не последовало отрисовки, ничего не
+// изменило на экране и в задержку не попадает
+constexpr qint64 MAX_INPUT_LATENCY_NS = 2000000000;
+
+namespace {
+
+// Элементы, отрисованные в текущем кадре. Элементы рисуются только из
+// paintEvent в потоке интерфейса, поэтому счётчик общий и без синхронизации.
+int s_paintedItems = 0;
+
+// Время запроса к индексу сцены добавляется к счётчику кадра
+class IndexQueryTimer
+{
+public:
+    IndexQueryTimer(qint64 *total, bool enabled) : m_total(enabled ? total : nullptr)
+    {
+        if (m_total) {
+            m_timer.start();
+        }
+    }
+    ~IndexQueryTimer()
+    {
+        if (m_total) {
+            *m_total += m_timer.nsecsElapsed();
+        }
+    }
+
+private:
+    qint64 *m_total;
+    QElapsedTimer m_timer;
+};
+
+QString updateModeName(QGraphicsView::ViewportUpdateMode mode)
+{
+    switch (mode) {
+    case QGraphicsView::FullViewportUpdate:
+        return QStringLiteral("full");
+    case QGraphicsView::MinimalViewportUpdate:
+        return QStringLiteral("minimal");
+    case QGraphicsView::SmartViewportUpdate:
+        return QStringLiteral("smart");
+    case QGraphicsView::BoundingRectViewportUpdate:
+        return QStringLiteral("bounding-rect");
+    case QGraphicsView::NoViewportUpdate:
+        return QStringLiteral("none");
+    }
+    return QString();
+}
+
+QRectF vertexBounds(const QPointF &position)
+{
+    return QRectF(position.x() - VERTEX_RADIUS, position.y() - VERTEX_RADIUS,
+                  2 * VERTEX_RADIUS, 2 * VERTEX_RADIUS);
+}
+
+QRectF edgeBounds(const Edge *edge)
+{
+    return QRectF(edge->sourceVertex()->position(), edge->destVertex()->position())
+        .normalized()
+        .adjusted(-CONFLICT_EDGE_WIDTH, -CONFLICT_EDGE_WIDTH, CONFLICT_EDGE_WIDTH, CONFLICT_EDGE_WIDTH);
+}
+
+} // namespace
 
 // Реализация VertexItem
 
@@ -22,8 +102,17 @@ VertexItem::VertexItem(Vertex *vertex, QGraphicsItem *parent)
     setFlag(QGraphicsItem::ItemIsSelectable);
     setFlag(QGraphicsItem::ItemSendsGeometryChanges);
     setBrush(vertex->color());
-    setPen(QPen(Qt::black, 1));
     setPos(vertex->position());
+    updateLock();
+}
+
+void VertexItem::setVertex(Vertex *vertex)
+{
+    m_vertex = vertex;
+    setSelected(false);
+    setBrush(vertex->color());
+    setPos(vertex->position());
+    updateLock();
 }
 
 void VertexItem::updateColor()
@@ -32,6 +121,11 @@ void VertexItem::updateColor()
     update();
 }
 
+void VertexItem::updateLock()
+{
+    setPen(QPen(Qt::black, m_vertex->isLocked() ? LOCKED_BORDER_WIDTH : 1));
+}
+
 void VertexItem::updatePosition()
 {
     setPos(m_vertex->position());
@@ -56,6 +150,7 @@ void VertexItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
 
 void VertexItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
 {
+    s_paintedItems++;
     QGraphicsEllipseItem::paint(painter, option, widget);
 
     // Добавим номер цвета вершины
@@ -76,6 +171,14 @@ EdgeItem::EdgeItem(Edge *edge, QGraphicsItem *parent)
     updatePosition();
 }
 
+void EdgeItem::setEdge(Edge *edge)
+{
+    m_edge = edge;
+    setSelected(false);
+    setConflict(false);
+    updatePosition();
+}
+
 void EdgeItem::updatePosition()
 {
     QLineF line(m_edge->sourceVertex()->position(),
@@ -83,8 +186,14 @@ void EdgeItem::updatePosition()
     setLine(line);
 }
 
+void EdgeItem::setConflict(bool conflict)
+{
+    setPen(conflict ? QPen(Qt::red, CONFLICT_EDGE_WIDTH) : QPen(Qt::black, EDGE_WIDTH));
+}
+
 void EdgeItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
 {
+    s_paintedItems++;
     QGraphicsLineItem::paint(painter, option, widget);
 }
 
@@ -92,7 +201,9 @@ void EdgeItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
 
 GraphWidget::GraphWidget(QWidget *parent)
     : QGraphicsView(parent), m_graph(nullptr), m_editMode(GraphEditMode::Select),
-    m_edgeStartVertex(nullptr), m_tempEdgeLine(nullptr)
+    m_edgeStartVertex(nullptr), m_tempEdgeLine(nullptr), m_moveBatchOpen(false),
+    m_virtualized(false), m_realizeScheduled(false), m_inputPendingNs(-1), m_indexQueryNs(0),
+    m_frameOverlayVisible(false)
 {
     // Настройка сцены
     m_scene = new QGraphicsScene(this);
@@ -108,6 +219,19 @@ GraphWidget::GraphWidget(QWidget *parent)
 
     // Включаем отслеживание мыши без нажатия кнопок
     setMouseTracking(true);
+
+    // Оверлей - отдельный непрозрачный виджет поверх viewport: его
+    // обновление не перерисовывает сцену и не искажает замеры
+    m_frameClock.start();
+    m_frameOverlay = new QLabel(this);
+    m_frameOverlay->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    m_frameOverlay->setAutoFillBackground(true);
+    m_frameOverlay->setMargin(4);
+    m_frameOverlay->setAttribute(Qt::WA_TransparentForMouseEvents);
+    m_frameOverlay->hide();
+    m_overlayTimer = new QTimer(this);
+    m_overlayTimer->setInterval(FRAME_OVERLAY_INTERVAL_MS);
+    connect(m_overlayTimer, &QTimer::timeout, this, &GraphWidget::updateFrameOverlay);
 }
 
 GraphWidget::~GraphWidget()
@@ -173,12 +297,96 @@ void GraphWidget::colorGraph()
     }
 }
 
+void GraphWidget::fitSceneToGraph()
+{
+    if (!m_graph)
+        return;
+
+    QRectF bounds(0, 0, SCENE_WIDTH, SCENE_HEIGHT);
+    const QList<Vertex*> &vertices = m_graph->vertices();
+    if (!vertices.isEmpty()) {
+        double minX = vertices.first()->position().x(), maxX = minX;
+        double minY = vertices.first()->position().y(), maxY = minY;
+        for (Vertex *vertex : vertices) {
+            const QPointF position = vertex->position();
+            minX = std::min(minX, position.x());
+            maxX = std::max(maxX, position.x());
+            minY = std::min(minY, position.y());
+            maxY = std::max(maxY, position.y());
+        }
+        const double margin = 2 * VERTEX_RADIUS;
+        bounds = bounds.united(QRectF(QPointF(minX - margin, minY - margin),
+                                      QPointF(maxX + margin, maxY + margin)));
+    }
+
+    if (bounds != m_scene->sceneRect()) {
+        m_scene->setSceneRect(bounds);
+    }
+}
+
+void GraphWidget::setVirtualized(bool enabled)
+{
+    if (m_virtualized == enabled)
+        return;
+
+    // Элементы сцены пересоздаются в новом режиме, вершины графа остаются
+    // и их сигналы подключаются заново
+    for (auto it = m_vertexItems.constBegin(); it != m_vertexItems.constEnd(); ++it) {
+        disconnect(it.key(), nullptr, this, nullptr);
+    }
+    Graph *graph = m_graph;
+    // Подсветка конфликтов (например, от распределения по слоям) очищается
+    // в cleanupGraph и восстанавливается на новых элементах
+    const QSet<Edge*> conflictEdges = m_conflictEdges;
+    cleanupGraph();
+    m_virtualized = enabled;
+    m_graph = graph;
+    setupGraph();
+    setConflictEdges(QVector<Edge*>(conflictEdges.cbegin(), conflictEdges.cend()));
+}
+
+QVector<Vertex*> GraphWidget::selectedVertices() const
+{
+    QVector<Vertex*> vertices;
+    for (QGraphicsItem *item : m_scene->selectedItems()) {
+        if (item->type() == VertexItem::Type) {
+            vertices.append(static_cast<VertexItem*>(item)->vertex());
+        }
+    }
+    return vertices;
+}
+
+void GraphWidget::setConflictEdges(const QVector<Edge*> &edges)
+{
+    for (Edge *edge : std::as_const(m_conflictEdges)) {
+        if (EdgeItem *item = m_edgeItems.value(edge)) {
+            item->setConflict(false);
+        }
+    }
+
+    // Подсветка запоминается и для рёбер без элемента сцены: она
+    // применяется, когда ребро попадает в видимую область
+    m_conflictEdges.clear();
+    for (Edge *edge : edges) {
+        m_conflictEdges.insert(edge);
+        if (EdgeItem *item = m_edgeItems.value(edge)) {
+            item->setConflict(true);
+        }
+    }
+}
+
 void GraphWidget::mousePressEvent(QMouseEvent *event)
 {
+    markInput();
     QPointF scenePos = mapToScene(event->pos());
 
     switch (m_editMode) {
     case GraphEditMode::Select:
+        // Все перемещения за время перетаскивания - одна операция
+        if (m_graph && event->button() == Qt::LeftButton && !m_moveBatchOpen) {
+            m_graph->beginBatch(tr("Move vertices"));
+            m_moveBatchOpen = true;
+        }
         QGraphicsView::mousePressEvent(event);
         break;
 
@@ -233,7 +441,11 @@ void GraphWidget::mousePressEvent(QMouseEvent *event)
     case GraphEditMode::RemoveItem:
         if (event->button() == Qt::LeftButton) {
             if (m_graph) {
-                QGraphicsItem *item = m_scene->itemAt(scenePos, transform());
+                QGraphicsItem *item;
+                {
+                    IndexQueryTimer queryTimer(&m_indexQueryNs, isMeasuringFrames());
+                    item = m_scene->itemAt(scenePos, transform());
+                }
                 if (item) {
                     if (item->type() == VertexItem::Type) {
                         m_graph->removeVertex(static_cast<VertexItem*>(item)->vertex());
@@ -249,6 +461,10 @@ void GraphWidget::mousePressEvent(QMouseEvent *event)
 
 void GraphWidget::mouseMoveEvent(QMouseEvent *event)
 {
+    // Движение без кнопок перерисовывает сцену только при построении ребра
+    if (event->buttons() != Qt::NoButton || m_tempEdgeLine) {
+        markInput();
+    }
     QPointF scenePos = mapToScene(event->pos());
 
     // Обновляем временную линию при режиме добавления ребра, если есть начальная вершина
@@ -286,6 +502,13 @@ void GraphWidget::mouseReleaseEvent(QMouseEvent *event)
 
     QGraphicsView::mouseReleaseEvent(event);
 
+    if (m_moveBatchOpen && event->button() == Qt::LeftButton) {
+        m_moveBatchOpen = false;
+        if (m_graph) {
+            m_graph->endBatch();
+        }
+    }
+
     // Проверяем выделение
     bool hasSelection = !scene()->selectedItems().isEmpty();
     emit itemSelected(hasSelection);
@@ -302,15 +525,21 @@ void GraphWidget::mouseReleaseEvent(QMouseEvent *event)
 
 void GraphWidget::keyPressEvent(QKeyEvent *event)
 {
+    markInput();
     if (event->key() == Qt::Key_Delete) {
         if (m_graph) {
+            // Собираем дескрипторы до удаления: элементы сцены удаляются
+            // вместе с вершинами, а рёбра могут уйти вместе со своими вершинами
+            QVector<SlotHandle> vertexHandles;
+            QVector<SlotHandle> edgeHandles;
             for (QGraphicsItem *item : scene()->selectedItems()) {
                 if (item->type() == VertexItem::Type) {
-                    m_graph->removeVertex(static_cast<VertexItem*>(item)->vertex());
+                    vertexHandles.append(static_cast<VertexItem*>(item)->vertex()->handle());
                 } else if (item->type() == EdgeItem::Type) {
-                    m_graph->removeEdge(static_cast<EdgeItem*>(item)->edge());
+                    edgeHandles.append(static_cast<EdgeItem*>(item)->edge()->handle());
                 }
             }
+            m_graph->removeItems(vertexHandles, edgeHandles);
         }
     } else if (event->key() == Qt::Key_Escape && m_editMode == GraphEditMode::AddEdge) {
         // Отменяем создание ребра при нажатии Escape
@@ -325,60 +554,175 @@ void GraphWidget::keyPressEvent(QKeyEvent *event)
     }
 }
 
-void GraphWidget::handleVertexAdded(Vertex *vertex)
+void GraphWidget::paintEvent(QPaintEvent *event)
 {
-    if (!m_vertexItems.contains(vertex)) {
-        VertexItem *item = new VertexItem(vertex);
-        m_scene->addItem(item);
-        m_vertexItems[vertex] = item;
+    PROFILE_SCOPE("render.paint");
+    // Масштаб меняется без прокрутки, поэтому область проверяется и при отрисовке
+    scheduleRealize();
+    if (!isMeasuringFrames()) {
+        QGraphicsView::paintEvent(event);
+        return;
+    }
 
-        // Подключаем сигналы вершины
-        connect(vertex, &Vertex::positionChanged, this, &GraphWidget::handleVertexPositionChanged);
-        connect(vertex, &Vertex::colorChanged, this, &GraphWidget::handleVertexColorChanged);
+    s_paintedItems = 0;
+    const qint64 startNs = m_frameClock.nsecsElapsed();
+    QGraphicsView::paintEvent(event);
+    recordFrame(m_frameClock.nsecsElapsed() - startNs);
+}
+
+void GraphWidget::setFrameOverlayVisible(bool visible)
+{
+    if (m_frameOverlayVisible == visible)
+        return;
+
+    m_frameOverlayVisible = visible;
+    m_frameOverlay->setVisible(visible);
+    if (visible) {
+        updateFrameOverlay();
+        m_overlayTimer->start();
+    } else {
+        m_overlayTimer->stop();
+    }
+}
+
+bool GraphWidget::setFrameLogPath(const QString &filePath, QString *errorMessage)
+{
+    m_frameLog.close();
+    if (filePath.isEmpty())
+        return true;
+
+    m_frameLog.setFileName(filePath);
+    if (!m_frameLog.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        if (errorMessage) {
+            *errorMessage = m_frameLog.errorString();
+        }
+        return false;
+    }
+    m_frameLog.write("frame,paint_ms,items,index_ms,input_ms,update_mode,virtualized\n");
+    return true;
+}
+
+void GraphWidget::resetFrameStats()
+{
+    m_frameStats.clear();
+    m_inputPendingNs = -1;
+    m_indexQueryNs = 0;
+    if (m_frameOverlayVisible) {
+        updateFrameOverlay();
+    }
+}
+
+void GraphWidget::setUpdateMode(QGraphicsView::ViewportUpdateMode mode)
+{
+    setViewportUpdateMode(mode);
+    resetFrameStats();
+    viewport()->update();
+}
+
+void GraphWidget::markInput()
+{
+    if (isMeasuringFrames() && m_inputPendingNs < 0) {
+        m_inputPendingNs = m_frameClock.nsecsElapsed();
+    }
+}
+
+void GraphWidget::recordFrame(qint64 paintNs)
+{
+    const qint64 nowNs = m_frameClock.nsecsElapsed();
+    double latencyMs = -1;
+    if (m_inputPendingNs >= 0 && nowNs - m_inputPendingNs <= MAX_INPUT_LATENCY_NS) {
+        latencyMs = (nowNs - m_inputPendingNs) / 1e6;
+        m_frameStats.addSample(FrameStats::InputLatency, latencyMs);
+    }
+    m_inputPendingNs = -1;
+
+    const double paintMs = paintNs / 1e6;
+    const double indexMs = m_indexQueryNs / 1e6;
+    m_indexQueryNs = 0;
+    m_frameStats.addSample(FrameStats::PaintTime, paintMs);
+    m_frameStats.addSample(FrameStats::PaintedItems, s_paintedItems);
+    m_frameStats.addSample(FrameStats::IndexQueryTime, indexMs);
+    m_frameStats.countFrame();
+
+    if (m_frameLog.isOpen()) {
+        QTextStream log(&m_frameLog);
+        log << m_frameStats.frameCount() << ',' << QString::number(paintMs, 'f', 3) << ','
+            << s_paintedItems << ',' << QString::number(indexMs, 'f', 3) << ','
+            << (latencyMs >= 0 ? QString::number(latencyMs, 'f', 3) : QString()) << ','
+            << updateModeName(viewportUpdateMode()) << ',' << (m_virtualized ? 1 : 0) << '\n';
     }
 }
 
+void GraphWidget::updateFrameOverlay()
+{
+    m_frameOverlay->setText(m_frameStats.report()
+                            + tr("\nupdate mode: %1%2").arg(updateModeName(viewportUpdateMode()),
+                                                           m_virtualized ? tr(", virtualized") : QString()));
+    m_frameOverlay->adjustSize();
+    m_frameOverlay->move(viewport()->geometry().topLeft() + QPoint(8, 8));
+    m_frameOverlay->raise();
+}
+
+void GraphWidget::scrollContentsBy(int dx, int dy)
+{
+    QGraphicsView::scrollContentsBy(dx, dy);
+    scheduleRealize();
+}
+
+void GraphWidget::resizeEvent(QResizeEvent *event)
+{
+    QGraphicsView::resizeEvent(event);
+    scheduleRealize();
+}
+
+void GraphWidget::handleVertexAdded(Vertex *vertex)
+{
+    PROFILE_SCOPE_AGGREGATE("scene.insertVertex");
+    if (m_virtualized) {
+        const QRectF bounds = vertexBounds(vertex->position());
+        m_vertexIndex.insert(vertex, bounds);
+        if (!m_realizedRect.intersects(bounds))
+            return;
+    }
+    realizeVertex(vertex);
+}
+
 void GraphWidget::handleEdgeAdded(Edge *edge)
 {
-    if (!m_edgeItems.contains(edge)) {
-        EdgeItem *item = new EdgeItem(edge);
-        // Убедимся, что ребра отображаются под вершинами
-        item->setZValue(-1);
-        m_scene->addItem(item);
-        m_edgeItems[edge] = item;
+    PROFILE_SCOPE_AGGREGATE("scene.insertEdge");
+    if (m_virtualized) {
+        const QRectF bounds = edgeBounds(edge);
+        m_edgeIndex.insert(edge, bounds);
+        if (!m_realizedRect.intersects(bounds))
+            return;
     }
+    realizeEdge(edge);
 }
 
 void GraphWidget::handleVertexRemoved(Vertex *vertex)
 {
-    if (m_vertexItems.contains(vertex)) {
-        VertexItem *item = m_vertexItems[vertex];
-        m_scene->removeItem(item);
-        m_vertexItems.remove(vertex);
-        delete item;
-    }
+    m_vertexIndex.remove(vertex);
+    releaseVertex(vertex);
 }
 
 void GraphWidget::handleEdgeRemoved(Edge *edge)
 {
-    if (m_edgeItems.contains(edge)) {
-        EdgeItem *item = m_edgeItems[edge];
-        m_scene->removeItem(item);
-        m_edgeItems.remove(edge);
-        delete item;
-    }
+    m_conflictEdges.remove(edge);
+    m_edgeIndex.remove(edge);
+    releaseEdge(edge);
 }
 
 void GraphWidget::handleVertexPositionChanged()
 {
     Vertex *vertex = qobject_cast<Vertex*>(sender());
-    if (vertex && m_vertexItems.contains(vertex)) {
-        m_vertexItems[vertex]->updatePosition();
+    VertexItem *item = m_vertexItems.value(vertex);
+    if (item) {
+        item->updatePosition();
 
         // Обновляем связанные ребра
         for (Edge *edge : vertex->edges()) {
-            if (m_edgeItems.contains(edge)) {
-                m_edgeItems[edge]->updatePosition();
+            if (EdgeItem *edgeItem = m_edgeItems.value(edge)) {
+                edgeItem->updatePosition();
             }
         }
     }
@@ -386,12 +730,198 @@ void GraphWidget::handleVertexPositionChanged()
 
 void GraphWidget::handleVertexColorChanged()
 {
-    Vertex *vertex = qobject_cast<Vertex*>(sender());
-    if (vertex && m_vertexItems.contains(vertex)) {
-        m_vertexItems[vertex]->updateColor();
+    PROFILE_SCOPE_AGGREGATE("color.signalFanout");
+    Vertex *vertex = static_cast<Vertex*>(sender());
+    if (VertexItem *item = m_vertexItems.value(vertex)) {
+        item->updateColor();
+    }
+}
+
+void GraphWidget::handleColorsChanged(const QVector<Vertex*> &vertices, const QVector<int> &oldIndices)
+{
+    Q_UNUSED(oldIndices);
+    PROFILE_SCOPE("color.sceneUpdate");
+
+    // Элементы только помечаются грязными, сцена перерисовывается один раз
+    for (Vertex *vertex : vertices) {
+        if (VertexItem *item = m_vertexItems.value(vertex)) {
+            item->updateColor();
+        }
+    }
+}
+
+void GraphWidget::handleVertexLockChanged(Vertex *vertex)
+{
+    if (VertexItem *item = m_vertexItems.value(vertex)) {
+        item->updateLock();
+    }
+}
+
+void GraphWidget::handleVertexMoved(Vertex *vertex, const QPointF &oldPosition)
+{
+    Q_UNUSED(oldPosition);
+
+    // Виртуализированный режим: перемещение любой вершины, в том числе
+    // без элемента сцены, обновляет сетку поиска
+    const QRectF bounds = vertexBounds(vertex->position());
+    m_vertexIndex.update(vertex, bounds);
+    if (VertexItem *item = m_vertexItems.value(vertex)) {
+        item->updatePosition();
+    } else if (m_realizedRect.intersects(bounds)) {
+        realizeVertex(vertex);
+    }
+
+    for (Edge *edge : vertex->edges()) {
+        const QRectF edgeRect = edgeBounds(edge);
+        m_edgeIndex.update(edge, edgeRect);
+        if (EdgeItem *item = m_edgeItems.value(edge)) {
+            item->updatePosition();
+        } else if (m_realizedRect.intersects(edgeRect)) {
+            realizeEdge(edge);
+        }
+    }
+}
+
+void GraphWidget::updateRealizedItems()
+{
+    PROFILE_SCOPE("scene.virtualize");
+    m_realizeScheduled = false;
+    if (!m_graph || !m_virtualized)
+        return;
+
+    const QRectF visible = visibleSceneRect();
+    m_realizedRect = visible.adjusted(-visible.width() * VIEWPORT_MARGIN, -visible.height() * VIEWPORT_MARGIN,
+                                      visible.width() * VIEWPORT_MARGIN, visible.height() * VIEWPORT_MARGIN);
+    QSet<Vertex*> vertices;
+    QSet<Edge*> edges;
+    {
+        IndexQueryTimer queryTimer(&m_indexQueryNs, isMeasuringFrames());
+        vertices = m_vertexIndex.query(m_realizedRect);
+        edges = m_edgeIndex.query(m_realizedRect);
+    }
+
+    // Выделенные и перетаскиваемые элементы остаются в сцене
+    QGraphicsItem *grabber = m_scene->mouseGrabberItem();
+    const QList<Vertex*> realizedVertices = m_vertexItems.keys();
+    for (Vertex *vertex : realizedVertices) {
+        VertexItem *item = m_vertexItems.value(vertex);
+        if (!vertices.contains(vertex) && !item->isSelected() && item != grabber
+            && vertex != m_edgeStartVertex) {
+            releaseVertex(vertex);
+        }
+    }
+    const QList<Edge*> realizedEdges = m_edgeItems.keys();
+    for (Edge *edge : realizedEdges) {
+        if (!edges.contains(edge) && !m_edgeItems.value(edge)->isSelected()) {
+            releaseEdge(edge);
+        }
+    }
+
+    for (Vertex *vertex : vertices) {
+        realizeVertex(vertex);
+    }
+    for (Edge *edge : edges) {
+        realizeEdge(edge);
     }
 }
 
+VertexItem* GraphWidget::realizeVertex(Vertex *vertex)
+{
+    if (VertexItem *item = m_vertexItems.value(vertex))
+        return item;
+
+    VertexItem *item;
+    if (!m_vertexPool.isEmpty()) {
+        item = m_vertexPool.takeLast();
+        item->setVertex(vertex);
+    } else {
+        item = new VertexItem(vertex);
+    }
+    m_scene->addItem(item);
+    m_vertexItems[vertex] = item;
+
+    // Подключаем сигналы вершины; перемещения в виртуализированном режиме
+    // приходят от графа (Graph::vertexMoved)
+    if (!m_virtualized) {
+        connect(vertex, &Vertex::positionChanged, this, &GraphWidget::handleVertexPositionChanged);
+    }
+    connect(vertex, &Vertex::colorChanged, this, &GraphWidget::handleVertexColorChanged);
+    return item;
+}
+
+EdgeItem* GraphWidget::realizeEdge(Edge *edge)
+{
+    if (EdgeItem *item = m_edgeItems.value(edge))
+        return item;
+
+    EdgeItem *item;
+    if (!m_edgePool.isEmpty()) {
+        item = m_edgePool.takeLast();
+        item->setEdge(edge);
+    } else {
+        item = new EdgeItem(edge);
+        // Убедимся, что ребра отображаются под вершинами
+        item->setZValue(-1);
+    }
+    if (m_conflictEdges.contains(edge)) {
+        item->setConflict(true);
+    }
+    m_scene->addItem(item);
+    m_edgeItems[edge] = item;
+    return item;
+}
+
+void GraphWidget::releaseVertex(Vertex *vertex)
+{
+    VertexItem *item = m_vertexItems.take(vertex);
+    if (!item)
+        return;
+
+    disconnect(vertex, nullptr, this, nullptr);
+    m_scene->removeItem(item);
+    if (m_virtualized && m_vertexPool.size() < ITEM_POOL_LIMIT) {
+        m_vertexPool.append(item);
+    } else {
+        delete item;
+    }
+}
+
+void GraphWidget::releaseEdge(Edge *edge)
+{
+    EdgeItem *item = m_edgeItems.take(edge);
+    if (!item)
+        return;
+
+    m_scene->removeItem(item);
+    if (m_virtualized && m_edgePool.size() < ITEM_POOL_LIMIT) {
+        m_edgePool.append(item);
+    } else {
+        delete item;
+    }
+}
+
+QRectF GraphWidget::visibleSceneRect() const
+{
+    return mapToScene(viewport()->rect()).boundingRect();
+}
+
+void GraphWidget::scheduleRealize()
+{
+    if (!m_virtualized || !m_graph || m_realizeScheduled)
+        return;
+
+    // Область пересчитывается, когда видимая часть вышла за её пределы
+    // или стала намного меньше (приближение)
+    const QRectF visible = visibleSceneRect();
+    if (m_realizedRect.contains(visible)
+        && m_realizedRect.width() <= visible.width() * MAX_REALIZED_FACTOR
+        && m_realizedRect.height() <= visible.height() * MAX_REALIZED_FACTOR)
+        return;
+
+    m_realizeScheduled = true;
+    QTimer::singleShot(0, this, &GraphWidget::updateRealizedItems);
+}
+
 void GraphWidget::setupGraph()
 {
     if (!m_graph)
@@ -402,8 +932,14 @@ void GraphWidget::setupGraph()
     connect(m_graph, &Graph::edgeAdded, this, &GraphWidget::handleEdgeAdded);
     connect(m_graph, &Graph::vertexRemoved, this, &GraphWidget::handleVertexRemoved);
     connect(m_graph, &Graph::edgeRemoved, this, &GraphWidget::handleEdgeRemoved);
+    connect(m_graph, &Graph::colorsChanged, this, &GraphWidget::handleColorsChanged);
+    connect(m_graph, &Graph::vertexLockChanged, this, &GraphWidget::handleVertexLockChanged);
+    if (m_virtualized) {
+        connect(m_graph, &Graph::vertexMoved, this, &GraphWidget::handleVertexMoved);
+    }
 
-    // Добавляем существующие вершины и ребра
+    // Добавляем существующие вершины и ребра (в виртуализированном режиме -
+    // только в сетку поиска, элементы создаются для видимой области)
     for (Vertex *vertex : m_graph->vertices()) {
         handleVertexAdded(vertex);
     }
@@ -411,6 +947,10 @@ void GraphWidget::setupGraph()
     for (Edge *edge : m_graph->edges()) {
         handleEdgeAdded(edge);
     }
+
+    if (m_virtualized) {
+        updateRealizedItems();
+    }
 }
 
 void GraphWidget::cleanupGraph()
@@ -418,6 +958,11 @@ void GraphWidget::cleanupGraph()
     if (!m_graph)
         return;
 
+    if (m_moveBatchOpen) {
+        m_moveBatchOpen = false;
+        m_graph->endBatch();
+    }
+
     // Отключаем сигналы графа
     disconnect(m_graph, nullptr, this, nullptr);
 
@@ -433,13 +978,26 @@ void GraphWidget::cleanupGraph()
         delete it.value();
     }
     m_edgeItems.clear();
+    m_conflictEdges.clear();
+
+    qDeleteAll(m_vertexPool);
+    m_vertexPool.clear();
+    qDeleteAll(m_edgePool);
+    m_edgePool.clear();
+    m_vertexIndex.clear();
+    m_edgeIndex.clear();
+    m_realizedRect = QRectF();
 
     m_graph = nullptr;
 }
 
 VertexItem* GraphWidget::findVertexItemAt(const QPointF &pos)
 {
-    QList<QGraphicsItem*> items = m_scene->items(pos);
+    QList<QGraphicsItem*> items;
+    {
+        IndexQueryTimer queryTimer(&m_indexQueryNs, isMeasuringFrames());
+        items = m_scene->items(pos);
+    }
     for (QGraphicsItem *item : items) {
         if (item->type() == VertexItem::Type) {
             return static_cast<VertexItem*>(item);
@@ -5,7 +5,16 @@
 #include <QGraphicsView>
 #include <QGraphicsScene>
 #include <QGraphicsItem>
+#include <QHash>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QFile>
 #include "graph.h"
+#include "spatialgrid.h"
+#include "framestats.h"
+
+class QLabel;
+class QTimer;
 
 // Графические элементы для отображения вершин и рёбер
 class VertexItem : public QGraphicsEllipseItem
@@ -17,8 +26,12 @@ public:
     int type() const override { return Type; }
 
     Vertex* vertex() const { return m_vertex; }
+    // Повторное использование элемента для другой вершины
+    void setVertex(Vertex *vertex);
     void updateColor();
     void updatePosition();
+    // Закреплённая вершина обводится толстой линией
+    void updateLock();
 
 protected:
     void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
@@ -40,7 +53,11 @@ public:
     int type() const override { return Type; }
 
     Edge* edge() const { return m_edge; }
+    // Повторное использование элемента для другого ребра
+    void setEdge(Edge *edge);
     void updatePosition();
+    // Подсветка ребра, концы которого остались в одном слое
+    void setConflict(bool conflict);
 
 protected:
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
@@ -79,6 +96,40 @@ public:
     // Применение алгоритма раскраски
     void colorGraph();
 
+    // Расширение сцены до размеров графа (сцена не меньше исходной)
+    void fitSceneToGraph();
+
+    // Виртуализация сцены: элементы создаются только для вершин и рёбер
+    // в видимой области с запасом, модель целиком хранится в сетке поиска.
+    // Ушедшие из области элементы переиспользуются.
+    void setVirtualized(bool enabled);
+    bool isVirtualized() const { return m_virtualized; }
+
+    // Выделенные вершины
+    QVector<Vertex*> selectedVertices() const;
+
+    // Подсветка конфликтных рёбер (предыдущая подсветка снимается)
+    void setConflictEdges(const QVector<Edge*> &edges);
+
+    // Замер кадров: время отрисовки, число отрисованных элементов, запросы
+    // к индексам сцены и задержка от ввода до кадра. Оверлей показывает
+    // перцентили за последние кадры, журнал пишет строку CSV на кадр.
+    // Пока оба выключены, замер не ведётся.
+    void setFrameOverlayVisible(bool visible);
+    bool isFrameOverlayVisible() const { return m_frameOverlayVisible; }
+    // Пустой путь закрывает журнал
+    bool setFrameLogPath(const QString &filePath, QString *errorMessage = nullptr);
+    const FrameStats &frameStats() const { return m_frameStats; }
+    void resetFrameStats();
+
+    // Смена режима обновления сбрасывает статистику кадров, чтобы
+    // перцентили относились к одному режиму
+    void setUpdateMode(QGraphicsView::ViewportUpdateMode mode);
+
+    // Число элементов сцены (для учёта памяти)
+    int vertexItemCount() const { return m_vertexItems.size() + m_vertexPool.size(); }
+    int edgeItemCount() const { return m_edgeItems.size() + m_edgePool.size(); }
+
 signals:
     void vertexSelected(Vertex *vertex);
     void edgeSelected(Edge *edge);
@@ -89,6 +140,9 @@ protected:
     void mouseMoveEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void resizeEvent(QResizeEvent *event) override;
 
 private slots:
     void handleVertexAdded(Vertex *vertex);
@@ -97,6 +151,11 @@ private slots:
     void handleEdgeRemoved(Edge *edge);
     void handleVertexPositionChanged();
     void handleVertexColorChanged();
+    void handleColorsChanged(const QVector<Vertex*> &vertices, const QVector<int> &oldIndices);
+    void handleVertexLockChanged(Vertex *vertex);
+    void handleVertexMoved(Vertex *vertex, const QPointF &oldPosition);
+    void updateRealizedItems();
+    void updateFrameOverlay();
 
 private:
     Graph *m_graph;
@@ -105,12 +164,42 @@ private:
     Vertex *m_edgeStartVertex;
     QPointF m_edgeStartPoint;
     QGraphicsLineItem *m_tempEdgeLine;
-    QMap<Vertex*, VertexItem*> m_vertexItems;
-    QMap<Edge*, EdgeItem*> m_edgeItems;
+    bool m_moveBatchOpen;  // Перетаскивание вершин записывается одной операцией
+    QHash<Vertex*, VertexItem*> m_vertexItems;
+    QHash<Edge*, EdgeItem*> m_edgeItems;
+    QSet<Edge*> m_conflictEdges;
+
+    // Виртуализированный режим
+    bool m_virtualized;
+    bool m_realizeScheduled;
+    SpatialGrid<Vertex*> m_vertexIndex;
+    SpatialGrid<Edge*> m_edgeIndex;
+    QRectF m_realizedRect;  // Область, для которой созданы элементы
+    QVector<VertexItem*> m_vertexPool;
+    QVector<EdgeItem*> m_edgePool;
+
+    // Замер кадров
+    FrameStats m_frameStats;
+    QElapsedTimer m_frameClock;
+    qint64 m_inputPendingNs;  // Время ещё не отрисованного события ввода или -1
+    qint64 m_indexQueryNs;    // Запросы к индексам сцены с прошлого кадра
+    bool m_frameOverlayVisible;
+    QLabel *m_frameOverlay;
+    QTimer *m_overlayTimer;
+    QFile m_frameLog;
 
     void setupGraph();
     void cleanupGraph();
+    VertexItem* realizeVertex(Vertex *vertex);
+    EdgeItem* realizeEdge(Edge *edge);
+    void releaseVertex(Vertex *vertex);
+    void releaseEdge(Edge *edge);
+    QRectF visibleSceneRect() const;
+    void scheduleRealize();
     VertexItem* findVertexItemAt(const QPointF &pos);
+    bool isMeasuringFrames() const { return m_frameOverlayVisible || m_frameLog.isOpen(); }
+    void markInput();
+    void recordFrame(qint64 paintNs);
 };
 
 #endif // GRAPHWIDGET_H
@@ -0,0 +1,150 @@
+#include "graphwriter.h"
+#include "graph.h"
+#include "parallel.h"
+#include "profiler.h"
+#include "memorystats.h"
+#include <QLocale>
+#include <QVector>
+#include <cmath>
+
+namespace {
+
+// Число элементов в блоке и число блоков, форматируемых за один проход.
+// Проход ограничивает объём буферов, которые одновременно держатся в памяти.
+constexpr int CHUNK_ITEMS = 8192;
+constexpr int CHUNKS_PER_THREAD = 4;
+
+// Примерный размер записи в байтах для резервирования буфера
+constexpr int VERTEX_RECORD_BYTES = 112;
+constexpr int EDGE_RECORD_BYTES = 80;
+
+void appendInt(QByteArray &out, qint64 value)
+{
+    out += QByteArray::number(value);
+}
+
+// Число в том виде, в каком его пишет QJsonDocument: значения, точно
+// представимые целым, хранятся в QJsonValue как целые и пишутся без
+// дробной части, остальные - кратчайшим представлением
+void appendDouble(QByteArray &out, double value)
+{
+    if (!std::isfinite(value)) {
+        out += "null";
+        return;
+    }
+
+    constexpr double MAX_EXACT_INTEGER = 9007199254740992.0;  // 2^53
+    if (value == std::floor(value) && std::abs(value) <= MAX_EXACT_INTEGER) {
+        appendInt(out, qint64(value));
+    } else {
+        out += QByteArray::number(value, 'g', QLocale::FloatingPointShortest);
+    }
+}
+
+// Форматирование массива по блокам с записью результата по порядку
+template<typename FormatItem>
+bool writeArray(QIODevice *device, int count, int recordBytes, FormatItem formatItem,
+                QString *errorMessage)
+{
+    const int chunkCount = (count + CHUNK_ITEMS - 1) / CHUNK_ITEMS;
+    const int window = std::max(1, QThreadPool::globalInstance()->maxThreadCount() * CHUNKS_PER_THREAD);
+
+    QVector<QByteArray> buffers(std::min(window, std::max(chunkCount, 1)));
+    MemoryReservation reservation(MemoryTracker::IoBuffers,
+                                  qint64(buffers.size()) * CHUNK_ITEMS * recordBytes);
+
+    for (int firstChunk = 0; firstChunk < chunkCount; firstChunk += window) {
+        const int windowChunks = std::min(window, chunkCount - firstChunk);
+
+        {
+            PROFILE_SCOPE("save.serialize");
+            parallelFor(windowChunks, [&](int slot) {
+                const int begin = (firstChunk + slot) * CHUNK_ITEMS;
+                const int end = std::min(count, begin + CHUNK_ITEMS);
+
+                QByteArray &buffer = buffers[slot];
+                buffer.resize(0);
+                buffer.reserve((end - begin) * recordBytes);
+                for (int i = begin; i < end; ++i) {
+                    formatItem(buffer, i);
+                    buffer += (i + 1 < count) ? ",\n" : "\n";
+                }
+            });
+        }
+
+        PROFILE_SCOPE("save.write");
+        for (int slot = 0; slot < windowChunks; ++slot) {
+            if (device->write(buffers[slot]) != buffers[slot].size()) {
+                if (errorMessage) {
+                    *errorMessage = device->errorString();
+                }
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool writeRaw(QIODevice *device, const QByteArray &data, QString *errorMessage)
+{
+    if (device->write(data) != data.size()) {
+        if (errorMessage) {
+            *errorMessage = device->errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool GraphWriter::writeJson(const Graph *graph, QIODevice *device, QString *errorMessage)
+{
+    // Ключи идут в алфавитном порядке, как их упорядочивает QJsonObject
+    const QList<Vertex*> &vertices = graph->vertices();
+    const QList<Edge*> &edges = graph->edges();
+
+    if (!writeRaw(device, "{\n    \"edges\": [\n", errorMessage))
+        return false;
+
+    bool ok = writeArray(device, edges.size(), EDGE_RECORD_BYTES,
+                         [&](QByteArray &out, int i) {
+        const Edge *edge = edges[i];
+        out += "        {\n            \"dest_id\": ";
+        appendInt(out, edge->destVertex()->id());
+        out += ",\n            \"source_id\": ";
+        appendInt(out, edge->sourceVertex()->id());
+        out += "\n        }";
+    }, errorMessage);
+    if (!ok)
+        return false;
+
+    QByteArray middle = "    ],\n    \"max_color\": ";
+    appendInt(middle, graph->maxColorCount());
+    middle += ",\n    \"vertices\": [\n";
+    if (!writeRaw(device, middle, errorMessage))
+        return false;
+
+    ok = writeArray(device, vertices.size(), VERTEX_RECORD_BYTES,
+                    [&](QByteArray &out, int i) {
+        const Vertex *vertex = vertices[i];
+        const QPointF position = vertex->position();
+        out += "        {\n            \"color_index\": ";
+        appendInt(out, vertex->colorIndex());
+        // Постоянный идентификатор, как в Graph::toJson
+        out += ",\n            \"id\": ";
+        appendInt(out, vertex->id());
+        if (vertex->isLocked()) {
+            out += ",\n            \"locked\": true";
+        }
+        out += ",\n            \"x\": ";
+        appendDouble(out, position.x());
+        out += ",\n            \"y\": ";
+        appendDouble(out, position.y());
+        out += "\n        }";
+    }, errorMessage);
+    if (!ok)
+        return false;
+
+    return writeRaw(device, "    ]\n}\n", errorMessage);
+}
@@ -0,0 +1,20 @@
+#ifndef GRAPHWRITER_H
+#define GRAPHWRITER_H
+
+#include <QIODevice>
+#include <QString>
+
+class Graph;
+
+// Класс GraphWriter записывает граф в JSON потоково, без построения DOM.
+// Вершины нумеруются позицией в хранилище графа, поэтому номер конца ребра
+// находится за O(1). Вершины и рёбра разбиваются на блоки, которые
+// форматируются параллельно в отдельные буферы и пишутся в файл по порядку.
+// Вывод побайтно совпадает с QJsonDocument(graph->toJson()).toJson().
+class GraphWriter
+{
+public:
+    static bool writeJson(const Graph *graph, QIODevice *device, QString *errorMessage = nullptr);
+};
+
+#endif // GRAPHWRITER_H
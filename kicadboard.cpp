@@ -0,0 +1,779 @@
+#include "kicadboard.h"
+#include "memorystats.h"
+#include "parallel.h"
+#include "profiler.h"
+#include <QFile>
+#include <QHash>
+#include <QObject>
+#include <QtMath>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// Зазор между дорожками разных цепей, если на плате нет правил (мм)
+constexpr double DEFAULT_CLEARANCE = 0.2;
+// Масштаб координат платы (мм) в координаты сцены
+constexpr double SCENE_SCALE = 10.0;
+// Ячеек сетки слоя на один сегмент, не больше
+constexpr qint64 CELLS_PER_SEGMENT = 4;
+// Номера цепей хранятся в плотном массиве
+constexpr int MAX_NET = 1 << 24;
+// Наибольший прогиб хорды при замене дуги хордами (мм), малая доля зазора
+constexpr double ARC_SAGITTA = 0.01;
+// Хорд на одну дугу, не больше
+constexpr int MAX_ARC_CHORDS = 64;
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Лексема ссылается на исходный текст без копирования
+struct Token
+{
+    enum Type { Open, Close, Atom, End, Error };
+
+    Type type = End;
+    const char *data = nullptr;
+    int length = 0;
+
+    bool is(const char *text) const
+    {
+        return type == Atom && length == int(std::strlen(text)) && std::memcmp(data, text, length) == 0;
+    }
+
+    // Ключ для поиска в хэше без копирования текста
+    QByteArray rawKey() const { return QByteArray::fromRawData(data, length); }
+};
+
+// Разбор целого со знаком по всей лексеме
+bool parseInteger(const Token &token, int *value)
+{
+    if (token.type != Token::Atom || token.length == 0)
+        return false;
+
+    const char *p = token.data;
+    const char *end = p + token.length;
+    const bool negative = *p == '-';
+    if (negative || *p == '+') {
+        p++;
+    }
+    if (p == end)
+        return false;
+
+    qint64 result = 0;
+    for (; p < end; ++p) {
+        if (*p < '0' || *p > '9')
+            return false;
+        result = result * 10 + (*p - '0');
+        if (result > INT_MAX)
+            return false;
+    }
+    *value = int(negative ? -result : result);
+    return true;
+}
+
+// Разбор десятичной дроби вида -12.345 (KiCad не пишет экспоненту)
+bool parseDecimal(const Token &token, double *value)
+{
+    static const double POWERS[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+    if (token.type != Token::Atom || token.length == 0)
+        return false;
+
+    const char *p = token.data;
+    const char *end = p + token.length;
+    const bool negative = *p == '-';
+    if (negative || *p == '+') {
+        p++;
+    }
+
+    quint64 mantissa = 0;
+    int digits = 0;
+    int fractionDigits = 0;
+    bool fraction = false;
+    for (; p < end; ++p) {
+        if (*p == '.' && !fraction) {
+            fraction = true;
+            continue;
+        }
+        if (*p < '0' || *p > '9')
+            return false;
+        // Лишние знаки после 18-го значимого не влияют на результат в double
+        if (digits < 18) {
+            mantissa = mantissa * 10 + quint64(*p - '0');
+            digits++;
+            if (fraction) {
+                fractionDigits++;
+            }
+        } else if (!fraction) {
+            return false;
+        }
+    }
+    if (digits == 0)
+        return false;
+
+    const double result = double(mantissa) / POWERS[fractionDigits];
+    *value = negative ? -result : result;
+    return true;
+}
+
+class Tokenizer
+{
+public:
+    Tokenizer(const char *begin, const char *end) : m_pos(begin), m_end(end), m_line(1) {}
+
+    Token next()
+    {
+        Token token;
+        while (m_pos < m_end && isSpace(*m_pos)) {
+            if (*m_pos == '\n') {
+                m_line++;
+            }
+            m_pos++;
+        }
+        if (m_pos >= m_end)
+            return token;
+
+        switch (*m_pos) {
+        case '(':
+            token.type = Token::Open;
+            m_pos++;
+            return token;
+        case ')':
+            token.type = Token::Close;
+            m_pos++;
+            return token;
+        case '"': {
+            // Строка в кавычках; экранированные символы остаются как есть
+            const char *start = ++m_pos;
+            if (!skipString()) {
+                token.type = Token::Error;
+                return token;
+            }
+            token.type = Token::Atom;
+            token.data = start;
+            token.length = int(m_pos - 1 - start);
+            return token;
+        }
+        default:
+            break;
+        }
+
+        const char *start = m_pos;
+        while (m_pos < m_end && !isSpace(*m_pos) && *m_pos != '(' && *m_pos != ')') {
+            m_pos++;
+        }
+        token.type = Token::Atom;
+        token.data = start;
+        token.length = int(m_pos - start);
+        return token;
+    }
+
+    // Пропуск остатка текущего списка вместе с вложенными списками.
+    // Лексемы не выделяются: посадочные места и полигоны - основная
+    // часть файла, и здесь нужны только скобки и кавычки.
+    bool skipList()
+    {
+        int depth = 1;
+        while (m_pos < m_end) {
+            const char c = *m_pos++;
+            if (c == '(') {
+                depth++;
+            } else if (c == ')') {
+                if (--depth == 0)
+                    return true;
+            } else if (c == '"') {
+                if (!skipString())
+                    return false;
+            } else if (c == '\n') {
+                m_line++;
+            }
+        }
+        return false;
+    }
+
+    int line() const { return m_line; }
+
+private:
+    const char *m_pos;
+    const char *m_end;
+    int m_line;
+
+    // Позиция сразу после открывающей кавычки; результат - после закрывающей
+    bool skipString()
+    {
+        while (m_pos < m_end) {
+            const char c = *m_pos++;
+            if (c == '"')
+                return true;
+            if (c == '\\' && m_pos < m_end) {
+                m_pos++;
+            } else if (c == '\n') {
+                m_line++;
+            }
+        }
+        return false;
+    }
+};
+
+// Отрезок дорожки; дуга заменяется хордами (см. BoardParser::addArc)
+struct Segment
+{
+    double x1, y1, x2, y2;
+    double halfWidth;
+    int net;
+};
+
+struct NetCenter
+{
+    double sumX = 0;
+    double sumY = 0;
+    int count = 0;
+};
+
+class BoardParser
+{
+public:
+    BoardParser(const char *begin, const char *end)
+        : m_tokens(begin, end), m_clearance(-1), m_nextNet(1)
+    {
+    }
+
+    bool parse()
+    {
+        if (m_tokens.next().type != Token::Open || !m_tokens.next().is("kicad_pcb"))
+            return fail(QObject::tr("Not a KiCad board file."));
+
+        while (true) {
+            const Token token = m_tokens.next();
+            if (token.type == Token::Close)
+                return true;
+            if (token.type == Token::Atom)
+                continue;
+            if (token.type != Token::Open)
+                return failSyntax();
+
+            const Token head = m_tokens.next();
+            if (head.type != Token::Atom)
+                return failSyntax();
+
+            bool ok;
+            if (head.is("net")) {
+                ok = parseNetDeclaration();
+            } else if (head.is("segment") || head.is("arc")) {
+                ok = parseTrack();
+            } else if (head.is("net_class")) {
+                ok = parseNetClass();
+            } else {
+                ok = m_tokens.skipList();
+            }
+            if (!ok)
+                return m_errorMessage.isEmpty() ? failSyntax() : false;
+        }
+    }
+
+    const QVector<QVector<Segment>> &layers() const { return m_layers; }
+    const QVector<NetCenter> &nets() const { return m_nets; }
+    double clearance() const { return m_clearance >= 0 ? m_clearance : DEFAULT_CLEARANCE; }
+    QString errorMessage() const { return m_errorMessage; }
+
+private:
+    Tokenizer m_tokens;
+    double m_clearance;
+    QHash<QByteArray, int> m_netNumbers;  // Имя цепи -> номер
+    int m_nextNet;                        // Номер для цепи без объявления
+    QHash<QByteArray, int> m_layerIndices;
+    QVector<QVector<Segment>> m_layers;
+    QVector<NetCenter> m_nets;
+    QString m_errorMessage;
+
+    bool fail(const QString &message)
+    {
+        m_errorMessage = message;
+        return false;
+    }
+
+    bool failSyntax()
+    {
+        return fail(QObject::tr("Malformed board near line %1.").arg(m_tokens.line()));
+    }
+
+    // Числа в списке вида (start x y) или (width w); остаток списка пропускается
+    bool readValues(double *values, int count)
+    {
+        for (int i = 0; i < count; ++i) {
+            if (!parseDecimal(m_tokens.next(), &values[i]))
+                return false;
+        }
+        return m_tokens.skipList();
+    }
+
+    // (net 3 "GND")
+    bool parseNetDeclaration()
+    {
+        int number;
+        if (!parseInteger(m_tokens.next(), &number))
+            return false;
+        m_nextNet = std::max(m_nextNet, number + 1);
+        const Token name = m_tokens.next();
+        if (name.type == Token::Atom) {
+            m_netNumbers.insert(QByteArray(name.data, name.length), number);
+        } else if (name.type == Token::Close) {
+            return true;
+        }
+        return m_tokens.skipList();
+    }
+
+    // (net_class Default "описание" (clearance 0.2) ...)
+    bool parseNetClass()
+    {
+        while (true) {
+            const Token token = m_tokens.next();
+            if (token.type == Token::Close)
+                return true;
+            if (token.type == Token::Atom)
+                continue;
+            if (token.type != Token::Open)
+                return false;
+
+            const Token head = m_tokens.next();
+            if (head.is("clearance")) {
+                double clearance;
+                if (!readValues(&clearance, 1))
+                    return false;
+                m_clearance = std::max(m_clearance, clearance);
+            } else if (!m_tokens.skipList()) {
+                return false;
+            }
+        }
+    }
+
+    // (net 3) в файлах KiCad до 8-й версии, (net "GND") - в новых
+    int resolveNet(const Token &token)
+    {
+        int number;
+        if (parseInteger(token, &number))
+            return number;
+        if (token.type != Token::Atom)
+            return -1;
+
+        auto it = m_netNumbers.constFind(token.rawKey());
+        if (it != m_netNumbers.constEnd())
+            return it.value();
+
+        // Цепь без объявления получает следующий свободный номер
+        number = m_nextNet++;
+        m_netNumbers.insert(QByteArray(token.data, token.length), number);
+        return number;
+    }
+
+    int resolveLayer(const Token &token)
+    {
+        // Дорожки лежат только на медных слоях
+        if (token.type != Token::Atom || token.length < 3
+            || std::memcmp(token.data + token.length - 3, ".Cu", 3) != 0) {
+            return -1;
+        }
+
+        auto it = m_layerIndices.constFind(token.rawKey());
+        if (it != m_layerIndices.constEnd())
+            return it.value();
+
+        const int index = m_layers.size();
+        m_layerIndices.insert(QByteArray(token.data, token.length), index);
+        m_layers.append(QVector<Segment>());
+        return index;
+    }
+
+    // (segment (start x y) (end x y) (width w) (layer "F.Cu") (net 3) ...)
+    // (arc (start x y) (mid x y) (end x y) (width w) (layer "F.Cu") (net 3) ...)
+    bool parseTrack()
+    {
+        double start[2] = {0, 0};
+        double mid[2] = {0, 0};
+        double end[2] = {0, 0};
+        double width = 0;
+        bool hasMid = false;
+        int layer = -1;
+        int net = 0;
+
+        while (true) {
+            const Token token = m_tokens.next();
+            if (token.type == Token::Close)
+                break;
+            if (token.type == Token::Atom)
+                continue;  // Флаги вроде locked
+            if (token.type != Token::Open)
+                return false;
+
+            const Token head = m_tokens.next();
+            bool ok;
+            if (head.is("start")) {
+                ok = readValues(start, 2);
+            } else if (head.is("end")) {
+                ok = readValues(end, 2);
+            } else if (head.is("mid")) {
+                ok = readValues(mid, 2);
+                hasMid = true;
+            } else if (head.is("width")) {
+                ok = readValues(&width, 1);
+            } else if (head.is("layer")) {
+                layer = resolveLayer(m_tokens.next());
+                ok = m_tokens.skipList();
+            } else if (head.is("net")) {
+                net = resolveNet(m_tokens.next());
+                ok = m_tokens.skipList();
+            } else {
+                ok = m_tokens.skipList();
+            }
+            if (!ok)
+                return false;
+        }
+
+        // Дорожки без цепи ни с чем не конфликтуют
+        if (layer < 0 || net <= 0)
+            return true;
+        if (net >= MAX_NET)
+            return fail(QObject::tr("Net number %1 out of range near line %2.").arg(net).arg(m_tokens.line()));
+
+        if (hasMid) {
+            addArc(layer, net, width, start, mid, end);
+        } else {
+            addSegment(layer, net, width, start[0], start[1], end[0], end[1]);
+        }
+        return true;
+    }
+
+    // Дуга через start, mid и end заменяется хордами с прогибом не больше
+    // ARC_SAGITTA; ширина хорд увеличивается на прогиб, так что хорды
+    // покрывают медь дуги и проверка зазора не пропускает конфликтов
+    void addArc(int layer, int net, double width, const double *start, const double *mid, const double *end)
+    {
+        // Центр окружности через три точки
+        const double ax = start[0], ay = start[1];
+        const double bx = mid[0], by = mid[1];
+        const double cx = end[0], cy = end[1];
+        const double d = 2 * (ax * (by - cy) + bx * (cy - ay) + cx * (ay - by));
+        const double a2 = ax * ax + ay * ay;
+        const double b2 = bx * bx + by * by;
+        const double c2 = cx * cx + cy * cy;
+        const double scale = std::max({ std::abs(ax - bx), std::abs(ay - by), std::abs(cx - bx), std::abs(cy - by) });
+        if (std::abs(d) <= 1e-12 * std::max(scale * scale, 1e-12)) {
+            // Точки на одной прямой: дуга вырождена в отрезки
+            addSegment(layer, net, width, ax, ay, bx, by);
+            addSegment(layer, net, width, bx, by, cx, cy);
+            return;
+        }
+        const double ox = (a2 * (by - cy) + b2 * (cy - ay) + c2 * (ay - by)) / d;
+        const double oy = (a2 * (cx - bx) + b2 * (ax - cx) + c2 * (bx - ax)) / d;
+        const double radius = std::hypot(ax - ox, ay - oy);
+
+        // Угол дуги со знаком: от start к end через mid
+        const double twoPi = 2 * M_PI;
+        const double startAngle = std::atan2(ay - oy, ax - ox);
+        auto ccwFromStart = [&](double x, double y) {
+            return std::fmod(std::atan2(y - oy, x - ox) - startAngle + twoPi, twoPi);
+        };
+        const double endSweep = ccwFromStart(cx, cy);
+        const double sweep = ccwFromStart(bx, by) <= endSweep ? endSweep : endSweep - twoPi;
+
+        // Хорда с углом phi прогибается на radius * (1 - cos(phi / 2))
+        const double halfStep = std::acos(std::clamp(1 - ARC_SAGITTA / radius, -1.0, 1.0));
+        int chords = halfStep > 0 ? int(std::ceil(std::abs(sweep) / (2 * halfStep))) : MAX_ARC_CHORDS;
+        chords = std::clamp(chords, 2, MAX_ARC_CHORDS);
+        const double step = sweep / chords;
+        const double sagitta = radius * (1 - std::cos(step / 2));
+
+        double x = ax, y = ay;
+        for (int i = 1; i <= chords; ++i) {
+            double nx = cx, ny = cy;
+            if (i < chords) {
+                nx = ox + radius * std::cos(startAngle + step * i);
+                ny = oy + radius * std::sin(startAngle + step * i);
+            }
+            addSegment(layer, net, width + 2 * sagitta, x, y, nx, ny);
+            x = nx;
+            y = ny;
+        }
+    }
+
+    void addSegment(int layer, int net, double width, double x1, double y1, double x2, double y2)
+    {
+        Segment segment;
+        segment.x1 = x1;
+        segment.y1 = y1;
+        segment.x2 = x2;
+        segment.y2 = y2;
+        segment.halfWidth = width / 2;
+        segment.net = net;
+        m_layers[layer].append(segment);
+
+        if (net >= m_nets.size()) {
+            m_nets.resize(net + 1);
+        }
+        NetCenter &center = m_nets[net];
+        center.sumX += (x1 + x2) / 2;
+        center.sumY += (y1 + y2) / 2;
+        center.count++;
+    }
+};
+
+double pointSegmentDistanceSquared(double px, double py, const Segment &segment)
+{
+    const double dx = segment.x2 - segment.x1;
+    const double dy = segment.y2 - segment.y1;
+    const double lengthSquared = dx * dx + dy * dy;
+    double t = 0;
+    if (lengthSquared > 0) {
+        t = std::clamp(((px - segment.x1) * dx + (py - segment.y1) * dy) / lengthSquared, 0.0, 1.0);
+    }
+    const double ex = segment.x1 + t * dx - px;
+    const double ey = segment.y1 + t * dy - py;
+    return ex * ex + ey * ey;
+}
+
+double cross(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+double segmentDistanceSquared(const Segment &a, const Segment &b)
+{
+    // Пересекающиеся оси дорожек
+    const double d1 = cross(a.x1, a.y1, a.x2, a.y2, b.x1, b.y1);
+    const double d2 = cross(a.x1, a.y1, a.x2, a.y2, b.x2, b.y2);
+    const double d3 = cross(b.x1, b.y1, b.x2, b.y2, a.x1, a.y1);
+    const double d4 = cross(b.x1, b.y1, b.x2, b.y2, a.x2, a.y2);
+    if (((d1 < 0 && d2 > 0) || (d1 > 0 && d2 < 0)) && ((d3 < 0 && d4 > 0) || (d3 > 0 && d4 < 0)))
+        return 0;
+
+    return std::min(std::min(pointSegmentDistanceSquared(a.x1, a.y1, b), pointSegmentDistanceSquared(a.x2, a.y2, b)),
+                    std::min(pointSegmentDistanceSquared(b.x1, b.y1, a), pointSegmentDistanceSquared(b.x2, b.y2, a)));
+}
+
+quint64 netPairKey(int a, int b)
+{
+    return (quint64(quint32(std::min(a, b))) << 32) | quint32(std::max(a, b));
+}
+
+// Пары конфликтующих цепей одного слоя без повторов. Сегменты
+// раскладываются по равномерной сетке (списки ячеек в виде CSR), с
+// прямоугольником, расширенным на половину ширины и половину зазора:
+// у конфликтующих сегментов такие прямоугольники пересекаются. Пара
+// проверяется только в ячейке, где лежит угол пересечения прямоугольников,
+// поэтому каждая пара рассматривается один раз.
+QVector<quint64> layerConflicts(const QVector<Segment> &segments, double clearance)
+{
+    QVector<quint64> keys;
+    const int count = segments.size();
+    if (count < 2)
+        return keys;
+
+    struct Box
+    {
+        double left, top, right, bottom;
+    };
+    QVector<Box> boxes(count);
+    double minX = 0, minY = 0, maxX = 0, maxY = 0;
+    double extentSum = 0;
+    for (int i = 0; i < count; ++i) {
+        const Segment &segment = segments[i];
+        const double margin = segment.halfWidth + clearance / 2;
+        Box &box = boxes[i];
+        box.left = std::min(segment.x1, segment.x2) - margin;
+        box.right = std::max(segment.x1, segment.x2) + margin;
+        box.top = std::min(segment.y1, segment.y2) - margin;
+        box.bottom = std::max(segment.y1, segment.y2) + margin;
+        if (i == 0) {
+            minX = box.left;
+            maxX = box.right;
+            minY = box.top;
+            maxY = box.bottom;
+        } else {
+            minX = std::min(minX, box.left);
+            maxX = std::max(maxX, box.right);
+            minY = std::min(minY, box.top);
+            maxY = std::max(maxY, box.bottom);
+        }
+        extentSum += std::max(box.right - box.left, box.bottom - box.top);
+    }
+
+    // Ячейка порядка среднего размера сегмента, но ячеек не больше
+    // CELLS_PER_SEGMENT на сегмент
+    const double width = std::max(maxX - minX, 1e-9);
+    const double height = std::max(maxY - minY, 1e-9);
+    double cellSize = std::max(extentSum / count, 1e-9);
+    const double cellLimit = double(CELLS_PER_SEGMENT) * count;
+    if ((width / cellSize + 1) * (height / cellSize + 1) > cellLimit) {
+        cellSize = std::max(cellSize, std::sqrt(width * height / cellLimit));
+        while ((width / cellSize + 1) * (height / cellSize + 1) > cellLimit) {
+            cellSize *= 1.5;
+        }
+    }
+    const int columns = int(width / cellSize) + 1;
+    const int rows = int(height / cellSize) + 1;
+    auto column = [&](double x) { return std::clamp(int((x - minX) / cellSize), 0, columns - 1); };
+    auto row = [&](double y) { return std::clamp(int((y - minY) / cellSize), 0, rows - 1); };
+
+    // Подсчёт, смещения и раскладка сегментов по ячейкам
+    QVector<int> offsets(columns * rows + 1, 0);
+    for (const Box &box : std::as_const(boxes)) {
+        for (int y = row(box.top); y <= row(box.bottom); ++y) {
+            for (int x = column(box.left); x <= column(box.right); ++x) {
+                offsets[y * columns + x + 1]++;
+            }
+        }
+    }
+    for (int cell = 0; cell < columns * rows; ++cell) {
+        offsets[cell + 1] += offsets[cell];
+    }
+    QVector<int> items(offsets.last());
+    QVector<int> cursor(offsets.constBegin(), offsets.constEnd() - 1);
+    for (int i = 0; i < count; ++i) {
+        const Box &box = boxes[i];
+        for (int y = row(box.top); y <= row(box.bottom); ++y) {
+            for (int x = column(box.left); x <= column(box.right); ++x) {
+                items[cursor[y * columns + x]++] = i;
+            }
+        }
+    }
+
+    for (int cell = 0; cell < columns * rows; ++cell) {
+        for (int p = offsets[cell]; p < offsets[cell + 1]; ++p) {
+            const int i = items[p];
+            const Segment &a = segments[i];
+            const Box &boxA = boxes[i];
+            for (int q = p + 1; q < offsets[cell + 1]; ++q) {
+                const int j = items[q];
+                const Segment &b = segments[j];
+                if (a.net == b.net)
+                    continue;
+
+                const Box &boxB = boxes[j];
+                const double left = std::max(boxA.left, boxB.left);
+                const double top = std::max(boxA.top, boxB.top);
+                if (left > std::min(boxA.right, boxB.right) || top > std::min(boxA.bottom, boxB.bottom))
+                    continue;
+                if (row(top) * columns + column(left) != cell)
+                    continue;
+
+                const double reach = a.halfWidth + b.halfWidth + clearance;
+                if (segmentDistanceSquared(a, b) < reach * reach) {
+                    keys.append(netPairKey(a.net, b.net));
+                }
+            }
+        }
+    }
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+bool buildConflictGraph(const char *begin, const char *end, GraphSnapshot *snapshot, QString *errorMessage)
+{
+    BoardParser parser(begin, end);
+    {
+        PROFILE_SCOPE("kicad.parse");
+        if (!parser.parse()) {
+            if (errorMessage) {
+                *errorMessage = parser.errorMessage();
+            }
+            return false;
+        }
+    }
+
+    const QVector<QVector<Segment>> &layers = parser.layers();
+    qint64 segmentCount = 0;
+    for (const QVector<Segment> &segments : layers) {
+        segmentCount += segments.size();
+    }
+    MemoryReservation segmentBuffer(MemoryTracker::Algorithm,
+                                    segmentCount * qint64(sizeof(Segment) + 4 * sizeof(double) + 2 * sizeof(int)));
+
+    // Слои независимы и обрабатываются параллельно
+    QVector<quint64> keys;
+    {
+        PROFILE_SCOPE("kicad.conflicts");
+        QVector<QVector<quint64>> layerKeys(layers.size());
+        const double clearance = parser.clearance();
+        parallelFor(layers.size(), [&](int layer) {
+            layerKeys[layer] = layerConflicts(layers[layer], clearance);
+        });
+
+        for (const QVector<quint64> &part : std::as_const(layerKeys)) {
+            keys += part;
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    }
+
+    const QVector<NetCenter> &nets = parser.nets();
+    snapshot->vertices.clear();
+    for (int net = 0; net < nets.size(); ++net) {
+        const NetCenter &center = nets[net];
+        if (center.count == 0)
+            continue;
+        GraphSnapshot::VertexRecord record;
+        record.id = net;
+        record.x = center.sumX / center.count * SCENE_SCALE;
+        record.y = center.sumY / center.count * SCENE_SCALE;
+        record.colorIndex = -1;
+        record.locked = false;
+        snapshot->vertices.append(record);
+    }
+
+    snapshot->edges.clear();
+    snapshot->edges.reserve(keys.size());
+    for (quint64 key : std::as_const(keys)) {
+        GraphSnapshot::EdgeRecord record;
+        record.sourceId = int(key >> 32);
+        record.destId = int(key & 0xFFFFFFFFu);
+        snapshot->edges.append(record);
+    }
+    snapshot->maxColor = 0;
+    return true;
+}
+
+} // namespace
+
+bool KicadBoard::read(QIODevice *device, GraphSnapshot *snapshot, QString *errorMessage)
+{
+    // Файл отображается в память целиком, прочие устройства читаются в буфер
+    QFile *file = qobject_cast<QFile *>(device);
+    if (file && file->size() > 0) {
+        const qint64 size = file->size();
+        uchar *mapped = file->map(0, size);
+        if (mapped) {
+#ifdef Q_OS_UNIX
+            // Файл читается один раз от начала до конца
+            posix_madvise(mapped, size_t(size), POSIX_MADV_SEQUENTIAL);
+#endif
+            const char *begin = reinterpret_cast<const char *>(mapped);
+            const bool ok = buildConflictGraph(begin, begin + size, snapshot, errorMessage);
+            file->unmap(mapped);
+            return ok;
+        }
+    }
+
+    const QByteArray data = device->readAll();
+    MemoryReservation dataBuffer(MemoryTracker::IoBuffers, data.size());
+    return buildConflictGraph(data.constData(), data.constData() + data.size(), snapshot, errorMessage);
+}
+
+bool KicadBoard::probe(QIODevice *device)
+{
+    const QByteArray head = device->peek(64);
+    int pos = 0;
+    while (pos < head.size() && isSpace(head[pos])) {
+        pos++;
+    }
+    return head.mid(pos).startsWith("(kicad_pcb");
+}
@@ -0,0 +1,30 @@
+#ifndef KICADBOARD_H
+#define KICADBOARD_H
+
+#include <QIODevice>
+#include <QString>
+#include "graphsnapshot.h"
+
+// Класс KicadBoard импортирует печатную плату KiCad (.kicad_pcb) как граф
+// конфликтов цепей: вершина - цепь, у которой есть дорожки, ребро - пара
+// цепей, дорожки которых на одном медном слое пересекаются или проходят
+// ближе зазора. Идентификатор вершины - номер цепи на плате, позиция -
+// центр её дорожек.
+// S-выражения разбираются потоково: файл отображается в память, лексемы
+// ссылаются прямо на отображение, ненужные списки (посадочные места,
+// полигоны) пропускаются сканированием скобок. Учитываются сегменты и дуги
+// дорожек; площадки и переходные отверстия в граф не попадают. Зазор
+// берётся из классов цепей платы (старые версии формата), иначе 0.2 мм.
+// Слои обрабатываются параллельно.
+class KicadBoard
+{
+public:
+    static bool read(QIODevice *device, GraphSnapshot *snapshot, QString *errorMessage = nullptr);
+
+    // Начинается ли содержимое с "(kicad_pcb"
+    static bool probe(QIODevice *device);
+
+    static const char *suffix() { return "kicad_pcb"; }
+};
+
+#endif // KICADBOARD_H
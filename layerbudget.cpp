@@ -0,0 +1,285 @@
+#include "layerbudget.h"
+#include "memorystats.h"
+#include "profiler.h"
+#include <QElapsedTimer>
+#include <QObject>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+constexpr int DEFAULT_TIME_LIMIT = 1000;
+// Время проверяется раз в столько шагов
+constexpr int TIME_CHECK_INTERVAL = 1024;
+// Случайный ход делается в среднем раз в столько шагов
+constexpr int RANDOM_WALK_PERIOD = 20;
+// Срок запрета возврата к прежнему цвету: доля числа конфликтных
+// вершин плюс случайная добавка (как в Tabucol)
+constexpr double TABU_FACTOR = 0.6;
+constexpr int TABU_RANDOM = 10;
+// Поиск прекращается, если лучший результат долго не улучшается
+constexpr qint64 STALL_STEPS_PER_VERTEX = 50;
+constexpr qint64 MIN_STALL_STEPS = 100000;
+
+} // namespace
+
+LayerBudgetSolver::LayerBudgetSolver(const Adjacency &adjacency, int layerCount)
+    : m_adjacency(adjacency), m_layerCount(layerCount), m_timeLimit(DEFAULT_TIME_LIMIT),
+    m_seed(1), m_conflictCount(0), m_stepCount(0)
+{
+}
+
+bool LayerBudgetSolver::solve(QString *errorMessage)
+{
+    PROFILE_SCOPE("engine.layerBudget");
+
+    auto fail = [errorMessage](const QString &message) {
+        if (errorMessage) {
+            *errorMessage = message;
+        }
+        return false;
+    };
+
+    const int vertexCount = m_adjacency.vertexCount();
+    if (m_layerCount < 1)
+        return fail(QObject::tr("The layer budget must be at least one layer."));
+
+    if (m_lockedColors.isEmpty()) {
+        m_lockedColors.fill(-1, vertexCount);
+    }
+    if (m_lockedColors.size() != vertexCount)
+        return fail(QObject::tr("Locked layers do not match the graph."));
+
+    for (int color : m_lockedColors) {
+        if (color >= m_layerCount)
+            return fail(QObject::tr("A vertex is locked to layer %1, but only %2 layers are available.")
+                            .arg(color).arg(m_layerCount));
+    }
+
+    // Пять массивов по числу вершин и счётчики цветов
+    MemoryReservation buffers(MemoryTracker::Algorithm,
+                              qint64(5 * vertexCount + m_layerCount) * qint64(sizeof(int)));
+
+    m_stepCount = 0;
+    buildInitial();
+    countConflicts();
+    search();
+    return true;
+}
+
+QVector<QPair<int, int>> LayerBudgetSolver::conflictEdges() const
+{
+    QVector<QPair<int, int>> edges;
+    for (int v = 0; v < m_colors.size(); ++v) {
+        if (m_sameColor[v] == 0)
+            continue;
+        for (const int *n = m_adjacency.neighborsBegin(v); n != m_adjacency.neighborsEnd(v); ++n) {
+            if (*n > v && m_colors[*n] == m_colors[v]) {
+                edges.append(qMakePair(v, *n));
+            }
+        }
+    }
+    return edges;
+}
+
+void LayerBudgetSolver::buildInitial()
+{
+    const int vertexCount = m_adjacency.vertexCount();
+
+    // Закреплённые вершины получают свой цвет заранее
+    m_colors = m_lockedColors;
+    m_neighborColors.fill(0, m_layerCount);
+
+    // Остальные - в порядке убывания степени, цвет с наименьшим числом
+    // уже раскрашенных соседей (при равенстве - меньший номер)
+    QVector<int> order;
+    order.reserve(vertexCount);
+    for (int v = 0; v < vertexCount; ++v) {
+        if (m_lockedColors[v] < 0) {
+            order.append(v);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return m_adjacency.degree(a) > m_adjacency.degree(b);
+    });
+
+    for (int vertex : order) {
+        countNeighborColors(vertex);
+        const int *counts = m_neighborColors.constData();
+        m_colors[vertex] = int(std::min_element(counts, counts + m_layerCount) - counts);
+    }
+}
+
+void LayerBudgetSolver::countConflicts()
+{
+    const int vertexCount = m_adjacency.vertexCount();
+    m_sameColor.fill(0, vertexCount);
+    m_conflictedPos.fill(-1, vertexCount);
+    m_conflicted.clear();
+
+    int sum = 0;
+    for (int v = 0; v < vertexCount; ++v) {
+        for (const int *n = m_adjacency.neighborsBegin(v); n != m_adjacency.neighborsEnd(v); ++n) {
+            if (m_colors[*n] == m_colors[v]) {
+                m_sameColor[v]++;
+            }
+        }
+        sum += m_sameColor[v];
+        updateConflicted(v);
+    }
+    m_conflictCount = sum / 2;
+}
+
+void LayerBudgetSolver::search()
+{
+    // С одним слоем ходов нет: раскраска единственна
+    if (m_layerCount < 2 || m_conflicted.isEmpty())
+        return;
+
+    const int vertexCount = m_adjacency.vertexCount();
+    QRandomGenerator random(m_seed);
+    QElapsedTimer timer;
+    timer.start();
+
+    // Запрещённый цвет вершины и шаг, до которого действует запрет
+    QVector<int> tabuColor(vertexCount, -1);
+    QVector<qint64> tabuUntil(vertexCount, 0);
+
+    // Лучшее состояние восстанавливается откатом ходов, сделанных после него.
+    // Если журнал становится длиннее числа вершин, лучшее состояние
+    // копируется целиком и журнал больше не ведётся до следующего улучшения.
+    QVector<QPair<int, int>> undoLog;
+    QVector<int> bestColors;
+    bool bestCopied = false;
+    int bestConflicts = m_conflictCount;
+    qint64 lastImprovement = 0;
+    const qint64 stallLimit = std::max(MIN_STALL_STEPS, STALL_STEPS_PER_VERTEX * vertexCount);
+
+    while (!m_conflicted.isEmpty() && m_stepCount - lastImprovement < stallLimit) {
+        if (m_stepCount % TIME_CHECK_INTERVAL == 0 && timer.elapsed() >= m_timeLimit)
+            break;
+        m_stepCount++;
+
+        const int vertex = m_conflicted[int(random.bounded(quint32(m_conflicted.size())))];
+        const int current = m_colors[vertex];
+        countNeighborColors(vertex);
+
+        int color = -1;
+        if (random.bounded(RANDOM_WALK_PERIOD) == 0) {
+            // Случайный ход выводит поиск с плато
+            color = int(random.bounded(quint32(m_layerCount - 1)));
+            if (color >= current) {
+                color++;
+            }
+        } else {
+            // Лучший незапрещённый цвет; запрет снимается, если ход даёт
+            // новый лучший результат. Равные варианты выбираются случайно.
+            int bestDelta = INT_MAX;
+            int ties = 0;
+            for (int c = 0; c < m_layerCount; ++c) {
+                if (c == current)
+                    continue;
+                const int delta = m_neighborColors[c] - m_neighborColors[current];
+                const bool tabu = tabuColor[vertex] == c && tabuUntil[vertex] > m_stepCount;
+                if (tabu && m_conflictCount + delta >= bestConflicts)
+                    continue;
+                if (delta < bestDelta) {
+                    bestDelta = delta;
+                    color = c;
+                    ties = 1;
+                } else if (delta == bestDelta && random.bounded(++ties) == 0) {
+                    color = c;
+                }
+            }
+        }
+        if (color < 0)
+            continue;
+
+        if (!bestCopied) {
+            undoLog.append(qMakePair(vertex, current));
+        }
+        tabuColor[vertex] = current;
+        tabuUntil[vertex] = m_stepCount + qint64(TABU_FACTOR * m_conflicted.size())
+                            + random.bounded(TABU_RANDOM);
+        moveVertex(vertex, color);
+
+        if (m_conflictCount < bestConflicts) {
+            bestConflicts = m_conflictCount;
+            lastImprovement = m_stepCount;
+            undoLog.clear();
+            bestCopied = false;
+        } else if (!bestCopied && undoLog.size() > vertexCount) {
+            bestColors = m_colors;
+            for (int i = undoLog.size() - 1; i >= 0; --i) {
+                bestColors[undoLog[i].first] = undoLog[i].second;
+            }
+            undoLog.clear();
+            bestCopied = true;
+        }
+    }
+
+    if (m_conflictCount > bestConflicts) {
+        if (bestCopied) {
+            m_colors = bestColors;
+        } else {
+            for (int i = undoLog.size() - 1; i >= 0; --i) {
+                m_colors[undoLog[i].first] = undoLog[i].second;
+            }
+        }
+        countConflicts();
+    }
+}
+
+void LayerBudgetSolver::countNeighborColors(int vertex)
+{
+    std::fill(m_neighborColors.begin(), m_neighborColors.end(), 0);
+    for (const int *n = m_adjacency.neighborsBegin(vertex); n != m_adjacency.neighborsEnd(vertex); ++n) {
+        const int color = m_colors[*n];
+        if (color >= 0) {
+            m_neighborColors[color]++;
+        }
+    }
+}
+
+void LayerBudgetSolver::moveVertex(int vertex, int color)
+{
+    const int previous = m_colors[vertex];
+    for (const int *n = m_adjacency.neighborsBegin(vertex); n != m_adjacency.neighborsEnd(vertex); ++n) {
+        const int neighbor = *n;
+        if (m_colors[neighbor] == previous) {
+            m_sameColor[neighbor]--;
+            m_sameColor[vertex]--;
+            m_conflictCount--;
+            updateConflicted(neighbor);
+        } else if (m_colors[neighbor] == color) {
+            m_sameColor[neighbor]++;
+            m_sameColor[vertex]++;
+            m_conflictCount++;
+            updateConflicted(neighbor);
+        }
+    }
+    m_colors[vertex] = color;
+    updateConflicted(vertex);
+}
+
+void LayerBudgetSolver::updateConflicted(int vertex)
+{
+    // Закреплённые вершины не перекрашиваются и в выборку не попадают
+    if (m_lockedColors[vertex] >= 0)
+        return;
+
+    const bool conflicted = m_sameColor[vertex] > 0;
+    const int position = m_conflictedPos[vertex];
+    if (conflicted && position < 0) {
+        m_conflictedPos[vertex] = m_conflicted.size();
+        m_conflicted.append(vertex);
+    } else if (!conflicted && position >= 0) {
+        // Последний элемент переносится на место удаляемого
+        const int last = m_conflicted.last();
+        m_conflicted[position] = last;
+        m_conflictedPos[last] = position;
+        m_conflicted.removeLast();
+        m_conflictedPos[vertex] = -1;
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef LAYERBUDGET_H
+#define LAYERBUDGET_H
+
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include "coloringengine.h"
+
+// Класс LayerBudgetSolver раскрашивает граф не более чем в заданное число
+// цветов (сигнальных слоёв платы). Часть вершин может быть закреплена за
+// слоем. Начальная раскраска строится жадно, затем локальный поиск
+// min-conflicts с табу-списком уменьшает число рёбер с одинаково
+// раскрашенными концами. Если слоёв не хватает, остающиеся конфликты
+// возвращаются для ручного исправления. Шаг поиска стоит O(deg + k).
+class LayerBudgetSolver
+{
+public:
+    LayerBudgetSolver(const Adjacency &adjacency, int layerCount);
+
+    // lockedColors[v] - закреплённый цвет вершины v или -1
+    void setLockedColors(const QVector<int> &lockedColors) { m_lockedColors = lockedColors; }
+
+    // Ограничение времени локального поиска
+    void setTimeLimit(int milliseconds) { m_timeLimit = milliseconds; }
+    void setSeed(quint32 seed) { m_seed = seed; }
+
+    // false, если бюджет меньше одного слоя или закреплённый цвет вне бюджета
+    bool solve(QString *errorMessage = nullptr);
+
+    const QVector<int> &colors() const { return m_colors; }
+    int conflictCount() const { return m_conflictCount; }
+    qint64 stepCount() const { return m_stepCount; }
+
+    // Рёбра с одинаково раскрашенными концами (пары номеров вершин)
+    QVector<QPair<int, int>> conflictEdges() const;
+
+private:
+    Adjacency m_adjacency;
+    int m_layerCount;
+    QVector<int> m_lockedColors;
+    int m_timeLimit;
+    quint32 m_seed;
+
+    QVector<int> m_colors;
+    QVector<int> m_sameColor;      // Число соседей того же цвета
+    QVector<int> m_conflicted;     // Незакреплённые вершины с конфликтами
+    QVector<int> m_conflictedPos;  // Позиция вершины в m_conflicted или -1
+    QVector<int> m_neighborColors; // Число соседей каждого цвета у текущей вершины
+    int m_conflictCount;
+    qint64 m_stepCount;
+
+    void buildInitial();
+    void search();
+    void countConflicts();
+    void countNeighborColors(int vertex);
+    void moveVertex(int vertex, int color);
+    void updateConflicted(int vertex);
+};
+
+#endif // LAYERBUDGET_H
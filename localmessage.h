@@ -0,0 +1,78 @@
+#ifndef LOCALMESSAGE_H
+#define LOCALMESSAGE_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QLocalSocket>
+#include <QtEndian>
+
+// Сообщения между процессами через QLocalSocket: длина (quint32, big-endian)
+// и данные QDataStream. Используются распределённой раскраской и службой
+// раскраски. Функции блокирующие, timeout - на каждое ожидание сокета.
+namespace LocalMessage {
+
+const int HEADER_SIZE = int(sizeof(quint32));
+
+inline bool write(QLocalSocket *socket, const QByteArray &payload, int timeout)
+{
+    const quint32 length = qToBigEndian(quint32(payload.size()));
+    if (socket->write(reinterpret_cast<const char *>(&length), sizeof(length)) != sizeof(length)
+        || socket->write(payload) != payload.size())
+        return false;
+    while (socket->bytesToWrite() > 0) {
+        if (!socket->waitForBytesWritten(timeout))
+            return false;
+    }
+    return true;
+}
+
+inline bool read(QLocalSocket *socket, QByteArray *payload, int timeout)
+{
+    while (socket->bytesAvailable() < qint64(sizeof(quint32))) {
+        if (!socket->waitForReadyRead(timeout))
+            return false;
+    }
+    quint32 length;
+    socket->read(reinterpret_cast<char *>(&length), sizeof(length));
+    length = qFromBigEndian(length);
+
+    while (socket->bytesAvailable() < qint64(length)) {
+        if (!socket->waitForReadyRead(timeout))
+            return false;
+    }
+    *payload = socket->read(length);
+    return true;
+}
+
+// Кадр для неблокирующей отправки: заголовок и данные одним буфером
+inline QByteArray frame(const QByteArray &payload)
+{
+    QByteArray data;
+    data.reserve(HEADER_SIZE + payload.size());
+    const quint32 length = qToBigEndian(quint32(payload.size()));
+    data.append(reinterpret_cast<const char *>(&length), sizeof(length));
+    data.append(payload);
+    return data;
+}
+
+// Длина данных кадра в начале buffer или -1, если заголовок ещё не пришёл
+inline qint64 peekLength(const QByteArray &buffer, int offset)
+{
+    if (buffer.size() - offset < HEADER_SIZE)
+        return -1;
+    return qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(buffer.constData() + offset));
+}
+
+template <typename Function>
+QByteArray encode(Function write)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_12);
+    write(stream);
+    return payload;
+}
+
+} // namespace LocalMessage
+
+#endif // LOCALMESSAGE_H
@@ -1,9 +1,17 @@
 #include "mainwindow.h"
+#include "console.h"
 
 #include <QApplication>
+#include <QCoreApplication>
 
 int main(int argc, char *argv[])
 {
+    // Консольные режимы не создают окон и работают без дисплея
+    if (Console::isConsoleCommand(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        return Console::run(app.arguments());
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
@@ -15,10 +15,29 @@
 #include <QJsonObject>
 #include <QCloseEvent>
 #include <QFileInfo>
+#include <QMenu>
+#include <QMenuBar>
+#include <QTimer>
+#include <QInputDialog>
+#include <QProgressBar>
+#include <QActionGroup>
+#include <algorithm>
+#include "graphfile.h"
+#include "graphwriter.h"
+#include "dimacs.h"
+#include "graphsnapshot.h"
+#include "profiler.h"
+#include "memorystats.h"
+#include "coloringcache.h"
+
+// Интервал расширения сцены по ходу загрузки
+constexpr int LOAD_FIT_INTERVAL_MS = 250;
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
+    , m_layerBudget(2)
+    , m_portfolioDeadline(2000)
 {
     ui->setupUi(this);
 
@@ -27,6 +46,75 @@ MainWindow::MainWindow(QWidget *parent)
     m_graphWidget = new GraphWidget(this);
     m_graphWidget->setGraph(m_graph);
 
+    // История изменений для отмены/повтора
+    m_history = new GraphHistory(m_graph, this);
+
+    // Фоновое автосохранение в журнал рядом с документом
+    m_autosave = new AutosaveJournal(m_graph, this);
+    connect(m_autosave, &AutosaveJournal::writeFailed, this, [this](const QString &message) {
+        statusBar()->showMessage(message);
+    });
+
+    // Силовая раскладка в фоновом потоке
+    m_autoLayout = new AutoLayout(m_graph, this);
+    connect(m_autoLayout, &AutoLayout::progress, this, [this](int percent) {
+        m_graphWidget->fitSceneToGraph();
+        statusBar()->showMessage(tr("Auto layout: %1%").arg(percent));
+    });
+    connect(m_autoLayout, &AutoLayout::finished, this, [this]() {
+        m_graphWidget->fitSceneToGraph();
+        m_graphWidget->fitInView(m_graphWidget->sceneRect(), Qt::KeepAspectRatio);
+        m_autoLayoutAction->setText(tr("Auto Layout"));
+        statusBar()->showMessage(tr("Auto layout finished"));
+    });
+
+    // Гонка алгоритмов раскраски в фоновом потоке; кнопка Color Graph
+    // на время гонки её отменяет
+    m_backgroundColoring = new BackgroundColoring(m_graph, this);
+    connect(m_backgroundColoring, &BackgroundColoring::started, this, [this]() {
+        ui->btnColorGraph->setText(tr("Stop Coloring"));
+        statusBar()->showMessage(tr("Racing coloring engines for up to %1 ms...")
+                                     .arg(m_graph->portfolioDeadline()));
+    });
+    connect(m_backgroundColoring, &BackgroundColoring::finished, this, [this](bool applied) {
+        ui->btnColorGraph->setText(tr("Color Graph"));
+        if (applied) {
+            showCacheHits();
+        } else {
+            statusBar()->showMessage(tr("Coloring cancelled"));
+        }
+    });
+
+    // Загрузка файлов по частям в фоновом потоке
+    m_loader = new GraphLoader(m_graph, this);
+    connect(m_loader, &GraphLoader::progress, this, &MainWindow::handleLoadProgress);
+    connect(m_loader, &GraphLoader::finished, this, &MainWindow::handleLoadFinished);
+    connect(m_loader, &GraphLoader::failed, this, &MainWindow::handleLoadFailed);
+    connect(m_loader, &GraphLoader::cancelled, this, &MainWindow::handleLoadCancelled);
+
+    // Перечитывание документа при его изменении другой программой
+    m_watcher = new GraphWatcher(m_graph, this);
+    connect(m_watcher, &GraphWatcher::reloaded, this, &MainWindow::handleGraphReloaded);
+    connect(m_watcher, &GraphWatcher::reloadFailed, this, [this](const QString &message) {
+        statusBar()->showMessage(message);
+    });
+
+    m_loadProgress = new QProgressBar(this);
+    m_loadProgress->setRange(0, 100);
+    m_loadProgress->setMaximumWidth(200);
+    m_loadProgress->hide();
+    statusBar()->addPermanentWidget(m_loadProgress);
+    m_cancelLoadButton = new QPushButton(tr("Cancel"), this);
+    m_cancelLoadButton->hide();
+    connect(m_cancelLoadButton, &QPushButton::clicked, m_loader, &GraphLoader::cancel);
+    statusBar()->addPermanentWidget(m_cancelLoadButton);
+
+    // Панель статистики (скрыта по умолчанию)
+    m_statsPanel = new StatsPanel(this);
+    m_statsPanel->setGraphWidget(m_graphWidget);
+    addDockWidget(Qt::RightDockWidgetArea, m_statsPanel);
+    m_statsPanel->hide();
+
     // Создаем действия
     createActions();
 
@@ -48,6 +136,9 @@ MainWindow::MainWindow(QWidget *parent)
 
     // Устанавливаем заголовок по умолчанию
     setCurrentFile("");
+
+    // Предлагаем восстановить несохранённую работу после сбоя
+    QTimer::singleShot(0, this, [this]() { offerRecovery(""); });
 }
 
 MainWindow::~MainWindow()
@@ -58,6 +149,8 @@ MainWindow::~MainWindow()
 void MainWindow::closeEvent(QCloseEvent *event)
 {
     if (maybeSave()) {
+        // Выход штатный: данные для восстановления больше не нужны
+        m_autosave->markClean();
         event->accept();
     } else {
         event->ignore();
@@ -72,6 +165,146 @@ void MainWindow::createActions()
     ui->actionSave->setShortcut(QKeySequence::Save);
     ui->actionSaveAs->setShortcut(QKeySequence::SaveAs);
     ui->actionExit->setShortcut(QKeySequence::Quit);
+
+    // Наблюдение за файлом, который перезаписывает трассировщик
+    QAction *watchAction = new QAction(tr("Watch File for Changes"), this);
+    watchAction->setCheckable(true);
+    connect(watchAction, &QAction::toggled, this, [this](bool checked) {
+        m_watcher->setEnabled(checked);
+        if (checked && m_currentFilePath.isEmpty()) {
+            statusBar()->showMessage(tr("The graph will be watched once it is saved or opened"));
+        }
+    });
+    ui->menuFile->insertAction(ui->actionExit, watchAction);
+    ui->menuFile->insertSeparator(ui->actionExit);
+
+    // Меню Edit с действиями отмены и повтора
+    QMenu *editMenu = new QMenu(tr("Edit"), this);
+    m_editMenu = editMenu;
+    QAction *undoAction = m_history->undoStack()->createUndoAction(this, tr("Undo"));
+    undoAction->setShortcut(QKeySequence::Undo);
+    QAction *redoAction = m_history->undoStack()->createRedoAction(this, tr("Redo"));
+    redoAction->setShortcut(QKeySequence::Redo);
+    editMenu->addAction(undoAction);
+    editMenu->addAction(redoAction);
+    menuBar()->insertMenu(ui->menuHelp->menuAction(), editMenu);
+
+    // Меню View с раскладкой и панелью статистики
+    QMenu *viewMenu = new QMenu(tr("View"), this);
+    m_autoLayoutAction = new QAction(tr("Auto Layout"), this);
+    m_autoLayoutAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_L));
+    connect(m_autoLayoutAction, &QAction::triggered, this, &MainWindow::handleAutoLayoutTriggered);
+    viewMenu->addAction(m_autoLayoutAction);
+    // Для больших плат: элементы сцены только для видимой области
+    QAction *virtualizedAction = viewMenu->addAction(tr("Virtualized Scene"));
+    virtualizedAction->setCheckable(true);
+    connect(virtualizedAction, &QAction::toggled, this, [this](bool checked) {
+        m_graphWidget->setVirtualized(checked);
+        statusBar()->showMessage(checked ? tr("Scene items are created for the visible area only")
+                                         : tr("Scene items are created for the whole graph"));
+    });
+    // Замер кадров отрисовки: по нему выбирается режим обновления viewport
+    QMenu *updateModeMenu = viewMenu->addMenu(tr("Viewport Update Mode"));
+    QActionGroup *updateModeGroup = new QActionGroup(this);
+    const QList<QPair<QString, QGraphicsView::ViewportUpdateMode>> updateModes = {
+        { tr("Full"), QGraphicsView::FullViewportUpdate },
+        { tr("Minimal"), QGraphicsView::MinimalViewportUpdate },
+        { tr("Smart"), QGraphicsView::SmartViewportUpdate },
+        { tr("Bounding Rectangle"), QGraphicsView::BoundingRectViewportUpdate },
+    };
+    for (const auto &updateMode : updateModes) {
+        QAction *action = updateModeMenu->addAction(updateMode.first);
+        action->setCheckable(true);
+        action->setChecked(m_graphWidget->viewportUpdateMode() == updateMode.second);
+        updateModeGroup->addAction(action);
+        const QGraphicsView::ViewportUpdateMode mode = updateMode.second;
+        connect(action, &QAction::triggered, this, [this, mode]() {
+            m_graphWidget->setUpdateMode(mode);
+        });
+    }
+    QAction *frameOverlayAction = viewMenu->addAction(tr("Frame Statistics Overlay"));
+    frameOverlayAction->setCheckable(true);
+    connect(frameOverlayAction, &QAction::toggled, m_graphWidget, &GraphWidget::setFrameOverlayVisible);
+    QAction *frameLogAction = viewMenu->addAction(tr("Log Frame Times..."));
+    frameLogAction->setCheckable(true);
+    connect(frameLogAction, &QAction::toggled, this, [this, frameLogAction](bool checked) {
+        if (!checked) {
+            m_graphWidget->setFrameLogPath(QString());
+            return;
+        }
+        const QString filePath = QFileDialog::getSaveFileName(this, tr("Log Frame Times"), QString(),
+                                                              tr("CSV Files (*.csv)"));
+        QString errorMessage;
+        if (filePath.isEmpty() || !m_graphWidget->setFrameLogPath(filePath, &errorMessage)) {
+            if (!filePath.isEmpty()) {
+                QMessageBox::warning(this, tr("Error"),
+                                     tr("Cannot write file %1:\n%2.").arg(filePath).arg(errorMessage));
+            }
+            QSignalBlocker blocker(frameLogAction);
+            frameLogAction->setChecked(false);
+            return;
+        }
+        statusBar()->showMessage(tr("Logging frame times to %1").arg(filePath));
+    });
+    viewMenu->addSeparator();
+    QAction *statsAction = m_statsPanel->toggleViewAction();
+    statsAction->setText(tr("Statistics"));
+    viewMenu->addAction(statsAction);
+    menuBar()->insertMenu(ui->menuHelp->menuAction(), viewMenu);
+
+    // Меню Layers: раскраска при фиксированном числе слоёв и закрепление вершин
+    QMenu *layersMenu = new QMenu(tr("Layers"), this);
+    m_layersMenu = layersMenu;
+    QAction *budgetAction = layersMenu->addAction(tr("Color with Layer Budget..."));
+    budgetAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_B));
+    connect(budgetAction, &QAction::triggered, this, &MainWindow::handleLayerBudgetTriggered);
+
+    // Алгоритм кнопки Color Graph: жадный или гонка алгоритмов до срока
+    QMenu *engineMenu = layersMenu->addMenu(tr("Coloring Engine"));
+    QActionGroup *engineGroup = new QActionGroup(this);
+    QAction *greedyAction = engineMenu->addAction(tr("Greedy"));
+    QAction *portfolioAction = engineMenu->addAction(tr("Portfolio with Deadline..."));
+    greedyAction->setCheckable(true);
+    portfolioAction->setCheckable(true);
+    greedyAction->setChecked(true);
+    engineGroup->addAction(greedyAction);
+    engineGroup->addAction(portfolioAction);
+    connect(greedyAction, &QAction::triggered, this, [this]() {
+        m_graph->setPortfolioDeadline(0);
+    });
+    connect(portfolioAction, &QAction::triggered, this, [this, greedyAction]() {
+        bool ok = false;
+        const int deadline = QInputDialog::getInt(this, tr("Portfolio Coloring"),
+                                                  tr("Deadline (milliseconds):"),
+                                                  m_portfolioDeadline, 100, 600000, 100, &ok);
+        if (!ok) {
+            if (m_graph->portfolioDeadline() == 0) {
+                greedyAction->setChecked(true);
+            }
+            return;
+        }
+        m_portfolioDeadline = deadline;
+        m_graph->setPortfolioDeadline(deadline);
+    });
+    layersMenu->addSeparator();
+    QAction *lockAction = layersMenu->addAction(tr("Lock Selection to Layer..."));
+    connect(lockAction, &QAction::triggered, this, &MainWindow::handleLockTriggered);
+    QAction *unlockAction = layersMenu->addAction(tr("Unlock Selection"));
+    connect(unlockAction, &QAction::triggered, this, &MainWindow::handleUnlockTriggered);
+    QAction *repairAction = layersMenu->addAction(tr("Repair Coloring"));
+    connect(repairAction, &QAction::triggered, this, [this]() {
+        const int recolored = m_graph->repairColoring();
+        if (recolored == 0) {
+            statusBar()->showMessage(tr("Coloring has no conflicts"));
+        }
+    });
+    layersMenu->addSeparator();
+    QAction *clearCacheAction = layersMenu->addAction(tr("Clear Coloring Cache"));
+    connect(clearCacheAction, &QAction::triggered, this, [this]() {
+        ColoringCache::instance().clear();
+        statusBar()->showMessage(tr("Coloring cache cleared"));
+    });
+    menuBar()->insertMenu(ui->menuHelp->menuAction(), layersMenu);
 }
 
 void MainWindow::updateModeButtons()
@@ -89,6 +322,8 @@ void MainWindow::on_actionNew_triggered()
 {
     if (maybeSave()) {
         // Очищаем граф
+        m_loader->cancel();
+        m_autoLayout->cancel();
         m_graph->clear();
         setCurrentFile("");
         statusBar()->showMessage(tr("New graph created"));
@@ -99,19 +334,19 @@ void MainWindow::on_actionOpen_triggered()
 {
     if (maybeSave()) {
         QString filePath = QFileDialog::getOpenFileName(this,
-                                                        tr("Open Graph"), "", getFileDialogFilter());
+                                                        tr("Open Graph"), "", getFileDialogFilter(true));
         if (!filePath.isEmpty()) {
-            if (loadGraph(filePath)) {
-                setCurrentFile(filePath);
-                statusBar()->showMessage(tr("Graph loaded from %1").arg(filePath));
-            }
+            m_autoLayout->cancel();
+            loadGraph(filePath);
         }
     }
 }
 
 void MainWindow::on_actionSave_triggered()
 {
-    if (m_currentFilePath.isEmpty()) {
+    // Импортированная плата не перезаписывается графом
+    if (m_currentFilePath.isEmpty()
+        || !GraphFile::canWrite(GraphFile::formatForPath(m_currentFilePath))) {
         on_actionSaveAs_triggered();
     } else {
         if (saveGraph(m_currentFilePath)) {
@@ -176,9 +411,113 @@ void MainWindow::on_btnRemove_clicked()
 
 void MainWindow::on_btnColorGraph_clicked()
 {
-    // Запускаем алгоритм раскраски
+    // Повторное нажатие во время гонки алгоритмов отменяет её
+    if (m_backgroundColoring->isRunning()) {
+        m_backgroundColoring->cancel();
+        return;
+    }
+
+    // Запускаем алгоритм раскраски; результат выводит handleGraphColored.
+    // Гонка алгоритмов идёт в фоне до срока, окно остаётся доступным.
+    m_graphWidget->setConflictEdges({});
+    if (m_graph->portfolioDeadline() > 0) {
+        m_backgroundColoring->start(m_graph->portfolioDeadline());
+        return;
+    }
+
     m_graphWidget->colorGraph();
-    statusBar()->showMessage(tr("Graph coloring algorithm applied"));
+    showCacheHits();
+}
+
+void MainWindow::showCacheHits()
+{
+    const int cacheHits = ColoringCache::instance().lastHitCount();
+    if (cacheHits > 0) {
+        statusBar()->showMessage(tr("Graph colored using %1 colors (%2 components reused from the coloring cache)")
+                                     .arg(m_graph->maxColorCount()).arg(cacheHits));
+    }
+}
+
+void MainWindow::handleLayerBudgetTriggered()
+{
+    bool ok = false;
+    const int layerCount = QInputDialog::getInt(this, tr("Color with Layer Budget"),
+                                                tr("Number of signal layers:"),
+                                                m_layerBudget, 1, 256, 1, &ok);
+    if (!ok)
+        return;
+    m_layerBudget = layerCount;
+
+    QVector<Edge*> conflicts;
+    QString errorMessage;
+    if (!m_graph->colorVerticesWithBudget(layerCount, &conflicts, &errorMessage)) {
+        QMessageBox::warning(this, tr("Error"), tr("Cannot color the graph:\n%1").arg(errorMessage));
+        return;
+    }
+
+    // Оставшиеся конфликты подсвечиваются для ручного исправления
+    m_graphWidget->setConflictEdges(conflicts);
+    if (conflicts.isEmpty()) {
+        statusBar()->showMessage(tr("Graph colored within %1 layers").arg(layerCount));
+    } else {
+        statusBar()->showMessage(tr("%1 conflicting edges remain with %2 layers (highlighted in red)")
+                                     .arg(conflicts.size()).arg(layerCount));
+    }
+}
+
+void MainWindow::handleLockTriggered()
+{
+    const QVector<Vertex*> vertices = m_graphWidget->selectedVertices();
+    if (vertices.isEmpty()) {
+        statusBar()->showMessage(tr("Select vertices to lock"));
+        return;
+    }
+
+    bool ok = false;
+    const int layer = QInputDialog::getInt(this, tr("Lock to Layer"), tr("Layer number:"),
+                                           std::max(0, vertices.first()->colorIndex()),
+                                           0, 255, 1, &ok);
+    if (!ok)
+        return;
+
+    m_graph->beginBatch(tr("Lock to layer"));
+    m_graph->setVertexColorIndices(vertices, QVector<int>(vertices.size(), layer));
+    for (Vertex *vertex : vertices) {
+        m_graph->setVertexLocked(vertex, true);
+    }
+    m_graph->endBatch();
+
+    statusBar()->showMessage(tr("%1 vertices locked to layer %2").arg(vertices.size()).arg(layer));
+}
+
+void MainWindow::handleUnlockTriggered()
+{
+    const QVector<Vertex*> vertices = m_graphWidget->selectedVertices();
+
+    m_graph->beginBatch(tr("Unlock vertices"));
+    for (Vertex *vertex : vertices) {
+        m_graph->setVertexLocked(vertex, false);
+    }
+    m_graph->endBatch();
+
+    statusBar()->showMessage(tr("%1 vertices unlocked").arg(vertices.size()));
+}
+
+void MainWindow::handleAutoLayoutTriggered()
+{
+    // Повторный вызов во время раскладки останавливает её
+    if (m_autoLayout->isRunning()) {
+        m_autoLayout->cancel();
+        return;
+    }
+
+    if (m_graph->vertexCount() == 0) {
+        statusBar()->showMessage(tr("Nothing to lay out"));
+        return;
+    }
+
+    m_autoLayoutAction->setText(tr("Stop Auto Layout"));
+    m_autoLayout->start();
 }
 
 void MainWindow::handleItemSelected(bool selected)
@@ -192,19 +531,35 @@ void MainWindow::handleItemSelected(bool selected)
 
 void MainWindow::handleGraphColored()
 {
-    // Выводим информацию о количестве использованных цветов
+    // Выводим информацию о количестве использованных цветов; модальное окно
+    // не показываем, чтобы повторная раскраска не прерывала работу
     int colorCount = m_graph->maxColorCount();
-    statusBar()->showMessage(tr("Graph colored using %1 colors").arg(colorCount));
-
-    // Можно вывести дополнительную информацию в диалоговом окне
-    QMessageBox::information(this, tr("Graph Coloring Result"),
-                             tr("The graph has been colored using %1 colors.\n\n"
-                                "In PCB routing, this would require %1 layers to avoid conflicts.")
-                                 .arg(colorCount));
+    QString message = tr("Graph colored using %1 colors (%1 PCB layers)").arg(colorCount);
+
+    // Для распознанного класса графа или найденной клики того же размера
+    // число слоёв меньше быть не может
+    const ColoringEngine::Structure structure = m_graph->coloringStructure();
+    if (structure != ColoringEngine::Structure::General) {
+        message += tr(", optimal for a %1 graph").arg(ColoringEngine::structureName(structure));
+    } else if (m_graph->isColoringOptimal()) {
+        message += tr(", optimal");
+    }
+    if (m_graph->portfolioDeadline() > 0) {
+        message += tr(", best engine: %1").arg(m_graph->coloringEngine());
+    }
+    statusBar()->showMessage(message);
 }
 
 bool MainWindow::saveGraph(const QString &filePath)
 {
+    // Проверка до открытия: открытие на запись обрезает файл платы
+    const GraphFile::Format format = GraphFile::formatForPath(filePath);
+    if (!GraphFile::canWrite(format)) {
+        QMessageBox::warning(this, tr("Error"),
+                             tr("Cannot save file %1:\nKiCad boards can only be imported.").arg(filePath));
+        return false;
+    }
+
     QFile file(filePath);
     if (!file.open(QIODevice::WriteOnly)) {
         QMessageBox::warning(this, tr("Error"),
@@ -212,44 +567,119 @@ bool MainWindow::saveGraph(const QString &filePath)
         return false;
     }
 
-    QJsonObject jsonGraph = m_graph->toJson();
-    QJsonDocument doc(jsonGraph);
-    file.write(doc.toJson());
+    PROFILE_SCOPE("save");
+    MEMORY_OPERATION("save");
 
+    if (format == GraphFile::Format::Json) {
+        // Потоковая запись без построения документа целиком
+        QString errorMessage;
+        if (!GraphWriter::writeJson(m_graph, &file, &errorMessage)) {
+            QMessageBox::warning(this, tr("Error"),
+                                 tr("Cannot save file %1:\n%2.").arg(filePath).arg(errorMessage));
+            return false;
+        }
+    } else {
+        QString errorMessage;
+        const GraphSnapshot snapshot = GraphSnapshot::capture(m_graph);
+        MemoryReservation snapshotBuffer(MemoryTracker::IoBuffers, MemoryStats::estimateSnapshotBytes(snapshot));
+        const bool ok = format == GraphFile::Format::Compressed
+                            ? GraphFile::writeCompressed(snapshot, &file, &errorMessage)
+                            : DimacsFile::write(snapshot, &file, &errorMessage);
+        if (!ok) {
+            QMessageBox::warning(this, tr("Error"),
+                                 tr("Cannot save file %1:\n%2.").arg(filePath).arg(errorMessage));
+            return false;
+        }
+    }
+
+    // Размер и время изменения фиксируются после закрытия файла
+    file.close();
+    m_watcher->markOwnWrite(filePath);
+    m_autosave->markClean();
     return true;
 }
 
-bool MainWindow::loadGraph(const QString &filePath)
+void MainWindow::loadGraph(const QString &filePath)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        QMessageBox::warning(this, tr("Error"),
-                             tr("Cannot open file %1:\n%2.").arg(filePath).arg(file.errorString()));
-        return false;
+    setLoading(true);
+    statusBar()->showMessage(tr("Loading %1...").arg(filePath));
+    m_loader->start(filePath);
+}
+
+void MainWindow::setLoading(bool loading)
+{
+    // Во время загрузки граф можно просматривать, но не редактировать
+    m_loadProgress->setValue(0);
+    m_loadProgress->setVisible(loading);
+    m_cancelLoadButton->setVisible(loading);
+    m_graphWidget->setInteractive(!loading);
+    // Раскраска, слои и раскладка меняют граф внутри открытой пакетной
+    // операции загрузки, пока приходят порции
+    m_editMenu->setEnabled(!loading);
+    m_layersMenu->setEnabled(!loading);
+    // Сочетания клавиш действий работают и при выключенном меню
+    for (QAction *action : m_layersMenu->actions()) {
+        action->setEnabled(!loading);
+    }
+    m_autoLayoutAction->setEnabled(!loading);
+    ui->btnColorGraph->setEnabled(!loading);
+    ui->actionSave->setEnabled(!loading);
+    ui->actionSaveAs->setEnabled(!loading);
+    if (loading) {
+        // Результат гонки по прежнему графу всё равно не будет применён
+        m_backgroundColoring->cancel();
+        m_loadFitTimer.invalidate();
     }
+}
 
-    QByteArray data = file.readAll();
-    QJsonDocument doc = QJsonDocument::fromJson(data);
+void MainWindow::handleLoadProgress(int percent)
+{
+    m_loadProgress->setValue(percent);
 
-    if (doc.isNull() || !doc.isObject()) {
-        QMessageBox::warning(this, tr("Error"),
-                             tr("Invalid JSON format in file %1.").arg(filePath));
-        return false;
+    // Загруженная часть может не помещаться в исходную сцену
+    if (!m_loadFitTimer.isValid() || m_loadFitTimer.elapsed() >= LOAD_FIT_INTERVAL_MS) {
+        m_loadFitTimer.start();
+        m_graphWidget->fitSceneToGraph();
     }
+}
 
-    if (!m_graph->fromJson(doc.object())) {
-        QMessageBox::warning(this, tr("Error"),
-                             tr("Error loading graph from file %1.").arg(filePath));
-        return false;
-    }
+void MainWindow::handleLoadFinished()
+{
+    setLoading(false);
+    m_graphWidget->fitSceneToGraph();
+    const QString filePath = m_loader->filePath();
+    setCurrentFile(filePath);
+    statusBar()->showMessage(tr("Graph loaded from %1").arg(filePath));
+    offerRecovery(filePath);
+}
 
-    return true;
+void MainWindow::handleLoadFailed(const QString &errorMessage)
+{
+    setLoading(false);
+    statusBar()->clearMessage();
+    QMessageBox::warning(this, tr("Error"), errorMessage);
+}
+
+void MainWindow::handleLoadCancelled(bool graphCleared)
+{
+    setLoading(false);
+    // Прежний документ, если он остался на экране, сохраняет свой файл
+    if (graphCleared) {
+        setCurrentFile("");
+    }
+    statusBar()->showMessage(tr("Loading cancelled"));
 }
 
 bool MainWindow::maybeSave()
 {
+    // Недогруженный граф - не работа пользователя: загрузка просто прерывается
+    if (m_loader->isRunning()) {
+        m_loader->cancel();
+        return true;
+    }
+
     // Если граф не пуст, предлагаем сохранить изменения
-    if (!m_graph->vertices().isEmpty()) {
+    if (m_graph->vertexCount() > 0) {
         QMessageBox::StandardButton ret = QMessageBox::warning(this, tr("Graph Coloring"),
                                                                tr("The graph has been modified.\nDo you want to save your changes?"),
                                                                QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
@@ -274,9 +704,56 @@ void MainWindow::setCurrentFile(const QString &filePath)
     }
 
     setWindowTitle(title);
+
+    m_autosave->setDocumentPath(m_currentFilePath);
+    m_watcher->setFilePath(m_currentFilePath);
+}
+
+void MainWindow::handleGraphReloaded(const GraphDiffStats &stats, int recolored)
+{
+    if (stats.isEmpty()) {
+        statusBar()->showMessage(tr("File changed on disk, graph is up to date"));
+        return;
+    }
+
+    QString message = tr("Reloaded: +%1/-%2 vertices, +%3/-%4 edges, %5 moved, %6 relayered")
+                          .arg(stats.addedVertices).arg(stats.removedVertices)
+                          .arg(stats.addedEdges).arg(stats.removedEdges).arg(stats.movedVertices)
+                          .arg(stats.changedVertices);
+    if (recolored > 0) {
+        message += tr(", %1 vertices recolored").arg(recolored);
+    }
+    statusBar()->showMessage(message);
 }
 
-QString MainWindow::getFileDialogFilter() const
+void MainWindow::offerRecovery(const QString &documentPath)
 {
-    return tr("JSON Files (*.json);;All Files (*)");
+    if (!AutosaveJournal::hasRecoveryData(documentPath))
+        return;
+
+    QMessageBox::StandardButton ret = QMessageBox::question(this, tr("Recover Graph"),
+                                                            tr("Unsaved changes from a previous session were found.\n"
+                                                               "Do you want to recover them?"),
+                                                            QMessageBox::Yes | QMessageBox::No);
+    if (ret != QMessageBox::Yes) {
+        m_autosave->markClean();
+        return;
+    }
+
+    QString errorMessage;
+    if (m_autosave->recover(documentPath, &errorMessage)) {
+        statusBar()->showMessage(tr("Unsaved changes recovered"));
+    } else {
+        QMessageBox::warning(this, tr("Error"),
+                             tr("Cannot recover unsaved changes:\n%1").arg(errorMessage));
+    }
+}
+
+QString MainWindow::getFileDialogFilter(bool includeImports) const
+{
+    if (includeImports) {
+        return tr("JSON Files (*.json);;Compressed Graph Files (*.ctz);;DIMACS Graphs (*.col);;"
+                  "KiCad Boards (*.kicad_pcb);;All Files (*)");
+    }
+    return tr("JSON Files (*.json);;Compressed Graph Files (*.ctz);;DIMACS Graphs (*.col);;All Files (*)");
 }
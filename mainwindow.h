@@ -4,8 +4,19 @@
 #include <QMainWindow>
 #include <QString>
 #include <QCloseEvent>
+#include <QElapsedTimer>
 #include "graph.h"
 #include "graphwidget.h"
+#include "graphhistory.h"
+#include "autosave.h"
+#include "statspanel.h"
+#include "forcelayout.h"
+#include "backgroundcoloring.h"
+#include "graphloader.h"
+#include "graphwatcher.h"
+
+class QProgressBar;
+class QPushButton;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -38,20 +49,50 @@ private slots:
 
     void handleItemSelected(bool selected);
     void handleGraphColored();
+    void handleAutoLayoutTriggered();
+    void handleLayerBudgetTriggered();
+    void handleLockTriggered();
+    void handleUnlockTriggered();
+    void handleLoadProgress(int percent);
+    void handleLoadFinished();
+    void handleLoadFailed(const QString &errorMessage);
+    void handleLoadCancelled(bool graphCleared);
+    void handleGraphReloaded(const GraphDiffStats &stats, int recolored);
 
 private:
     Ui::MainWindow *ui;
     Graph *m_graph;
     GraphWidget *m_graphWidget;
+    GraphHistory *m_history;
+    AutosaveJournal *m_autosave;
+    StatsPanel *m_statsPanel;
+    AutoLayout *m_autoLayout;
+    BackgroundColoring *m_backgroundColoring;
+    QAction *m_autoLayoutAction;
+    GraphLoader *m_loader;
+    GraphWatcher *m_watcher;
+    QProgressBar *m_loadProgress;
+    QPushButton *m_cancelLoadButton;
+    QMenu *m_editMenu;
+    QMenu *m_layersMenu;
+    QElapsedTimer m_loadFitTimer;  // Сцена расширяется по ходу загрузки не чаще раза в интервал
+    int m_layerBudget;  // Последнее введённое число слоёв
+    int m_portfolioDeadline;  // Последний введённый срок гонки алгоритмов, мс
     QString m_currentFilePath;
 
     void createActions();
     void updateModeButtons();
 
     bool saveGraph(const QString &filePath);
-    bool loadGraph(const QString &filePath);
+    // Загрузка идёт в фоне, по окончании вызывается handleLoadFinished
+    void loadGraph(const QString &filePath);
+    void setLoading(bool loading);
     bool maybeSave();
     void setCurrentFile(const QString &filePath);
-    QString getFileDialogFilter() const;
+    void offerRecovery(const QString &documentPath);
+    // includeImports - добавить форматы, которые можно только открыть
+    QString getFileDialogFilter(bool includeImports = false) const;
+    // Сообщение о компонентах, взятых из кэша раскрасок
+    void showCacheHits();
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,225 @@
+#include "memorystats.h"
+#include "graph.h"
+#include "graphwidget.h"
+#include "graphsnapshot.h"
+#include <QFile>
+#include <QMutexLocker>
+#include <algorithm>
+#include <cmath>
+
+// Накладные расходы, которые не видны через sizeof: приватные данные
+// QObject и QGraphicsItem, заголовки блоков кучи, узлы хеш-таблиц и
+// индекса сцены. Значения получены замером на 64-битной сборке и дают
+// оценку с точностью до десятков процентов.
+constexpr qint64 QOBJECT_PRIVATE_BYTES = 112;
+constexpr qint64 GRAPHICS_ITEM_PRIVATE_BYTES = 208;
+constexpr qint64 HEAP_BLOCK_OVERHEAD = 16;
+constexpr qint64 HASH_NODE_BYTES = 32;
+constexpr qint64 MAP_NODE_BYTES = 48;
+constexpr qint64 SCENE_INDEX_ENTRY_BYTES = 64;
+
+MemoryTracker::MemoryTracker()
+    : m_total(0), m_operationPeak(0)
+{
+    for (int i = 0; i < CategoryCount; ++i) {
+        m_current[i].store(0);
+        m_peak[i].store(0);
+    }
+}
+
+MemoryTracker &MemoryTracker::instance()
+{
+    static MemoryTracker tracker;
+    return tracker;
+}
+
+// Атомарное обновление максимума
+static void updateMaximum(std::atomic<qint64> &maximum, qint64 value)
+{
+    qint64 previous = maximum.load(std::memory_order_relaxed);
+    while (value > previous
+           && !maximum.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {
+    }
+}
+
+void MemoryTracker::allocate(Category category, qint64 bytes)
+{
+    const qint64 current = m_current[category].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    const qint64 total = m_total.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    updateMaximum(m_peak[category], current);
+    updateMaximum(m_operationPeak, total);
+}
+
+void MemoryTracker::release(Category category, qint64 bytes)
+{
+    m_current[category].fetch_sub(bytes, std::memory_order_relaxed);
+    m_total.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void MemoryTracker::recordOperation(const char *name, qint64 peakBytes, qint64 residentDelta)
+{
+    QMutexLocker locker(&m_mutex);
+    const QString key = QString::fromUtf8(name);
+    OperationStats &stats = m_operations[key];
+    if (stats.runs == 0) {
+        stats.name = key;
+    }
+    stats.runs++;
+    stats.lastPeakBytes = peakBytes;
+    stats.maxPeakBytes = std::max(stats.maxPeakBytes, peakBytes);
+    stats.lastResidentDelta = residentDelta;
+}
+
+QVector<MemoryTracker::OperationStats> MemoryTracker::operationStats() const
+{
+    QVector<OperationStats> result;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (const OperationStats &stats : m_operations) {
+            result.append(stats);
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const OperationStats &a, const OperationStats &b) {
+        return a.name < b.name;
+    });
+    return result;
+}
+
+MemoryTracker::OperationStats MemoryTracker::operationStats(const QString &name) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_operations.value(name);
+}
+
+void MemoryTracker::clearOperations()
+{
+    QMutexLocker locker(&m_mutex);
+    m_operations.clear();
+    for (int i = 0; i < CategoryCount; ++i) {
+        m_peak[i].store(m_current[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+QString MemoryTracker::categoryName(Category category)
+{
+    switch (category) {
+    case Algorithm:
+        return QStringLiteral("Algorithm buffers");
+    case IoBuffers:
+        return QStringLiteral("I/O buffers");
+    default:
+        return QString();
+    }
+}
+
+MemoryOperationScope::MemoryOperationScope(const char *name)
+    : m_name(name)
+{
+    MemoryTracker &tracker = MemoryTracker::instance();
+    m_startTotal = tracker.totalCurrent();
+    // Пик внешней операции сохраняется и восстанавливается в деструкторе,
+    // поэтому вложенные операции не сбрасывают его
+    m_outerPeak = tracker.m_operationPeak.exchange(m_startTotal, std::memory_order_relaxed);
+    m_startResident = MemoryStats::residentBytes();
+}
+
+MemoryOperationScope::~MemoryOperationScope()
+{
+    MemoryTracker &tracker = MemoryTracker::instance();
+    const qint64 peak = tracker.m_operationPeak.load(std::memory_order_relaxed);
+    tracker.recordOperation(m_name, std::max<qint64>(0, peak - m_startTotal),
+                            MemoryStats::residentBytes() - m_startResident);
+    updateMaximum(tracker.m_operationPeak, m_outerPeak);
+}
+
+namespace MemoryStats {
+
+qint64 estimateGraphBytes(const Graph *graph)
+{
+    if (!graph)
+        return 0;
+
+    const qint64 vertexCount = graph->vertexCount();
+    const qint64 edgeCount = graph->edgeCount();
+
+    // Объекты вершин и рёбер
+    qint64 bytes = vertexCount * (qint64(sizeof(Vertex)) + QOBJECT_PRIVATE_BYTES + HEAP_BLOCK_OVERHEAD);
+    bytes += edgeCount * (qint64(sizeof(Edge)) + QOBJECT_PRIVATE_BYTES + HEAP_BLOCK_OVERHEAD);
+    // Списки инцидентности: каждое ребро хранится у обоих концов
+    bytes += 2 * edgeCount * qint64(sizeof(Edge*)) + vertexCount * HEAP_BLOCK_OVERHEAD;
+    // Хранилища с дескрипторами (плотный массив, обратный индекс и слоты)
+    bytes += vertexCount * (qint64(sizeof(Vertex*)) + 3 * qint64(sizeof(quint32)));
+    bytes += edgeCount * (qint64(sizeof(Edge*)) + 3 * qint64(sizeof(quint32)));
+    // Индекс постоянных идентификаторов
+    bytes += vertexCount * HASH_NODE_BYTES;
+    return bytes;
+}
+
+qint64 estimateSceneBytes(int vertexItems, int edgeItems)
+{
+    const qint64 perVertex = qint64(sizeof(VertexItem)) + GRAPHICS_ITEM_PRIVATE_BYTES
+                             + HEAP_BLOCK_OVERHEAD + SCENE_INDEX_ENTRY_BYTES + MAP_NODE_BYTES;
+    const qint64 perEdge = qint64(sizeof(EdgeItem)) + GRAPHICS_ITEM_PRIVATE_BYTES
+                           + HEAP_BLOCK_OVERHEAD + SCENE_INDEX_ENTRY_BYTES + MAP_NODE_BYTES;
+    return vertexItems * perVertex + edgeItems * perEdge;
+}
+
+qint64 estimateSnapshotBytes(const GraphSnapshot &snapshot)
+{
+    return qint64(snapshot.vertices.capacity()) * qint64(sizeof(GraphSnapshot::VertexRecord))
+           + qint64(snapshot.edges.capacity()) * qint64(sizeof(GraphSnapshot::EdgeRecord));
+}
+
+#ifdef Q_OS_LINUX
+// Значение поля из /proc/self/status в байтах
+static qint64 readProcStatusField(const char *field)
+{
+    QFile file(QStringLiteral("/proc/self/status"));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return 0;
+
+    const QByteArray prefix = QByteArray(field) + ':';
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        if (line.startsWith(prefix)) {
+            // Формат: "VmRSS:     12345 kB"
+            const QList<QByteArray> parts = line.mid(prefix.size()).simplified().split(' ');
+            return parts.isEmpty() ? 0 : parts.first().toLongLong() * 1024;
+        }
+    }
+    return 0;
+}
+#endif
+
+qint64 residentBytes()
+{
+#ifdef Q_OS_LINUX
+    return readProcStatusField("VmRSS");
+#else
+    return 0;
+#endif
+}
+
+qint64 peakResidentBytes()
+{
+#ifdef Q_OS_LINUX
+    return readProcStatusField("VmHWM");
+#else
+    return 0;
+#endif
+}
+
+QString formatBytes(qint64 bytes)
+{
+    const double absolute = std::abs(double(bytes));
+    if (absolute >= 1024.0 * 1024 * 1024)
+        return QString::number(bytes / (1024.0 * 1024 * 1024), 'f', 2) + " GiB";
+    if (absolute >= 1024.0 * 1024)
+        return QString::number(bytes / (1024.0 * 1024), 'f', 2) + " MiB";
+    if (absolute >= 1024.0)
+        return QString::number(bytes / 1024.0, 'f', 1) + " KiB";
+    return QString::number(bytes) + " B";
+}
+
+} // namespace MemoryStats
@@ -0,0 +1,135 @@
+#ifndef MEMORYSTATS_H
+#define MEMORYSTATS_H
+
+#include <QtGlobal>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <atomic>
+
+class Graph;
+struct GraphSnapshot;
+
+// Класс MemoryTracker учитывает временные буферы алгоритмов и ввода-вывода
+// и пик их суммарного объёма в пределах операции (загрузка, раскраска...)
+class MemoryTracker
+{
+public:
+    enum Category {
+        Algorithm,   // Буферы алгоритмов раскраски и раскладки
+        IoBuffers,   // Буферы чтения, разбора и записи файлов
+        CategoryCount
+    };
+
+    // Сводка по операции: пик учтённых буферов и прирост резидентной памяти
+    struct OperationStats
+    {
+        QString name;
+        qint64 runs = 0;
+        qint64 lastPeakBytes = 0;
+        qint64 maxPeakBytes = 0;
+        qint64 lastResidentDelta = 0;
+    };
+
+    static MemoryTracker &instance();
+
+    void allocate(Category category, qint64 bytes);
+    void release(Category category, qint64 bytes);
+
+    qint64 current(Category category) const { return m_current[category].load(std::memory_order_relaxed); }
+    qint64 peak(Category category) const { return m_peak[category].load(std::memory_order_relaxed); }
+    qint64 totalCurrent() const { return m_total.load(std::memory_order_relaxed); }
+
+    QVector<OperationStats> operationStats() const;
+    OperationStats operationStats(const QString &name) const;
+    void clearOperations();
+
+    static QString categoryName(Category category);
+
+private:
+    friend class MemoryOperationScope;
+
+    MemoryTracker();
+
+    std::atomic<qint64> m_current[CategoryCount];
+    std::atomic<qint64> m_peak[CategoryCount];
+    std::atomic<qint64> m_total;
+    std::atomic<qint64> m_operationPeak;  // Максимум m_total с начала текущей операции
+
+    mutable QMutex m_mutex;
+    QHash<QString, OperationStats> m_operations;
+
+    void recordOperation(const char *name, qint64 peakBytes, qint64 residentDelta);
+};
+
+// Учёт буфера на время жизни объекта
+class MemoryReservation
+{
+public:
+    MemoryReservation(MemoryTracker::Category category, qint64 bytes)
+        : m_category(category), m_bytes(bytes)
+    {
+        MemoryTracker::instance().allocate(m_category, m_bytes);
+    }
+
+    ~MemoryReservation()
+    {
+        MemoryTracker::instance().release(m_category, m_bytes);
+    }
+
+    // Уточнение размера буфера после его заполнения
+    void resize(qint64 bytes)
+    {
+        MemoryTracker::instance().allocate(m_category, bytes - m_bytes);
+        m_bytes = bytes;
+    }
+
+private:
+    MemoryTracker::Category m_category;
+    qint64 m_bytes;
+
+    Q_DISABLE_COPY(MemoryReservation)
+};
+
+// Операция, для которой фиксируется пиковое потребление памяти
+class MemoryOperationScope
+{
+public:
+    explicit MemoryOperationScope(const char *name);
+    ~MemoryOperationScope();
+
+private:
+    const char *m_name;
+    qint64 m_startTotal;
+    qint64 m_outerPeak;
+    qint64 m_startResident;
+
+    Q_DISABLE_COPY(MemoryOperationScope)
+};
+
+// Оценки памяти подсистем и сведения о процессе
+namespace MemoryStats {
+
+// Оценка объёма модели графа (объекты Vertex/Edge, списки, индексы)
+qint64 estimateGraphBytes(const Graph *graph);
+// Оценка объёма элементов сцены для заданного числа вершин и рёбер
+qint64 estimateSceneBytes(int vertexItems, int edgeItems);
+// Объём снимка графа (буфер загрузки, сохранения и автосохранения)
+qint64 estimateSnapshotBytes(const GraphSnapshot &snapshot);
+
+// Резидентная память процесса и её пик (0, если платформа не поддерживается)
+qint64 residentBytes();
+qint64 peakResidentBytes();
+
+QString formatBytes(qint64 bytes);
+
+} // namespace MemoryStats
+
+#define MEMORY_CONCAT_IMPL(a, b) a##b
+#define MEMORY_CONCAT(a, b) MEMORY_CONCAT_IMPL(a, b)
+
+// Операция с учётом пика памяти
+#define MEMORY_OPERATION(name) MemoryOperationScope MEMORY_CONCAT(memoryScope, __LINE__)(name)
+
+#endif // MEMORYSTATS_H
@@ -0,0 +1,49 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <QThreadPool>
+#include <QSemaphore>
+#include <algorithm>
+#include <atomic>
+
+// Параллельный вызов function(i) для i из [0, count) в глобальном пуле потоков.
+// Индексы раздаются по одному через атомарный счётчик, вызывающий поток
+// участвует в работе сам. Задачи ставятся в пул только при наличии свободных
+// потоков, поэтому занятый пул не приводит к ожиданию - работа просто
+// выполняется в меньшее число потоков. Возврат - после обработки всех индексов.
+template<typename Function>
+void parallelFor(int count, Function function)
+{
+    if (count <= 0)
+        return;
+
+    QThreadPool *pool = QThreadPool::globalInstance();
+    const int helpers = std::min(count, pool->maxThreadCount()) - 1;
+    if (helpers <= 0) {
+        for (int i = 0; i < count; ++i) {
+            function(i);
+        }
+        return;
+    }
+
+    std::atomic<int> next(0);
+    auto work = [&]() {
+        for (int i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            function(i);
+        }
+    };
+
+    QSemaphore finished;
+    int started = 0;
+    for (int helper = 0; helper < helpers; ++helper) {
+        if (!pool->tryStart([&]() { work(); finished.release(); })) {
+            break;
+        }
+        started++;
+    }
+
+    work();
+    finished.acquire(started);
+}
+
+#endif // PARALLEL_H
@@ -0,0 +1,296 @@
+#include "partition.h"
+#include "memorystats.h"
+#include "profiler.h"
+#include <QRandomGenerator>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+// Огрубление прекращается, когда вершин на часть остаётся столько
+constexpr int COARSE_VERTICES_PER_PART = 32;
+// ... или когда уровень уменьшается меньше чем в такое число раз
+constexpr double MIN_COARSENING_RATIO = 0.95;
+// Допустимое превышение среднего веса части
+constexpr double IMBALANCE = 0.03;
+constexpr int REFINE_PASSES = 4;
+
+// Граф уровня огрубления: веса вершин - число исходных вершин,
+// веса рёбер - число исходных рёбер между группами
+struct Level
+{
+    QVector<int> offsets;
+    QVector<int> neighbors;
+    QVector<int> edgeWeights;
+    QVector<int> vertexWeights;
+    QVector<int> coarseMap;  // Вершина следующего (более грубого) уровня
+
+    int vertexCount() const { return offsets.size() - 1; }
+};
+
+Level fromAdjacency(const Adjacency &adjacency)
+{
+    Level level;
+    level.offsets = adjacency.offsets;
+    level.neighbors = adjacency.neighbors;
+    level.edgeWeights.fill(1, adjacency.neighbors.size());
+    level.vertexWeights.fill(1, adjacency.vertexCount());
+    if (level.offsets.isEmpty()) {
+        level.offsets.append(0);
+    }
+    return level;
+}
+
+// Паросочетание по тяжёлым рёбрам в случайном порядке вершин и построение
+// грубого графа; кратные рёбра между группами сливаются с суммой весов
+Level coarsen(Level &fine, QRandomGenerator &random)
+{
+    const int vertexCount = fine.vertexCount();
+    QVector<int> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), random);
+
+    QVector<int> match(vertexCount, -1);
+    for (int v : order) {
+        if (match[v] >= 0)
+            continue;
+        int best = v;
+        int bestWeight = 0;
+        for (int e = fine.offsets[v]; e < fine.offsets[v + 1]; ++e) {
+            const int u = fine.neighbors[e];
+            if (match[u] < 0 && u != v && fine.edgeWeights[e] > bestWeight) {
+                best = u;
+                bestWeight = fine.edgeWeights[e];
+            }
+        }
+        match[v] = best;
+        match[best] = v;
+    }
+
+    // Номера групп в порядке исходных вершин
+    fine.coarseMap.fill(-1, vertexCount);
+    int coarseCount = 0;
+    for (int v = 0; v < vertexCount; ++v) {
+        if (fine.coarseMap[v] < 0) {
+            fine.coarseMap[v] = coarseCount;
+            fine.coarseMap[match[v]] = coarseCount;
+            coarseCount++;
+        }
+    }
+
+    Level coarse;
+    coarse.offsets.reserve(coarseCount + 1);
+    coarse.offsets.append(0);
+    coarse.vertexWeights.fill(0, coarseCount);
+    coarse.neighbors.reserve(fine.neighbors.size());
+    coarse.edgeWeights.reserve(fine.neighbors.size());
+
+    // slot[c] - позиция соседа c в списке текущей группы, отмечается номером группы
+    QVector<int> slot(coarseCount, -1);
+    QVector<int> owner(coarseCount, -1);
+    int group = 0;
+    for (int v = 0; v < vertexCount; ++v) {
+        if (fine.coarseMap[v] != group)
+            continue;
+
+        const int members[2] = { v, match[v] };
+        const int memberCount = match[v] == v ? 1 : 2;
+        for (int m = 0; m < memberCount; ++m) {
+            const int member = members[m];
+            coarse.vertexWeights[group] += fine.vertexWeights[member];
+            for (int e = fine.offsets[member]; e < fine.offsets[member + 1]; ++e) {
+                const int target = fine.coarseMap[fine.neighbors[e]];
+                if (target == group)
+                    continue;
+                if (owner[target] != group) {
+                    owner[target] = group;
+                    slot[target] = coarse.neighbors.size();
+                    coarse.neighbors.append(target);
+                    coarse.edgeWeights.append(fine.edgeWeights[e]);
+                } else {
+                    coarse.edgeWeights[slot[target]] += fine.edgeWeights[e];
+                }
+            }
+        }
+        coarse.offsets.append(coarse.neighbors.size());
+        group++;
+    }
+    return coarse;
+}
+
+// Начальное разбиение наращиванием областей обходом в ширину
+QVector<int> growRegions(const Level &level, int partCount, qint64 totalWeight)
+{
+    const int vertexCount = level.vertexCount();
+    QVector<int> parts(vertexCount, -1);
+    QVector<int> queue;
+    queue.reserve(vertexCount);
+
+    int nextSeed = 0;
+    qint64 assignedWeight = 0;
+    for (int part = 0; part < partCount - 1; ++part) {
+        // Оставшийся вес делится поровну между оставшимися частями
+        const qint64 target = (totalWeight - assignedWeight) / (partCount - part);
+        qint64 weight = 0;
+        queue.clear();
+        int head = 0;
+        while (weight < target) {
+            if (head == queue.size()) {
+                // Область исчерпана: новая точка роста в ещё не занятой вершине
+                while (nextSeed < vertexCount && parts[nextSeed] >= 0) {
+                    nextSeed++;
+                }
+                if (nextSeed == vertexCount)
+                    break;
+                parts[nextSeed] = part;
+                weight += level.vertexWeights[nextSeed];
+                queue.append(nextSeed);
+                continue;
+            }
+            const int v = queue[head++];
+            for (int e = level.offsets[v]; e < level.offsets[v + 1] && weight < target; ++e) {
+                const int u = level.neighbors[e];
+                if (parts[u] < 0) {
+                    parts[u] = part;
+                    weight += level.vertexWeights[u];
+                    queue.append(u);
+                }
+            }
+        }
+        assignedWeight += weight;
+    }
+
+    for (int v = 0; v < vertexCount; ++v) {
+        if (parts[v] < 0) {
+            parts[v] = partCount - 1;
+        }
+    }
+    return parts;
+}
+
+// Жадное улучшение: вершина переходит в часть, с которой связана сильнее,
+// если это не нарушает баланс
+void refine(const Level &level, QVector<int> &parts, int partCount, qint64 maxPartWeight,
+            QRandomGenerator &random)
+{
+    const int vertexCount = level.vertexCount();
+    QVector<qint64> partWeights(partCount, 0);
+    for (int v = 0; v < vertexCount; ++v) {
+        partWeights[parts[v]] += level.vertexWeights[v];
+    }
+
+    QVector<int> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0);
+    QVector<qint64> connection(partCount, 0);
+    QVector<int> touched;
+
+    for (int pass = 0; pass < REFINE_PASSES; ++pass) {
+        std::shuffle(order.begin(), order.end(), random);
+        int moves = 0;
+
+        for (int v : order) {
+            const int own = parts[v];
+            touched.clear();
+            bool boundary = false;
+            for (int e = level.offsets[v]; e < level.offsets[v + 1]; ++e) {
+                const int part = parts[level.neighbors[e]];
+                if (connection[part] == 0) {
+                    touched.append(part);
+                }
+                connection[part] += level.edgeWeights[e];
+                boundary = boundary || part != own;
+            }
+
+            if (boundary) {
+                const int weight = level.vertexWeights[v];
+                int best = own;
+                qint64 bestGain = 0;
+                for (int part : std::as_const(touched)) {
+                    if (part == own || partWeights[part] + weight > maxPartWeight)
+                        continue;
+                    const qint64 gain = connection[part] - connection[own];
+                    // При равной связности переход выравнивает веса частей
+                    if (gain > bestGain
+                        || (gain == 0 && best == own && partWeights[part] + weight < partWeights[own])) {
+                        best = part;
+                        bestGain = gain;
+                    }
+                }
+                if (best != own) {
+                    parts[v] = best;
+                    partWeights[own] -= weight;
+                    partWeights[best] += weight;
+                    moves++;
+                }
+            }
+
+            for (int part : std::as_const(touched)) {
+                connection[part] = 0;
+            }
+        }
+
+        if (moves == 0)
+            break;
+    }
+}
+
+} // namespace
+
+QVector<int> GraphPartition::partition(const Adjacency &adjacency, int partCount, quint32 seed)
+{
+    PROFILE_SCOPE("partition");
+
+    const int vertexCount = adjacency.vertexCount();
+    if (partCount <= 1 || vertexCount == 0)
+        return QVector<int>(vertexCount, 0);
+    partCount = std::min(partCount, vertexCount);
+
+    MemoryReservation buffers(MemoryTracker::Algorithm,
+                              qint64(adjacency.neighbors.size()) * 2 * qint64(sizeof(int)));
+    QRandomGenerator random(seed);
+
+    // Огрубление
+    QVector<Level> levels;
+    levels.append(fromAdjacency(adjacency));
+    const int coarseTarget = partCount * COARSE_VERTICES_PER_PART;
+    while (levels.last().vertexCount() > coarseTarget) {
+        Level coarse = coarsen(levels.last(), random);
+        if (coarse.vertexCount() > MIN_COARSENING_RATIO * levels.last().vertexCount()) {
+            levels.last().coarseMap.clear();
+            break;
+        }
+        levels.append(std::move(coarse));
+    }
+
+    const qint64 totalWeight = vertexCount;
+    const qint64 maxPartWeight = qint64(std::ceil(double(totalWeight) / partCount * (1.0 + IMBALANCE)));
+
+    // Начальное разбиение и перенос на подробные уровни
+    QVector<int> parts = growRegions(levels.last(), partCount, totalWeight);
+    refine(levels.last(), parts, partCount, maxPartWeight, random);
+    for (int i = levels.size() - 2; i >= 0; --i) {
+        const Level &level = levels[i];
+        QVector<int> finer(level.vertexCount());
+        for (int v = 0; v < level.vertexCount(); ++v) {
+            finer[v] = parts[level.coarseMap[v]];
+        }
+        parts = std::move(finer);
+        levels.removeLast();
+        refine(levels[i], parts, partCount, maxPartWeight, random);
+    }
+    return parts;
+}
+
+qint64 GraphPartition::edgeCut(const Adjacency &adjacency, const QVector<int> &parts)
+{
+    qint64 cut = 0;
+    for (int v = 0; v < adjacency.vertexCount(); ++v) {
+        for (const int *n = adjacency.neighborsBegin(v); n != adjacency.neighborsEnd(v); ++n) {
+            if (*n > v && parts[*n] != parts[v]) {
+                cut++;
+            }
+        }
+    }
+    return cut;
+}
@@ -0,0 +1,22 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <QVector>
+#include "coloringengine.h"
+
+// Многоуровневое разбиение графа на части с минимизацией числа разрезанных
+// рёбер: граф огрубляется паросочетаниями по тяжёлым рёбрам, самый грубый
+// уровень делится наращиванием областей, затем разбиение переносится на
+// более подробные уровни и улучшается жадным переносом граничных вершин.
+namespace GraphPartition {
+
+// part[v] - номер части вершины v в [0, partCount).
+// Веса частей отличаются от среднего не более чем на несколько процентов.
+QVector<int> partition(const Adjacency &adjacency, int partCount, quint32 seed = 1);
+
+// Число рёбер, концы которых попали в разные части
+qint64 edgeCut(const Adjacency &adjacency, const QVector<int> &parts);
+
+} // namespace GraphPartition
+
+#endif // PARTITION_H
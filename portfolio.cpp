@@ -0,0 +1,377 @@
+#include "portfolio.h"
+#include "layerbudget.h"
+#include "memorystats.h"
+#include "parallel.h"
+#include "profiler.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <tuple>
+
+namespace {
+
+constexpr int DEFAULT_DEADLINE_MS = 2000;
+// Срок проверяется раз в столько раскрашенных вершин
+constexpr int DEADLINE_CHECK_INTERVAL = 1024;
+// Одна попытка локального поиска; между попытками проверяется остановка гонки
+constexpr qint64 LOCAL_SEARCH_SLICE_MS = 200;
+// Клика для нижней границы ищется от стольких вершин наибольшей степени
+constexpr int CLIQUE_STARTS = 8;
+
+} // namespace
+
+PortfolioColoring::PortfolioColoring(const Adjacency &adjacency)
+    : m_adjacency(adjacency), m_members(defaultMembers()), m_deadlineMs(DEFAULT_DEADLINE_MS),
+    m_bestBound(0), m_stop(false), m_lowerBound(0)
+{
+}
+
+QList<PortfolioColoring::Member> PortfolioColoring::defaultMembers()
+{
+    // При нехватке потоков участники идут по порядку: быстрые и способные
+    // доказать оптимальность - первыми, локальный поиск получает остаток срока
+    return { Member::Structured, Member::Greedy, Member::LargestFirst,
+             Member::SmallestLast, Member::Dsatur, Member::LocalSearch };
+}
+
+QString PortfolioColoring::memberName(Member member)
+{
+    switch (member) {
+    case Member::Greedy:
+        return QStringLiteral("greedy");
+    case Member::LargestFirst:
+        return QStringLiteral("largest-first");
+    case Member::SmallestLast:
+        return QStringLiteral("smallest-last");
+    case Member::Dsatur:
+        return QStringLiteral("dsatur");
+    case Member::Structured:
+        return QStringLiteral("structured");
+    case Member::LocalSearch:
+        return QStringLiteral("local-search");
+    }
+    return QString();
+}
+
+PortfolioColoring::Result PortfolioColoring::run()
+{
+    PROFILE_SCOPE("engine.portfolio");
+    QElapsedTimer timer;
+    timer.start();
+
+    const int vertexCount = m_adjacency.vertexCount();
+    m_deadline = QDeadlineTimer(std::max(1, m_deadlineMs));
+    m_bestBound.store(vertexCount + 1);
+    m_stop.store(false);
+    m_result = Result();
+    m_lowerBound = greedyCliqueSize();
+
+    std::atomic<int> finished(0);
+    parallelFor(m_members.size(), [this, &finished](int i) {
+        if (runMember(m_members[i])) {
+            finished++;
+        }
+    });
+
+    if (m_result.colors.size() != vertexCount) {
+        m_result.colorCount = ColoringEngine::color(m_adjacency, ColoringEngine::Engine::Greedy, &m_result.colors);
+        m_result.winner = Member::Greedy;
+    }
+    m_result.lowerBound = m_lowerBound;
+    m_result.optimal = m_result.optimal || m_result.colorCount <= m_lowerBound;
+    m_result.finishedMembers = finished.load();
+    m_result.elapsedMs = timer.elapsed();
+    return m_result;
+}
+
+void PortfolioColoring::submit(Member member, const QVector<int> &colors, bool optimal)
+{
+    if (!ColoringEngine::isProperColoring(m_adjacency, colors))
+        return;
+    const int colorCount = colors.isEmpty() ? 0 : *std::max_element(colors.constBegin(), colors.constEnd()) + 1;
+
+    QMutexLocker locker(&m_mutex);
+    if (colorCount >= m_bestBound.load())
+        return;
+
+    m_result.colors = colors;
+    m_result.colorCount = colorCount;
+    m_result.winner = member;
+    m_bestBound.store(colorCount);
+
+    // Лучше не бывает - остальные участники останавливаются
+    if (optimal || colorCount <= m_lowerBound) {
+        m_result.optimal = true;
+        m_stop.store(true);
+    }
+}
+
+bool PortfolioColoring::runMember(Member member)
+{
+    if (shouldStop())
+        return false;
+
+    QVector<int> order(m_adjacency.vertexCount());
+    QVector<int> colors;
+    switch (member) {
+    case Member::Greedy:
+        std::iota(order.begin(), order.end(), 0);
+        break;
+    case Member::LargestFirst:
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+            return m_adjacency.degree(a) > m_adjacency.degree(b);
+        });
+        break;
+    case Member::SmallestLast:
+        order = smallestLastOrder();
+        break;
+    case Member::Dsatur:
+        if (!colorDsatur(&colors))
+            return false;
+        submit(member, colors);
+        return true;
+    case Member::Structured: {
+        const ColoringEngine::Structure structure =
+            ColoringEngine::colorByStructure(m_adjacency, ColoringEngine::Engine::LargestFirst, &colors);
+        submit(member, colors, structure != ColoringEngine::Structure::General);
+        return true;
+    }
+    case Member::LocalSearch:
+        runLocalSearch();
+        return !m_deadline.hasExpired();
+    }
+
+    if (!colorInOrder(order, &colors))
+        return false;
+    submit(member, colors);
+    return true;
+}
+
+bool PortfolioColoring::colorInOrder(const QVector<int> &order, QVector<int> *colors) const
+{
+    const int vertexCount = m_adjacency.vertexCount();
+    colors->fill(-1, vertexCount);
+    QVector<int> usedBy(vertexCount + 1, -1);
+    MemoryReservation buffers(MemoryTracker::Algorithm, qint64(vertexCount) * 3 * qint64(sizeof(int)));
+
+    for (int i = 0; i < order.size(); ++i) {
+        if (i % DEADLINE_CHECK_INTERVAL == 0 && shouldStop())
+            return false;
+
+        const int vertex = order[i];
+        for (const int *n = m_adjacency.neighborsBegin(vertex); n != m_adjacency.neighborsEnd(vertex); ++n) {
+            const int neighborColor = (*colors)[*n];
+            if (neighborColor >= 0) {
+                usedBy[neighborColor] = vertex;
+            }
+        }
+        int color = 0;
+        while (usedBy[color] == vertex) {
+            color++;
+        }
+
+        // Уже не лучше найденной раскраски
+        if (color + 1 >= m_bestBound.load())
+            return false;
+        (*colors)[vertex] = color;
+    }
+    return true;
+}
+
+bool PortfolioColoring::colorDsatur(QVector<int> *colors) const
+{
+    const int vertexCount = m_adjacency.vertexCount();
+    colors->fill(-1, vertexCount);
+    QVector<int> saturation(vertexCount, 0);
+    QVector<int> usedBy(vertexCount + 1, -1);
+    // Цвета, уже встречающиеся у соседей каждой вершины
+    QVector<QVector<char>> neighborColors(vertexCount);
+    MemoryReservation buffers(MemoryTracker::Algorithm,
+                              qint64(vertexCount) * 3 * qint64(sizeof(int))
+                                  + qint64(m_adjacency.neighbors.size()) * 4 * qint64(sizeof(int)));
+
+    // Очередь с устаревшими записями: запись пропускается, если насыщенность
+    // вершины с тех пор выросла. При равенстве - большая степень, меньший номер.
+    using Key = std::tuple<int, int, int>;
+    std::priority_queue<Key> queue;
+    for (int v = 0; v < vertexCount; ++v) {
+        queue.push(Key(0, m_adjacency.degree(v), -v));
+    }
+
+    int colored = 0;
+    while (!queue.empty()) {
+        const int vertex = -std::get<2>(queue.top());
+        const int keySaturation = std::get<0>(queue.top());
+        queue.pop();
+        if ((*colors)[vertex] >= 0 || keySaturation != saturation[vertex])
+            continue;
+        if (colored++ % DEADLINE_CHECK_INTERVAL == 0 && shouldStop())
+            return false;
+
+        for (const int *n = m_adjacency.neighborsBegin(vertex); n != m_adjacency.neighborsEnd(vertex); ++n) {
+            const int neighborColor = (*colors)[*n];
+            if (neighborColor >= 0) {
+                usedBy[neighborColor] = vertex;
+            }
+        }
+        int color = 0;
+        while (usedBy[color] == vertex) {
+            color++;
+        }
+        if (color + 1 >= m_bestBound.load())
+            return false;
+        (*colors)[vertex] = color;
+
+        for (const int *n = m_adjacency.neighborsBegin(vertex); n != m_adjacency.neighborsEnd(vertex); ++n) {
+            const int neighbor = *n;
+            if ((*colors)[neighbor] >= 0)
+                continue;
+            QVector<char> &seen = neighborColors[neighbor];
+            if (seen.size() <= color) {
+                seen.resize(color + 1);
+            }
+            if (!seen[color]) {
+                seen[color] = 1;
+                saturation[neighbor]++;
+                queue.push(Key(saturation[neighbor], m_adjacency.degree(neighbor), -neighbor));
+            }
+        }
+    }
+    return true;
+}
+
+void PortfolioColoring::runLocalSearch()
+{
+    // Без чужой границы начинаем со своей раскраски
+    if (m_bestBound.load() > m_adjacency.vertexCount()) {
+        QVector<int> colors;
+        ColoringEngine::color(m_adjacency, ColoringEngine::Engine::LargestFirst, &colors);
+        submit(Member::LocalSearch, colors);
+    }
+
+    quint32 seed = 1;
+    while (!shouldStop()) {
+        const int target = m_bestBound.load() - 1;
+        if (target < std::max(m_lowerBound, 1))
+            return;
+
+        LayerBudgetSolver solver(m_adjacency, target);
+        solver.setSeed(seed++);
+        solver.setTimeLimit(int(std::min(m_deadline.remainingTime(), LOCAL_SEARCH_SLICE_MS)));
+        if (!solver.solve())
+            return;
+        if (solver.conflictCount() == 0) {
+            submit(Member::LocalSearch, solver.colors());
+        }
+    }
+}
+
+QVector<int> PortfolioColoring::smallestLastOrder() const
+{
+    // Удаление вершин наименьшей текущей степени корзинами по степени
+    // (Батагель-Заверсник), раскраска - в обратном порядке удаления
+    const int vertexCount = m_adjacency.vertexCount();
+    QVector<int> degree(vertexCount);
+    int maxDegree = 0;
+    for (int v = 0; v < vertexCount; ++v) {
+        degree[v] = m_adjacency.degree(v);
+        maxDegree = std::max(maxDegree, degree[v]);
+    }
+
+    QVector<int> binStart(maxDegree + 1, 0);
+    for (int v = 0; v < vertexCount; ++v) {
+        binStart[degree[v]]++;
+    }
+    int start = 0;
+    for (int d = 0; d <= maxDegree; ++d) {
+        const int count = binStart[d];
+        binStart[d] = start;
+        start += count;
+    }
+
+    QVector<int> removal(vertexCount);
+    QVector<int> position(vertexCount);
+    for (int v = 0; v < vertexCount; ++v) {
+        position[v] = binStart[degree[v]]++;
+        removal[position[v]] = v;
+    }
+    for (int d = maxDegree; d > 0; --d) {
+        binStart[d] = binStart[d - 1];
+    }
+    binStart[0] = 0;
+
+    for (int i = 0; i < vertexCount; ++i) {
+        const int v = removal[i];
+        for (const int *n = m_adjacency.neighborsBegin(v); n != m_adjacency.neighborsEnd(v); ++n) {
+            const int u = *n;
+            if (degree[u] <= degree[v])
+                continue;
+
+            // u переходит в начало своей корзины, корзина сужается
+            const int first = binStart[degree[u]];
+            const int w = removal[first];
+            if (u != w) {
+                removal[position[u]] = w;
+                position[w] = position[u];
+                removal[first] = u;
+                position[u] = first;
+            }
+            binStart[degree[u]]++;
+            degree[u]--;
+        }
+    }
+
+    std::reverse(removal.begin(), removal.end());
+    return removal;
+}
+
+int PortfolioColoring::greedyCliqueSize() const
+{
+    const int vertexCount = m_adjacency.vertexCount();
+    if (vertexCount == 0)
+        return 0;
+
+    QVector<int> starts(vertexCount);
+    std::iota(starts.begin(), starts.end(), 0);
+    const int startCount = std::min(CLIQUE_STARTS, vertexCount);
+    std::partial_sort(starts.begin(), starts.begin() + startCount, starts.end(), [this](int a, int b) {
+        return m_adjacency.degree(a) > m_adjacency.degree(b);
+    });
+
+    // adjacentToClique[u] - число вершин клики, смежных с u
+    QVector<int> adjacentToClique(vertexCount, 0);
+    QVector<int> clique;
+    QVector<int> candidates;
+    int best = 1;
+    for (int s = 0; s < startCount; ++s) {
+        const int root = starts[s];
+        candidates = QVector<int>(m_adjacency.neighborsBegin(root), m_adjacency.neighborsEnd(root));
+        std::sort(candidates.begin(), candidates.end(), [this](int a, int b) {
+            return m_adjacency.degree(a) > m_adjacency.degree(b);
+        });
+
+        clique = { root };
+        for (const int *n = m_adjacency.neighborsBegin(root); n != m_adjacency.neighborsEnd(root); ++n) {
+            adjacentToClique[*n]++;
+        }
+        for (int u : std::as_const(candidates)) {
+            if (adjacentToClique[u] != clique.size())
+                continue;
+            clique.append(u);
+            for (const int *n = m_adjacency.neighborsBegin(u); n != m_adjacency.neighborsEnd(u); ++n) {
+                adjacentToClique[*n]++;
+            }
+        }
+        best = std::max(best, int(clique.size()));
+
+        for (int v : std::as_const(clique)) {
+            for (const int *n = m_adjacency.neighborsBegin(v); n != m_adjacency.neighborsEnd(v); ++n) {
+                adjacentToClique[*n] = 0;
+            }
+        }
+    }
+    return best;
+}
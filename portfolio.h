@@ -0,0 +1,89 @@
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include <QDeadlineTimer>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include "coloringengine.h"
+
+// Класс PortfolioColoring одновременно запускает несколько алгоритмов
+// раскраски на общих списках смежности (только чтение) и возвращает лучшую
+// правильную раскраску к сроку. Участники делят лучшую найденную верхнюю
+// границу числа цветов: жадные порядки и DSATUR прекращают работу, как
+// только превышают её, локальный поиск пытается обойтись на цвет меньше.
+// Гонка заканчивается досрочно, когда все участники завершились или
+// достигнута нижняя граница (размер найденной клики либо оптимум для
+// распознанного класса графа).
+class PortfolioColoring
+{
+public:
+    enum class Member {
+        Greedy,        // Первый свободный цвет в порядке вершин
+        LargestFirst,  // В порядке убывания степени
+        SmallestLast,  // В порядке, обратном удалению вершин наименьшей степени
+        Dsatur,        // Вершина с наибольшим числом разных цветов у соседей
+        Structured,    // Оптимально для двудольных и хордальных компонент
+        LocalSearch    // Tabu-поиск раскраски на цвет меньше лучшей (LayerBudgetSolver)
+    };
+
+    struct Result
+    {
+        QVector<int> colors;
+        int colorCount = 0;
+        Member winner = Member::Greedy;
+        bool optimal = false;        // Число цветов равно нижней границе
+        int lowerBound = 0;
+        int finishedMembers = 0;     // Участники, завершившиеся до срока
+        qint64 elapsedMs = 0;
+    };
+
+    explicit PortfolioColoring(const Adjacency &adjacency);
+
+    static QList<Member> defaultMembers();
+    static QString memberName(Member member);
+
+    void setMembers(const QList<Member> &members) { m_members = members; }
+    // Срок в миллисекундах от начала run()
+    void setDeadline(int milliseconds) { m_deadlineMs = milliseconds; }
+    // Внешняя отмена (из любого потока): гонка заканчивается, как по сроку
+    void setCancelCheck(const std::function<bool()> &cancelled) { m_cancelled = cancelled; }
+
+    // Результат есть всегда: если к сроку никто не успел, граф
+    // раскрашивается жадно без ограничения времени (линейно)
+    Result run();
+
+private:
+    const Adjacency &m_adjacency;
+    QList<Member> m_members;
+    int m_deadlineMs;
+    std::function<bool()> m_cancelled;
+
+    QDeadlineTimer m_deadline;
+    std::atomic<int> m_bestBound;
+    std::atomic<bool> m_stop;
+    int m_lowerBound;
+    QMutex m_mutex;
+    Result m_result;
+
+    bool shouldStop() const
+    {
+        return m_stop.load() || m_deadline.hasExpired() || (m_cancelled && m_cancelled());
+    }
+    // Принимает раскраску, если она правильная и лучше текущей
+    void submit(Member member, const QVector<int> &colors, bool optimal = false);
+
+    // false - участник прерван (срок или граница) и результата не дал
+    bool runMember(Member member);
+    bool colorInOrder(const QVector<int> &order, QVector<int> *colors) const;
+    bool colorDsatur(QVector<int> *colors) const;
+    void runLocalSearch();
+
+    QVector<int> smallestLastOrder() const;
+    int greedyCliqueSize() const;
+};
+
+#endif // PORTFOLIO_H
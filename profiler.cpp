@@ -0,0 +1,146 @@
+#include "profiler.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+#include <cstring>
+
+// Ограничение числа событий трассы; сводка по фазам ведётся всегда
+constexpr int MAX_TRACE_EVENTS = 1000000;
+
+std::atomic<bool> Profiler::s_enabled(false);
+
+Profiler::Profiler()
+    : m_droppedEvents(0)
+{
+    m_clock.start();
+}
+
+Profiler &Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::record(const char *name, qint64 startNs, qint64 durationNs)
+{
+    QMutexLocker locker(&m_mutex);
+    addToStats(name, durationNs);
+
+    if (m_events.size() >= MAX_TRACE_EVENTS) {
+        m_droppedEvents++;
+        return;
+    }
+
+    Event event;
+    event.name = name;
+    event.startNs = startNs;
+    event.durationNs = durationNs;
+    event.threadId = quint64(quintptr(QThread::currentThreadId()));
+    m_events.append(event);
+}
+
+void Profiler::accumulate(const char *name, qint64 durationNs)
+{
+    QMutexLocker locker(&m_mutex);
+    addToStats(name, durationNs);
+}
+
+void Profiler::addToStats(const char *name, qint64 durationNs)
+{
+    // Имена - строковые литералы, ключ ссылается на них без копирования
+    PhaseStats &stats = m_stats[QByteArray::fromRawData(name, int(std::strlen(name)))];
+    if (stats.count == 0) {
+        stats.name = QString::fromUtf8(name);
+    }
+    stats.count++;
+    stats.totalNs += durationNs;
+    stats.maxNs = std::max(stats.maxNs, durationNs);
+}
+
+QVector<Profiler::Event> Profiler::events() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_events;
+}
+
+QVector<Profiler::PhaseStats> Profiler::phaseStats() const
+{
+    QVector<PhaseStats> result;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (const PhaseStats &stats : m_stats) {
+            result.append(stats);
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const PhaseStats &a, const PhaseStats &b) {
+        return a.name < b.name;
+    });
+    return result;
+}
+
+void Profiler::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_events.clear();
+    m_stats.clear();
+    m_droppedEvents = 0;
+}
+
+bool Profiler::exportChromeTrace(const QString &filePath, QString *errorMessage) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+
+    const QVector<Event> traceEvents = events();
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    // Пишем вручную: событий может быть очень много, DOM не нужен
+    QByteArray chunk;
+    chunk.reserve(1 << 16);
+    chunk += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    for (int i = 0; i < traceEvents.size(); ++i) {
+        const Event &event = traceEvents[i];
+        if (i > 0) {
+            chunk += ',';
+        }
+        chunk += "\n{\"name\":\"";
+        chunk += event.name;
+        chunk += "\",\"cat\":\"phase\",\"ph\":\"X\",\"ts\":";
+        chunk += QByteArray::number(event.startNs / 1000.0, 'f', 3);
+        chunk += ",\"dur\":";
+        chunk += QByteArray::number(event.durationNs / 1000.0, 'f', 3);
+        chunk += ",\"pid\":";
+        chunk += QByteArray::number(pid);
+        chunk += ",\"tid\":";
+        chunk += QByteArray::number(event.threadId);
+        chunk += '}';
+
+        if (chunk.size() >= (1 << 16)) {
+            file.write(chunk);
+            chunk.resize(0);
+        }
+    }
+
+    chunk += "\n]}\n";
+    if (file.write(chunk) != chunk.size()) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
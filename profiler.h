@@ -0,0 +1,113 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <atomic>
+
+// Класс Profiler собирает длительность фаз (загрузка, разбор, построение,
+// раскраска, применение, отрисовка). Пока профилирование выключено,
+// каждая точка замера стоит одной атомарной загрузки флага.
+class Profiler
+{
+public:
+    // Отдельный замер для экспорта в формате Chrome trace
+    struct Event
+    {
+        const char *name;
+        qint64 startNs;
+        qint64 durationNs;
+        quint64 threadId;
+    };
+
+    // Сводка по фазе для панели статистики
+    struct PhaseStats
+    {
+        QString name;
+        qint64 count = 0;
+        qint64 totalNs = 0;
+        qint64 maxNs = 0;
+    };
+
+    static Profiler &instance();
+
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled);
+
+    qint64 nowNs() const { return m_clock.nsecsElapsed(); }
+
+    // Замер с сохранением события для трассы
+    void record(const char *name, qint64 startNs, qint64 durationNs);
+    // Замер только в сводку: для точек, вызываемых на каждый элемент графа
+    void accumulate(const char *name, qint64 durationNs);
+
+    QVector<Event> events() const;
+    QVector<PhaseStats> phaseStats() const;
+    void clear();
+
+    // Экспорт в формате Chrome trace-event JSON (chrome://tracing, Perfetto)
+    bool exportChromeTrace(const QString &filePath, QString *errorMessage = nullptr) const;
+
+private:
+    Profiler();
+
+    static std::atomic<bool> s_enabled;
+
+    QElapsedTimer m_clock;
+    mutable QMutex m_mutex;
+    QVector<Event> m_events;
+    // По тексту имени: одинаковые литералы из разных единиц трансляции
+    // не обязаны совпадать по адресу
+    QHash<QByteArray, PhaseStats> m_stats;
+    qint64 m_droppedEvents;
+
+    void addToStats(const char *name, qint64 durationNs);
+};
+
+// Замер длительности области видимости
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char *name, bool aggregateOnly = false)
+        : m_name(Profiler::isEnabled() ? name : nullptr), m_startNs(0), m_aggregateOnly(aggregateOnly)
+    {
+        if (m_name) {
+            m_startNs = Profiler::instance().nowNs();
+        }
+    }
+
+    ~ProfileScope()
+    {
+        if (m_name) {
+            Profiler &profiler = Profiler::instance();
+            qint64 durationNs = profiler.nowNs() - m_startNs;
+            if (m_aggregateOnly) {
+                profiler.accumulate(m_name, durationNs);
+            } else {
+                profiler.record(m_name, m_startNs, durationNs);
+            }
+        }
+    }
+
+private:
+    const char *m_name;
+    qint64 m_startNs;
+    bool m_aggregateOnly;
+
+    Q_DISABLE_COPY(ProfileScope)
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+// Замер фазы: попадает и в сводку, и в трассу
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+// Замер часто вызываемой точки: только в сводку
+#define PROFILE_SCOPE_AGGREGATE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
+
+#endif // PROFILER_H
@@ -0,0 +1,144 @@
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+#include <QtGlobal>
+#include <QList>
+#include <QVector>
+
+// Дескриптор элемента в SlotMap: номер слота и поколение.
+// Поколение увеличивается при каждом удалении, поэтому устаревший
+// дескриптор никогда не указывает на чужой элемент.
+struct SlotHandle
+{
+    quint32 index = 0xFFFFFFFFu;
+    quint32 generation = 0;
+
+    bool isNull() const { return index == 0xFFFFFFFFu; }
+
+    bool operator==(const SlotHandle &other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+    bool operator!=(const SlotHandle &other) const { return !(*this == other); }
+};
+
+// Класс SlotMap хранит элементы в плотном массиве и выдаёт стабильные
+// дескрипторы. Вставка, поиск и удаление (swap-and-pop) выполняются за O(1),
+// порядок элементов в плотном массиве при удалении не сохраняется.
+template <typename T>
+class SlotMap
+{
+public:
+    SlotHandle insert(const T &value)
+    {
+        quint32 slotIndex;
+        if (!m_freeSlots.isEmpty()) {
+            slotIndex = m_freeSlots.takeLast();
+        } else {
+            slotIndex = quint32(m_slots.size());
+            m_slots.append(Slot());
+        }
+
+        Slot &slot = m_slots[int(slotIndex)];
+        slot.denseIndex = m_values.size();
+        m_values.append(value);
+        m_denseToSlot.append(slotIndex);
+
+        SlotHandle handle;
+        handle.index = slotIndex;
+        handle.generation = slot.generation;
+        return handle;
+    }
+
+    bool remove(const SlotHandle &handle)
+    {
+        if (!contains(handle))
+            return false;
+
+        Slot &slot = m_slots[int(handle.index)];
+        const int denseIndex = slot.denseIndex;
+        const int lastIndex = m_values.size() - 1;
+
+        // Переносим последний элемент на место удаляемого
+        if (denseIndex != lastIndex) {
+            m_values[denseIndex] = m_values[lastIndex];
+            m_denseToSlot[denseIndex] = m_denseToSlot[lastIndex];
+            m_slots[int(m_denseToSlot[denseIndex])].denseIndex = denseIndex;
+        }
+        m_values.removeLast();
+        m_denseToSlot.removeLast();
+
+        slot.denseIndex = -1;
+        slot.generation++;
+        m_freeSlots.append(handle.index);
+        return true;
+    }
+
+    bool contains(const SlotHandle &handle) const
+    {
+        if (handle.index >= quint32(m_slots.size()))
+            return false;
+        const Slot &slot = m_slots[int(handle.index)];
+        return slot.generation == handle.generation && slot.denseIndex >= 0;
+    }
+
+    // Возвращает элемент по дескриптору или defaultValue для устаревшего дескриптора
+    T value(const SlotHandle &handle, const T &defaultValue = T()) const
+    {
+        return contains(handle) ? m_values[m_slots[int(handle.index)].denseIndex] : defaultValue;
+    }
+
+    // Позиция элемента в плотном массиве или -1
+    int indexOf(const SlotHandle &handle) const
+    {
+        return contains(handle) ? m_slots[int(handle.index)].denseIndex : -1;
+    }
+
+    SlotHandle handleAt(int denseIndex) const
+    {
+        SlotHandle handle;
+        handle.index = m_denseToSlot[denseIndex];
+        handle.generation = m_slots[int(handle.index)].generation;
+        return handle;
+    }
+
+    const T &at(int denseIndex) const { return m_values[denseIndex]; }
+    const QList<T> &values() const { return m_values; }
+
+    int size() const { return m_values.size(); }
+    bool isEmpty() const { return m_values.isEmpty(); }
+
+    void reserve(int size)
+    {
+        m_values.reserve(size);
+        m_denseToSlot.reserve(size);
+        m_slots.reserve(size);
+    }
+
+    // Очистка с сохранением поколений, чтобы старые дескрипторы оставались недействительными
+    void clear()
+    {
+        for (int i = 0; i < m_values.size(); ++i) {
+            Slot &slot = m_slots[int(m_denseToSlot[i])];
+            slot.denseIndex = -1;
+            slot.generation++;
+            m_freeSlots.append(m_denseToSlot[i]);
+        }
+        m_values.clear();
+        m_denseToSlot.clear();
+    }
+
+private:
+    struct Slot
+    {
+        int denseIndex = -1;
+        quint32 generation = 0;
+    };
+
+    QList<T> m_values;
+    QVector<quint32> m_denseToSlot;
+    QVector<Slot> m_slots;
+    QVector<quint32> m_freeSlots;
+};
+
+#endif // SLOTMAP_H
@@ -0,0 +1,183 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <QtGlobal>
+#include <QHash>
+#include <QRectF>
+#include <QSet>
+#include <QVector>
+#include <cmath>
+
+// Класс SpatialGrid - равномерная сетка над плоскостью сцены для поиска
+// элементов, пересекающих прямоугольник. Элемент записывается во все
+// ячейки своих границ; элементы, занимающие слишком много ячеек (длинные
+// рёбра), хранятся отдельным списком и проверяются при каждом запросе.
+template <typename T>
+class SpatialGrid
+{
+public:
+    explicit SpatialGrid(qreal cellSize = 256.0) : m_cellSize(cellSize) {}
+
+    void insert(const T &item, const QRectF &bounds)
+    {
+        Entry entry;
+        entry.bounds = bounds;
+        cellRange(bounds, &entry.left, &entry.top, &entry.right, &entry.bottom);
+        entry.overflow = qint64(entry.right - entry.left + 1) * (entry.bottom - entry.top + 1) > MAX_CELLS_PER_ITEM;
+
+        if (entry.overflow) {
+            m_overflow.insert(item);
+        } else {
+            for (int x = entry.left; x <= entry.right; ++x) {
+                for (int y = entry.top; y <= entry.bottom; ++y) {
+                    m_cells[cellKey(x, y)].append(item);
+                }
+            }
+        }
+        m_entries.insert(item, entry);
+    }
+
+    void remove(const T &item)
+    {
+        auto it = m_entries.find(item);
+        if (it == m_entries.end())
+            return;
+
+        const Entry &entry = it.value();
+        if (entry.overflow) {
+            m_overflow.remove(item);
+        } else {
+            for (int x = entry.left; x <= entry.right; ++x) {
+                for (int y = entry.top; y <= entry.bottom; ++y) {
+                    removeFromCell(cellKey(x, y), item);
+                }
+            }
+        }
+        m_entries.erase(it);
+    }
+
+    // Перемещение элемента; если набор ячеек не изменился, обновляются только границы
+    void update(const T &item, const QRectF &bounds)
+    {
+        auto it = m_entries.find(item);
+        if (it != m_entries.end()) {
+            int left, top, right, bottom;
+            cellRange(bounds, &left, &top, &right, &bottom);
+            Entry &entry = it.value();
+            if (!entry.overflow && left == entry.left && top == entry.top
+                && right == entry.right && bottom == entry.bottom) {
+                entry.bounds = bounds;
+                return;
+            }
+            remove(item);
+        }
+        insert(item, bounds);
+    }
+
+    bool contains(const T &item) const { return m_entries.contains(item); }
+
+    // Элементы, границы которых пересекают rect
+    QSet<T> query(const QRectF &rect) const
+    {
+        QSet<T> result;
+        int left, top, right, bottom;
+        cellRange(rect, &left, &top, &right, &bottom);
+
+        const qint64 rangeCells = qint64(right - left + 1) * (bottom - top + 1);
+        if (rangeCells <= m_cells.size()) {
+            for (int x = left; x <= right; ++x) {
+                for (int y = top; y <= bottom; ++y) {
+                    auto cell = m_cells.constFind(cellKey(x, y));
+                    if (cell != m_cells.constEnd()) {
+                        collect(cell.value(), rect, &result);
+                    }
+                }
+            }
+        } else {
+            // Запрос шире занятой части сетки: обходятся непустые ячейки
+            for (auto cell = m_cells.constBegin(); cell != m_cells.constEnd(); ++cell) {
+                const int x = int(qint32(quint32(cell.key() >> 32)));
+                const int y = int(qint32(quint32(cell.key())));
+                if (x >= left && x <= right && y >= top && y <= bottom) {
+                    collect(cell.value(), rect, &result);
+                }
+            }
+        }
+
+        for (const T &item : m_overflow) {
+            if (m_entries.value(item).bounds.intersects(rect)) {
+                result.insert(item);
+            }
+        }
+        return result;
+    }
+
+    void clear()
+    {
+        m_cells.clear();
+        m_entries.clear();
+        m_overflow.clear();
+    }
+
+    int size() const { return m_entries.size(); }
+
+private:
+    // Больше стольких ячеек элемент не раскладывается по сетке
+    static constexpr qint64 MAX_CELLS_PER_ITEM = 64;
+
+    struct Entry
+    {
+        QRectF bounds;
+        int left = 0;
+        int top = 0;
+        int right = 0;
+        int bottom = 0;
+        bool overflow = false;
+    };
+
+    qreal m_cellSize;
+    QHash<quint64, QVector<T>> m_cells;
+    QHash<T, Entry> m_entries;
+    QSet<T> m_overflow;
+
+    static quint64 cellKey(int x, int y)
+    {
+        return (quint64(quint32(x)) << 32) | quint32(y);
+    }
+
+    void cellRange(const QRectF &rect, int *left, int *top, int *right, int *bottom) const
+    {
+        *left = int(std::floor(rect.left() / m_cellSize));
+        *top = int(std::floor(rect.top() / m_cellSize));
+        *right = int(std::floor(rect.right() / m_cellSize));
+        *bottom = int(std::floor(rect.bottom() / m_cellSize));
+    }
+
+    void collect(const QVector<T> &cell, const QRectF &rect, QSet<T> *result) const
+    {
+        for (const T &item : cell) {
+            // Элемент мог попасть в ячейку только краем границ
+            if (m_entries.value(item).bounds.intersects(rect)) {
+                result->insert(item);
+            }
+        }
+    }
+
+    void removeFromCell(quint64 key, const T &item)
+    {
+        auto cell = m_cells.find(key);
+        if (cell == m_cells.end())
+            return;
+        QVector<T> &items = cell.value();
+        const int index = items.indexOf(item);
+        if (index >= 0) {
+            items[index] = items.last();
+            items.removeLast();
+        }
+        if (items.isEmpty()) {
+            m_cells.erase(cell);
+        }
+    }
+};
+
+#endif // SPATIALGRID_H
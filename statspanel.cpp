@@ -0,0 +1,198 @@
+#include "statspanel.h"
+#include "profiler.h"
+#include "memorystats.h"
+#include "graphwidget.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QTabWidget>
+
+// Период обновления таблицы, пока панель видима
+constexpr int REFRESH_INTERVAL_MS = 500;
+
+StatsPanel::StatsPanel(QWidget *parent)
+    : QDockWidget(tr("Statistics"), parent)
+    , m_graphWidget(nullptr)
+{
+    setObjectName("statsPanel");
+
+    QWidget *content = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout(content);
+
+    // Управление профилированием
+    QHBoxLayout *controls = new QHBoxLayout();
+    m_enableCheck = new QCheckBox(tr("Profiling"), content);
+    m_enableCheck->setChecked(Profiler::isEnabled());
+    m_clearButton = new QPushButton(tr("Clear"), content);
+    m_exportButton = new QPushButton(tr("Export Trace..."), content);
+    controls->addWidget(m_enableCheck);
+    controls->addStretch();
+    controls->addWidget(m_clearButton);
+    controls->addWidget(m_exportButton);
+    layout->addLayout(controls);
+
+    QTabWidget *tabs = new QTabWidget(content);
+    layout->addWidget(tabs);
+
+    // Таблица фаз
+    m_phaseTable = createTable({ tr("Phase"), tr("Count"), tr("Total, ms"),
+                                 tr("Average, ms"), tr("Max, ms") }, tabs);
+    tabs->addTab(m_phaseTable, tr("Timing"));
+
+    // Память по подсистемам и пики операций
+    QWidget *memoryPage = new QWidget(tabs);
+    QVBoxLayout *memoryLayout = new QVBoxLayout(memoryPage);
+    memoryLayout->setContentsMargins(0, 0, 0, 0);
+    m_memoryTable = createTable({ tr("Subsystem"), tr("Current"), tr("Peak") }, memoryPage);
+    m_operationTable = createTable({ tr("Operation"), tr("Runs"), tr("Last peak"),
+                                     tr("Max peak"), tr("RSS delta") }, memoryPage);
+    memoryLayout->addWidget(m_memoryTable);
+    memoryLayout->addWidget(m_operationTable);
+    tabs->addTab(memoryPage, tr("Memory"));
+
+    setWidget(content);
+
+    connect(m_enableCheck, &QCheckBox::toggled, this, &StatsPanel::handleProfilingToggled);
+    connect(m_clearButton, &QPushButton::clicked, this, &StatsPanel::handleClearClicked);
+    connect(m_exportButton, &QPushButton::clicked, this, &StatsPanel::handleExportClicked);
+
+    m_refreshTimer.setInterval(REFRESH_INTERVAL_MS);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &StatsPanel::refresh);
+}
+
+QTableWidget *StatsPanel::createTable(const QStringList &headers, QWidget *parent)
+{
+    QTableWidget *table = new QTableWidget(0, headers.size(), parent);
+    table->setHorizontalHeaderLabels(headers);
+    table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    table->verticalHeader()->setVisible(false);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    return table;
+}
+
+void StatsPanel::setRow(QTableWidget *table, int row, const QStringList &cells)
+{
+    for (int column = 0; column < cells.size(); ++column) {
+        QTableWidgetItem *item = table->item(row, column);
+        if (!item) {
+            item = new QTableWidgetItem();
+            if (column > 0) {
+                item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            }
+            table->setItem(row, column, item);
+        }
+        item->setText(cells[column]);
+    }
+}
+
+void StatsPanel::refresh()
+{
+    refreshPhases();
+    refreshMemory();
+}
+
+void StatsPanel::refreshPhases()
+{
+    const QVector<Profiler::PhaseStats> stats = Profiler::instance().phaseStats();
+
+    m_phaseTable->setRowCount(stats.size());
+    for (int row = 0; row < stats.size(); ++row) {
+        const Profiler::PhaseStats &phase = stats[row];
+        const double totalMs = phase.totalNs / 1e6;
+        const double averageMs = phase.count > 0 ? totalMs / phase.count : 0;
+
+        setRow(m_phaseTable, row, {
+            phase.name,
+            QString::number(phase.count),
+            QString::number(totalMs, 'f', 3),
+            QString::number(averageMs, 'f', 3),
+            QString::number(phase.maxNs / 1e6, 'f', 3)
+        });
+    }
+}
+
+void StatsPanel::refreshMemory()
+{
+    using MemoryStats::formatBytes;
+    MemoryTracker &tracker = MemoryTracker::instance();
+
+    // Граф и сцена оцениваются по числу элементов, пик для них не ведётся
+    qint64 graphBytes = 0;
+    qint64 sceneBytes = 0;
+    if (m_graphWidget) {
+        graphBytes = MemoryStats::estimateGraphBytes(m_graphWidget->graph());
+        sceneBytes = MemoryStats::estimateSceneBytes(m_graphWidget->vertexItemCount(),
+                                                     m_graphWidget->edgeItemCount());
+    }
+
+    QVector<QStringList> rows;
+    rows.append({ tr("Graph model"), formatBytes(graphBytes), QString() });
+    rows.append({ tr("Scene items"), formatBytes(sceneBytes), QString() });
+    for (int i = 0; i < MemoryTracker::CategoryCount; ++i) {
+        const MemoryTracker::Category category = MemoryTracker::Category(i);
+        rows.append({ MemoryTracker::categoryName(category),
+                      formatBytes(tracker.current(category)),
+                      formatBytes(tracker.peak(category)) });
+    }
+    rows.append({ tr("Process (RSS)"), formatBytes(MemoryStats::residentBytes()),
+                  formatBytes(MemoryStats::peakResidentBytes()) });
+
+    m_memoryTable->setRowCount(rows.size());
+    for (int row = 0; row < rows.size(); ++row) {
+        setRow(m_memoryTable, row, rows[row]);
+    }
+
+    const QVector<MemoryTracker::OperationStats> operations = tracker.operationStats();
+    m_operationTable->setRowCount(operations.size());
+    for (int row = 0; row < operations.size(); ++row) {
+        const MemoryTracker::OperationStats &operation = operations[row];
+        setRow(m_operationTable, row, {
+            operation.name,
+            QString::number(operation.runs),
+            formatBytes(operation.lastPeakBytes),
+            formatBytes(operation.maxPeakBytes),
+            formatBytes(operation.lastResidentDelta)
+        });
+    }
+}
+
+void StatsPanel::handleProfilingToggled(bool enabled)
+{
+    Profiler::instance().setEnabled(enabled);
+}
+
+void StatsPanel::handleClearClicked()
+{
+    Profiler::instance().clear();
+    MemoryTracker::instance().clearOperations();
+    refresh();
+}
+
+void StatsPanel::handleExportClicked()
+{
+    QString filePath = QFileDialog::getSaveFileName(this, tr("Export Trace"), "trace.json",
+                                                    tr("Trace Files (*.json);;All Files (*)"));
+    if (filePath.isEmpty())
+        return;
+
+    QString errorMessage;
+    if (!Profiler::instance().exportChromeTrace(filePath, &errorMessage)) {
+        QMessageBox::warning(this, tr("Error"),
+                             tr("Cannot export trace to %1:\n%2.").arg(filePath, errorMessage));
+    }
+}
+
+void StatsPanel::showEvent(QShowEvent *event)
+{
+    QDockWidget::showEvent(event);
+    refresh();
+    m_refreshTimer.start();
+}
+
+void StatsPanel::hideEvent(QHideEvent *event)
+{
+    m_refreshTimer.stop();
+    QDockWidget::hideEvent(event);
+}
@@ -0,0 +1,51 @@
+#ifndef STATSPANEL_H
+#define STATSPANEL_H
+
+#include <QDockWidget>
+#include <QTableWidget>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QTimer>
+
+class GraphWidget;
+
+// Панель статистики: сводка замеров по фазам, экспорт трассы
+// и потребление памяти по подсистемам и операциям
+class StatsPanel : public QDockWidget
+{
+    Q_OBJECT
+public:
+    explicit StatsPanel(QWidget *parent = nullptr);
+
+    // Источник данных для оценки памяти графа и сцены
+    void setGraphWidget(GraphWidget *graphWidget) { m_graphWidget = graphWidget; }
+
+public slots:
+    void refresh();
+
+private slots:
+    void handleProfilingToggled(bool enabled);
+    void handleClearClicked();
+    void handleExportClicked();
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    GraphWidget *m_graphWidget;
+    QTableWidget *m_phaseTable;
+    QTableWidget *m_memoryTable;
+    QTableWidget *m_operationTable;
+    QCheckBox *m_enableCheck;
+    QPushButton *m_clearButton;
+    QPushButton *m_exportButton;
+    QTimer m_refreshTimer;
+
+    void refreshPhases();
+    void refreshMemory();
+    static QTableWidget *createTable(const QStringList &headers, QWidget *parent);
+    static void setRow(QTableWidget *table, int row, const QStringList &cells);
+};
+
+#endif // STATSPANEL_H
@@ -1,16 +1,33 @@
 #include "vertex.h"
 #include "edge.h"
+#include "graph.h"
 
 Vertex::Vertex(const QPointF &position, QObject *parent)
-    : QObject(parent), m_position(position), m_color(Qt::white), m_colorIndex(-1)
+    : QObject(parent), m_position(position), m_color(Qt::white), m_colorIndex(-1),
+    m_locked(false), m_id(-1), m_graph(nullptr)
 {
 }
 
 void Vertex::setPosition(const QPointF &position)
 {
     if (m_position != position) {
+        QPointF oldPosition = m_position;
         m_position = position;
         emit positionChanged();
+        if (m_graph) {
+            m_graph->notifyVertexMoved(this, oldPosition);
+        }
+    }
+}
+
+void Vertex::setColorIndex(int index)
+{
+    if (m_colorIndex != index) {
+        int oldIndex = m_colorIndex;
+        m_colorIndex = index;
+        if (m_graph) {
+            m_graph->notifyVertexColorIndexChanged(this, oldIndex);
+        }
     }
 }
 
@@ -24,25 +41,35 @@ void Vertex::setColor(const QColor &color)
 
 void Vertex::addEdge(Edge *edge)
 {
-    if (!m_edges.contains(edge)) {
+    int &slot = edge->incidenceSlot(this);
+    if (slot < 0) {
+        slot = m_edges.size();
         m_edges.append(edge);
     }
 }
 
 void Vertex::removeEdge(Edge *edge)
 {
-    m_edges.removeOne(edge);
+    int &slot = edge->incidenceSlot(this);
+    if (slot < 0 || slot >= m_edges.size() || m_edges[slot] != edge)
+        return;
+
+    // Переносим последнее ребро на место удаляемого (swap-and-pop)
+    Edge *last = m_edges.last();
+    if (last != edge) {
+        m_edges[slot] = last;
+        last->incidenceSlot(this) = slot;
+    }
+    m_edges.removeLast();
+    slot = -1;
 }
 
-QList<Vertex*> Vertex::neighbors() const
+QList<Vertex*> Vertex::NeighborRange::toList() const
 {
     QList<Vertex*> result;
-    for (Edge *edge : m_edges) {
-        if (edge->sourceVertex() == this) {
-            result.append(edge->destVertex());
-        } else {
-            result.append(edge->sourceVertex());
-        }
+    result.reserve(size());
+    for (Vertex *neighbor : *this) {
+        result.append(neighbor);
     }
     return result;
 }
@@ -5,8 +5,10 @@
 #include <QPointF>
 #include <QColor>
 #include <QList>
+#include "slotmap.h"
+#include "edge.h"
 
-class Edge;
+class Graph;
 
 // Класс Vertex представляет вершину графа
 class Vertex : public QObject
@@ -22,14 +24,60 @@ public:
     void setColor(const QColor &color);
 
     int colorIndex() const { return m_colorIndex; }
-    void setColorIndex(int index) { m_colorIndex = index; }
+    void setColorIndex(int index);
 
-    QList<Edge*> edges() const { return m_edges; }
+    // Вершина закреплена за слоем: раскраска с бюджетом слоёв не меняет её цвет
+    bool isLocked() const { return m_locked; }
+
+    // Инцидентные рёбра без копирования. Список меняется при добавлении и
+    // удалении рёбер вершины, поэтому обходить его при этом нельзя.
+    const QList<Edge*> &edges() const { return m_edges; }
+    int degree() const { return m_edges.size(); }
     void addEdge(Edge *edge);
     void removeEdge(Edge *edge);
 
-    // Получить соседние вершины
-    QList<Vertex*> neighbors() const;
+    // Соседние вершины без выделения памяти: итератор идёт по списку
+    // инцидентных рёбер и возвращает второй конец ребра
+    class NeighborIterator
+    {
+    public:
+        NeighborIterator(const Vertex *vertex, Edge *const *edge) : m_vertex(vertex), m_edge(edge) {}
+        Vertex *operator*() const { return (*m_edge)->otherVertex(m_vertex); }
+        NeighborIterator &operator++() { ++m_edge; return *this; }
+        bool operator==(const NeighborIterator &other) const { return m_edge == other.m_edge; }
+        bool operator!=(const NeighborIterator &other) const { return m_edge != other.m_edge; }
+
+    private:
+        const Vertex *m_vertex;
+        Edge *const *m_edge;
+    };
+
+    class NeighborRange
+    {
+    public:
+        explicit NeighborRange(const Vertex *vertex) : m_vertex(vertex) {}
+        NeighborIterator begin() const { return NeighborIterator(m_vertex, m_vertex->m_edges.constData()); }
+        NeighborIterator end() const
+        {
+            return NeighborIterator(m_vertex, m_vertex->m_edges.constData() + m_vertex->m_edges.size());
+        }
+        int size() const { return m_vertex->m_edges.size(); }
+        bool isEmpty() const { return m_vertex->m_edges.isEmpty(); }
+        // Копия списком, если он нужен дольше обхода
+        QList<Vertex*> toList() const;
+
+    private:
+        const Vertex *m_vertex;
+    };
+
+    // for (Vertex *neighbor : vertex->neighbors())
+    NeighborRange neighbors() const { return NeighborRange(this); }
+
+    // Дескриптор вершины в хранилище графа
+    SlotHandle handle() const { return m_handle; }
+
+    // Постоянный идентификатор вершины в пределах графа
+    int id() const { return m_id; }
 
 signals:
     void positionChanged();
@@ -39,7 +87,13 @@ private:
     QPointF m_position;
     QColor m_color;
     int m_colorIndex;
+    bool m_locked;
     QList<Edge*> m_edges;
+    SlotHandle m_handle;
+    int m_id;
+    Graph *m_graph;
+
+    friend class Graph;
 };
 
 #endif // VERTEX_H